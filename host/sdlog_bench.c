@@ -0,0 +1,455 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/twai.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include "board.h"
+#include "sdlog_header.h"
+#include "sdlog_service.h"
+#include "sdlog_service_private.h"
+#include "sdlog_conv.h"
+#include "sdlog_pool.h"
+
+// Replay benchmark of the sdlog core on host
+// 1. build a workload, either synthetic CAN frames, synthetic console messages or the records of a recorded log.bin
+// 2. push it through sdlog_write() (or sdlog_write_batch() with -b) -> sdlog_task -> log.bin (write path)
+//    the console messages are formatted by the producer as log_hub does, or deferred (sdlog_write_fmt()) with -d
+// 3. run the exporter on the produced log.bin (convert path)
+// Every iteration reports MB/s, records/s and the allocations made by the sdlog code
+// With -x, the SD card is pulled out for the middle third of the workload (shim/shim_sdcard.c), the records go to the
+// spill buffer until sdlog_task remounts the card. The remount waits SDLOG_REMOUNT_MS, the records beyond the spill
+// buffer meanwhile and the FILE buffer of the broken file are reported apart (drop), "write" counts the ones in the
+// log files, all the files of the session
+
+extern esp_err_t sdlog_service_init(void);
+extern esp_err_t sdlog_service_scan(void);
+extern uint32_t sdlog_syscfg(const char *section, const char *key, const char *value);
+
+// ----------
+// Workload
+// ----------
+typedef struct bench_rec_s {
+    uint8_t type_data;
+    uint32_t len;
+    const void *payload;
+} bench_rec_t;
+
+enum {
+    BENCH_TEXT_OFF = 0, // replay the records
+    BENCH_TEXT_FORMATTED,
+    BENCH_TEXT_DEFERRED,
+};
+
+typedef struct bench_workload_s {
+    uint32_t source;
+    uint32_t text; // BENCH_TEXT_xxx, synthetic console messages instead of records
+    uint32_t num;
+    bench_rec_t *rec;
+    void *blob; // storage of the payloads
+} bench_workload_t;
+
+static void bench_workload_synthetic(bench_workload_t *p_wl, uint32_t num)
+{
+    twai_message_t *p_msg = calloc(num, sizeof(twai_message_t));
+    p_wl->rec             = calloc(num, sizeof(bench_rec_t));
+    p_wl->blob            = p_msg;
+    p_wl->source          = SDLOG_SOURCE_CAN;
+    p_wl->num             = num;
+
+    // 64 IDs, mixed DLC, counter-like payload, that's close to a body CAN bus
+    for (uint32_t i = 0; i < num; i++) {
+        p_msg[i].identifier       = 0x100 + (i * 7) % 64;
+        p_msg[i].data_length_code = (i % 5 == 0) ? 4 : 8;
+        for (uint32_t j = 0; j < p_msg[i].data_length_code; j++) {
+            p_msg[i].data[j] = (uint8_t)(i >> (j % 4 * 8)) ^ (uint8_t)j;
+        }
+        p_wl->rec[i] = (bench_rec_t){.type_data = 0, .len = sizeof(twai_message_t), .payload = &p_msg[i]};
+    }
+}
+
+static void bench_workload_text(bench_workload_t *p_wl, uint32_t num, uint32_t deferred)
+{
+    p_wl->source = SDLOG_SOURCE_CONSOLE;
+    p_wl->text   = deferred ? BENCH_TEXT_DEFERRED : BENCH_TEXT_FORMATTED;
+    p_wl->num    = num;
+}
+
+static int bench_workload_recorded(bench_workload_t *p_wl, const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "can't open %s\n", path);
+        return -1;
+    }
+    fseek(fp, 0, SEEK_END);
+    long file_sz = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    uint8_t *p_file = malloc(file_sz);
+    if (p_file == NULL || file_sz < (long)sizeof(sdlog_header_t) || fread(p_file, 1, file_sz, fp) != (size_t)file_sz) {
+        fprintf(stderr, "can't read %s\n", path);
+        fclose(fp);
+        free(p_file);
+        return -1;
+    }
+    fclose(fp);
+
+    sdlog_header_t *p_header = (sdlog_header_t *)p_file;
+    if (strcmp(p_header->sys.magic, "QQMLAB")) {
+        fprintf(stderr, "%s is not a QQMLAB log\n", path);
+        free(p_file);
+        return -1;
+    }
+    p_wl->source = (p_header->sys.fmt == SDLOG_FMT_CAN) ? SDLOG_SOURCE_CAN : SDLOG_SOURCE_CONSOLE;
+    p_wl->blob   = p_file;
+
+    // the worst case record is a 16-byte header with empty payload
+    uint32_t max_rec = (file_sz - sizeof(sdlog_header_t)) / sizeof(sdlog_data_t);
+    p_wl->rec        = calloc(max_rec ? max_rec : 1, sizeof(bench_rec_t));
+    p_wl->num        = 0;
+
+    long pos = p_header->sys.offset_data;
+    while (pos + (long)sizeof(sdlog_data_t) <= file_sz) {
+        sdlog_data_t *p_data = (sdlog_data_t *)(p_file + pos);
+        long rec_sz          = sizeof(sdlog_data_t) + (p_data->payload_len + 7) / 8 * 8;
+        if (p_data->magic != 0xA5 || pos + rec_sz > file_sz) {
+            break; // truncated tail or corrupted, replay what we have
+        }
+        p_wl->rec[p_wl->num++] = (bench_rec_t){
+            .type_data = p_data->type_data,
+            .len       = p_data->payload_len,
+            .payload   = p_data + 1,
+        };
+        pos += rec_sz;
+    }
+    return 0;
+}
+
+// ----------
+// Benchmark body
+// ----------
+static void bench_wait_ready(uint32_t source, uint32_t ready)
+{
+    while (sdlog_source_ready(source) != ready) {
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+}
+
+static uint64_t bench_file_size(const char *path)
+{
+    struct stat st;
+    return (stat(path, &st) == 0) ? (uint64_t)st.st_size : 0;
+}
+
+// records in a log.bin, the conversion of a -x run only reads the file after the remount
+static uint32_t bench_file_records(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    sdlog_header_t header;
+    sdlog_data_t data;
+    uint32_t num = 0;
+    if (fp == NULL) {
+        return 0;
+    }
+    fseek(fp, 0, SEEK_END);
+    long file_sz = ftell(fp);
+    rewind(fp);
+    if (fread(&header, sizeof(header), 1, fp) == 1 && fseek(fp, header.sys.offset_data, SEEK_SET) == 0) {
+        long pos = header.sys.offset_data;
+        while (fread(&data, sizeof(data), 1, fp) == 1 && data.magic == 0xA5) {
+            pos += sizeof(data) + (data.payload_len + 7) / 8 * 8;
+            if (pos > file_sz) {
+                break; // cut by the fault
+            }
+            num++;
+            fseek(fp, pos, SEEK_SET);
+        }
+    }
+    fclose(fp);
+    return num;
+}
+
+static void bench_report(const char *name, uint32_t num, uint64_t bytes, int64_t us, const host_alloc_stat_t *p_a0, const host_alloc_stat_t *p_a1)
+{
+    double sec = (us > 0) ? us / 1e6 : 1e-6;
+    printf("  %-5s: %8" PRIu32 " rec %10.3f MB %8.3f s %9.2f MB/s %11.0f rec/s  alloc=%" PRIu64 " (%" PRIu64 " B) free=%" PRIu64 "\n",
+        name, num, bytes / 1e6, sec, bytes / 1e6 / sec, num / sec,
+        p_a1->alloc_cnt - p_a0->alloc_cnt, p_a1->alloc_bytes - p_a0->alloc_bytes, p_a1->free_cnt - p_a0->free_cnt);
+}
+
+// one console message, formatted on the producer (vsnprintf() + sdlog_write(), the log_hub way) or deferred
+static esp_err_t bench_write_text(uint32_t text, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    esp_err_t ret;
+    if (text == BENCH_TEXT_DEFERRED) {
+        ret = sdlog_write_fmt(SDLOG_SOURCE_CONSOLE, fmt, args);
+    } else {
+        char buf[256];
+        int len = vsnprintf(buf, sizeof(buf), fmt, args);
+        ret     = sdlog_write(SDLOG_SOURCE_CONSOLE, SDLOG_FMT_TEXT__STRING, (len < (int)sizeof(buf)) ? (uint32_t)len : (uint32_t)sizeof(buf) - 1, buf);
+    }
+    va_end(args);
+    return ret;
+}
+
+// consecutive records of the same type and length, up to batch, as twai_rx_task submits a burst
+static uint32_t bench_write_batch(const bench_workload_t *p_wl, uint32_t i, uint32_t batch, uint8_t *p_stage, uint64_t *p_stall, uint64_t *p_rejected)
+{
+    const bench_rec_t *p_first = &p_wl->rec[i];
+    int64_t us_sys_time[batch];
+    uint32_t num = 0;
+    while (num < batch && i + num < p_wl->num && p_wl->rec[i + num].type_data == p_first->type_data &&
+           p_wl->rec[i + num].len == p_first->len) {
+        memcpy(p_stage + num * p_first->len, p_wl->rec[i + num].payload, p_first->len);
+        us_sys_time[num++] = esp_timer_get_time();
+    }
+    while (sdlog_write_batch(p_wl->source, p_first->type_data, num, p_first->len, us_sys_time, p_stage) != ESP_OK) {
+        (*p_stall)++;
+        *p_rejected += num; // counted in drop_cnt, then submitted again
+        sched_yield();
+    }
+    return num;
+}
+
+// -x: the card is removed while i is in the middle third of the workload
+static void bench_fault_step(const bench_workload_t *p_wl, uint32_t i, uint32_t *p_removed)
+{
+    uint32_t removed = (i >= p_wl->num / 3 && i < p_wl->num / 3 * 2);
+    if (removed != *p_removed) {
+        host_sd_fault_set(removed);
+        *p_removed = removed;
+    }
+}
+
+static void bench_run(const bench_workload_t *p_wl, uint32_t iter, uint32_t exporter, uint32_t batch, uint8_t *p_stage, uint32_t fault)
+{
+    host_alloc_stat_t a0, a1, a2;
+    sdlog_webui_status_t status;
+    uint64_t stall    = 0;
+    uint64_t rejected = 0; // records of the sdlog_write() calls refused (ring buffer full), they're retried
+    uint32_t removed  = 0;
+
+    // write path, timed from sdlog_start() to the file closed
+    host_alloc_stat(&a0);
+    int64_t t0 = esp_timer_get_time();
+
+    sdlog_start(p_wl->source, (uint64_t)time(NULL) * 1000000);
+    bench_wait_ready(p_wl->source, 1);
+    sdlog_webui_query(p_wl->source, &status);
+
+    if (p_wl->text) {
+        static const char *tag[] = {"TWAI", "SDLOG", "HTTP_SERVER", "WIFI"};
+        for (uint32_t i = 0; i < p_wl->num; i++) {
+            if (fault) {
+                bench_fault_step(p_wl, i, &removed);
+            }
+            while (bench_write_text(p_wl->text, "I (%" PRIu32 ") %s: rx id=0x%03" PRIX32 " dlc=%d load=%.1f%% state=%s\n",
+                       (uint32_t)(esp_timer_get_time() / 1000), tag[i % 4], 0x100 + (i * 7) % 64, (int)(i % 9), (i % 1000) / 10.0,
+                       (i % 3) ? "running" : "bus-off") != ESP_OK) {
+                stall++;
+                rejected++;
+                sched_yield();
+            }
+        }
+    } else if (batch > 1) {
+        for (uint32_t i = 0; i < p_wl->num;) {
+            if (fault) {
+                bench_fault_step(p_wl, i, &removed);
+            }
+            i += bench_write_batch(p_wl, i, batch, p_stage, &stall, &rejected);
+        }
+    } else {
+        for (uint32_t i = 0; i < p_wl->num; i++) {
+            if (fault) {
+                bench_fault_step(p_wl, i, &removed);
+            }
+            const bench_rec_t *p_rec = &p_wl->rec[i];
+            while (sdlog_write(p_wl->source, p_rec->type_data, p_rec->len, p_rec->payload) != ESP_OK) {
+                stall++; // the writer is slower than us, wait for room instead of measuring drops
+                rejected++;
+                sched_yield();
+            }
+        }
+    }
+
+    sdlog_webui_status_t fault_status;
+    sdlog_webui_query(p_wl->source, &fault_status);
+    uint32_t drop       = fault_status.drop_cnt; // 0 once the session is closed, sampled before
+    uint32_t fault_lost = fault_status.fault_lost;
+    sdlog_stop(p_wl->source);
+    bench_wait_ready(p_wl->source, 0);
+    if (fault) { // the stopped session is closed by the remount
+        int64_t us_back = esp_timer_get_time();
+        do {
+            drop       = fault_status.drop_cnt;
+            fault_lost = fault_status.fault_lost;
+            vTaskDelay(pdMS_TO_TICKS(10));
+            sdlog_webui_query(p_wl->source, &fault_status);
+        } while (fault_status.sd_fault);
+        uint32_t fault_cnt, mount_cnt;
+        host_sd_fault_stat(&fault_cnt, &mount_cnt);
+        printf("  fault: drop_cnt=%" PRIu32 " (producer stalls included), %" PRIu32 " faults, %" PRIu32 " remounts, flushed %" PRId64 " ms after the stop\n",
+            drop, fault_cnt, mount_cnt, (esp_timer_get_time() - us_back) / 1000);
+    }
+    // the records beyond the spill buffer while the card is out (the remount waits SDLOG_REMOUNT_MS) and the FILE
+    // buffer of the broken file, the refused calls are out of drop_cnt since they were submitted again
+    uint32_t dropped = (drop > rejected) ? drop - (uint32_t)rejected : 0;
+
+    int64_t t1 = esp_timer_get_time();
+    host_alloc_stat(&a1);
+
+    // every file of the session, a fault goes on in the next serial number, the last one is converted
+    char log_path[256];
+    uint32_t sn_last  = sdlog_source_sn(p_wl->source) - 1;
+    uint64_t bytes    = 0;
+    uint32_t rec_file = 0;
+    for (uint32_t sn = status.sn; sn <= sn_last; sn++) {
+        snprintf(log_path, sizeof(log_path), "%s/log/%s/%06" PRIu32 "/log.bin", MNT_SDCARD, status.name, sn);
+        bytes += bench_file_size(log_path);
+        rec_file += fault ? bench_file_records(log_path) : 0;
+    }
+
+    // convert path
+    esp_err_t conv_result = sdlog_conv_file(log_path, exporter);
+
+    int64_t t2 = esp_timer_get_time();
+    host_alloc_stat(&a2);
+
+    printf("#%" PRIu32 " %s (producer stalls=%" PRIu64 ", conv=%s)\n", iter, log_path, stall, (conv_result == ESP_OK) ? "OK" : "FAIL");
+    bench_report("write", p_wl->num - dropped, bytes, t1 - t0, &a0, &a1);
+    if (fault) {
+        printf("  files: %8" PRIu32 " rec in %" PRIu32 " files\n", rec_file, sn_last - status.sn + 1);
+    }
+    if (dropped) {
+        printf("  drop : %8" PRIu32 " rec, not in the log, %" PRIu32 " of them lost in the FILE buffer at the fault\n", dropped, fault_lost);
+    }
+    bench_report("conv", fault ? bench_file_records(log_path) : p_wl->num, bench_file_size(log_path), t2 - t1, &a1, &a2);
+}
+
+static void bench_usage(const char *prog)
+{
+    fprintf(stderr,
+        "Usage: %s [-n frames] [-t] [-d] [-r log.bin] [-e exporter] [-b batch] [-i iterations] [-w workdir] [-x spill_kb] [-v]\n"
+        "  -n  number of synthetic CAN frames (or console messages with -t, default 100000)\n"
+        "  -t  synthetic console messages, formatted by the producer\n"
+        "  -d  synthetic console messages, deferred (SDLOG_FMT_TEXT__BIN), formatted by the exporter\n"
+        "  -r  replay the records of a recorded log.bin instead of synthetic frames\n"
+        "  -e  exporter name in sdlog_exporter_reg.h, eg. CAN, CANCOL (default: the one of the log format)\n"
+        "  -b  records per sdlog_write_batch() (default 1: sdlog_write() per record)\n"
+        "  -i  iterations (default 3)\n"
+        "  -w  working folder, logs go to <workdir>/" MNT_SDCARD "/log (default .)\n"
+        "  -x  remove the SD card for the middle third of the workload, with a spill buffer of spill_kb\n"
+        "  -v  keep the sdlog INFO logs\n",
+        prog);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t num         = 100000;
+    uint32_t iter        = 3;
+    const char *p_replay = NULL;
+    const char *p_wd     = ".";
+    uint32_t exporter    = SDLOG_EXPORTER_AUTO;
+    uint32_t batch       = 1;
+    uint32_t text        = BENCH_TEXT_OFF;
+    uint32_t fault       = 0;
+    int verbose          = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:tdr:e:b:i:w:x:vh")) != -1) {
+        switch (opt) {
+        case 'n':
+            num = strtoul(optarg, NULL, 0);
+            break;
+        case 't':
+            text = BENCH_TEXT_FORMATTED;
+            break;
+        case 'd':
+            text = BENCH_TEXT_DEFERRED;
+            break;
+        case 'r':
+            p_replay = optarg;
+            break;
+        case 'e':
+            if ((exporter = sdlog_conv_exporter_find(optarg)) == SDLOG_EXPORTER_NUM) {
+                fprintf(stderr, "unknown exporter %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'b':
+            batch = strtoul(optarg, NULL, 0);
+            break;
+        case 'i':
+            iter = strtoul(optarg, NULL, 0);
+            break;
+        case 'w':
+            p_wd = optarg;
+            break;
+        case 'x':
+            fault = 1;
+            sdlog_syscfg("sdlog", "spill_kb", optarg);
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        default:
+            bench_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    bench_workload_t wl = {0};
+    if (p_replay) {
+        if (bench_workload_recorded(&wl, p_replay) != 0) {
+            return 1;
+        }
+    } else if (text) {
+        bench_workload_text(&wl, num, text == BENCH_TEXT_DEFERRED);
+        sdlog_syscfg("sdlog", "deferred_fmt", (text == BENCH_TEXT_DEFERRED) ? "on" : "off");
+    } else {
+        bench_workload_synthetic(&wl, num);
+    }
+
+    mkdir(p_wd, 0700);
+    if (chdir(p_wd) != 0) {
+        fprintf(stderr, "can't enter %s\n", p_wd);
+        return 1;
+    }
+    mkdir(MNT_SDCARD, 0700);
+
+    esp_log_level_set("*", verbose ? ESP_LOG_INFO : ESP_LOG_WARN);
+    ESP_ERROR_CHECK(sdlog_pool_init()); // the first step of the boot too
+    ESP_ERROR_CHECK(sdlog_service_init());
+    ESP_ERROR_CHECK(sdlog_service_scan()); // the background step of the boot
+
+    // staging of sdlog_write_batch(), allocated outside of the timed/counted part
+    uint32_t max_len = 0;
+    for (uint32_t i = 0; wl.rec && i < wl.num; i++) {
+        max_len = (wl.rec[i].len > max_len) ? wl.rec[i].len : max_len;
+    }
+    uint8_t *p_stage = malloc((size_t)batch * max_len + 1);
+
+    static const char *text_name[] = {"synthetic CAN", "console messages, formatted", "console messages, deferred"};
+    printf("workload: %s, %" PRIu32 " records, batch=%" PRIu32 "\n", p_replay ? p_replay : text_name[text], wl.num, batch);
+    for (uint32_t i = 0; i < iter; i++) {
+        bench_run(&wl, i, exporter, batch, p_stage, fault);
+    }
+
+    free(p_stage);
+    free(wl.rec);
+    free(wl.blob);
+    return 0;
+}
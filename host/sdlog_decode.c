@@ -0,0 +1,673 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "driver/twai.h"
+
+#include "sdlog_header.h"
+#include "sdlog_service.h"
+#include "sdlog_service_private.h"
+#include "sdlog_fmt.h"
+
+// Host decoder of log.bin, replacing tool/parse_log.py
+// - the file is mmap'ed and split into chunks, the worker threads decode the chunks in parallel
+// - a chunk starts at the first resync point after its nominal offset (0xA5 magic + a chain of sane records)
+//   and ends at the resync point of the next chunk, so every record is decoded exactly once
+// - the main thread writes the chunk outputs in file order, only DEC_INFLIGHT chunks per thread are kept in RAM
+//
+// Output formats
+// - candump: "(sec.usec) can1 ID [dlc] XX XX ..", the TEXT logs as "[abs_us] text" (same as the on-device exporter)
+// - csv:     one row per record, one row per sample of an ADC log
+// - col:     columnar, a folder with one raw little-endian array per column (ts_us.u64, id.u32, flags.u8, dlc.u8, data.8u8)
+//
+// The absolute time is interpolated between the time sync records (sdlog_time_sync_abs_us), same as the device
+// The deferred text records (SDLOG_FMT_TEXT__BIN) are formatted with the string table of the whole file
+
+#define DEC_CHUNK_SZ_DEF (8 << 20)
+#define DEC_INFLIGHT (2)         // chunks per thread decoded ahead of the writer
+#define DEC_SYNC_CHAIN (4)       // records in a row that must look sane to accept a resync point
+#define DEC_MAX_PAYLOAD (32768)  // the sdlog_task input ring buffer is 32KB, no record is larger
+#define DEC_DATA_MAGIC (0xA5)
+#define DEC_TEXT_MAX (1024)      // a deferred text record is formatted up to this
+
+enum {
+    DEC_FMT_CANDUMP = 0,
+    DEC_FMT_CSV,
+    DEC_FMT_COL,
+};
+
+enum { // output streams of a chunk, text formats use DEC_OUT_TEXT only
+    DEC_OUT_TEXT = 0,
+    DEC_OUT_TS   = 0,
+    DEC_OUT_ID,
+    DEC_OUT_FLAGS,
+    DEC_OUT_DLC,
+    DEC_OUT_DATA,
+    DEC_OUT_NUM,
+};
+
+static const char *dec_col_fn[DEC_OUT_NUM] = {
+    [DEC_OUT_TS]    = "ts_us.u64",
+    [DEC_OUT_ID]    = "id.u32",
+    [DEC_OUT_FLAGS] = "flags.u8",
+    [DEC_OUT_DLC]   = "dlc.u8",
+    [DEC_OUT_DATA]  = "data.8u8",
+};
+
+// ----------
+// data structure definition
+// ----------
+typedef struct dec_buf_s {
+    uint8_t *p;
+    size_t len;
+    size_t cap;
+} dec_buf_t;
+
+typedef struct dec_chunk_s {
+    size_t begin; // resynced begin/end offset in the file
+    size_t end;
+    uint32_t done;
+    uint64_t rec_num;
+    uint64_t resync_num; // corrupted records skipped inside the chunk
+    uint32_t bus_num;    // SDLOG_CAN_TYPE_BUS records, the last one is kept for the summary
+    uint32_t bus_alerts;
+    sdlog_can_bus_t bus_last;
+    uint32_t sync_idx; // cursor in dec_ctrl.p_sync
+    dec_buf_t out[DEC_OUT_NUM];
+} dec_chunk_t;
+
+typedef struct dec_ctrl_s {
+    // input
+    const uint8_t *p_map;
+    size_t size;
+    uint32_t fmt_log; // SDLOG_FMT_xxx of the log
+    uint64_t us_epoch_time;
+    uint64_t us_sys_time;
+    sdlog_time_sync_t *p_sync; // time sync records, the header offset is used if there's none
+    uint32_t sync_num;
+    sdlog_fmt_table_t fmt_table; // SDLOG_FMT_TEXT__FMT records of a TEXT log
+
+    // output
+    uint32_t fmt_out;
+    FILE *fp_out[DEC_OUT_NUM];
+
+    // chunks
+    dec_chunk_t *chunk;
+    uint32_t chunk_num;
+    uint32_t chunk_next;    // next chunk to be picked up by a worker
+    uint32_t chunk_written; // chunks flushed by the writer
+    uint32_t inflight;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} dec_ctrl_t;
+
+static dec_ctrl_t dec_ctrl;
+
+// ----------
+// output buffer
+// ----------
+static uint8_t *dec_buf_reserve(dec_buf_t *p_buf, size_t n)
+{
+    if (p_buf->len + n > p_buf->cap) {
+        size_t cap = p_buf->cap ? p_buf->cap : 65536;
+        while (cap < p_buf->len + n) {
+            cap *= 2;
+        }
+        uint8_t *p = realloc(p_buf->p, cap);
+        if (p == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        p_buf->p   = p;
+        p_buf->cap = cap;
+    }
+    return p_buf->p + p_buf->len;
+}
+
+static void dec_buf_put(dec_buf_t *p_buf, const void *p_data, size_t n)
+{
+    memcpy(dec_buf_reserve(p_buf, n), p_data, n);
+    p_buf->len += n;
+}
+
+// ----------
+// formatting helpers, snprintf() is the bottleneck of a text decoder
+// ----------
+static char *dec_fmt_u64(char *p, uint64_t v)
+{
+    char tmp[20];
+    uint32_t n = 0;
+    do {
+        tmp[n++] = '0' + (v % 10);
+        v /= 10;
+    } while (v);
+    while (n) {
+        *p++ = tmp[--n];
+    }
+    return p;
+}
+
+static char *dec_fmt_time(char *p, uint64_t abs_us) // "sec.usec"
+{
+    uint32_t usec = abs_us % 1000000;
+    p             = dec_fmt_u64(p, abs_us / 1000000);
+    *p++          = '.';
+    for (int32_t i = 5; i >= 0; i--) {
+        p[i] = '0' + (usec % 10);
+        usec /= 10;
+    }
+    return p + 6;
+}
+
+static char *dec_fmt_hex(char *p, uint32_t v, uint32_t digits)
+{
+    static const char hex_table[] = "0123456789ABCDEF";
+    for (int32_t i = digits - 1; i >= 0; i--) {
+        p[i] = hex_table[v & 0xF];
+        v >>= 4;
+    }
+    return p + digits;
+}
+
+// ----------
+// record walk
+// ----------
+static inline size_t dec_rec_size(const sdlog_data_t *p_data)
+{
+    return sizeof(sdlog_data_t) + (p_data->payload_len + 7) / 8 * 8;
+}
+
+static int dec_rec_valid(size_t pos)
+{
+    if (pos + sizeof(sdlog_data_t) > dec_ctrl.size) {
+        return 0;
+    }
+    const sdlog_data_t *p_data = (const sdlog_data_t *)(dec_ctrl.p_map + pos);
+    return p_data->magic == DEC_DATA_MAGIC && p_data->payload_len <= DEC_MAX_PAYLOAD && pos + dec_rec_size(p_data) <= dec_ctrl.size;
+}
+
+// find the first position >= pos where DEC_SYNC_CHAIN records in a row are sane (or reach EOF)
+static size_t dec_resync(size_t pos, size_t data_begin)
+{
+    pos = data_begin + (pos - data_begin + 7) / 8 * 8; // records are 8-byte aligned from offset_data
+    for (; pos < dec_ctrl.size; pos += 8) {
+        size_t p = pos;
+        uint32_t k;
+        for (k = 0; k < DEC_SYNC_CHAIN && p < dec_ctrl.size; k++) {
+            if (!dec_rec_valid(p)) {
+                break;
+            }
+            p += dec_rec_size((const sdlog_data_t *)(dec_ctrl.p_map + p));
+        }
+        if (k == DEC_SYNC_CHAIN || p >= dec_ctrl.size) {
+            return pos;
+        }
+    }
+    return dec_ctrl.size;
+}
+
+// ----------
+// decoders
+// ----------
+static void dec_emit_can(dec_chunk_t *p_chunk, uint64_t abs_us, const twai_message_t *p_can)
+{
+    uint32_t dlc = (p_can->data_length_code > TWAI_FRAME_MAX_DLC) ? TWAI_FRAME_MAX_DLC : p_can->data_length_code;
+
+    if (dec_ctrl.fmt_out == DEC_FMT_COL) {
+        uint8_t flags  = p_can->flags & 0xFF;
+        uint8_t data[8] = {0};
+        memcpy(data, p_can->data, dlc);
+        dec_buf_put(&p_chunk->out[DEC_OUT_TS], &abs_us, sizeof(abs_us));
+        dec_buf_put(&p_chunk->out[DEC_OUT_ID], &p_can->identifier, sizeof(uint32_t));
+        dec_buf_put(&p_chunk->out[DEC_OUT_FLAGS], &flags, 1);
+        dec_buf_put(&p_chunk->out[DEC_OUT_DLC], &p_can->data_length_code, 1);
+        dec_buf_put(&p_chunk->out[DEC_OUT_DATA], data, sizeof(data));
+        return;
+    }
+
+    dec_buf_t *p_buf = &p_chunk->out[DEC_OUT_TEXT];
+    char *p_begin    = (char *)dec_buf_reserve(p_buf, 80);
+    char *p          = p_begin;
+    uint32_t digits  = p_can->extd ? 8 : 3;
+
+    if (dec_ctrl.fmt_out == DEC_FMT_CANDUMP) {
+        *p++ = '(';
+        p    = dec_fmt_time(p, abs_us);
+        memcpy(p, ") can1 ", 7);
+        p += 7;
+        p    = dec_fmt_hex(p, p_can->identifier, digits);
+        *p++ = ' ';
+        *p++ = '[';
+        *p++ = '0' + dlc;
+        *p++ = ']';
+        for (uint32_t i = 0; i < dlc; i++) {
+            *p++ = ' ';
+            p    = dec_fmt_hex(p, p_can->data[i], 2);
+        }
+    } else { // csv: timestamp,id,ext,rtr,dlc,data
+        p    = dec_fmt_time(p, abs_us);
+        *p++ = ',';
+        p    = dec_fmt_hex(p, p_can->identifier, digits);
+        *p++ = ',';
+        *p++ = '0' + p_can->extd;
+        *p++ = ',';
+        *p++ = '0' + p_can->rtr;
+        *p++ = ',';
+        *p++ = '0' + dlc;
+        *p++ = ',';
+        for (uint32_t i = 0; i < dlc; i++) {
+            p = dec_fmt_hex(p, p_can->data[i], 2);
+        }
+    }
+    *p++ = '\n';
+    p_buf->len += p - p_begin;
+}
+
+// an ADC block, one "sec.usec,channel,raw" line per sample (candump and csv, same as the ADCCSV exporter)
+static void dec_emit_adc(dec_chunk_t *p_chunk, uint64_t abs_us, const sdlog_adc_block_t *p_blk)
+{
+    dec_buf_t *p_buf = &p_chunk->out[DEC_OUT_TEXT];
+    char *p_begin    = (char *)dec_buf_reserve(p_buf, SDLOG_ADC_BLOCK_SAMPLES * 40);
+    char *p          = p_begin;
+
+    for (uint32_t i = 0; i < SDLOG_ADC_BLOCK_SAMPLES; i++) {
+        p    = dec_fmt_time(p, abs_us + (uint64_t)i * 1000000 / p_blk->rate_hz);
+        *p++ = ',';
+        p    = dec_fmt_u64(p, SDLOG_ADC_SAMPLE_CH(p_blk->sample[i]));
+        *p++ = ',';
+        p    = dec_fmt_u64(p, SDLOG_ADC_SAMPLE_RAW(p_blk->sample[i]));
+        *p++ = '\n';
+    }
+    p_buf->len += p - p_begin;
+}
+
+// a continuation record (SDLOG_FMT_TEXT__CONT) is appended to the line of the previous record,
+// or starts its own line if the previous record is in another chunk
+static void dec_emit_text(dec_chunk_t *p_chunk, uint64_t abs_us, const char *p_text, uint32_t len, uint32_t cont)
+{
+    dec_buf_t *p_buf = &p_chunk->out[DEC_OUT_TEXT];
+
+    while (len && (p_text[len - 1] == '\n' || p_text[len - 1] == '\0')) {
+        len--;
+    }
+
+    uint32_t tail = (dec_ctrl.fmt_out == DEC_FMT_CSV) ? 2 : 1; // the closing '"' and '\n' of the previous line
+    cont          = cont && p_buf->len >= tail;
+    if (cont) {
+        p_buf->len -= tail;
+    }
+
+    char *p_begin = (char *)dec_buf_reserve(p_buf, 32 + 2 * len + 4);
+    char *p       = p_begin;
+    if (dec_ctrl.fmt_out == DEC_FMT_CSV) { // timestamp,"text" with quotes doubled
+        if (!cont) {
+            p    = dec_fmt_time(p, abs_us);
+            *p++ = ',';
+            *p++ = '"';
+        }
+        for (uint32_t i = 0; i < len; i++) {
+            if (p_text[i] == '"') {
+                *p++ = '"';
+            }
+            *p++ = p_text[i];
+        }
+        *p++ = '"';
+    } else {
+        if (!cont) {
+            *p++ = '[';
+            p    = dec_fmt_u64(p, abs_us);
+            *p++ = ']';
+            *p++ = ' ';
+        }
+        memcpy(p, p_text, len);
+        p += len;
+    }
+    *p++ = '\n';
+    p_buf->len += p - p_begin;
+}
+
+// collect the time sync records and the string table before the parallel decode, a chunk needs the ones after it too
+static void dec_prescan(size_t data_begin)
+{
+    uint32_t cap = 0;
+    size_t pos   = data_begin;
+    while (pos < dec_ctrl.size) {
+        if (!dec_rec_valid(pos)) {
+            pos = dec_resync(pos + 8, data_begin);
+            continue;
+        }
+        const sdlog_data_t *p_data = (const sdlog_data_t *)(dec_ctrl.p_map + pos);
+        if (p_data->type_data == SDLOG_TYPE_TIME_SYNC && p_data->payload_len == sizeof(sdlog_time_sync_t)) {
+            if (dec_ctrl.sync_num == cap) {
+                cap             = cap ? cap * 2 : 64;
+                dec_ctrl.p_sync = realloc(dec_ctrl.p_sync, cap * sizeof(sdlog_time_sync_t));
+            }
+            sdlog_time_sync_t *p_sync = &dec_ctrl.p_sync[dec_ctrl.sync_num];
+            memcpy(p_sync, p_data + 1, sizeof(*p_sync));
+            if (dec_ctrl.sync_num == 0 || p_sync->us_sys_time >= p_sync[-1].us_sys_time) {
+                dec_ctrl.sync_num++;
+            }
+        } else if (dec_ctrl.fmt_log == SDLOG_FMT_TEXT && p_data->type_data == SDLOG_FMT_TEXT__FMT) {
+            sdlog_fmt_table_add(&dec_ctrl.fmt_table, p_data + 1, p_data->payload_len);
+        }
+        pos += dec_rec_size(p_data);
+    }
+}
+
+static uint64_t dec_abs_us(dec_chunk_t *p_chunk, uint64_t us_sys_time)
+{
+    if (dec_ctrl.sync_num == 0) {
+        return dec_ctrl.us_epoch_time + (us_sys_time - dec_ctrl.us_sys_time);
+    }
+    return sdlog_time_sync_abs_us(dec_ctrl.p_sync, dec_ctrl.sync_num, &p_chunk->sync_idx, us_sys_time);
+}
+
+static void dec_chunk_decode(dec_chunk_t *p_chunk)
+{
+    size_t pos = p_chunk->begin;
+    while (pos < p_chunk->end) {
+        if (!dec_rec_valid(pos)) {
+            p_chunk->resync_num++;
+            pos = dec_resync(pos + 8, p_chunk->begin);
+            continue;
+        }
+
+        const sdlog_data_t *p_data = (const sdlog_data_t *)(dec_ctrl.p_map + pos);
+        const void *p_payload      = p_data + 1;
+        uint64_t abs_us            = dec_abs_us(p_chunk, p_data->us_sys_time);
+
+        if (p_data->type_data >= SDLOG_TYPE_FRAMEWORK) {
+            // framework records, not part of the output
+        } else if (dec_ctrl.fmt_log == SDLOG_FMT_CAN) {
+            if (p_data->type_data == SDLOG_CAN_TYPE_BUS && p_data->payload_len >= sizeof(sdlog_can_bus_t)) {
+                memcpy(&p_chunk->bus_last, p_payload, sizeof(sdlog_can_bus_t));
+                p_chunk->bus_alerts |= p_chunk->bus_last.alerts;
+                p_chunk->bus_num++;
+            } else if (p_data->type_data == SDLOG_CAN_TYPE_FRAME && p_data->payload_len >= sizeof(twai_message_t)) {
+                twai_message_t can_msg;
+                memcpy(&can_msg, p_payload, sizeof(can_msg)); // payload is only 8-byte aligned in the file, copy it out
+                dec_emit_can(p_chunk, abs_us, &can_msg);
+                p_chunk->rec_num++;
+            }
+        } else if (dec_ctrl.fmt_log == SDLOG_FMT_ADC) {
+            if (p_data->type_data == SDLOG_ADC_TYPE_BLOCK && p_data->payload_len == sizeof(sdlog_adc_block_t)) {
+                sdlog_adc_block_t blk;
+                memcpy(&blk, p_payload, sizeof(blk));
+                if (blk.rate_hz) {
+                    dec_emit_adc(p_chunk, abs_us, &blk);
+                    p_chunk->rec_num++;
+                }
+            }
+        } else if (dec_ctrl.fmt_out == DEC_FMT_COL || p_data->type_data == SDLOG_FMT_TEXT__FMT) {
+            // no text columns, the string table is collected by dec_prescan()
+        } else if (p_data->type_data == SDLOG_FMT_TEXT__BIN || p_data->type_data == SDLOG_FMT_TEXT__HTTP) {
+            char text[DEC_TEXT_MAX];
+            uint32_t len = (p_data->type_data == SDLOG_FMT_TEXT__HTTP) ? sdlog_fmt_render_http(p_payload, p_data->payload_len, text, sizeof(text))
+                                                                       : sdlog_fmt_render_rec(&dec_ctrl.fmt_table, p_payload, p_data->payload_len, text, sizeof(text));
+            dec_emit_text(p_chunk, abs_us, text, len, 0);
+            p_chunk->rec_num++;
+        } else {
+            dec_emit_text(p_chunk, abs_us, p_payload, p_data->payload_len, p_data->type_data == SDLOG_FMT_TEXT__CONT);
+            p_chunk->rec_num++;
+        }
+        pos += dec_rec_size(p_data);
+    }
+}
+
+// ----------
+// worker/writer
+// ----------
+static void *dec_worker(void *arg)
+{
+    while (1) {
+        pthread_mutex_lock(&dec_ctrl.lock);
+        uint32_t idx = dec_ctrl.chunk_next;
+        while (idx < dec_ctrl.chunk_num && idx >= dec_ctrl.chunk_written + dec_ctrl.inflight) {
+            pthread_cond_wait(&dec_ctrl.cond, &dec_ctrl.lock); // don't run too far ahead of the writer
+            idx = dec_ctrl.chunk_next;
+        }
+        dec_ctrl.chunk_next = idx + 1;
+        pthread_mutex_unlock(&dec_ctrl.lock);
+
+        if (idx >= dec_ctrl.chunk_num) {
+            break;
+        }
+
+        dec_chunk_decode(&dec_ctrl.chunk[idx]);
+
+        pthread_mutex_lock(&dec_ctrl.lock);
+        dec_ctrl.chunk[idx].done = 1;
+        pthread_cond_broadcast(&dec_ctrl.cond);
+        pthread_mutex_unlock(&dec_ctrl.lock);
+    }
+    return NULL;
+}
+
+static void dec_writer(void)
+{
+    for (uint32_t idx = 0; idx < dec_ctrl.chunk_num; idx++) {
+        dec_chunk_t *p_chunk = &dec_ctrl.chunk[idx];
+
+        pthread_mutex_lock(&dec_ctrl.lock);
+        while (!p_chunk->done) {
+            pthread_cond_wait(&dec_ctrl.cond, &dec_ctrl.lock);
+        }
+        pthread_mutex_unlock(&dec_ctrl.lock);
+
+        for (uint32_t i = 0; i < DEC_OUT_NUM; i++) {
+            if (dec_ctrl.fp_out[i] && p_chunk->out[i].len) {
+                fwrite(p_chunk->out[i].p, 1, p_chunk->out[i].len, dec_ctrl.fp_out[i]);
+            }
+            free(p_chunk->out[i].p);
+            p_chunk->out[i] = (dec_buf_t){0};
+        }
+
+        pthread_mutex_lock(&dec_ctrl.lock);
+        dec_ctrl.chunk_written = idx + 1;
+        pthread_cond_broadcast(&dec_ctrl.cond);
+        pthread_mutex_unlock(&dec_ctrl.lock);
+    }
+}
+
+// ----------
+// main
+// ----------
+static int dec_open_output(const char *p_out)
+{
+    if (dec_ctrl.fmt_out != DEC_FMT_COL) {
+        dec_ctrl.fp_out[DEC_OUT_TEXT] = p_out ? fopen(p_out, "wb") : stdout;
+        if (dec_ctrl.fp_out[DEC_OUT_TEXT] == NULL) {
+            fprintf(stderr, "can't create %s\n", p_out);
+            return -1;
+        }
+        if (dec_ctrl.fmt_out == DEC_FMT_CSV) {
+            fputs((dec_ctrl.fmt_log == SDLOG_FMT_CAN)   ? "timestamp,id,ext,rtr,dlc,data\n"
+                  : (dec_ctrl.fmt_log == SDLOG_FMT_ADC) ? "time,channel,raw\n"
+                                                        : "timestamp,text\n",
+                dec_ctrl.fp_out[DEC_OUT_TEXT]);
+        }
+        return 0;
+    }
+
+    if (p_out == NULL || dec_ctrl.fmt_log != SDLOG_FMT_CAN) {
+        fprintf(stderr, "col output needs a CAN log and an output folder (-o)\n");
+        return -1;
+    }
+    mkdir(p_out, 0755);
+    for (uint32_t i = 0; i < DEC_OUT_NUM; i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", p_out, dec_col_fn[i]);
+        if ((dec_ctrl.fp_out[i] = fopen(path, "wb")) == NULL) {
+            fprintf(stderr, "can't create %s\n", path);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void dec_usage(const char *prog)
+{
+    fprintf(stderr,
+        "Usage: %s [-f candump|csv|col] [-o output] [-j threads] [-c chunk_mb] log.bin\n"
+        "  -f  output format (default candump)\n"
+        "  -o  output file, or output folder for col (default stdout)\n"
+        "  -j  decoder threads (default: online CPUs)\n"
+        "  -c  chunk size in MB (default %d)\n",
+        prog, DEC_CHUNK_SZ_DEF >> 20);
+}
+
+int main(int argc, char **argv)
+{
+    const char *p_out = NULL;
+    uint32_t threads  = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t chunk_sz   = DEC_CHUNK_SZ_DEF;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "f:o:j:c:h")) != -1) {
+        switch (opt) {
+        case 'f':
+            if (strcmp(optarg, "candump") == 0) {
+                dec_ctrl.fmt_out = DEC_FMT_CANDUMP;
+            } else if (strcmp(optarg, "csv") == 0) {
+                dec_ctrl.fmt_out = DEC_FMT_CSV;
+            } else if (strcmp(optarg, "col") == 0) {
+                dec_ctrl.fmt_out = DEC_FMT_COL;
+            } else {
+                dec_usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'o':
+            p_out = optarg;
+            break;
+        case 'j':
+            threads = strtoul(optarg, NULL, 0);
+            break;
+        case 'c':
+            chunk_sz = (size_t)strtoul(optarg, NULL, 0) << 20;
+            break;
+        default:
+            dec_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc) {
+        dec_usage(argv[0]);
+        return 1;
+    }
+    threads  = threads ? threads : 1;
+    chunk_sz = chunk_sz ? chunk_sz : DEC_CHUNK_SZ_DEF;
+
+    // map the input
+    const char *p_in = argv[optind];
+    int fd           = open(p_in, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(sdlog_header_t)) {
+        fprintf(stderr, "can't open %s\n", p_in);
+        return 1;
+    }
+    dec_ctrl.size  = st.st_size;
+    dec_ctrl.p_map = mmap(NULL, dec_ctrl.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (dec_ctrl.p_map == MAP_FAILED) {
+        fprintf(stderr, "mmap %s: %s\n", p_in, strerror(errno));
+        return 1;
+    }
+    madvise((void *)dec_ctrl.p_map, dec_ctrl.size, MADV_SEQUENTIAL);
+
+    const sdlog_header_t *p_header = (const sdlog_header_t *)dec_ctrl.p_map;
+    if (strncmp(p_header->sys.magic, "QQMLAB", sizeof(p_header->sys.magic)) || p_header->sys.offset_data < sizeof(sdlog_header_t)) {
+        fprintf(stderr, "%s is not a QQMLAB log\n", p_in);
+        return 1;
+    }
+    dec_ctrl.fmt_log       = p_header->sys.fmt;
+    dec_ctrl.us_epoch_time = p_header->sys.us_epoch_time;
+    dec_ctrl.us_sys_time   = p_header->sys.us_sys_time;
+
+    if (dec_open_output(p_out) != 0) {
+        return 1;
+    }
+
+    // split the data region at resync points
+    size_t data_begin  = p_header->sys.offset_data;
+    size_t data_len    = (dec_ctrl.size > data_begin) ? dec_ctrl.size - data_begin : 0;
+    dec_ctrl.chunk_num = (data_len + chunk_sz - 1) / chunk_sz;
+    dec_ctrl.chunk     = calloc(dec_ctrl.chunk_num ? dec_ctrl.chunk_num : 1, sizeof(dec_chunk_t));
+
+    size_t begin = data_begin;
+    for (uint32_t i = 0; i < dec_ctrl.chunk_num; i++) {
+        size_t end = (i + 1 == dec_ctrl.chunk_num) ? dec_ctrl.size : dec_resync(data_begin + (size_t)(i + 1) * chunk_sz, data_begin);
+        dec_ctrl.chunk[i].begin = begin;
+        dec_ctrl.chunk[i].end   = (end > begin) ? end : begin;
+        begin                   = dec_ctrl.chunk[i].end;
+    }
+
+    // decode
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    dec_prescan(data_begin);
+    if (p_header->sys.epoch_src == SDLOG_EPOCH_PROVISIONAL && dec_ctrl.sync_num == 0) {
+        fprintf(stderr, "%s: provisional epoch (device clock at autostart) and no time sync record, the wall clock may be wrong\n", p_in);
+    }
+
+    dec_ctrl.inflight = threads * DEC_INFLIGHT;
+    pthread_mutex_init(&dec_ctrl.lock, NULL);
+    pthread_cond_init(&dec_ctrl.cond, NULL);
+
+    pthread_t *p_thread = calloc(threads, sizeof(pthread_t));
+    for (uint32_t i = 0; i < threads; i++) {
+        pthread_create(&p_thread[i], NULL, dec_worker, NULL);
+    }
+    dec_writer();
+    for (uint32_t i = 0; i < threads; i++) {
+        pthread_join(p_thread[i], NULL);
+    }
+
+    for (uint32_t i = 0; i < DEC_OUT_NUM; i++) {
+        if (dec_ctrl.fp_out[i] && dec_ctrl.fp_out[i] != stdout) {
+            fclose(dec_ctrl.fp_out[i]);
+        }
+    }
+    fflush(stdout);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    uint64_t rec_num = 0, resync_num = 0;
+    for (uint32_t i = 0; i < dec_ctrl.chunk_num; i++) {
+        rec_num += dec_ctrl.chunk[i].rec_num;
+        resync_num += dec_ctrl.chunk[i].resync_num;
+    }
+    double sec = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    fprintf(stderr, "%s: %" PRIu64 " records, %" PRIu64 " resync, %u chunks, %u threads, %.3f s, %.1f MB/s\n",
+        p_in, rec_num, resync_num, dec_ctrl.chunk_num, threads, sec, dec_ctrl.size / 1e6 / sec);
+
+    // the bus counters are cumulative, the last record tells the loss of the whole log
+    uint32_t bus_num = 0, bus_alerts = 0;
+    const sdlog_can_bus_t *p_bus = NULL;
+    for (uint32_t i = 0; i < dec_ctrl.chunk_num; i++) {
+        bus_num += dec_ctrl.chunk[i].bus_num;
+        bus_alerts |= dec_ctrl.chunk[i].bus_alerts;
+        if (dec_ctrl.chunk[i].bus_num) {
+            p_bus = &dec_ctrl.chunk[i].bus_last;
+        }
+    }
+    if (p_bus) {
+        fprintf(stderr, "%s: %" PRIu32 " bus records, alerts 0x%05" PRIX32 ", driver lost %" PRIu32 " (queue full) %" PRIu32 " (FIFO overrun), "
+                        "logger dropped %" PRIu32 ", bus errors %" PRIu32 ", arbitration lost %" PRIu32 "\n",
+            p_in, bus_num, bus_alerts, p_bus->rx_missed, p_bus->rx_overrun, p_bus->sdlog_drop, p_bus->bus_error, p_bus->arb_lost);
+    }
+
+    free(p_thread);
+    free(dec_ctrl.chunk);
+    free(dec_ctrl.p_sync);
+    sdlog_fmt_table_free(&dec_ctrl.fmt_table);
+    munmap((void *)dec_ctrl.p_map, dec_ctrl.size);
+    close(fd);
+    return (resync_num == 0) ? 0 : 2;
+}
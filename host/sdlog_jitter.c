@@ -0,0 +1,231 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "driver/twai.h"
+
+#include "sdlog_header.h"
+#include "sdlog_service_private.h"
+
+// Timestamp jitter of a periodic test frame, measured from recorded log.bin files
+// Record the same periodic frame (eg. a 10ms frame of an ECU, or another node running /can_tx in a loop) once with
+// TWAI_RX_TS_CAPTURE=1 and once with TWAI_RX_TS_CAPTURE=0, then compare both logs side by side
+// - period: the delta between two frames, includes the jitter of both ends
+// - phase:  the residual against a least-squares line t = a + k * period, k is the frame index on the sender's grid
+//           (lost frames keep their slot), it's the timestamp error itself, the clock drift of the sender is removed
+
+typedef struct jit_result_s {
+    uint32_t num;
+    uint32_t lost; // empty slots on the sender's grid
+    double period;
+    double period_sd;
+    double period_min;
+    double period_max;
+    double phase_sd;
+    double phase_p99;
+    double phase_max;
+} jit_result_t;
+
+static int jit_cmp_double(const void *a, const void *b)
+{
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+// timestamps of the frames of key, us_sys_time in the record
+static int jit_load(const char *path, uint32_t key, int64_t **pp_ts, uint32_t *p_num)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "can't open %s\n", path);
+        return -1;
+    }
+
+    sdlog_header_t header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 || strncmp(header.sys.magic, "QQMLAB", sizeof(header.sys.magic)) ||
+        header.sys.fmt != SDLOG_FMT_CAN || fseek(fp, header.sys.offset_data, SEEK_SET) != 0) {
+        fprintf(stderr, "%s is not a QQMLAB CAN log\n", path);
+        fclose(fp);
+        return -1;
+    }
+
+    uint32_t num = 0, cap = 4096;
+    int64_t *p_ts = malloc(cap * sizeof(int64_t));
+
+    sdlog_data_t h;
+    while (p_ts && fread(&h, sizeof(h), 1, fp) == 1 && h.magic == 0xA5) {
+        uint32_t pad_sz = (h.payload_len + 7) / 8 * 8;
+        twai_message_t msg;
+        if (h.type_data == SDLOG_CAN_TYPE_FRAME && h.payload_len == sizeof(msg)) {
+            if (fread(&msg, sizeof(msg), 1, fp) != 1) {
+                break;
+            }
+            fseek(fp, pad_sz - sizeof(msg), SEEK_CUR);
+            if ((msg.identifier | ((uint32_t)msg.extd << 31)) != key) {
+                continue;
+            }
+            if (num == cap) {
+                cap *= 2;
+                p_ts = realloc(p_ts, cap * sizeof(int64_t));
+            }
+            if (p_ts) {
+                p_ts[num++] = h.us_sys_time;
+            }
+        } else {
+            fseek(fp, pad_sz, SEEK_CUR);
+        }
+    }
+    fclose(fp);
+
+    if (p_ts == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return -1;
+    }
+    *pp_ts = p_ts;
+    *p_num = num;
+    return 0;
+}
+
+static int jit_analyze(const int64_t *p_ts, uint32_t num, double period, jit_result_t *p_res)
+{
+    memset(p_res, 0, sizeof(*p_res));
+    if (num < 3) {
+        return -1;
+    }
+    double *p_tmp = malloc(num * sizeof(double));
+    if (p_tmp == NULL) {
+        return -1;
+    }
+
+    // nominal period, the median of the deltas unless given
+    for (uint32_t i = 1; i < num; i++) {
+        p_tmp[i - 1] = (double)(p_ts[i] - p_ts[i - 1]);
+    }
+    qsort(p_tmp, num - 1, sizeof(double), jit_cmp_double);
+    if (period <= 0) {
+        period = p_tmp[(num - 1) / 2];
+    }
+    p_res->period_min = p_tmp[0];
+    p_res->period_max = p_tmp[num - 2];
+
+    // period statistics over the consecutive frames only, a lost frame makes a 2x delta
+    double sum = 0, sq_sum = 0;
+    uint32_t n = 0;
+    for (uint32_t i = 1; i < num; i++) {
+        double d = (double)(p_ts[i] - p_ts[i - 1]);
+        if (d < period * 1.5) {
+            sum += d;
+            sq_sum += d * d;
+            n++;
+        }
+    }
+    double mean      = n ? sum / n : period;
+    p_res->period    = mean;
+    p_res->period_sd = n ? sqrt(fmax(sq_sum / n - mean * mean, 0)) : 0;
+    p_res->num       = num;
+
+    // least-squares line on the sender's grid
+    // the slot is counted against a slowly tracked grid, neither a late frame nor a small period error
+    // can walk it off the grid
+    int64_t *p_k = malloc(num * sizeof(int64_t));
+    if (p_k == NULL) {
+        free(p_tmp);
+        return -1;
+    }
+    double sk = 0, st = 0, skk = 0, skt = 0;
+    double grid = 0; // time of the slot p_k[i - 1]
+    for (uint32_t i = 0; i < num; i++) {
+        double t    = (double)(p_ts[i] - p_ts[0]);
+        int64_t adv = i ? llround((t - grid) / mean) : 0;
+        p_k[i]      = i ? p_k[i - 1] + adv : 0;
+        grid += adv * mean;
+        grid += (t - grid) / 32;
+        sk += p_k[i];
+        st += t;
+        skk += (double)p_k[i] * p_k[i];
+        skt += p_k[i] * t;
+    }
+    double det   = num * skk - sk * sk;
+    double slope = (det != 0) ? (num * skt - sk * st) / det : mean;
+    double icpt  = (st - slope * sk) / num;
+    p_res->lost  = (uint32_t)(p_k[num - 1] + 1 - num);
+
+    sq_sum = 0;
+    for (uint32_t i = 0; i < num; i++) {
+        double r = (double)(p_ts[i] - p_ts[0]) - (icpt + slope * p_k[i]);
+        p_tmp[i] = fabs(r);
+        sq_sum += r * r;
+    }
+    qsort(p_tmp, num, sizeof(double), jit_cmp_double);
+    p_res->phase_sd  = sqrt(sq_sum / num);
+    p_res->phase_p99 = p_tmp[(uint32_t)((num - 1) * 0.99)];
+    p_res->phase_max = p_tmp[num - 1];
+
+    free(p_k);
+    free(p_tmp);
+    return 0;
+}
+
+static void jit_usage(const char *prog)
+{
+    fprintf(stderr,
+        "Usage: %s -i id [-x] [-p period_us] log.bin [log.bin ...]\n"
+        "  -i  CAN ID of the periodic test frame (hex)\n"
+        "  -x  the ID is extended\n"
+        "  -p  nominal period in us (default: median of the deltas)\n",
+        prog);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t key  = UINT32_MAX;
+    uint32_t extd = 0;
+    double period = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "i:xp:h")) != -1) {
+        switch (opt) {
+        case 'i':
+            key = strtoul(optarg, NULL, 16);
+            break;
+        case 'x':
+            extd = 1;
+            break;
+        case 'p':
+            period = strtod(optarg, NULL);
+            break;
+        default:
+            jit_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (key == UINT32_MAX || optind >= argc) {
+        jit_usage(argv[0]);
+        return 1;
+    }
+    key |= extd << 31;
+
+    printf("%-32s %8s %6s %10s | %9s %9s %9s | %9s %9s %9s\n",
+        "log", "frames", "lost", "period", "period_sd", "min", "max", "phase_sd", "phase_p99", "phase_max");
+    for (int i = optind; i < argc; i++) {
+        int64_t *p_ts = NULL;
+        uint32_t num  = 0;
+        jit_result_t res;
+        if (jit_load(argv[i], key, &p_ts, &num) != 0) {
+            return 1;
+        }
+        if (jit_analyze(p_ts, num, period, &res) != 0) {
+            printf("%-32s %8" PRIu32 "  not enough frames of the ID\n", argv[i], num);
+        } else {
+            printf("%-32s %8" PRIu32 " %6" PRIu32 " %10.1f | %9.1f %9.0f %9.0f | %9.1f %9.1f %9.1f\n",
+                argv[i], res.num, res.lost, res.period, res.period_sd, res.period_min, res.period_max,
+                res.phase_sd, res.phase_p99, res.phase_max);
+        }
+        free(p_ts);
+    }
+    return 0;
+}
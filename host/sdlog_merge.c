@@ -0,0 +1,415 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "driver/twai.h"
+
+#include "sdlog_header.h"
+#include "sdlog_service.h"
+#include "sdlog_service_private.h"
+#include "sdlog_fmt.h"
+
+// Merge the log.bin files of a logger group (main/group_sync.c) into one time-aligned stream
+//
+//   sdlog_merge [-o out.log] front=front/log.bin rear=rear/log.bin ...
+//
+// Every input is mapped to the wall clock in two steps
+// - member: local esp_timer -> esp_timer of the master, piecewise linear over the beacon records. The UDP latency
+//   only adds delay, so the earliest arrival (min local - master) of every MRG_BEACON_WIN beacons is the point
+// - master esp_timer -> wall clock, by the time sync records of the master's own log when it's an input,
+//   else by the wall clock the master put in the beacons
+// A log without beacons (or the master's log) uses its own time sync records, or the header offset
+//
+// The inputs are only streamed: a pre-scan collects the sync points (fread the record headers, fseek the payloads),
+// then a k-way merge over a min-heap keeps one record per input in RAM
+// Output: candump "(sec.usec) name ID [dlc] XX XX ..", the TEXT logs as "(sec.usec) name: text"
+
+#define MRG_MAX_INPUT (64)
+#define MRG_MAX_PAYLOAD (32768) // the sdlog_task input ring buffer is 32KB, no record is larger
+#define MRG_BEACON_WIN (8)      // beacons per point of the member -> master mapping
+#define MRG_DATA_MAGIC (0xA5)
+#define MRG_TEXT_MAX (1024)     // a deferred text record is formatted up to this
+
+// ----------
+// data structure definition
+// ----------
+typedef struct mrg_points_s {
+    sdlog_time_sync_t *p; // .us_sys_time -> .us_epoch_time, reused for the master esp_timer mapping
+    uint32_t num;
+    uint32_t cap;
+    uint32_t idx; // cursor of sdlog_time_sync_abs_us()
+} mrg_points_t;
+
+typedef struct mrg_input_s {
+    const char *name;
+    const char *path;
+    FILE *fp;
+    sdlog_header_t header;
+
+    mrg_points_t sync;        // own time sync records
+    mrg_points_t to_master;   // member: local esp_timer -> master esp_timer
+    mrg_points_t master_wall; // master esp_timer -> wall clock, from the beacons
+    uint32_t is_master;
+    char master[16];
+    sdlog_fmt_table_t fmt_table; // string table of the deferred text records, the entries come before their use
+
+    // merge cursor
+    sdlog_data_t rec;
+    uint8_t *p_payload;
+    uint64_t abs_us;
+    uint64_t rec_num;
+} mrg_input_t;
+
+typedef struct mrg_ctrl_s {
+    mrg_input_t in[MRG_MAX_INPUT];
+    uint32_t in_num;
+    mrg_input_t *p_master; // the input with is_master beacons, NULL if the master's log isn't given
+    uint32_t heap[MRG_MAX_INPUT];
+    uint32_t heap_num;
+    FILE *fp_out;
+} mrg_ctrl_t;
+
+static mrg_ctrl_t mrg_ctrl;
+
+// ----------
+// sync points
+// ----------
+static void mrg_points_add(mrg_points_t *p_pt, uint64_t from, uint64_t to)
+{
+    if (p_pt->num && from < p_pt->p[p_pt->num - 1].us_sys_time) {
+        return; // out of order (eg. the master rebooted), the interpolation needs sorted points
+    }
+    if (p_pt->num == p_pt->cap) {
+        p_pt->cap = p_pt->cap ? p_pt->cap * 2 : 64;
+        p_pt->p   = realloc(p_pt->p, p_pt->cap * sizeof(sdlog_time_sync_t));
+        if (p_pt->p == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    sdlog_time_sync_t *p_sync = &p_pt->p[p_pt->num++];
+    memset(p_sync, 0, sizeof(*p_sync));
+    p_sync->us_sys_time   = from;
+    p_sync->us_epoch_time = to;
+}
+
+static uint64_t mrg_points_map(mrg_points_t *p_pt, uint64_t us)
+{
+    return sdlog_time_sync_abs_us(p_pt->p, p_pt->num, &p_pt->idx, us);
+}
+
+// ----------
+// input
+// ----------
+static int mrg_rec_read(mrg_input_t *p_in)
+{
+    if (fread(&p_in->rec, sizeof(p_in->rec), 1, p_in->fp) != 1) {
+        return 0;
+    }
+    if (p_in->rec.magic != MRG_DATA_MAGIC || p_in->rec.payload_len > MRG_MAX_PAYLOAD) {
+        fprintf(stderr, "%s: corrupted record at 0x%lx, the rest is skipped\n", p_in->name, ftell(p_in->fp) - (long)sizeof(p_in->rec));
+        return 0;
+    }
+
+    uint32_t pad_sz = (p_in->rec.payload_len + 7) / 8 * 8;
+    return fread(p_in->p_payload, 1, pad_sz, p_in->fp) == pad_sz;
+}
+
+static uint32_t mrg_is_sync_rec(const sdlog_data_t *p_rec)
+{
+    return (p_rec->type_data == SDLOG_TYPE_TIME_SYNC && p_rec->payload_len == sizeof(sdlog_time_sync_t)) ||
+           (p_rec->type_data == SDLOG_TYPE_GROUP_BEACON && p_rec->payload_len == sizeof(sdlog_group_beacon_t));
+}
+
+static int mrg_open(mrg_input_t *p_in)
+{
+    p_in->fp        = fopen(p_in->path, "rb");
+    p_in->p_payload = malloc(MRG_MAX_PAYLOAD + 8);
+    if (p_in->fp == NULL || p_in->p_payload == NULL) {
+        fprintf(stderr, "can't open %s\n", p_in->path);
+        return -1;
+    }
+    if (fread(&p_in->header, sizeof(p_in->header), 1, p_in->fp) != 1 ||
+        strncmp(p_in->header.sys.magic, "QQMLAB", sizeof(p_in->header.sys.magic)) != 0) {
+        fprintf(stderr, "%s is not a QQMLAB log\n", p_in->path);
+        return -1;
+    }
+    return fseek(p_in->fp, p_in->header.sys.offset_data, SEEK_SET);
+}
+
+// pre-scan, the time sync records and the beacons of one input
+static void mrg_scan(mrg_input_t *p_in)
+{
+    uint64_t win_from = 0, win_to = 0;
+    int64_t win_offset = INT64_MAX;
+    uint32_t win_num   = 0;
+
+    while (1) {
+        if (fread(&p_in->rec, sizeof(p_in->rec), 1, p_in->fp) != 1 || p_in->rec.magic != MRG_DATA_MAGIC ||
+            p_in->rec.payload_len > MRG_MAX_PAYLOAD) {
+            break;
+        }
+        uint32_t pad_sz = (p_in->rec.payload_len + 7) / 8 * 8;
+        if (!mrg_is_sync_rec(&p_in->rec)) {
+            fseek(p_in->fp, pad_sz, SEEK_CUR);
+            continue;
+        }
+        if (fread(p_in->p_payload, 1, pad_sz, p_in->fp) != pad_sz) {
+            break;
+        }
+
+        if (p_in->rec.type_data == SDLOG_TYPE_TIME_SYNC) {
+            const sdlog_time_sync_t *p_sync = (const sdlog_time_sync_t *)p_in->p_payload;
+            mrg_points_add(&p_in->sync, p_sync->us_sys_time, p_sync->us_epoch_time);
+            continue;
+        }
+
+        const sdlog_group_beacon_t *p_beacon = (const sdlog_group_beacon_t *)p_in->p_payload;
+        memcpy(p_in->master, p_beacon->master, sizeof(p_in->master) - 1);
+        if (p_beacon->is_master) {
+            p_in->is_master = 1;
+            continue;
+        }
+        if (p_beacon->us_epoch_time) {
+            mrg_points_add(&p_in->master_wall, p_beacon->us_sys_time, p_beacon->us_epoch_time);
+        }
+
+        int64_t offset = (int64_t)(p_in->rec.us_sys_time - p_beacon->us_sys_time);
+        if (offset < win_offset) {
+            win_offset = offset;
+            win_from   = p_in->rec.us_sys_time;
+            win_to     = p_beacon->us_sys_time;
+        }
+        if (++win_num == MRG_BEACON_WIN) {
+            mrg_points_add(&p_in->to_master, win_from, win_to);
+            win_offset = INT64_MAX;
+            win_num    = 0;
+        }
+    }
+    if (win_num) {
+        mrg_points_add(&p_in->to_master, win_from, win_to);
+    }
+}
+
+// record time -> wall clock
+static uint64_t mrg_abs_us(mrg_input_t *p_in, uint64_t us_sys_time)
+{
+    if (!p_in->is_master && p_in->to_master.num) {
+        uint64_t us_master = mrg_points_map(&p_in->to_master, us_sys_time);
+        if (mrg_ctrl.p_master) {
+            return mrg_abs_us(mrg_ctrl.p_master, us_master);
+        }
+        if (p_in->master_wall.num) {
+            return mrg_points_map(&p_in->master_wall, us_master);
+        }
+    }
+    if (p_in->sync.num) {
+        return mrg_points_map(&p_in->sync, us_sys_time);
+    }
+    return p_in->header.sys.us_epoch_time + (us_sys_time - p_in->header.sys.us_sys_time);
+}
+
+// ----------
+// k-way merge
+// ----------
+static int mrg_less(uint32_t a, uint32_t b)
+{
+    const mrg_input_t *p_a = &mrg_ctrl.in[a];
+    const mrg_input_t *p_b = &mrg_ctrl.in[b];
+    return (p_a->abs_us < p_b->abs_us) || (p_a->abs_us == p_b->abs_us && a < b); // the input order breaks the tie
+}
+
+static void mrg_heap_down(uint32_t i)
+{
+    while (1) {
+        uint32_t l = 2 * i + 1, r = l + 1, m = i;
+        if (l < mrg_ctrl.heap_num && mrg_less(mrg_ctrl.heap[l], mrg_ctrl.heap[m])) {
+            m = l;
+        }
+        if (r < mrg_ctrl.heap_num && mrg_less(mrg_ctrl.heap[r], mrg_ctrl.heap[m])) {
+            m = r;
+        }
+        if (m == i) {
+            return;
+        }
+        uint32_t tmp     = mrg_ctrl.heap[i];
+        mrg_ctrl.heap[i] = mrg_ctrl.heap[m];
+        mrg_ctrl.heap[m] = tmp;
+        i                = m;
+    }
+}
+
+// the continuation records of a long console message are joined into the payload of the first one
+static void mrg_text_join(mrg_input_t *p_in)
+{
+    sdlog_data_t next;
+    while (fread(&next, sizeof(next), 1, p_in->fp) == 1) {
+        uint32_t pad_sz = (next.payload_len + 7) / 8 * 8;
+        if (next.magic != MRG_DATA_MAGIC || next.type_data != SDLOG_FMT_TEXT__CONT || p_in->rec.payload_len + pad_sz > MRG_MAX_PAYLOAD) {
+            fseek(p_in->fp, -(long)sizeof(next), SEEK_CUR); // not ours, the next mrg_rec_read() takes it
+            return;
+        }
+        if (fread(p_in->p_payload + p_in->rec.payload_len, 1, pad_sz, p_in->fp) != pad_sz) {
+            return;
+        }
+        p_in->rec.payload_len += next.payload_len;
+    }
+}
+
+// next record worth writing, 0 at EOF
+static int mrg_next(mrg_input_t *p_in)
+{
+    uint32_t fmt = p_in->header.sys.fmt;
+    while (mrg_rec_read(p_in)) {
+        uint32_t type = p_in->rec.type_data;
+        if (fmt == SDLOG_FMT_TEXT && type == SDLOG_FMT_TEXT__FMT) {
+            sdlog_fmt_table_add(&p_in->fmt_table, p_in->p_payload, p_in->rec.payload_len);
+            continue;
+        }
+        if (fmt == SDLOG_FMT_TEXT && (type == SDLOG_FMT_TEXT__BIN || type == SDLOG_FMT_TEXT__HTTP)) { // formatted into the payload, written as a text
+            char text[MRG_TEXT_MAX];
+            p_in->rec.payload_len = (type == SDLOG_FMT_TEXT__HTTP) ? sdlog_fmt_render_http(p_in->p_payload, p_in->rec.payload_len, text, sizeof(text))
+                                                                   : sdlog_fmt_render_rec(&p_in->fmt_table, p_in->p_payload, p_in->rec.payload_len, text, sizeof(text));
+            memcpy(p_in->p_payload, text, p_in->rec.payload_len);
+            p_in->abs_us = mrg_abs_us(p_in, p_in->rec.us_sys_time);
+            return 1;
+        }
+        if ((fmt == SDLOG_FMT_CAN && type == SDLOG_CAN_TYPE_FRAME && p_in->rec.payload_len == sizeof(twai_message_t)) ||
+            (fmt == SDLOG_FMT_TEXT && type == SDLOG_FMT_TEXT__STRING)) {
+            if (fmt == SDLOG_FMT_TEXT) {
+                mrg_text_join(p_in);
+            }
+            p_in->abs_us = mrg_abs_us(p_in, p_in->rec.us_sys_time);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void mrg_write(mrg_input_t *p_in)
+{
+    FILE *fp        = mrg_ctrl.fp_out;
+    uint64_t abs_us = p_in->abs_us;
+    p_in->rec_num++;
+
+    fprintf(fp, "(%" PRIu64 ".%06" PRIu64 ") %s", abs_us / 1000000, abs_us % 1000000, p_in->name);
+    if (p_in->header.sys.fmt == SDLOG_FMT_CAN) {
+        const twai_message_t *p_can = (const twai_message_t *)p_in->p_payload;
+        uint32_t dlc                = (p_can->data_length_code > TWAI_FRAME_MAX_DLC) ? TWAI_FRAME_MAX_DLC : p_can->data_length_code;
+        fprintf(fp, p_can->extd ? " %08" PRIX32 " [%" PRIu32 "]" : " %03" PRIX32 " [%" PRIu32 "]", p_can->identifier, dlc);
+        for (uint32_t i = 0; i < dlc; i++) {
+            fprintf(fp, " %02X", p_can->data[i]);
+        }
+        fputc('\n', fp);
+    } else {
+        uint32_t len = p_in->rec.payload_len;
+        while (len && (p_in->p_payload[len - 1] == '\n' || p_in->p_payload[len - 1] == '\0')) {
+            len--;
+        }
+        fprintf(fp, ": %.*s\n", (int)len, (const char *)p_in->p_payload);
+    }
+}
+
+static void mrg_run(void)
+{
+    for (uint32_t i = 0; i < mrg_ctrl.in_num; i++) {
+        mrg_input_t *p_in = &mrg_ctrl.in[i];
+        fseek(p_in->fp, p_in->header.sys.offset_data, SEEK_SET);
+        if (mrg_next(p_in)) {
+            mrg_ctrl.heap[mrg_ctrl.heap_num++] = i;
+        }
+    }
+    for (int32_t i = mrg_ctrl.heap_num / 2 - 1; i >= 0; i--) {
+        mrg_heap_down(i);
+    }
+
+    while (mrg_ctrl.heap_num) {
+        mrg_input_t *p_in = &mrg_ctrl.in[mrg_ctrl.heap[0]];
+        mrg_write(p_in);
+        if (!mrg_next(p_in)) {
+            mrg_ctrl.heap[0] = mrg_ctrl.heap[--mrg_ctrl.heap_num];
+        }
+        mrg_heap_down(0);
+    }
+}
+
+// ----------
+// main
+// ----------
+static void mrg_usage(void)
+{
+    fprintf(stderr, "usage: sdlog_merge [-o out.log] name=log.bin [name=log.bin ...]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    const char *out_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (argv[i][0] == '-' || mrg_ctrl.in_num == MRG_MAX_INPUT) {
+            mrg_usage();
+        } else {
+            mrg_input_t *p_in = &mrg_ctrl.in[mrg_ctrl.in_num++];
+            char *p_eq        = strchr(argv[i], '=');
+            p_in->name        = argv[i];
+            p_in->path        = argv[i];
+            if (p_eq) {
+                *p_eq      = '\0';
+                p_in->path = p_eq + 1;
+            }
+        }
+    }
+    if (mrg_ctrl.in_num == 0) {
+        mrg_usage();
+    }
+
+    for (uint32_t i = 0; i < mrg_ctrl.in_num; i++) {
+        mrg_input_t *p_in = &mrg_ctrl.in[i];
+        if (mrg_open(p_in) != 0) {
+            return 1;
+        }
+        mrg_scan(p_in);
+        if (p_in->is_master && mrg_ctrl.p_master == NULL) {
+            mrg_ctrl.p_master = p_in;
+        }
+    }
+
+    for (uint32_t i = 0; i < mrg_ctrl.in_num; i++) {
+        mrg_input_t *p_in = &mrg_ctrl.in[i];
+        const char *p_ref = "own time sync";
+        if (p_in->header.sys.epoch_src == SDLOG_EPOCH_PROVISIONAL && p_in->sync.num == 0) {
+            p_ref = "provisional epoch (device clock at autostart)";
+        }
+        if (p_in->is_master) {
+            p_ref = "master";
+        } else if (p_in->to_master.num && mrg_ctrl.p_master) {
+            p_ref = "beacons + master log";
+        } else if (p_in->to_master.num && p_in->master_wall.num) {
+            p_ref = "beacons + master wall clock";
+        }
+        fprintf(stderr, "%s: %s, group master %s, %" PRIu32 " time sync, %" PRIu32 " beacon points, aligned by %s\n", p_in->name,
+            p_in->path, p_in->master[0] ? p_in->master : "-", p_in->sync.num, p_in->to_master.num, p_ref);
+    }
+
+    mrg_ctrl.fp_out = out_path ? fopen(out_path, "w") : stdout;
+    if (mrg_ctrl.fp_out == NULL) {
+        fprintf(stderr, "can't open %s\n", out_path);
+        return 1;
+    }
+    mrg_run();
+
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < mrg_ctrl.in_num; i++) {
+        total += mrg_ctrl.in[i].rec_num;
+        fclose(mrg_ctrl.in[i].fp);
+        sdlog_fmt_table_free(&mrg_ctrl.in[i].fmt_table);
+    }
+    if (out_path) {
+        fclose(mrg_ctrl.fp_out);
+    }
+    fprintf(stderr, "%" PRIu64 " records merged from %" PRIu32 " logs\n", total, mrg_ctrl.in_num);
+    return 0;
+}
@@ -0,0 +1,7 @@
+#ifndef __ESP_CHECK_H__
+#define __ESP_CHECK_H__
+
+#include "esp_err.h"
+#include "esp_log.h"
+
+#endif // __ESP_CHECK_H__
@@ -0,0 +1,28 @@
+#ifndef __ESP_LOG_H__
+#define __ESP_LOG_H__
+
+#include <stdarg.h>
+#include "esp_err.h"
+
+typedef enum {
+    ESP_LOG_NONE = 0,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+typedef int (*vprintf_like_t)(const char *, va_list);
+
+// The tag is ignored, only the global level is kept on host
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func);
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+#define ESP_LOGE(tag, format, ...) esp_log_write(ESP_LOG_ERROR, tag, "E %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) esp_log_write(ESP_LOG_WARN, tag, "W %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) esp_log_write(ESP_LOG_INFO, tag, "I %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) esp_log_write(ESP_LOG_DEBUG, tag, "D %s: " format "\n", tag, ##__VA_ARGS__)
+
+#endif // __ESP_LOG_H__
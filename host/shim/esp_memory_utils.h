@@ -0,0 +1,12 @@
+#ifndef __ESP_MEMORY_UTILS_H__
+#define __ESP_MEMORY_UTILS_H__
+
+#include <stdbool.h>
+
+// every address of the process stays valid for its whole run, a string literal in particular
+static inline bool esp_ptr_in_drom(const void *p)
+{
+    return p != NULL;
+}
+
+#endif // __ESP_MEMORY_UTILS_H__
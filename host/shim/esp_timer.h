@@ -0,0 +1,8 @@
+#ifndef __ESP_TIMER_H__
+#define __ESP_TIMER_H__
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void); // CLOCK_MONOTONIC in micro-second
+
+#endif // __ESP_TIMER_H__
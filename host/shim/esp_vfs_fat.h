@@ -0,0 +1,10 @@
+#ifndef __ESP_VFS_FAT_H__
+#define __ESP_VFS_FAT_H__
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// size and free space of the file system holding base_path, statvfs() on host
+esp_err_t esp_vfs_fat_info(const char *base_path, uint64_t *out_total_bytes, uint64_t *out_free_bytes);
+
+#endif // __ESP_VFS_FAT_H__
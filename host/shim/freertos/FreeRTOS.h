@@ -0,0 +1,48 @@
+#ifndef __FREERTOS_H__
+#define __FREERTOS_H__
+
+// Thin POSIX stand-in of the FreeRTOS API used by the sdlog core
+// - tasks are detached pthreads, priority/stack size/core affinity are ignored
+// - one tick is one milli-second
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE (1)
+#define pdFALSE (0)
+#define pdPASS (pdTRUE)
+#define pdFAIL (pdFALSE)
+
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFF)
+#define portTICK_PERIOD_MS (1)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#define configNUMBER_OF_CORES (1)
+#define tskNO_AFFINITY (0x7FFFFFFF)
+
+// ----------
+// task
+// ----------
+typedef struct host_task_s *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *param, UBaseType_t prio, TaskHandle_t *p_handle);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *param, UBaseType_t prio, TaskHandle_t *p_handle, BaseType_t core);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+
+// ----------
+// queue
+// ----------
+typedef struct host_queue_s *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+BaseType_t xQueueSend(QueueHandle_t q, const void *p_item, TickType_t ticks_to_wait);
+BaseType_t xQueueReceive(QueueHandle_t q, void *p_item, TickType_t ticks_to_wait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q);
+
+#endif // __FREERTOS_H__
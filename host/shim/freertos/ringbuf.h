@@ -0,0 +1,23 @@
+#ifndef __FREERTOS_RINGBUF_H__
+#define __FREERTOS_RINGBUF_H__
+
+#include "freertos/FreeRTOS.h"
+
+// Only RINGBUF_TYPE_NOSPLIT is implemented, with a single consumer returning items in order
+typedef enum {
+    RINGBUF_TYPE_NOSPLIT = 0,
+    RINGBUF_TYPE_ALLOWSPLIT,
+    RINGBUF_TYPE_BYTEBUF,
+} RingbufferType_t;
+
+typedef struct host_ringbuf_s *RingbufHandle_t;
+
+RingbufHandle_t xRingbufferCreate(size_t buf_sz, RingbufferType_t type);
+BaseType_t xRingbufferSendAcquire(RingbufHandle_t rb, void **pp_item, size_t item_sz, TickType_t ticks_to_wait);
+BaseType_t xRingbufferSendComplete(RingbufHandle_t rb, void *p_item);
+BaseType_t xRingbufferSend(RingbufHandle_t rb, const void *p_item, size_t item_sz, TickType_t ticks_to_wait);
+void *xRingbufferReceive(RingbufHandle_t rb, size_t *p_item_sz, TickType_t ticks_to_wait);
+void vRingbufferReturnItem(RingbufHandle_t rb, void *p_item);
+size_t xRingbufferGetCurFreeSize(RingbufHandle_t rb);
+
+#endif // __FREERTOS_RINGBUF_H__
@@ -0,0 +1,31 @@
+#ifndef __HOST_PORT_H__
+#define __HOST_PORT_H__
+
+// Force-included into every translation unit of the host build (see host/CMakeLists.txt)
+// It fills the gaps between newlib (ESP-IDF) and glibc, so the sources in main/ build unmodified
+
+#include <stddef.h>
+#include <stdint.h>
+
+// glibc < 2.38 has no strlcpy(), newlib does
+#define strlcpy host_strlcpy
+size_t host_strlcpy(char *dst, const char *src, size_t size);
+
+// ----------
+// Allocation statistics, malloc/calloc/realloc/free are wrapped by the linker (-Wl,--wrap)
+// ----------
+typedef struct host_alloc_stat_s {
+    uint64_t alloc_cnt;   // number of successful malloc/calloc/realloc
+    uint64_t free_cnt;    // number of free() with non-NULL pointer
+    uint64_t alloc_bytes; // total requested bytes
+} host_alloc_stat_t;
+
+void host_alloc_stat(host_alloc_stat_t *p_stat);
+
+// ----------
+// SD card fault injection (shim_sdcard.c), fopen/fwrite/ferror/fclose are wrapped by the linker
+// ----------
+void host_sd_fault_set(uint32_t removed); // 1: the card is pulled out, 0: inserted again
+void host_sd_fault_stat(uint32_t *p_fault_cnt, uint32_t *p_mount_cnt);
+
+#endif // __HOST_PORT_H__
@@ -0,0 +1,25 @@
+#ifndef __NVS_H__
+#define __NVS_H__
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// RAM only key/value store, one namespace, it lives as long as the process
+typedef uint32_t nvs_handle_t;
+
+typedef enum {
+    NVS_READONLY,
+    NVS_READWRITE,
+} nvs_open_mode_t;
+
+#define ESP_ERR_NVS_BASE (0x1100)
+#define ESP_ERR_NVS_NOT_FOUND (ESP_ERR_NVS_BASE + 0x02)
+#define ESP_ERR_NVS_NOT_ENOUGH_SPACE (ESP_ERR_NVS_BASE + 0x05)
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle);
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value);
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value);
+esp_err_t nvs_commit(nvs_handle_t handle);
+void nvs_close(nvs_handle_t handle);
+
+#endif // __NVS_H__
@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <sys/statvfs.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "esp_vfs_fat.h"
+
+// ----------
+// esp_timer
+// ----------
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// ----------
+// esp_log
+// ----------
+static int _host_log_vprintf(const char *fmt, va_list args)
+{
+    return vfprintf(stderr, fmt, args);
+}
+
+static esp_log_level_t host_log_level = ESP_LOG_INFO;
+static vprintf_like_t host_log_func   = _host_log_vprintf;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    host_log_level = level;
+}
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func)
+{
+    vprintf_like_t orig = host_log_func;
+    host_log_func       = func;
+    return orig;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    if (level > host_log_level) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    host_log_func(format, args);
+    va_end(args);
+}
+
+// ----------
+// nvs
+// ----------
+#define HOST_NVS_NUM (16)
+
+typedef struct host_nvs_s {
+    char key[16]; // NVS_KEY_NAME_MAX_SIZE
+    uint32_t value;
+} host_nvs_t;
+
+static host_nvs_t host_nvs[HOST_NVS_NUM];
+
+static host_nvs_t *_host_nvs_find(const char *key, int create)
+{
+    for (uint32_t i = 0; i < HOST_NVS_NUM; i++) {
+        if (strcmp(host_nvs[i].key, key) == 0) {
+            return &host_nvs[i];
+        }
+        if (host_nvs[i].key[0] == '\0') {
+            if (!create) {
+                return NULL;
+            }
+            strncpy(host_nvs[i].key, key, sizeof(host_nvs[i].key) - 1);
+            return &host_nvs[i];
+        }
+    }
+    return NULL;
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value)
+{
+    host_nvs_t *p_kv = _host_nvs_find(key, 0);
+    if (p_kv == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    *out_value = p_kv->value;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+    host_nvs_t *p_kv = _host_nvs_find(key, 1);
+    if (p_kv == NULL) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+    p_kv->value = value;
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+// ----------
+// esp_vfs_fat
+// ----------
+esp_err_t esp_vfs_fat_info(const char *base_path, uint64_t *out_total_bytes, uint64_t *out_free_bytes)
+{
+    struct statvfs st;
+    if (statvfs(base_path, &st) != 0) {
+        return ESP_FAIL;
+    }
+    *out_total_bytes = (uint64_t)st.f_blocks * st.f_frsize;
+    *out_free_bytes  = (uint64_t)st.f_bavail * st.f_frsize;
+    return ESP_OK;
+}
+
+// ----------
+// libc gaps
+// ----------
+size_t host_strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t len = strlen(src);
+    if (size) {
+        size_t n = (len >= size) ? size - 1 : len;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+
+// ----------
+// allocation counters (-Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free)
+// ----------
+static host_alloc_stat_t host_alloc;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static void _host_alloc_count(void *ptr, size_t size)
+{
+    if (ptr) {
+        __atomic_fetch_add(&host_alloc.alloc_cnt, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&host_alloc.alloc_bytes, size, __ATOMIC_RELAXED);
+    }
+}
+
+void *__wrap_malloc(size_t size)
+{
+    void *ptr = __real_malloc(size);
+    _host_alloc_count(ptr, size);
+    return ptr;
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+    void *ptr = __real_calloc(nmemb, size);
+    _host_alloc_count(ptr, nmemb * size);
+    return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    void *p_new = __real_realloc(ptr, size);
+    _host_alloc_count(p_new, size);
+    return p_new;
+}
+
+void __wrap_free(void *ptr)
+{
+    if (ptr) {
+        __atomic_fetch_add(&host_alloc.free_cnt, 1, __ATOMIC_RELAXED);
+    }
+    __real_free(ptr);
+}
+
+void host_alloc_stat(host_alloc_stat_t *p_stat)
+{
+    p_stat->alloc_cnt   = __atomic_load_n(&host_alloc.alloc_cnt, __ATOMIC_RELAXED);
+    p_stat->free_cnt    = __atomic_load_n(&host_alloc.free_cnt, __ATOMIC_RELAXED);
+    p_stat->alloc_bytes = __atomic_load_n(&host_alloc.alloc_bytes, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,377 @@
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/ringbuf.h"
+
+// ----------
+// Blocking helpers, every primitive owns a mutex + a condition variable on CLOCK_MONOTONIC
+// ----------
+static void _host_cond_init(pthread_cond_t *p_cond)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(p_cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+static struct timespec _host_deadline(TickType_t ticks)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += ticks / 1000;
+    ts.tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+// return 0 if the caller should give up (no wait requested or timed out)
+static int _host_wait(pthread_cond_t *p_cond, pthread_mutex_t *p_lock, TickType_t ticks, const struct timespec *p_deadline)
+{
+    if (ticks == 0) {
+        return 0;
+    } else if (ticks == portMAX_DELAY) {
+        pthread_cond_wait(p_cond, p_lock);
+        return 1;
+    }
+    return pthread_cond_timedwait(p_cond, p_lock, p_deadline) != ETIMEDOUT;
+}
+
+// ----------
+// task
+// ----------
+struct host_task_s {
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *param;
+};
+
+static void *_host_task_entry(void *arg)
+{
+    struct host_task_s *p_task = arg;
+    p_task->fn(p_task->param);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *param, UBaseType_t prio, TaskHandle_t *p_handle)
+{
+    struct host_task_s *p_task = calloc(1, sizeof(struct host_task_s));
+    if (p_task == NULL) {
+        return pdFAIL;
+    }
+    p_task->fn    = fn;
+    p_task->param = param;
+
+    if (pthread_create(&p_task->thread, NULL, _host_task_entry, p_task) != 0) {
+        free(p_task);
+        return pdFAIL;
+    }
+    pthread_detach(p_task->thread);
+
+    if (p_handle) {
+        *p_handle = p_task;
+    }
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *param, UBaseType_t prio, TaskHandle_t *p_handle, BaseType_t core)
+{
+    return xTaskCreate(fn, name, stack_depth, param, prio, p_handle);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    usleep((useconds_t)ticks * 1000);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (TickType_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+// ----------
+// queue
+// ----------
+struct host_queue_s {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint8_t *storage;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    struct host_queue_s *q = calloc(1, sizeof(struct host_queue_s));
+    if (q == NULL) {
+        return NULL;
+    }
+    q->storage = malloc((size_t)length * item_size);
+    if (q->storage == NULL) {
+        free(q);
+        return NULL;
+    }
+    q->length    = length;
+    q->item_size = item_size;
+    pthread_mutex_init(&q->lock, NULL);
+    _host_cond_init(&q->cond);
+    return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *p_item, TickType_t ticks_to_wait)
+{
+    struct timespec deadline = _host_deadline(ticks_to_wait);
+    BaseType_t ret           = pdFAIL;
+
+    pthread_mutex_lock(&q->lock);
+    while (1) {
+        if (q->count < q->length) {
+            UBaseType_t idx = (q->head + q->count) % q->length;
+            memcpy(q->storage + idx * q->item_size, p_item, q->item_size);
+            q->count++;
+            pthread_cond_broadcast(&q->cond);
+            ret = pdPASS;
+            break;
+        }
+        if (!_host_wait(&q->cond, &q->lock, ticks_to_wait, &deadline)) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ret;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *p_item, TickType_t ticks_to_wait)
+{
+    struct timespec deadline = _host_deadline(ticks_to_wait);
+    BaseType_t ret           = pdFAIL;
+
+    pthread_mutex_lock(&q->lock);
+    while (1) {
+        if (q->count) {
+            memcpy(p_item, q->storage + q->head * q->item_size, q->item_size);
+            q->head = (q->head + 1) % q->length;
+            q->count--;
+            pthread_cond_broadcast(&q->cond);
+            ret = pdPASS;
+            break;
+        }
+        if (!_host_wait(&q->cond, &q->lock, ticks_to_wait, &deadline)) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ret;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    UBaseType_t count = q->count;
+    pthread_mutex_unlock(&q->lock);
+    return count;
+}
+
+// ----------
+// ring buffer (NOSPLIT)
+// ----------
+// Each item is [rb_item_hdr_t][payload padded to 8 bytes]
+// When an item doesn't fit at the end, the rest of the buffer is filled with a DUMMY item and it wraps to 0
+// Items are handed to the reader only after SendComplete(), in the acquired order
+#define RB_FLAG_DONE (1 << 0)
+#define RB_FLAG_READ (1 << 1)
+#define RB_FLAG_DUMMY (1 << 2)
+
+typedef struct rb_item_hdr_s {
+    uint32_t len;
+    uint32_t flags;
+} rb_item_hdr_t;
+
+struct host_ringbuf_s {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint8_t *buf;
+    size_t size;
+    size_t head; // oldest item
+    size_t tail; // next free byte
+    size_t used; // bytes between head and tail, including the DUMMY region
+};
+
+static size_t _rb_item_sz(size_t len)
+{
+    return sizeof(rb_item_hdr_t) + (len + 7) / 8 * 8;
+}
+
+RingbufHandle_t xRingbufferCreate(size_t buf_sz, RingbufferType_t type)
+{
+    assert(type == RINGBUF_TYPE_NOSPLIT);
+
+    struct host_ringbuf_s *rb = calloc(1, sizeof(struct host_ringbuf_s));
+    if (rb == NULL) {
+        return NULL;
+    }
+    rb->size = buf_sz / 8 * 8;
+    rb->buf  = malloc(rb->size);
+    if (rb->buf == NULL) {
+        free(rb);
+        return NULL;
+    }
+    pthread_mutex_init(&rb->lock, NULL);
+    _host_cond_init(&rb->cond);
+    return rb;
+}
+
+// called with lock held, return the item header or NULL if no contiguous room
+static rb_item_hdr_t *_rb_reserve(struct host_ringbuf_s *rb, size_t need)
+{
+    if (rb->used == 0) {
+        rb->head = rb->tail = 0; // empty, restart from the beginning to get the largest room
+    }
+
+    if (rb->tail > rb->head || rb->used == 0) { // free room is [tail, size) + [0, head)
+        if (rb->size - rb->tail < need) {
+            if (rb->head < need) {
+                return NULL;
+            }
+            if (rb->tail < rb->size) {
+                rb_item_hdr_t *p_dummy = (rb_item_hdr_t *)(rb->buf + rb->tail);
+                p_dummy->len           = 0;
+                p_dummy->flags         = RB_FLAG_DUMMY;
+                rb->used += rb->size - rb->tail;
+            }
+            rb->tail = 0;
+        }
+    } else if (rb->head - rb->tail < need) { // free room is [tail, head)
+        return NULL;
+    }
+
+    rb_item_hdr_t *p_hdr = (rb_item_hdr_t *)(rb->buf + rb->tail);
+    rb->tail += need;
+    rb->used += need;
+    return p_hdr;
+}
+
+BaseType_t xRingbufferSendAcquire(RingbufHandle_t rb, void **pp_item, size_t item_sz, TickType_t ticks_to_wait)
+{
+    struct timespec deadline = _host_deadline(ticks_to_wait);
+    size_t need              = _rb_item_sz(item_sz);
+    BaseType_t ret           = pdFALSE;
+
+    *pp_item = NULL;
+    if (need > rb->size) {
+        return pdFALSE;
+    }
+
+    pthread_mutex_lock(&rb->lock);
+    while (1) {
+        rb_item_hdr_t *p_hdr = _rb_reserve(rb, need);
+        if (p_hdr) {
+            p_hdr->len   = item_sz;
+            p_hdr->flags = 0;
+            *pp_item     = p_hdr + 1;
+            ret          = pdTRUE;
+            break;
+        }
+        if (!_host_wait(&rb->cond, &rb->lock, ticks_to_wait, &deadline)) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&rb->lock);
+    return ret;
+}
+
+BaseType_t xRingbufferSendComplete(RingbufHandle_t rb, void *p_item)
+{
+    rb_item_hdr_t *p_hdr = (rb_item_hdr_t *)p_item - 1;
+
+    pthread_mutex_lock(&rb->lock);
+    p_hdr->flags |= RB_FLAG_DONE;
+    pthread_cond_broadcast(&rb->cond);
+    pthread_mutex_unlock(&rb->lock);
+    return pdTRUE;
+}
+
+BaseType_t xRingbufferSend(RingbufHandle_t rb, const void *p_item, size_t item_sz, TickType_t ticks_to_wait)
+{
+    void *p_buf;
+    if (xRingbufferSendAcquire(rb, &p_buf, item_sz, ticks_to_wait) != pdTRUE) {
+        return pdFALSE;
+    }
+    memcpy(p_buf, p_item, item_sz);
+    return xRingbufferSendComplete(rb, p_buf);
+}
+
+void *xRingbufferReceive(RingbufHandle_t rb, size_t *p_item_sz, TickType_t ticks_to_wait)
+{
+    struct timespec deadline = _host_deadline(ticks_to_wait);
+    void *p_item             = NULL;
+
+    pthread_mutex_lock(&rb->lock);
+    while (1) {
+        if (rb->used) {
+            rb_item_hdr_t *p_hdr = (rb_item_hdr_t *)(rb->buf + rb->head);
+            if (p_hdr->flags & RB_FLAG_DUMMY) { // skip the wrap padding
+                rb->used -= rb->size - rb->head;
+                rb->head = 0;
+                continue;
+            }
+            if ((p_hdr->flags & (RB_FLAG_DONE | RB_FLAG_READ)) == RB_FLAG_DONE) {
+                p_hdr->flags |= RB_FLAG_READ;
+                *p_item_sz = p_hdr->len;
+                p_item     = p_hdr + 1;
+                break;
+            }
+        }
+        if (!_host_wait(&rb->cond, &rb->lock, ticks_to_wait, &deadline)) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&rb->lock);
+    return p_item;
+}
+
+void vRingbufferReturnItem(RingbufHandle_t rb, void *p_item)
+{
+    rb_item_hdr_t *p_hdr = (rb_item_hdr_t *)p_item - 1;
+
+    pthread_mutex_lock(&rb->lock);
+    assert((uint8_t *)p_hdr == rb->buf + rb->head); // single reader, items returned in order
+    size_t item_sz = _rb_item_sz(p_hdr->len);
+    rb->head += item_sz;
+    rb->used -= item_sz;
+    if (rb->head == rb->size) {
+        rb->head = 0;
+    }
+    pthread_cond_broadcast(&rb->cond);
+    pthread_mutex_unlock(&rb->lock);
+}
+
+size_t xRingbufferGetCurFreeSize(RingbufHandle_t rb)
+{
+    pthread_mutex_lock(&rb->lock);
+    size_t room;
+    if (rb->used == 0) {
+        room = rb->size;
+    } else if (rb->tail > rb->head) {
+        room = (rb->size - rb->tail > rb->head) ? rb->size - rb->tail : rb->head;
+    } else {
+        room = rb->head - rb->tail;
+    }
+    pthread_mutex_unlock(&rb->lock);
+    return (room > sizeof(rb_item_hdr_t)) ? room - sizeof(rb_item_hdr_t) : 0;
+}
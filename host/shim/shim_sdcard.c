@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdio_ext.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "esp_err.h"
+#include "sdcard.h"
+
+// Stand-in of main/sdcard.c, the SD card is the MNT_SDCARD folder and host_sd_fault_set() pulls it out
+// While removed (-Wl,--wrap=fopen,--wrap=fwrite,--wrap=ferror,--wrap=fclose):
+// - fopen() of a path under MNT_SDCARD fails with ENODEV, sd_card_remount() fails
+// - the files opened on the card before fail every fwrite(), ferror() reports it until they're closed, and their
+//   FILE buffer is discarded by fclose() as a card gone would lose it
+// The other streams (stdout, the exporters' input on the host disk) aren't touched
+
+#define HOST_SD_FILE_NUM (32)
+
+typedef struct host_sd_s {
+    pthread_mutex_t lock;
+    uint32_t removed;
+    uint32_t fault_cnt; // sd_card_fault() calls
+    uint32_t mount_cnt; // successful sd_card_remount() calls
+    FILE *fp[HOST_SD_FILE_NUM];
+    uint8_t err[HOST_SD_FILE_NUM]; // the file was written while the card was removed
+} host_sd_t;
+
+static host_sd_t host_sd = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+FILE *__real_fopen(const char *path, const char *mode);
+size_t __real_fwrite(const void *ptr, size_t size, size_t nmemb, FILE *fp);
+int __real_ferror(FILE *fp);
+int __real_fclose(FILE *fp);
+
+// index of the card file, -1 if fp isn't on the card
+static int32_t _host_sd_find(FILE *fp)
+{
+    for (int32_t i = 0; i < HOST_SD_FILE_NUM; i++) {
+        if (host_sd.fp[i] == fp) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// ----------
+// sdcard.h
+// ----------
+esp_err_t sd_card_init(void)
+{
+    return ESP_OK;
+}
+
+uint32_t sd_card_ready(void)
+{
+    return !__atomic_load_n(&host_sd.removed, __ATOMIC_RELAXED);
+}
+
+uint32_t sd_card_busy(void)
+{
+    return 0;
+}
+
+void sd_card_fault(void)
+{
+    __atomic_fetch_add(&host_sd.fault_cnt, 1, __ATOMIC_RELAXED);
+}
+
+esp_err_t sd_card_remount(void)
+{
+    if (!sd_card_ready()) {
+        return ESP_FAIL;
+    }
+    __atomic_fetch_add(&host_sd.mount_cnt, 1, __ATOMIC_RELAXED);
+    return ESP_OK;
+}
+
+// ----------
+// Fault injection
+// ----------
+void host_sd_fault_set(uint32_t removed)
+{
+    __atomic_store_n(&host_sd.removed, removed, __ATOMIC_RELAXED);
+}
+
+void host_sd_fault_stat(uint32_t *p_fault_cnt, uint32_t *p_mount_cnt)
+{
+    *p_fault_cnt = __atomic_load_n(&host_sd.fault_cnt, __ATOMIC_RELAXED);
+    *p_mount_cnt = __atomic_load_n(&host_sd.mount_cnt, __ATOMIC_RELAXED);
+}
+
+FILE *__wrap_fopen(const char *path, const char *mode)
+{
+    size_t mnt_len = strlen(MNT_SDCARD);
+    if (strncmp(path, MNT_SDCARD, mnt_len) != 0 || path[mnt_len] != '/') {
+        return __real_fopen(path, mode);
+    }
+    if (!sd_card_ready()) {
+        errno = ENODEV;
+        return NULL;
+    }
+
+    FILE *fp = __real_fopen(path, mode);
+    pthread_mutex_lock(&host_sd.lock);
+    int32_t i = fp ? _host_sd_find(NULL) : -1;
+    if (i >= 0) {
+        host_sd.fp[i]  = fp;
+        host_sd.err[i] = 0;
+    }
+    pthread_mutex_unlock(&host_sd.lock);
+    return fp;
+}
+
+size_t __wrap_fwrite(const void *ptr, size_t size, size_t nmemb, FILE *fp)
+{
+    if (sd_card_ready()) {
+        return __real_fwrite(ptr, size, nmemb, fp);
+    }
+
+    pthread_mutex_lock(&host_sd.lock);
+    int32_t i = _host_sd_find(fp);
+    if (i >= 0) {
+        host_sd.err[i] = 1;
+    }
+    pthread_mutex_unlock(&host_sd.lock);
+    return (i >= 0) ? 0 : __real_fwrite(ptr, size, nmemb, fp);
+}
+
+int __wrap_ferror(FILE *fp)
+{
+    pthread_mutex_lock(&host_sd.lock);
+    int32_t i = _host_sd_find(fp);
+    int err   = (i >= 0) && host_sd.err[i];
+    pthread_mutex_unlock(&host_sd.lock);
+    return err || __real_ferror(fp);
+}
+
+int __wrap_fclose(FILE *fp)
+{
+    pthread_mutex_lock(&host_sd.lock);
+    int32_t i = _host_sd_find(fp);
+    int err   = (i >= 0) && host_sd.err[i];
+    if (i >= 0) {
+        host_sd.fp[i] = NULL;
+    }
+    pthread_mutex_unlock(&host_sd.lock);
+
+    if (err) {
+        __fpurge(fp); // the buffered tail never reaches the card
+    }
+    int ret = __real_fclose(fp);
+    return err ? EOF : ret;
+}
@@ -0,0 +1,247 @@
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_adc/adc_continuous.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "soc/soc_caps.h"
+#include "sdlog_service.h"
+#include "sdlog_header.h"
+#include "board.h"
+#include "adc_source.h"
+#include "task_cfg.h"
+
+static const char *TAG = "ADC";
+
+// ----------
+// Continuous (DMA) sampling
+// ----------
+// The driver fills one conversion frame of ADC_SOURCE_FRAME_SZ bytes per DMA descriptor, a frame is one block record
+// (SDLOG_ADC_BLOCK_SAMPLES results) with a single timestamp:
+// - on_conv_done (ISR) takes esp_timer when the frame is complete, kept by the frame sequence number in ts_ring
+// - adc_rd task reads the frames in order, the block time is the first sample: frame end - (N - 1) sample periods
+// The driver pool holds ADC_SOURCE_POOL_FRAMES frames, when adc_rd falls behind the driver drops the new frames
+// (on_pool_ovf), the gap shows in the seq of the blocks
+#define ADC_SOURCE_FRAME_SZ (SDLOG_ADC_BLOCK_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES)
+#define ADC_SOURCE_POOL_FRAMES (8)
+#define ADC_SOURCE_TS_NUM (64) // frame timestamps in flight, more than the pool, a power of 2
+#define ADC_SOURCE_RATE_DEF (1000)
+
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define ADC_SOURCE_OUTPUT_FORMAT ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define ADC_SOURCE_RESULT_CH(p) ((p)->type1.channel)
+#define ADC_SOURCE_RESULT_RAW(p) ((p)->type1.data)
+#else
+#define ADC_SOURCE_OUTPUT_FORMAT ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define ADC_SOURCE_RESULT_CH(p) ((p)->type2.channel)
+#define ADC_SOURCE_RESULT_RAW(p) ((p)->type2.data)
+#endif
+
+typedef struct adc_source_ts_s {
+    uint32_t seq;
+    int64_t us; // 0: the frame was dropped by the driver
+} adc_source_ts_t;
+
+static struct {
+    adc_continuous_handle_t handle;
+    uint32_t rate_hz;
+    uint32_t atten; // adc_atten_t
+    uint32_t ch_num;
+    uint8_t ch[ADC_SOURCE_CH_MAX];
+    uint32_t seq_isr; // frames completed, written by the ISR only
+    adc_source_ts_t ts_ring[ADC_SOURCE_TS_NUM];
+} adc_source_ctrl = {
+    .rate_hz = ADC_SOURCE_RATE_DEF,
+    .atten   = ADC_ATTEN_DB_12,
+};
+
+static adc_webui_status_t adc_webui_stat;
+
+// [adc]
+// channels = 4          ; ADC1 channels of the pattern, comma separated, none: the ADC source is off
+// rate_hz = 1000        ; conversions per second of the whole pattern
+// atten_db = 12         ; 0, 2.5, 6 or 12
+uint32_t adc_source_syscfg(const char *section, const char *key, const char *value)
+{
+    if (strcmp(key, "channels") == 0) {
+        char *p                = (char *)value;
+        adc_source_ctrl.ch_num = 0;
+        while (*p && adc_source_ctrl.ch_num < ADC_SOURCE_CH_MAX) {
+            char *end   = NULL;
+            uint32_t ch = strtoul(p, &end, 10);
+            if (end == p) {
+                break;
+            }
+            if (ch < SOC_ADC_CHANNEL_NUM(ADC_UNIT_1)) {
+                adc_source_ctrl.ch[adc_source_ctrl.ch_num++] = ch;
+            }
+            p = end + strspn(end, ", ");
+        }
+    } else if (strcmp(key, "rate_hz") == 0) {
+        uint32_t rate_hz        = strtoul(value, NULL, 10);
+        rate_hz                 = (rate_hz < SOC_ADC_SAMPLE_FREQ_THRES_LOW) ? SOC_ADC_SAMPLE_FREQ_THRES_LOW : rate_hz;
+        adc_source_ctrl.rate_hz = (rate_hz > SOC_ADC_SAMPLE_FREQ_THRES_HIGH) ? SOC_ADC_SAMPLE_FREQ_THRES_HIGH : rate_hz;
+    } else if (strcmp(key, "atten_db") == 0) {
+        float db              = strtof(value, NULL);
+        adc_source_ctrl.atten = (db < 2) ? ADC_ATTEN_DB_0 : (db < 4) ? ADC_ATTEN_DB_2_5 : (db < 9) ? ADC_ATTEN_DB_6 : ADC_ATTEN_DB_12;
+    }
+    return 1;
+}
+
+static bool IRAM_ATTR _adc_source_conv_done(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data)
+{
+    uint32_t seq                                          = adc_source_ctrl.seq_isr++;
+    adc_source_ctrl.ts_ring[seq % ADC_SOURCE_TS_NUM].seq = seq;
+    adc_source_ctrl.ts_ring[seq % ADC_SOURCE_TS_NUM].us  = esp_timer_get_time();
+    return false;
+}
+
+// called after on_conv_done of the same frame, which didn't fit the pool
+static bool IRAM_ATTR _adc_source_pool_ovf(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data)
+{
+    adc_source_ctrl.ts_ring[(adc_source_ctrl.seq_isr - 1) % ADC_SOURCE_TS_NUM].us = 0;
+    return false;
+}
+
+static void adc_source_task(void *arg)
+{
+    uint8_t *p_frame     = malloc(ADC_SOURCE_FRAME_SZ);
+    uint32_t frame_len   = 0;
+    uint32_t seq         = 0; // the next frame of the driver
+    int64_t us_end_last  = 0;
+    int64_t us_per_frame = (int64_t)SDLOG_ADC_BLOCK_SAMPLES * 1000000 / adc_source_ctrl.rate_hz;
+    sdlog_adc_block_t blk = {
+        .rate_hz = adc_source_ctrl.rate_hz,
+        .unit    = ADC_UNIT_1,
+        .atten   = adc_source_ctrl.atten,
+        .ch_num  = adc_source_ctrl.ch_num,
+    };
+    ESP_LOGI(TAG, "ADC read Task started, rate=%" PRIu32 "Hz, channels=%" PRIu32 ", frame=%dB", adc_source_ctrl.rate_hz, adc_source_ctrl.ch_num, ADC_SOURCE_FRAME_SZ);
+
+    while (p_frame) {
+        uint32_t got = 0;
+        if (adc_continuous_read(adc_source_ctrl.handle, p_frame + frame_len, ADC_SOURCE_FRAME_SZ - frame_len, &got, ADC_MAX_DELAY) != ESP_OK) {
+            continue;
+        }
+        frame_len += got;
+        if (frame_len < ADC_SOURCE_FRAME_SZ) {
+            continue; // the pool hands out whole frames, unless it wrapped around
+        }
+        frame_len = 0;
+
+        // the timestamp of the frame, the frames dropped by the driver are skipped
+        adc_source_ts_t ts = adc_source_ctrl.ts_ring[seq % ADC_SOURCE_TS_NUM];
+        while (ts.seq == seq && ts.us == 0) {
+            adc_webui_stat.frame_drop++;
+            seq++;
+            ts = adc_source_ctrl.ts_ring[seq % ADC_SOURCE_TS_NUM];
+        }
+        int64_t us_end = (ts.seq == seq) ? ts.us : us_end_last + us_per_frame; // overwritten, adc_rd is far behind
+        us_end_last    = us_end;
+
+        // pack the results, channel << 12 | raw
+        const adc_digi_output_data_t *p_res = (const adc_digi_output_data_t *)p_frame;
+        for (uint32_t i = 0; i < SDLOG_ADC_BLOCK_SAMPLES; i++, p_res++) {
+            uint32_t ch   = ADC_SOURCE_RESULT_CH(p_res);
+            uint32_t raw  = ADC_SOURCE_RESULT_RAW(p_res);
+            blk.sample[i] = (ch << 12) | (raw & 0xFFF);
+        }
+        for (uint32_t i = 0; i < adc_source_ctrl.ch_num; i++) {
+            for (uint32_t j = SDLOG_ADC_BLOCK_SAMPLES; j > 0; j--) {
+                if (SDLOG_ADC_SAMPLE_CH(blk.sample[j - 1]) == adc_source_ctrl.ch[i]) {
+                    adc_webui_stat.raw_last[i] = SDLOG_ADC_SAMPLE_RAW(blk.sample[j - 1]);
+                    break;
+                }
+            }
+        }
+
+        blk.seq = seq++;
+        if (sdlog_source_ready(SDLOG_SOURCE_ADC)) {
+            int64_t us_first = us_end - (int64_t)(SDLOG_ADC_BLOCK_SAMPLES - 1) * 1000000 / adc_source_ctrl.rate_hz;
+            if (sdlog_write_ts(SDLOG_SOURCE_ADC, SDLOG_ADC_TYPE_BLOCK, us_first, sizeof(blk), &blk) == ESP_OK) {
+                adc_webui_stat.blocks++;
+            } else {
+                adc_webui_stat.block_drop++;
+            }
+        }
+    }
+    ESP_LOGE(TAG, "no memory for the frame buffer");
+    vTaskDelete(NULL);
+}
+
+esp_err_t adc_source_init(void)
+{
+    if (!ADC_EN || adc_source_ctrl.ch_num == 0) {
+        ESP_LOGI(TAG, "ADC source off");
+        return ESP_OK;
+    }
+
+    adc_continuous_handle_cfg_t handle_cfg = {
+        .max_store_buf_size = ADC_SOURCE_FRAME_SZ * ADC_SOURCE_POOL_FRAMES,
+        .conv_frame_size    = ADC_SOURCE_FRAME_SZ,
+    };
+    adc_digi_pattern_config_t pattern[ADC_SOURCE_CH_MAX];
+    for (uint32_t i = 0; i < adc_source_ctrl.ch_num; i++) {
+        pattern[i] = (adc_digi_pattern_config_t){
+            .atten     = adc_source_ctrl.atten,
+            .channel   = adc_source_ctrl.ch[i],
+            .unit      = ADC_UNIT_1,
+            .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+        };
+    }
+    adc_continuous_config_t dig_cfg = {
+        .pattern_num    = adc_source_ctrl.ch_num,
+        .adc_pattern    = pattern,
+        .sample_freq_hz = adc_source_ctrl.rate_hz,
+        .conv_mode      = ADC_CONV_SINGLE_UNIT_1,
+        .format         = ADC_SOURCE_OUTPUT_FORMAT,
+    };
+    adc_continuous_evt_cbs_t cbs = {
+        .on_conv_done = _adc_source_conv_done,
+        .on_pool_ovf  = _adc_source_pool_ovf,
+    };
+
+    // an ADC failure leaves the other sources running
+    esp_err_t ret;
+    if ((ret = adc_continuous_new_handle(&handle_cfg, &adc_source_ctrl.handle)) != ESP_OK) {
+        ESP_LOGE(TAG, "adc_continuous_new_handle() failed, %d", ret);
+        return ESP_OK;
+    }
+    if ((ret = adc_continuous_config(adc_source_ctrl.handle, &dig_cfg)) != ESP_OK ||
+        (ret = adc_continuous_register_event_callbacks(adc_source_ctrl.handle, &cbs, NULL)) != ESP_OK) {
+        ESP_LOGE(TAG, "ADC config failed, %d", ret);
+        adc_continuous_deinit(adc_source_ctrl.handle);
+        return ESP_OK;
+    }
+
+    adc_webui_stat.rate_hz = adc_source_ctrl.rate_hz;
+    adc_webui_stat.ch_num  = adc_source_ctrl.ch_num;
+    memcpy(adc_webui_stat.ch, adc_source_ctrl.ch, sizeof(adc_webui_stat.ch));
+    for (uint32_t i = 0; i < adc_source_ctrl.ch_num; i++) {
+        int io = -1;
+        adc_continuous_channel_to_io(ADC_UNIT_1, adc_source_ctrl.ch[i], &io);
+        ESP_LOGI(TAG, "ADC1 channel %d on GPIO%d", adc_source_ctrl.ch[i], io);
+    }
+
+    if ((ret = adc_continuous_start(adc_source_ctrl.handle)) != ESP_OK) {
+        ESP_LOGE(TAG, "adc_continuous_start() failed, %d", ret);
+        adc_continuous_deinit(adc_source_ctrl.handle);
+        return ESP_OK;
+    }
+    task_create(TASK_ID_ADC_RD, adc_source_task, NULL, NULL); // the pool keeps the first frames meanwhile
+    adc_webui_stat.running = 1;
+    return ESP_OK;
+}
+
+// ----------
+// WEB-UI
+// ----------
+uint32_t adc_webui_query(adc_webui_status_t *p_status)
+{
+    *p_status = adc_webui_stat;
+    return 0;
+}
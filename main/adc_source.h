@@ -0,0 +1,22 @@
+#ifndef __ADC_SOURCE_H__
+#define __ADC_SOURCE_H__
+
+#include <stdint.h>
+#include <esp_err.h>
+
+#define ADC_SOURCE_CH_MAX (8) // channels of the pattern
+
+typedef struct adc_webui_status_s {
+    uint32_t running;
+    uint32_t rate_hz; // conversions per second, all the channels together
+    uint32_t ch_num;
+    uint8_t ch[ADC_SOURCE_CH_MAX];
+    uint16_t raw_last[ADC_SOURCE_CH_MAX]; // the last result of every channel of the pattern
+    uint32_t blocks;                      // block records written
+    uint32_t frame_drop;                  // DMA frames lost by the driver, its pool was full
+    uint32_t block_drop;                  // blocks not written, the sdlog ring buffer was full
+} adc_webui_status_t;
+
+uint32_t adc_webui_query(adc_webui_status_t *p_status);
+
+#endif // __ADC_SOURCE_H__
@@ -6,13 +6,21 @@
 
 #define DEF_HOSTNAME "QQMLAB-LOGGER" // HOST-NAME
 
+#ifndef MNT_SDCARD // host build relocates it into the working folder
 #define MNT_SDCARD "/sdcard" // SD card mount position
+#endif
 
 // ----------
 // TWAI config
 // ----------
 #define TWAI_RXBUF (128)
 #define TWAI_SPEED (0) // 0:125, 1:500
+#define TWAI_RX_TS_CAPTURE (1) // 1: RX timestamp captured on twai_receive() return by a high priority task, 0: legacy, taken in sdlog_write()
+
+// ----------
+// TASK config
+// ----------
+#define TASK_PIN_CORES (1) // 1: pin the tasks as task_reg.h says on a dual-core target, 0: no affinity, for the comparison
 
 // ----------
 // BOARD SELECT
@@ -42,12 +50,15 @@
 #define SDCARD_SPI_MISO_PIN (2)
 #define SDCARD_SPI_CLK_PIN (6)
 #define SDCARD_SPI_CS_PIN (10)
+#define SDCARD_PROFILE "spi20" // bus profile of the boot (sdcard_profile_reg.h), [sdcard] profile overrides it
 
 #define TWAI_EN (1)
 #define TWAI_PIN_TX (0)
 #define TWAI_PIN_RX (1)
 #define TWAI_PIN_STANDBY (3)
 
+#define ADC_EN (1) // [adc] channels of syscfg.ini, ADC1 channel 4 (GPIO4) is the free one, 0..3 are TWAI/SD pins
+
 #elif defined(TARGET_BOARD_ESP32_CAM)
 #define BOARD_NAME "ESP32-CAM"
 #define LED_PIN0 (33)
@@ -55,6 +66,10 @@
 
 #define SDCARD_IN_SDMMC
 // In ESP32, the SDMMC interface is hardwired to dedicated pins, so no further configuration here
+// The 4-bit profiles take GPIO4 (flash LED), GPIO12 and GPIO13 as DAT1..DAT3
+#define SDCARD_PROFILE "sdmmc1_20"
+
+#define ADC_EN (0) // the continuous ADC of the ESP32 runs through I2S0, the camera's
 
 #else
 #error "not support board"
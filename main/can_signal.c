@@ -0,0 +1,322 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+
+#include "esp_log.h"
+
+#include "board.h"
+#include "can_signal.h"
+
+static const char *TAG = "CAN_SIGNAL";
+
+// Decode the signals of the known messages on every received frame, and keep running statistics
+// - the DBC image is loaded once at boot, nothing is allocated per frame
+// - the per-frame path is integer only (ESP32-C3 has no FPU): raw min/max/sum and the histogram are kept in raw unit,
+//   scale/offset are applied when the WEB-UI queries the statistics
+// - the statistics are written by twai_stat_task only, a reader may see a sample half-updated, which is fine for monitoring
+
+#define CAN_SIGNAL_DBC (MNT_SDCARD "/dbc.bin")
+#define CAN_SIGNAL_MSG_MAX (128)
+#define CAN_SIGNAL_SIG_MAX (512)
+
+// ----------
+// data structure definition
+// ----------
+typedef struct can_signal_s {
+    // decode table
+    uint64_t mask;
+    uint8_t shift;
+    uint8_t length;
+    uint8_t flags;
+    uint8_t reserved;
+    uint16_t msg_idx;
+    int64_t hist_lo; // histogram range in raw unit
+    uint64_t hist_span;
+
+    // statistics
+    uint32_t count;
+    int64_t raw_min;
+    int64_t raw_max;
+    int64_t raw_last;
+    int64_t raw_sum;
+    uint32_t hist[CAN_SIGNAL_HIST_BIN];
+} can_signal_t;
+
+typedef struct can_signal_ctrl_s {
+    uint32_t msg_num;
+    uint32_t sig_num;
+    can_dbc_msg_t *msg;     // sorted by (extd, identifier)
+    can_dbc_sig_t *sig_def; // name/scale/offset, only used by the WEB-UI
+    can_signal_t *sig;
+    uint32_t reset_req; // set by can_signal_reset(), the statistics are cleared by the writer (twai_stat_task)
+} can_signal_ctrl_t;
+
+static can_signal_ctrl_t can_signal_ctrl;
+
+// ----------
+// Decoder
+// ----------
+static inline uint64_t _can_signal_key(uint32_t extd, uint32_t identifier)
+{
+    return ((uint64_t)extd << 32) | identifier;
+}
+
+static const can_dbc_msg_t *_can_signal_find_msg(const twai_message_t *p_msg)
+{
+    uint64_t key = _can_signal_key(p_msg->extd, p_msg->identifier);
+    int32_t lo   = 0;
+    int32_t hi   = (int32_t)can_signal_ctrl.msg_num - 1;
+
+    while (lo <= hi) {
+        int32_t mid              = (lo + hi) / 2;
+        const can_dbc_msg_t *p_m = &can_signal_ctrl.msg[mid];
+        uint64_t key_mid         = _can_signal_key(p_m->flags & 1, p_m->identifier);
+        if (key_mid == key) {
+            return p_m;
+        } else if (key_mid < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return NULL;
+}
+
+static void _can_signal_feed_one(const twai_message_t *p_msg)
+{
+    const can_dbc_msg_t *p_m = _can_signal_find_msg(p_msg);
+    if (p_m == NULL) {
+        return;
+    }
+
+    // bytes beyond DLC are treated as 0
+    uint64_t word_le = 0;
+    uint64_t word_be = 0;
+    for (uint32_t i = 0; i < 8; i++) {
+        uint8_t b = (i < p_msg->data_length_code) ? p_msg->data[i] : 0;
+        word_le |= (uint64_t)b << (8 * i);
+        word_be = (word_be << 8) | b;
+    }
+
+    can_signal_t *p_sig = &can_signal_ctrl.sig[p_m->sig_first];
+    for (uint32_t i = 0; i < p_m->sig_num; i++, p_sig++) {
+        uint64_t raw = (((p_sig->flags & CAN_DBC_SIG_BIG_ENDIAN) ? word_be : word_le) >> p_sig->shift) & p_sig->mask;
+        if ((p_sig->flags & CAN_DBC_SIG_SIGNED) && (raw >> (p_sig->length - 1)) & 1) {
+            raw |= ~p_sig->mask; // sign extension
+        }
+        int64_t v = (int64_t)raw;
+
+        if (p_sig->count == 0 || v < p_sig->raw_min) {
+            p_sig->raw_min = v;
+        }
+        if (p_sig->count == 0 || v > p_sig->raw_max) {
+            p_sig->raw_max = v;
+        }
+        p_sig->raw_last = v;
+        p_sig->raw_sum += v;
+        p_sig->count++;
+
+        uint32_t bin;
+        uint64_t d = (uint64_t)v - (uint64_t)p_sig->hist_lo; // in unsigned, v - hist_lo may overflow int64
+        if (v < p_sig->hist_lo) {
+            bin = 0;
+        } else if (d >= p_sig->hist_span) {
+            bin = CAN_SIGNAL_HIST_BIN - 1;
+        } else {
+            bin = (p_sig->hist_span <= UINT64_MAX / CAN_SIGNAL_HIST_BIN) ? d * CAN_SIGNAL_HIST_BIN / p_sig->hist_span
+                                                                          : d / (p_sig->hist_span / CAN_SIGNAL_HIST_BIN + 1);
+        }
+        p_sig->hist[bin]++;
+    }
+}
+
+static void _can_signal_clear(void)
+{
+    for (uint32_t i = 0; i < can_signal_ctrl.sig_num; i++) {
+        can_signal_t *p_sig = &can_signal_ctrl.sig[i];
+        p_sig->count        = 0;
+        p_sig->raw_sum      = 0;
+        memset(p_sig->hist, 0, sizeof(p_sig->hist));
+    }
+}
+
+void can_signal_feed(const twai_message_t *p_msg, uint32_t num)
+{
+    if (can_signal_ctrl.msg_num == 0) {
+        return;
+    }
+    if (__atomic_load_n(&can_signal_ctrl.reset_req, __ATOMIC_ACQUIRE)) {
+        _can_signal_clear();
+        __atomic_store_n(&can_signal_ctrl.reset_req, 0, __ATOMIC_RELEASE);
+    }
+
+    for (uint32_t i = 0; i < num; i++) {
+        _can_signal_feed_one(&p_msg[i]);
+    }
+}
+
+// the writer clears the statistics before its next frame, until then they read as empty
+void can_signal_reset(void)
+{
+    __atomic_store_n(&can_signal_ctrl.reset_req, 1, __ATOMIC_RELEASE);
+}
+
+// ----------
+// INIT API
+// ----------
+// a histogram bound in raw unit, clamped to the raw range of the signal, NaN gives lo, the cast is never out of range
+static int64_t _can_signal_raw_clamp(float raw, int64_t lo, int64_t hi)
+{
+    if (!(raw > (float)lo)) {
+        return lo;
+    }
+    if (raw >= (float)hi) {
+        return hi;
+    }
+    return (int64_t)raw;
+}
+
+static void _can_signal_setup(can_signal_t *p_sig, const can_dbc_sig_t *p_def, uint16_t msg_idx)
+{
+    p_sig->shift   = p_def->shift;
+    p_sig->length  = p_def->length;
+    p_sig->flags   = p_def->flags;
+    p_sig->mask    = (p_def->length >= 64) ? UINT64_MAX : ((1ULL << p_def->length) - 1);
+    p_sig->msg_idx = msg_idx;
+
+    // convert the histogram range to raw unit, so the per-frame path doesn't touch float
+    float raw_a = (p_def->hist_min - p_def->offset) / p_def->scale;
+    float raw_b = (p_def->hist_max - p_def->offset) / p_def->scale;
+    if (raw_a > raw_b) { // negative scale
+        float t = raw_a;
+        raw_a   = raw_b;
+        raw_b   = t;
+    }
+    int64_t sig_hi = (p_sig->length >= 64) ? INT64_MAX : (int64_t)p_sig->mask; // decoded raw value range
+    int64_t sig_lo = 0;
+    if (p_sig->flags & CAN_DBC_SIG_SIGNED) {
+        sig_hi = (int64_t)(p_sig->mask >> 1);
+        sig_lo = -sig_hi - 1;
+    }
+    p_sig->hist_lo = _can_signal_raw_clamp(floorf(raw_a), sig_lo, sig_hi);
+    int64_t hi     = _can_signal_raw_clamp(ceilf(raw_b), sig_lo, sig_hi);
+    if (hi <= p_sig->hist_lo) { // NaN/inf scale or bounds, or an empty range: dbc_compile.py rejects them
+        ESP_LOGW(TAG, "%s: histogram range [%g|%g] unusable", p_def->name, p_def->hist_min, p_def->hist_max);
+        p_sig->hist_span = 1;
+        return;
+    }
+    p_sig->hist_span = (uint64_t)hi - (uint64_t)p_sig->hist_lo + 1;
+    if (p_sig->hist_span == 0) { // the full 64-bit range
+        p_sig->hist_span = UINT64_MAX;
+    }
+}
+
+static esp_err_t _can_signal_load(FILE *fp)
+{
+    can_dbc_header_t header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 || strncmp(header.magic, "QQDBC", sizeof(header.magic)) || header.version != 1) {
+        ESP_LOGE(TAG, "%s: header check fail", CAN_SIGNAL_DBC);
+        return ESP_FAIL;
+    }
+    if (header.msg_num > CAN_SIGNAL_MSG_MAX || header.sig_num > CAN_SIGNAL_SIG_MAX) {
+        ESP_LOGE(TAG, "%s: too large, msg=%" PRIu32 " sig=%" PRIu32, CAN_SIGNAL_DBC, header.msg_num, header.sig_num);
+        return ESP_FAIL;
+    }
+
+    can_signal_ctrl.msg     = calloc(header.msg_num, sizeof(can_dbc_msg_t));
+    can_signal_ctrl.sig_def = calloc(header.sig_num, sizeof(can_dbc_sig_t));
+    can_signal_ctrl.sig     = calloc(header.sig_num, sizeof(can_signal_t));
+    if ((header.msg_num && can_signal_ctrl.msg == NULL) || (header.sig_num && (can_signal_ctrl.sig_def == NULL || can_signal_ctrl.sig == NULL))) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (fread(can_signal_ctrl.msg, sizeof(can_dbc_msg_t), header.msg_num, fp) != header.msg_num ||
+        fread(can_signal_ctrl.sig_def, sizeof(can_dbc_sig_t), header.sig_num, fp) != header.sig_num) {
+        return ESP_FAIL;
+    }
+
+    for (uint32_t i = 0; i < header.msg_num; i++) {
+        can_dbc_msg_t *p_m = &can_signal_ctrl.msg[i];
+        if (p_m->sig_first + p_m->sig_num > header.sig_num) {
+            return ESP_FAIL;
+        }
+        if (i && _can_signal_key(p_m[-1].flags & 1, p_m[-1].identifier) >= _can_signal_key(p_m->flags & 1, p_m->identifier)) {
+            return ESP_FAIL; // binary search needs the sorted table
+        }
+        for (uint32_t j = p_m->sig_first; j < p_m->sig_first + p_m->sig_num; j++) {
+            can_dbc_sig_t *p_def = &can_signal_ctrl.sig_def[j];
+            if (p_def->length == 0 || p_def->length > 64 || p_def->shift + p_def->length > 64 || p_def->scale == 0) {
+                return ESP_FAIL;
+            }
+            p_def->name[sizeof(p_def->name) - 1] = '\0';
+            _can_signal_setup(&can_signal_ctrl.sig[j], p_def, i);
+        }
+    }
+
+    can_signal_ctrl.sig_num = header.sig_num;
+    can_signal_ctrl.msg_num = header.msg_num; // publish last, can_signal_feed() checks it
+    return ESP_OK;
+}
+
+esp_err_t can_signal_init(void)
+{
+    FILE *fp = fopen(CAN_SIGNAL_DBC, "rb");
+    if (fp == NULL) {
+        ESP_LOGI(TAG, "No %s, signal decoding disabled", CAN_SIGNAL_DBC);
+        return ESP_OK; // optional feature
+    }
+
+    esp_err_t ret = _can_signal_load(fp);
+    fclose(fp);
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "DBC loaded, msg=%" PRIu32 " sig=%" PRIu32, can_signal_ctrl.msg_num, can_signal_ctrl.sig_num);
+    } else {
+        ESP_LOGE(TAG, "DBC load fail (%d), signal decoding disabled", ret);
+        free(can_signal_ctrl.msg);
+        free(can_signal_ctrl.sig_def);
+        free(can_signal_ctrl.sig);
+        memset(&can_signal_ctrl, 0, sizeof(can_signal_ctrl));
+    }
+    return ESP_OK;
+}
+
+// ----------
+// Status query API, for WEB-UI
+// ----------
+uint32_t can_signal_num(void)
+{
+    return can_signal_ctrl.sig_num;
+}
+
+uint32_t can_signal_webui_query(uint32_t idx, can_signal_webui_status_t *p_status)
+{
+    memset(p_status, 0, sizeof(*p_status));
+    if (idx >= can_signal_ctrl.sig_num) {
+        return 1;
+    }
+
+    const can_signal_t *p_sig  = &can_signal_ctrl.sig[idx];
+    const can_dbc_sig_t *p_def = &can_signal_ctrl.sig_def[idx];
+    const can_dbc_msg_t *p_m   = &can_signal_ctrl.msg[p_sig->msg_idx];
+    uint32_t count             = __atomic_load_n(&can_signal_ctrl.reset_req, __ATOMIC_ACQUIRE) ? 0 : p_sig->count;
+
+    p_status->name       = p_def->name;
+    p_status->identifier = p_m->identifier;
+    p_status->extd       = p_m->flags & 1;
+    p_status->count      = count;
+    p_status->hist_min   = p_def->hist_min;
+    p_status->hist_max   = p_def->hist_max;
+    if (count) {
+        memcpy(p_status->hist, p_sig->hist, sizeof(p_status->hist));
+
+        float a        = p_sig->raw_min * p_def->scale + p_def->offset;
+        float b        = p_sig->raw_max * p_def->scale + p_def->offset;
+        p_status->min  = (a < b) ? a : b;
+        p_status->max  = (a < b) ? b : a;
+        p_status->mean = (float)((double)p_sig->raw_sum / count) * p_def->scale + p_def->offset;
+        p_status->last = p_sig->raw_last * p_def->scale + p_def->offset;
+    }
+    return 0;
+}
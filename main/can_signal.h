@@ -0,0 +1,84 @@
+#ifndef __CAN_SIGNAL_H__
+#define __CAN_SIGNAL_H__
+
+#include <stdint.h>
+#include <assert.h>
+#include "esp_err.h"
+#include "driver/twai.h"
+
+// ----------
+// Precompiled DBC image (MNT_SDCARD/dbc.bin), generated by tool/dbc_compile.py
+// ----------
+// [header][msg x msg_num, sorted by (extd, identifier)][sig x sig_num]
+// The bit extraction is resolved by the compiler, the device does (word >> shift) & mask only
+// - Intel signals: word is the 8 data bytes read as little-endian uint64
+// - Motorola signals: word is the 8 data bytes read as big-endian uint64
+
+#pragma pack(push, 1)
+
+typedef struct can_dbc_header_s {
+    char magic[8];    // FIXED TO "QQDBC"
+    uint32_t version; // 1
+    uint32_t msg_num;
+    uint32_t sig_num;
+    uint32_t reserved;
+} can_dbc_header_t;
+
+typedef struct can_dbc_msg_s {
+    uint32_t identifier;
+    uint32_t flags; // bit0: extd
+    uint16_t sig_first;
+    uint16_t sig_num;
+    uint32_t reserved;
+} can_dbc_msg_t;
+
+#define CAN_DBC_SIG_BIG_ENDIAN (1 << 0)
+#define CAN_DBC_SIG_SIGNED (1 << 1)
+
+typedef struct can_dbc_sig_s {
+    char name[24];
+    uint8_t shift;
+    uint8_t length;
+    uint8_t flags; // CAN_DBC_SIG_xxx
+    uint8_t reserved;
+    float scale; // phys = raw * scale + offset
+    float offset;
+    float hist_min; // histogram range in physical unit, from [min|max] in the DBC
+    float hist_max;
+} can_dbc_sig_t;
+
+#pragma pack(pop)
+
+static_assert(sizeof(can_dbc_header_t) == 24, "DBC header size mismatch!");
+static_assert(sizeof(can_dbc_msg_t) == 16, "DBC msg size mismatch!");
+static_assert(sizeof(can_dbc_sig_t) == 44, "DBC sig size mismatch!");
+
+// ----------
+// Runtime API
+// ----------
+#define CAN_SIGNAL_HIST_BIN (16)
+
+void can_signal_feed(const twai_message_t *p_msg, uint32_t num); // called by twai_stat_task for every batch of frames
+void can_signal_reset(void);
+
+// ----------
+// WEBUI API
+// ----------
+typedef struct can_signal_webui_status_s {
+    const char *name;
+    uint32_t identifier;
+    uint32_t extd;
+    uint32_t count;
+    float min;
+    float max;
+    float mean;
+    float last;
+    float hist_min;
+    float hist_max;
+    uint32_t hist[CAN_SIGNAL_HIST_BIN];
+} can_signal_webui_status_t;
+
+uint32_t can_signal_num(void);
+uint32_t can_signal_webui_query(uint32_t idx, can_signal_webui_status_t *p_status);
+
+#endif // __CAN_SIGNAL_H__
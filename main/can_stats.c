@@ -0,0 +1,189 @@
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+#include "esp_log.h"
+
+#include "can_stats.h"
+
+// Per-ID bus statistics, updated by twai_stat_task for every batch of frames received by twai_rx_task
+// - fixed capacity: the entries are a dense array in arrival order, an open addressing hash maps the ID to the entry
+// - O(1) update and no lock: twai_stat_task is the only writer, each entry is guarded by a sequence counter,
+//   the readers (HTTP) copy an entry and retry if the writer touched it meanwhile
+// - the reset is requested by the reader and done by the writer, so the writer never races with a memset
+
+#define CAN_STATS_ID_MAX (256)
+#define CAN_STATS_HASH_SZ (512) // 2x of CAN_STATS_ID_MAX
+#define CAN_STATS_READ_RETRY (8)
+
+// ----------
+// data structure definition
+// ----------
+typedef struct can_stats_entry_s {
+    uint32_t seq; // odd while the writer updates the entry
+    uint32_t key; // identifier | (extd << 31)
+    uint32_t count;
+    uint32_t change_cnt;
+    int64_t us_last;
+    uint32_t period_min;
+    uint32_t period_max;
+    uint64_t period_sum;
+    uint64_t period_sq_sum; // for the standard deviation
+    uint8_t dlc;
+    uint8_t data[8];
+} can_stats_entry_t;
+
+typedef struct can_stats_ctrl_s {
+    uint32_t num;      // published entries
+    uint32_t overflow; // frames of IDs which don't fit in the table
+    uint32_t reset_req;
+    int16_t hash[CAN_STATS_HASH_SZ]; // index of entry[], -1 if empty
+    can_stats_entry_t entry[CAN_STATS_ID_MAX];
+} can_stats_ctrl_t;
+
+static can_stats_ctrl_t can_stats_ctrl = {
+    .hash = {[0 ... CAN_STATS_HASH_SZ - 1] = -1},
+};
+
+// ----------
+// Writer, twai_stat_task
+// ----------
+static can_stats_entry_t *_can_stats_lookup(uint32_t key)
+{
+    uint32_t h = (key * 2654435761u) % CAN_STATS_HASH_SZ;
+    for (uint32_t i = 0; i < CAN_STATS_HASH_SZ; i++, h = (h + 1) % CAN_STATS_HASH_SZ) {
+        int16_t idx = can_stats_ctrl.hash[h];
+        if (idx < 0) { // not seen before, create the entry
+            if (can_stats_ctrl.num >= CAN_STATS_ID_MAX) {
+                return NULL;
+            }
+            // a reader may still look at this entry from before a reset, keep the sequence counter going
+            can_stats_entry_t *p_entry = &can_stats_ctrl.entry[can_stats_ctrl.num];
+            __atomic_store_n(&p_entry->seq, p_entry->seq + 1, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            memset((uint8_t *)p_entry + offsetof(can_stats_entry_t, key), 0, sizeof(*p_entry) - offsetof(can_stats_entry_t, key));
+            p_entry->key = key;
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            __atomic_store_n(&p_entry->seq, p_entry->seq + 1, __ATOMIC_RELAXED);
+
+            can_stats_ctrl.hash[h] = can_stats_ctrl.num;
+            __atomic_store_n(&can_stats_ctrl.num, can_stats_ctrl.num + 1, __ATOMIC_RELEASE); // publish to the readers
+            return p_entry;
+        } else if (can_stats_ctrl.entry[idx].key == key) {
+            return &can_stats_ctrl.entry[idx];
+        }
+    }
+    return NULL;
+}
+
+static void _can_stats_clear(void)
+{
+    __atomic_store_n(&can_stats_ctrl.num, 0, __ATOMIC_RELEASE);
+    memset(can_stats_ctrl.hash, 0xFF, sizeof(can_stats_ctrl.hash));
+    can_stats_ctrl.overflow = 0;
+}
+
+static void _can_stats_update_one(const twai_message_t *p_msg, int64_t us_time)
+{
+    can_stats_entry_t *p_entry = _can_stats_lookup(p_msg->identifier | ((uint32_t)p_msg->extd << 31));
+    if (p_entry == NULL) {
+        can_stats_ctrl.overflow++;
+        return;
+    }
+
+    __atomic_store_n(&p_entry->seq, p_entry->seq + 1, __ATOMIC_RELAXED); // odd, entry is being updated
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if (p_entry->count) {
+        uint32_t period = (uint32_t)(us_time - p_entry->us_last);
+        if (p_entry->count == 1 || period < p_entry->period_min) {
+            p_entry->period_min = period;
+        }
+        if (period > p_entry->period_max) {
+            p_entry->period_max = period;
+        }
+        p_entry->period_sum += period;
+        p_entry->period_sq_sum += (uint64_t)period * period;
+
+        if (p_entry->dlc != p_msg->data_length_code || memcmp(p_entry->data, p_msg->data, sizeof(p_entry->data))) {
+            p_entry->change_cnt++;
+        }
+    }
+    p_entry->count++;
+    p_entry->us_last = us_time;
+    p_entry->dlc     = p_msg->data_length_code;
+    memcpy(p_entry->data, p_msg->data, sizeof(p_entry->data));
+
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&p_entry->seq, p_entry->seq + 1, __ATOMIC_RELAXED); // even, entry is consistent
+}
+
+void can_stats_update(const twai_message_t *p_msg, const int64_t *p_us_time, uint32_t num)
+{
+    if (__atomic_load_n(&can_stats_ctrl.reset_req, __ATOMIC_ACQUIRE)) {
+        _can_stats_clear();
+        __atomic_store_n(&can_stats_ctrl.reset_req, 0, __ATOMIC_RELEASE);
+    }
+
+    for (uint32_t i = 0; i < num; i++) {
+        _can_stats_update_one(&p_msg[i], p_us_time[i]);
+    }
+}
+
+void can_stats_reset(void)
+{
+    __atomic_store_n(&can_stats_ctrl.reset_req, 1, __ATOMIC_RELEASE);
+}
+
+// ----------
+// Status query API, for WEB-UI
+// ----------
+uint32_t can_stats_num(void)
+{
+    return __atomic_load_n(&can_stats_ctrl.num, __ATOMIC_ACQUIRE);
+}
+
+uint32_t can_stats_webui_query(uint32_t idx, can_stats_webui_status_t *p_status)
+{
+    memset(p_status, 0, sizeof(*p_status));
+    if (idx >= can_stats_num()) {
+        return 1;
+    }
+
+    const can_stats_entry_t *p_entry = &can_stats_ctrl.entry[idx];
+    can_stats_entry_t copy;
+    uint32_t retry;
+    for (retry = 0; retry < CAN_STATS_READ_RETRY; retry++) {
+        uint32_t seq = __atomic_load_n(&p_entry->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            continue;
+        }
+        memcpy(&copy, p_entry, sizeof(copy));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&p_entry->seq, __ATOMIC_RELAXED) == seq) {
+            break;
+        }
+    }
+    if (retry == CAN_STATS_READ_RETRY) {
+        return 1; // the ID is too busy, the caller skips it this time
+    }
+
+    p_status->identifier = copy.key & 0x7FFFFFFF;
+    p_status->extd       = copy.key >> 31;
+    p_status->count      = copy.count;
+    p_status->change_cnt = copy.change_cnt;
+    p_status->us_last    = copy.us_last;
+    p_status->dlc        = copy.dlc;
+    memcpy(p_status->data, copy.data, sizeof(p_status->data));
+
+    if (copy.count > 1) {
+        uint32_t n            = copy.count - 1;
+        double mean           = (double)copy.period_sum / n;
+        double var            = (double)copy.period_sq_sum / n - mean * mean;
+        p_status->period_min  = copy.period_min;
+        p_status->period_max  = copy.period_max;
+        p_status->period_mean = (uint32_t)mean;
+        p_status->jitter      = (var > 0) ? (uint32_t)sqrt(var) : 0;
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+#ifndef __CAN_STATS_H__
+#define __CAN_STATS_H__
+
+#include <stdint.h>
+#include "driver/twai.h"
+
+// ----------
+// Runtime API, only twai_stat_task updates the table
+// ----------
+void can_stats_update(const twai_message_t *p_msg, const int64_t *p_us_time, uint32_t num); // a batch of frames
+void can_stats_reset(void); // served by twai_stat_task on the next batch
+
+// ----------
+// WEBUI API
+// ----------
+typedef struct can_stats_webui_status_s {
+    uint32_t identifier;
+    uint32_t extd;
+    uint32_t count;
+    uint32_t change_cnt; // frames whose DLC/data differs from the previous one
+    int64_t us_last;
+    uint32_t period_min; // us
+    uint32_t period_max;
+    uint32_t period_mean;
+    uint32_t jitter; // standard deviation of the period, us
+    uint8_t dlc;
+    uint8_t data[8];
+} can_stats_webui_status_t;
+
+uint32_t can_stats_num(void);
+uint32_t can_stats_webui_query(uint32_t idx, can_stats_webui_status_t *p_status);
+
+#endif // __CAN_STATS_H__
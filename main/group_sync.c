@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+
+#include "syscfg.h"
+#include "sdlog_service.h"
+#include "sdlog_header.h"
+#include "time_sync.h"
+#include "group_sync.h"
+#include "task_cfg.h"
+
+static const char *TAG = "GROUP_SYNC";
+
+// Several loggers on the same LAN recording one session
+// - the master broadcasts a BEACON every beacon_ms, and START/STOP when the user presses START ALL/STOP ALL on its home page
+// - every logger writes a SDLOG_TYPE_GROUP_BEACON record into each opened log, the record time is the
+//   esp_timer when the beacon arrived (member) or left (master)
+// - host/sdlog_merge maps the logs onto the esp_timer of the master with the beacons, and merges them
+//   into one time-aligned stream
+// The UDP latency is in the beacon records, sdlog_merge keeps the earliest arrival of a window as the reference
+//
+// syscfg.ini
+// [group_sync]
+// role = master      ; master or member, the group sync is off without it
+// group = car1       ; loggers only follow the master of the same group
+// port = 50734
+// beacon_ms = 1000
+
+#define GROUP_SYNC_BEACON_MS_DEF (1000)
+#define GROUP_SYNC_BEACON_MS_MIN (100)
+#define GROUP_SYNC_CMD_REPEAT (3) // UDP broadcast has no retry, the member drops the repeated seq/send time
+
+enum {
+    GROUP_SYNC_ROLE_OFF    = 0,
+    GROUP_SYNC_ROLE_MASTER = 1,
+    GROUP_SYNC_ROLE_MEMBER = 2,
+};
+
+// ----------
+// data structure definition
+// ----------
+typedef struct group_sync_ctrl_s {
+    uint32_t role;
+    char group[16];
+    uint32_t port;
+    uint32_t beacon_ms;
+
+    int sock;
+    uint32_t beacon_seq;
+    uint32_t cmd_seq;         // master: the last command sent, member: the last command executed
+    uint32_t cmd_valid;       // member: cmd_seq is valid
+    uint64_t cmd_us_sys_time; // member: the master's send time of the last command, the repeats carry the same one
+    uint32_t beacon_cnt;
+    uint32_t cmd_cnt;
+    char master[32];
+} group_sync_ctrl_t;
+
+static group_sync_ctrl_t group_sync_ctrl = {
+    .group     = "default",
+    .port      = GROUP_SYNC_PORT_DEF,
+    .beacon_ms = GROUP_SYNC_BEACON_MS_DEF,
+    .sock      = -1,
+};
+
+// ----------
+// SYSCFG
+// ----------
+uint32_t group_sync_syscfg(const char *section, const char *key, const char *value)
+{
+    if (strcmp(key, "role") == 0) {
+        if (strcmp(value, "master") == 0) {
+            group_sync_ctrl.role = GROUP_SYNC_ROLE_MASTER;
+        } else if (strcmp(value, "member") == 0) {
+            group_sync_ctrl.role = GROUP_SYNC_ROLE_MEMBER;
+        }
+    } else if (strcmp(key, "group") == 0) {
+        strlcpy(group_sync_ctrl.group, value, sizeof(group_sync_ctrl.group));
+    } else if (strcmp(key, "port") == 0) {
+        group_sync_ctrl.port = strtoul(value, NULL, 10);
+    } else if (strcmp(key, "beacon_ms") == 0) {
+        uint32_t beacon_ms        = strtoul(value, NULL, 10);
+        group_sync_ctrl.beacon_ms = (beacon_ms < GROUP_SYNC_BEACON_MS_MIN) ? GROUP_SYNC_BEACON_MS_MIN : beacon_ms;
+    }
+    return 1;
+}
+
+// ----------
+// Beacon records
+// ----------
+static void _group_sync_log_beacon(const group_sync_pkt_t *p_pkt, int64_t us_rx, uint32_t is_master)
+{
+    sdlog_group_beacon_t rec = {
+        .seq           = p_pkt->seq,
+        .is_master     = is_master,
+        .us_sys_time   = p_pkt->us_sys_time,
+        .us_epoch_time = p_pkt->us_epoch_time,
+    };
+    memcpy(rec.master, p_pkt->sender, sizeof(rec.master) - 1); // sender is \0 terminated, rec.master[15] stays \0
+
+    for (uint32_t i = 0; i < SDLOG_SOURCE_NUM; i++) {
+        if (sdlog_source_ready(i)) {
+            sdlog_write_ts(i, SDLOG_TYPE_GROUP_BEACON, us_rx, sizeof(rec), &rec);
+        }
+    }
+}
+
+// ----------
+// Master
+// ----------
+// epoch_time: the wall clock of the command without SNTP (the browser time of START ALL), 0 if unknown
+static void _group_sync_pkt_fill(group_sync_pkt_t *p_pkt, uint32_t type, uint32_t source, uint32_t seq, uint64_t epoch_time)
+{
+    memset(p_pkt, 0, sizeof(*p_pkt));
+    memcpy(p_pkt->magic, "QQGS", 4);
+    p_pkt->version = 1;
+    p_pkt->type    = type;
+    p_pkt->source  = source;
+    p_pkt->seq     = seq;
+    strlcpy(p_pkt->group, group_sync_ctrl.group, sizeof(p_pkt->group));
+    strlcpy(p_pkt->sender, syscfg_system_p()->hostname, sizeof(p_pkt->sender));
+    p_pkt->us_sys_time   = esp_timer_get_time();
+    p_pkt->us_epoch_time = time_sync_valid() ? time_sync_epoch_now() : epoch_time;
+}
+
+static int _group_sync_send(const group_sync_pkt_t *p_pkt)
+{
+    struct sockaddr_in dst = {
+        .sin_family      = AF_INET,
+        .sin_port        = htons(group_sync_ctrl.port),
+        .sin_addr.s_addr = htonl(INADDR_BROADCAST),
+    };
+    return sendto(group_sync_ctrl.sock, p_pkt, sizeof(*p_pkt), 0, (struct sockaddr *)&dst, sizeof(dst));
+}
+
+esp_err_t group_sync_cmd(uint32_t type, uint32_t source, uint64_t epoch_time)
+{
+    if (group_sync_ctrl.role != GROUP_SYNC_ROLE_MASTER || group_sync_ctrl.sock < 0 || source >= SDLOG_SOURCE_NUM) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    group_sync_pkt_t pkt;
+    _group_sync_pkt_fill(&pkt, type, source, ++group_sync_ctrl.cmd_seq, epoch_time);
+    for (uint32_t i = 0; i < GROUP_SYNC_CMD_REPEAT; i++) {
+        if (_group_sync_send(&pkt) < 0) {
+            ESP_LOGW(TAG, "send command failed, errno=%d", errno);
+        }
+    }
+
+    if (type == GROUP_SYNC_PKT_START) {
+        sdlog_start(source, pkt.us_epoch_time); // 0: provisional, the first time sync record corrects it
+    } else if (type == GROUP_SYNC_PKT_STOP) {
+        sdlog_stop(source);
+    }
+    group_sync_ctrl.cmd_cnt++;
+    ESP_LOGI(TAG, "%s source %" PRIu32 ", seq=%" PRIu32, (type == GROUP_SYNC_PKT_START) ? "START" : "STOP", source, pkt.seq);
+    return ESP_OK;
+}
+
+static void _group_sync_master_loop(void)
+{
+    while (1) {
+        group_sync_pkt_t pkt;
+        _group_sync_pkt_fill(&pkt, GROUP_SYNC_PKT_BEACON, 0, ++group_sync_ctrl.beacon_seq, 0);
+        if (_group_sync_send(&pkt) >= 0) {
+            _group_sync_log_beacon(&pkt, pkt.us_sys_time, 1); // the send time is the reference of the group
+        }
+        vTaskDelay(pdMS_TO_TICKS(group_sync_ctrl.beacon_ms));
+    }
+}
+
+// ----------
+// Member
+// ----------
+static void _group_sync_member_cmd(const group_sync_pkt_t *p_pkt)
+{
+    // seq restarts at 1 when the master reboots, a repeat also has the send time of the command
+    if (p_pkt->source >= SDLOG_SOURCE_NUM ||
+        (group_sync_ctrl.cmd_valid && p_pkt->seq == group_sync_ctrl.cmd_seq && p_pkt->us_sys_time == group_sync_ctrl.cmd_us_sys_time)) {
+        return; // a repeated command
+    }
+    group_sync_ctrl.cmd_seq         = p_pkt->seq;
+    group_sync_ctrl.cmd_us_sys_time = p_pkt->us_sys_time;
+    group_sync_ctrl.cmd_valid       = 1;
+    group_sync_ctrl.cmd_cnt++;
+
+    if (p_pkt->type == GROUP_SYNC_PKT_START) {
+        if (!sdlog_source_ready(p_pkt->source)) {
+            uint64_t epoch = time_sync_valid() ? time_sync_epoch_now() : p_pkt->us_epoch_time;
+            sdlog_start(p_pkt->source, epoch);
+        }
+    } else if (p_pkt->type == GROUP_SYNC_PKT_STOP) {
+        sdlog_stop(p_pkt->source);
+    }
+    ESP_LOGI(TAG, "%s source %u from %s, seq=%" PRIu32, (p_pkt->type == GROUP_SYNC_PKT_START) ? "START" : "STOP",
+        p_pkt->source, p_pkt->sender, p_pkt->seq);
+}
+
+static void _group_sync_member_loop(void)
+{
+    struct timeval tv = {.tv_sec = 1};
+    setsockopt(group_sync_ctrl.sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    while (1) {
+        group_sync_pkt_t pkt;
+        int len       = recvfrom(group_sync_ctrl.sock, &pkt, sizeof(pkt), 0, NULL, NULL);
+        int64_t us_rx = esp_timer_get_time(); // as close to the arrival as the task gets
+
+        if (len != sizeof(pkt) || memcmp(pkt.magic, "QQGS", 4) != 0 || pkt.version != 1) {
+            continue; // timeout, or not ours
+        }
+        pkt.group[sizeof(pkt.group) - 1]   = '\0';
+        pkt.sender[sizeof(pkt.sender) - 1] = '\0';
+        if (strcmp(pkt.group, group_sync_ctrl.group) != 0) {
+            continue;
+        }
+
+        strlcpy(group_sync_ctrl.master, pkt.sender, sizeof(group_sync_ctrl.master));
+        if (pkt.type == GROUP_SYNC_PKT_BEACON) {
+            group_sync_ctrl.beacon_seq = pkt.seq;
+            group_sync_ctrl.beacon_cnt++;
+            _group_sync_log_beacon(&pkt, us_rx, 0);
+        } else {
+            _group_sync_member_cmd(&pkt);
+        }
+    }
+}
+
+// ----------
+// Task
+// ----------
+static void group_sync_task(void *arg)
+{
+    if (group_sync_ctrl.role == GROUP_SYNC_ROLE_MASTER) {
+        _group_sync_master_loop();
+    } else {
+        _group_sync_member_loop();
+    }
+}
+
+// after wifi_sta_init(), the socket works before the station gets the IP, the packets are just lost
+esp_err_t group_sync_init(void)
+{
+    if (group_sync_ctrl.role == GROUP_SYNC_ROLE_OFF) {
+        return ESP_OK;
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "socket failed, errno=%d", errno);
+        return ESP_OK; // every logger still records on its own, don't stop the boot
+    }
+
+    int opt = 1;
+    setsockopt(sock, SOL_SOCKET, SO_BROADCAST, &opt, sizeof(opt));
+    struct sockaddr_in addr = {
+        .sin_family      = AF_INET,
+        .sin_port        = htons(group_sync_ctrl.port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        ESP_LOGE(TAG, "bind port %" PRIu32 " failed, errno=%d", group_sync_ctrl.port, errno);
+        close(sock);
+        return ESP_OK;
+    }
+    group_sync_ctrl.sock = sock;
+
+    task_create(TASK_ID_GROUP_SYNC, group_sync_task, NULL, NULL);
+
+    ESP_LOGI(TAG, "%s of group %s, port=%" PRIu32 ", beacon=%" PRIu32 "ms",
+        (group_sync_ctrl.role == GROUP_SYNC_ROLE_MASTER) ? "master" : "member", group_sync_ctrl.group,
+        group_sync_ctrl.port, group_sync_ctrl.beacon_ms);
+    return ESP_OK;
+}
+
+// ----------
+// Status query API, for WEB-UI
+// ----------
+uint32_t group_sync_webui_query(group_sync_webui_status_t *p_status)
+{
+    p_status->role       = group_sync_ctrl.role;
+    p_status->group      = group_sync_ctrl.group;
+    p_status->port       = group_sync_ctrl.port;
+    p_status->beacon_seq = group_sync_ctrl.beacon_seq;
+    p_status->beacon_cnt = group_sync_ctrl.beacon_cnt;
+    p_status->cmd_cnt    = group_sync_ctrl.cmd_cnt;
+    strlcpy(p_status->master, group_sync_ctrl.master, sizeof(p_status->master));
+    return 0;
+}
@@ -0,0 +1,59 @@
+#ifndef __GROUP_SYNC_H__
+#define __GROUP_SYNC_H__
+
+#include <stdint.h>
+#include <assert.h>
+#include "esp_err.h"
+
+// ----------
+// UDP packet between the loggers of a group
+// ----------
+#define GROUP_SYNC_PORT_DEF (50734)
+
+enum {
+    GROUP_SYNC_PKT_BEACON = 0,
+    GROUP_SYNC_PKT_START  = 1, // start the sdlog source, the master repeats a command with the same seq
+    GROUP_SYNC_PKT_STOP   = 2,
+};
+
+#pragma pack(push, 1)
+
+typedef struct group_sync_pkt_s {
+    char magic[4];   // FIXED TO "QQGS"
+    uint8_t version; // 1
+    uint8_t type;    // GROUP_SYNC_PKT_xxx
+    uint8_t source;  // SDLOG_SOURCE_xxx of START/STOP
+    uint8_t reserved;
+    char group[16];  // loggers only follow the master of the same group
+    char sender[32]; // hostname of the master
+    uint32_t seq;    // beacons and commands have their own sequence
+    uint32_t reserved2;
+    uint64_t us_sys_time;   // esp_timer of the master at send
+    uint64_t us_epoch_time; // wall clock of the master at send: SNTP, or the browser time of a command, else 0
+} group_sync_pkt_t;
+
+#pragma pack(pop)
+
+static_assert(sizeof(group_sync_pkt_t) == 80, "Group sync packet size mismatch!");
+
+// ----------
+// Master API
+// ----------
+esp_err_t group_sync_cmd(uint32_t type, uint32_t source, uint64_t epoch_time); // broadcast START/STOP and apply it locally, epoch_time: browser time or 0
+
+// ----------
+// WEBUI API
+// ----------
+typedef struct group_sync_webui_status_s {
+    uint32_t role; // 0: off, 1: master, 2: member
+    const char *group;
+    uint32_t port;
+    uint32_t beacon_seq;  // sent (master) or last received (member)
+    uint32_t beacon_cnt;  // received beacons
+    uint32_t cmd_cnt;     // executed commands
+    char master[32];      // the master heard last
+} group_sync_webui_status_t;
+
+uint32_t group_sync_webui_query(group_sync_webui_status_t *p_status);
+
+#endif // __GROUP_SYNC_H__
@@ -1,15 +1,30 @@
 #include <dirent.h>
 #include <sys/stat.h>
 #include <stdarg.h>
+#include <math.h>
 
 #include "esp_http_server.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "lwip/sockets.h"
 
 #include "board.h"
 #include "led.h"
+#include "sdcard.h"
+#include "sdlog_header.h"
 #include "sdlog_service.h"
 #include "sdlog_conv.h"
+#include "sdlog_retention.h"
+#include "sdlog_pool.h"
 #include "twai.h"
+#include "adc_source.h"
+#include "can_signal.h"
+#include "can_stats.h"
+#include "time_sync.h"
+#include "group_sync.h"
+#include "task_cfg.h"
 
 static const char *TAG = "HTTP_SERVER";
 
@@ -59,15 +74,133 @@ uint32_t http_syscfg(const char *section, const char *key, const char *value)
 // ----------
 // HTTP SERVER LOG API
 // ----------
+// The requests are logged by http_server_dispatch() as sdlog_http_access_t records, this is for the events
 static void http_server_sdlog(char *fmt, ...)
 {
-    char buf[SDLOG_HTTP_BUF_SZ];
     va_list args;
     va_start(args, fmt);
-    int32_t ret = vsprintf(buf, fmt, args);
-    if (ret > 0 && ret < sizeof(buf)) {
-        sdlog_write(SDLOG_SOURCE_HTTP, SDLOG_FMT_TEXT__STRING, ret, buf);
+    if (sdlog_write_fmt(SDLOG_SOURCE_HTTP, fmt, args) == ESP_ERR_NOT_SUPPORTED) { // [sdlog] deferred_fmt is off
+        char buf[SDLOG_HTTP_BUF_SZ];
+        int32_t ret = vsnprintf(buf, sizeof(buf), fmt, args);
+        if (ret > 0) {
+            sdlog_write(SDLOG_SOURCE_HTTP, SDLOG_FMT_TEXT__STRING, (ret < sizeof(buf)) ? ret : sizeof(buf) - 1, buf);
+        }
+    }
+    va_end(args);
+}
+
+// ----------
+// HTTP ACCESS LOG
+// ----------
+enum http_uri_e {
+#define HTTP_URI_REG(_name, _uri, _handler) HTTP_URI_##_name,
+#include "http_uri_reg.h"
+#undef HTTP_URI_REG
+    HTTP_URI_NUM,
+};
+
+#define HTTP_URI_REG(_name, _uri, _handler) esp_err_t _handler(httpd_req_t *req);
+#include "http_uri_reg.h"
+#undef HTTP_URI_REG
+
+typedef struct http_uri_stat_s {
+    uint32_t count;
+    uint32_t err_cnt; // status >= 400, or the handler failed
+    uint64_t bytes;
+    uint64_t us_total;
+    uint32_t us_max;
+} http_uri_stat_t;
+
+// httpd serves one request at a time (a single httpd task), the response being sent is accounted here
+typedef struct http_resp_s {
+    uint32_t status;
+    uint32_t bytes;
+    uint32_t no_log; // the request is counted, but no access record (eg. polled every second)
+} http_resp_t;
+
+static http_resp_t http_resp;
+static http_uri_stat_t http_uri_stat[HTTP_URI_NUM];
+
+static esp_err_t _http_send_chunk(httpd_req_t *req, const char *buf, ssize_t buf_len)
+{
+    if (buf) {
+        http_resp.bytes += (buf_len == HTTPD_RESP_USE_STRLEN) ? strlen(buf) : buf_len;
+    }
+    return httpd_resp_send_chunk(req, buf, buf_len);
+}
+
+static esp_err_t _http_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg)
+{
+    switch (error) {
+    case HTTPD_400_BAD_REQUEST:
+        http_resp.status = 400;
+        break;
+    case HTTPD_403_FORBIDDEN:
+        http_resp.status = 403;
+        break;
+    case HTTPD_404_NOT_FOUND:
+        http_resp.status = 404;
+        break;
+    default:
+        http_resp.status = 500;
+        break;
+    }
+    return httpd_resp_send_err(req, error, msg);
+}
+
+static uint32_t _http_client_ip(httpd_req_t *req)
+{
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    if (getpeername(httpd_req_to_sockfd(req), (struct sockaddr *)&addr, &addr_len) != 0) {
+        return 0;
+    }
+
+    uint32_t ip = 0;
+    if (addr.ss_family == AF_INET) {
+        ip = ((struct sockaddr_in *)&addr)->sin_addr.s_addr;
+    } else if (addr.ss_family == AF_INET6) { // httpd listens on IPv6 with LWIP_IPV6, an IPv4 client is ::ffff:a.b.c.d
+        memcpy(&ip, &((struct sockaddr_in6 *)&addr)->sin6_addr.s6_addr[12], sizeof(ip));
+    }
+    return ip;
+}
+
+// Every URI runs through here, user_ctx is the HTTP_URI_xxx
+// After the handler returned: one sdlog_write() of a fixed-size record, the text is made by the exporters
+static esp_err_t http_server_dispatch(httpd_req_t *req)
+{
+    static esp_err_t (*const handler[HTTP_URI_NUM])(httpd_req_t *req) = {
+#define HTTP_URI_REG(_name, _uri, _handler) [HTTP_URI_##_name] = _handler,
+#include "http_uri_reg.h"
+#undef HTTP_URI_REG
+    };
+    uint32_t uri_id = (uint32_t)(uintptr_t)req->user_ctx;
+
+    http_resp      = (http_resp_t){.status = 200};
+    int64_t us_beg = esp_timer_get_time();
+    esp_err_t ret  = handler[uri_id](req);
+    uint32_t us    = esp_timer_get_time() - us_beg;
+
+    http_uri_stat_t *p_stat = &http_uri_stat[uri_id];
+    p_stat->count++;
+    p_stat->err_cnt += (ret != ESP_OK || http_resp.status >= 400);
+    p_stat->bytes += http_resp.bytes;
+    p_stat->us_total += us;
+    p_stat->us_max = (us > p_stat->us_max) ? us : p_stat->us_max;
+
+    if (!http_resp.no_log) {
+        sdlog_http_access_t rec = {
+            .method      = req->method,
+            .uri_id      = uri_id,
+            .status      = http_resp.status,
+            .bytes       = http_resp.bytes,
+            .us_duration = us,
+            .client_ip   = _http_client_ip(req),
+        };
+        httpd_req_get_url_query_str(req, rec.query, sizeof(rec.query)); // cut if longer, empty if none
+        sdlog_write(SDLOG_SOURCE_HTTP, SDLOG_FMT_TEXT__HTTP, sizeof(rec), &rec);
     }
+    return ret;
 }
 
 // ----------
@@ -75,6 +208,7 @@ static void http_server_sdlog(char *fmt, ...)
 // ----------
 static esp_err_t _http_redirect_to_index(httpd_req_t *req, char *uri_redirect)
 {
+    http_resp.status = 303;
     httpd_resp_set_status(req, "303 See Other"); // send HTTP 303 "see other", and redirect to index
     httpd_resp_set_type(req, "text/html");
     httpd_resp_set_hdr(req, "Location", uri_redirect);
@@ -90,14 +224,15 @@ static void http_server_send_resp_chunk_f(httpd_req_t *req, char *fmt, ...)
     vsnprintf(buf, sizeof(buf), fmt, args);
     buf[sizeof(buf) - 1] = '\0';
     va_end(args);
-    httpd_resp_send_chunk(req, buf, HTTPD_RESP_USE_STRLEN);
+    _http_send_chunk(req, buf, HTTPD_RESP_USE_STRLEN);
 }
 
 // ----------
 // URI: /
-// led_op=0(on), led_op=1(off), led_op=2(toggle)
+// led_op=0(on), led_op=1(off), led_op=2(toggle), led_op=3(auto, back to the status patterns)
 // sdlog_start=ch(0/1/2)&epoch_time=time
 // sdlog_stop=ch(0/1/2)
+// group_start=ch(0/1/2)&epoch_time=time, group_stop=ch(0/1/2), the master starts/stops the whole logger group
 // ----------
 
 static void uri_index_led_msg_handle(char *buf)
@@ -110,6 +245,8 @@ static void uri_index_led_msg_handle(char *buf)
             led_op(1);
         } else if (strcmp(param, "2") == 0) {
             led_op(2);
+        } else if (strcmp(param, "3") == 0) {
+            led_op(3);
         }
     }
 }
@@ -123,6 +260,9 @@ static void uri_index_sdlog_msg_handle(char *buf)
         if (ch < SDLOG_SOURCE_NUM) {
             if (httpd_query_key_value(buf, "epoch_time", val_str, sizeof(val_str)) == ESP_OK) {
                 uint64_t epoch = strtoull(val_str, NULL, 10);
+                if (time_sync_valid()) {
+                    epoch = time_sync_epoch_now(); // SNTP is more accurate than the browser
+                }
                 sdlog_start(ch, epoch);
             }
         }
@@ -135,23 +275,31 @@ static void uri_index_sdlog_msg_handle(char *buf)
             http_server_sdlog("sdlog_stop, ch=%d", ch);
         }
     }
+
+    if (httpd_query_key_value(buf, "group_start", val_str, sizeof(val_str)) == ESP_OK) {
+        uint32_t ch    = atoi(val_str);
+        uint64_t epoch = 0; // SNTP goes first, group_sync_cmd() takes it
+        if (httpd_query_key_value(buf, "epoch_time", val_str, sizeof(val_str)) == ESP_OK) {
+            epoch = strtoull(val_str, NULL, 10);
+        }
+        group_sync_cmd(GROUP_SYNC_PKT_START, ch, epoch);
+    }
+
+    if (httpd_query_key_value(buf, "group_stop", val_str, sizeof(val_str)) == ESP_OK) {
+        group_sync_cmd(GROUP_SYNC_PKT_STOP, atoi(val_str), 0);
+    }
 }
 
 esp_err_t uri_index(httpd_req_t *req)
 {
     // Handle GET
     char buf[128]; // No very long query string here, fixed size here to avoid buffer overflow
-    if (httpd_req_get_url_query_len(req)) {
-        http_server_sdlog("/?%s", buf);
-
-        if (httpd_req_get_url_query_str(req, buf, sizeof(buf)) == ESP_OK) {
-            uri_index_led_msg_handle(buf);
-            uri_index_sdlog_msg_handle(buf);
-        }
-    } else {
-        http_server_sdlog("/");
+    if (httpd_req_get_url_query_str(req, buf, sizeof(buf)) == ESP_OK) {
+        uri_index_led_msg_handle(buf);
+        uri_index_sdlog_msg_handle(buf);
     }
 
+    static const char *twai_state_str[] = {"STOPPED", "RUNNING", "BUS-OFF", "RECOVERING"}; // twai_state_t
     twai_webui_status_t twai_status;
     twai_webui_query(&twai_status);
 
@@ -166,30 +314,85 @@ esp_err_t uri_index(httpd_req_t *req)
         "<head><title>QQMLAB CAN Logger</title></head>"
         "<h1>QQMLAB CAN LOGGER</h1>"
         "<h3>Status</h3>"
-        "<p>Board: %s | Free RAM: %lu bytes</p>"
+        "<p>Board: %s | Free RAM: %lu bytes (low water %lu, largest block %lu)</p>"
         "<p>LED Status: <b>%s</b></p>"
         "<p>CAN RX:%lu TX:%lu</p>"
-        "<hr>",
-        BOARD_NAME, esp_get_free_heap_size(), led_stat_buf, twai_status.rx_pkt, twai_status.tx_pkt);
+        "<p>CAN Bus: %s, load %lu.%lu%%, TEC/REC %lu/%lu, bus errors %lu, arbitration lost %lu, "
+        "driver lost %lu (queue full) %lu (FIFO overrun), statistics lost %lu, alerts 0x%05lX</p>",
+        BOARD_NAME, esp_get_free_heap_size(), esp_get_minimum_free_heap_size(),
+        (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT), led_stat_buf, twai_status.rx_pkt, twai_status.tx_pkt,
+        (twai_status.state < 4) ? twai_state_str[twai_status.state] : "?", twai_status.bus_load / 10, twai_status.bus_load % 10,
+        twai_status.tx_error_counter, twai_status.rx_error_counter, twai_status.bus_error, twai_status.arb_lost,
+        twai_status.rx_missed, twai_status.rx_overrun, twai_status.stat_drop, twai_status.alerts);
+
+    adc_webui_status_t adc_status;
+    adc_webui_query(&adc_status);
+    if (adc_status.running) {
+        char adc_last_buf[ADC_SOURCE_CH_MAX * 12] = {0};
+        for (uint32_t i = 0; i < adc_status.ch_num; i++) {
+            snprintf(adc_last_buf + strlen(adc_last_buf), sizeof(adc_last_buf) - strlen(adc_last_buf), " ch%u=%u",
+                adc_status.ch[i], adc_status.raw_last[i]);
+        }
+        http_server_send_resp_chunk_f(req, "<p>ADC: %lu Hz, %lu blocks, driver lost %lu frames, %lu blocks not logged,%s</p>",
+            adc_status.rate_hz, adc_status.blocks, adc_status.frame_drop, adc_status.block_drop, adc_last_buf);
+    }
+
+    time_sync_webui_status_t time_status;
+    time_sync_webui_query(&time_status);
+    if (time_status.valid) {
+        http_server_send_resp_chunk_f(req, "<p>Time: SNTP %s, %lu updates, last correction %lld us (%ld ppb)</p><hr>",
+            time_status.server, time_status.sync_cnt, time_status.us_correction, time_status.drift_ppb);
+    } else {
+        http_server_send_resp_chunk_f(req, "<p>Time: SNTP %s not synced yet, the logs use the browser time</p><hr>", time_status.server);
+    }
+
+    group_sync_webui_status_t group_status;
+    group_sync_webui_query(&group_status);
+    if (group_status.role == 1) {
+        http_server_send_resp_chunk_f(req, "<p>Group %s (UDP %lu): master, beacon #%lu, %lu commands</p>",
+            group_status.group, group_status.port, group_status.beacon_seq, group_status.cmd_cnt);
+    } else if (group_status.role == 2) {
+        http_server_send_resp_chunk_f(req, "<p>Group %s (UDP %lu): member of %s, %lu beacons (last #%lu), %lu commands</p>",
+            group_status.group, group_status.port, group_status.master[0] ? group_status.master : "-",
+            group_status.beacon_cnt, group_status.beacon_seq, group_status.cmd_cnt);
+    }
 
     http_server_send_resp_chunk_f(req, "<h3>SD Logging Control</h3><p>");
 
+    sdlog_retention_status_t ret_status;
+    sdlog_retention_query(SDLOG_SOURCE_NUM, &ret_status);
+    if (ret_status.total) {
+        http_server_send_resp_chunk_f(req, "  SD card: %" PRIu64 " MB free of %" PRIu64 " MB (estimated)<br>", ret_status.free >> 20, ret_status.total >> 20);
+    }
+
     for (int i = 0; i < SDLOG_SOURCE_NUM; i++) {
         sdlog_webui_status_t status;
         sdlog_webui_query(i, &status);
+        sdlog_retention_query(i, &ret_status);
 
         http_server_send_resp_chunk_f(req,
             "  Channel %d (%s): %s "
             "  <button onclick='doStart(%d)' %s>START</button> "
             "  <button onclick='doStop(%d)' %s>STOP</button> "
-            "  <i>(Written: %" PRIu32 " bytes)</i><br>",
+            "  <i>(Written: %" PRIu32 " bytes, Dropped: %" PRIu32 ", First record: %" PRIu64 " ms after boot, "
+            "Sessions: %" PRIu64 " MB, %" PRIu32 " evicted)</i><br>",
             i, status.name, status.is_logging ? "&#128308; <b style='color:red;'>[REC]</b>" : "&#9898; IDLE",
             i, status.is_logging ? "disabled" : "", // Recording, no press START
             i, status.is_logging ? "" : "disabled", // IDLE, no press STOP
-            status.bytes_written);
+            status.bytes_written, status.drop_cnt, status.us_first_rec / 1000, ret_status.used >> 20, ret_status.evicted);
+        if (status.sd_fault) {
+            http_server_send_resp_chunk_f(req, "  &nbsp;&nbsp;<b style='color:red;'>SD card fault</b>, waiting for the card (spill buffer: %" PRIu32 " bytes)<br>",
+                status.spill_bytes);
+        }
+        if (group_status.role == 1) {
+            http_server_send_resp_chunk_f(req,
+                "  &nbsp;&nbsp;Group: <button onclick='doGroup(\"group_start\",%d)'>START ALL</button> "
+                "<button onclick='doGroup(\"group_stop\",%d)'>STOP ALL</button><br>",
+                i, i);
+        }
     }
 
-    httpd_resp_send_chunk(req,
+    _http_send_chunk(req,
         "</p>"
         "<script>"
         "async function doStart(ch) {"
@@ -202,18 +405,31 @@ esp_err_t uri_index(httpd_req_t *req)
         "  fetch(`/?sdlog_stop=${ch}`).then(() => {"
         "    setTimeout(() => { location.href = '/'; }, 500);});" // once fetch got response, then wait 0.5ms to refresh
         "}"
+
+        "async function doGroup(op, ch) {"
+        "  const ts = BigInt(Date.now()) * 1000n;" // same as doStart(), the epoch without SNTP
+        "  fetch(`/?${op}=${ch}&epoch_time=${ts.toString()}`).then(() => {"
+        "    setTimeout(() => { location.href = '/'; }, 500);});"
+        "}"
         "</script>"
 
         "<hr>"
         "<h3>Log Download</h3>"
         "<a href='/log_browse?admin=0'>[ Browse Log ]</a><br>"
         "<a href='/log_browse?admin=1'>[ Browse Log (admin) ]</a><br>"
+        "<a href='/bus_stats'>[ Bus Statistics ]</a><br>"
+        "<a href='/signal_stats'>[ Signal Statistics (JSON) ]</a><br>"
+        "<a href='/http_stats'>[ HTTP Statistics (JSON) ]</a><br>"
+        "<a href='/sd_bench'>[ SD Card Benchmark (JSON, stop the logging first) ]</a><br>"
+        "<a href='/mem_stats'>[ Memory Statistics (JSON) ]</a><br>"
+        "<a href='/conv_jobs'>[ Conversion Jobs (JSON) ]</a><br>"
 
         "<hr>"
         "<h3>LED Control Panel</h3>"
         "<a href='/?led_op=0'>[ Turn ON ]</a><br>"
         "<a href='/?led_op=1'>[ Turn OFF ]</a><br>"
-        "<a href='/?led_op=2'>[ Toggle ]</a><br>",
+        "<a href='/?led_op=2'>[ Toggle ]</a><br>"
+        "<a href='/?led_op=3'>[ Auto ]</a><br>",
 
         HTTPD_RESP_USE_STRLEN);
 
@@ -225,8 +441,8 @@ esp_err_t uri_index(httpd_req_t *req)
         }
     }
 
-    httpd_resp_send_chunk(req, "</html>", HTTPD_RESP_USE_STRLEN);
-    httpd_resp_send_chunk(req, NULL, 0); // end-of-transmission
+    _http_send_chunk(req, "</html>", HTTPD_RESP_USE_STRLEN);
+    _http_send_chunk(req, NULL, 0); // end-of-transmission
 
     return ESP_OK;
 }
@@ -238,7 +454,7 @@ static esp_err_t uri_browse_log_recursive(httpd_req_t *req, const char *dir_path
 {
     DIR *dir = opendir(dir_path);
     if (dir == NULL) {
-        httpd_resp_send_chunk(req, "<tr><td colspan='5' style='color:grey; text-align:center;'>No data in this category</td></tr>", HTTPD_RESP_USE_STRLEN);
+        _http_send_chunk(req, "<tr><td colspan='5' style='color:grey; text-align:center;'>No data in this category</td></tr>", HTTPD_RESP_USE_STRLEN);
         return ESP_OK;
     }
 
@@ -284,10 +500,14 @@ static esp_err_t uri_browse_log_recursive(httpd_req_t *req, const char *dir_path
             if (admin_mode == 0) {
                 http_server_send_resp_chunk_f(req, "<td></td><td></td>");
             } else {
-                http_server_send_resp_chunk_f(req,
-                    "<td><a href='/log_conv?path=%s'>Conv</a></td>"
-                    "<td><a href='/log_remove?path=%s'>Remove</a></td>",
-                    entry_path, entry_path);
+                http_server_send_resp_chunk_f(req, "<td><a href='/log_conv?path=%s'>Conv</a>", entry_path);
+                if (strstr(entry_path, "/can/") && strcmp(entry->d_name, "log.bin") == 0) { // per-ID columnar export for CAN logs
+                    http_server_send_resp_chunk_f(req, " | <a href='/log_conv?path=%s&exporter=CANCOL'>Col</a>", entry_path);
+                }
+                if (strstr(entry_path, "/adc/") && strcmp(entry->d_name, "log.bin") == 0) { // a line per sample, Conv makes adc.bin
+                    http_server_send_resp_chunk_f(req, " | <a href='/log_conv?path=%s&exporter=ADCCSV'>CSV</a>", entry_path);
+                }
+                http_server_send_resp_chunk_f(req, "</td><td><a href='/log_remove?path=%s'>Remove</a></td>", entry_path);
             }
 
             http_server_send_resp_chunk_f(req, "</tr>", HTTPD_RESP_USE_STRLEN);
@@ -308,16 +528,13 @@ esp_err_t uri_browse_log(httpd_req_t *req)
     uint32_t admin_mode = 0;
     if (httpd_req_get_url_query_str(req, buf, sizeof(buf)) == ESP_OK) {
         char buf_admin[8];
-        http_server_sdlog("/browse_log?%s", buf);
         if (httpd_query_key_value(buf, "admin", buf_admin, sizeof(buf_admin)) == ESP_OK) {
             admin_mode = (strcmp(buf_admin, "1") == 0);
         }
-    } else {
-        http_server_sdlog("/browse_log");
     }
 
     // Send HTTP header
-    httpd_resp_send_chunk(req,
+    _http_send_chunk(req,
         "<html><head><style>"
         // 1. 回歸第一版最愛的 Sans-serif 現代感
         "body{margin:15px; background-color:#f8f9fa; font-family:sans-serif; font-size:14px; color:#333;}"
@@ -337,7 +554,7 @@ esp_err_t uri_browse_log(httpd_req_t *req)
         "</style></head><body>",
         HTTPD_RESP_USE_STRLEN);
 
-    httpd_resp_send_chunk(req, "<h2>QQMLAB Logger - File Explorer</h2>", HTTPD_RESP_USE_STRLEN);
+    _http_send_chunk(req, "<h2>QQMLAB Logger - File Explorer</h2>", HTTPD_RESP_USE_STRLEN);
 
     // Define the category that we want to display. Static first, dynamic later
     for (uint32_t i = 0; i < SDLOG_SOURCE_NUM; i++) {
@@ -348,7 +565,7 @@ esp_err_t uri_browse_log(httpd_req_t *req)
         http_server_send_resp_chunk_f(req, "<h3>[ %s ]</h3>", status.name);
 
         // BEGIN OF TABLE
-        httpd_resp_send_chunk(req, "<table><tr><th>File Path</th><th>Size</th><th>Action</th><th>Conv</th><th>Remove</th></tr>", HTTPD_RESP_USE_STRLEN);
+        _http_send_chunk(req, "<table><tr><th>File Path</th><th>Size</th><th>Action</th><th>Conv</th><th>Remove</th></tr>", HTTPD_RESP_USE_STRLEN);
 
         // Generate target path, and scan
         char target_path[64];
@@ -356,11 +573,11 @@ esp_err_t uri_browse_log(httpd_req_t *req)
         uri_browse_log_recursive(req, target_path, admin_mode);
 
         // END OF TABLE
-        httpd_resp_send_chunk(req, "</table>", HTTPD_RESP_USE_STRLEN);
+        _http_send_chunk(req, "</table>", HTTPD_RESP_USE_STRLEN);
     }
 
-    httpd_resp_send_chunk(req, "<br><a href='/'>Back to Home</a></body></html>", HTTPD_RESP_USE_STRLEN);
-    httpd_resp_send_chunk(req, NULL, 0);
+    _http_send_chunk(req, "<br><a href='/'>Back to Home</a></body></html>", HTTPD_RESP_USE_STRLEN);
+    _http_send_chunk(req, NULL, 0);
     return ESP_OK;
 }
 
@@ -373,28 +590,25 @@ static esp_err_t _log_op(httpd_req_t *req, uint32_t op_0download_1remove_2conv)
     // Eg: /download?path=/sdcard/log/http/000023/log.txt
     char buf[128];
     if (httpd_req_get_url_query_str(req, buf, sizeof(buf)) != ESP_OK) {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing Query String");
+        _http_send_err(req, HTTPD_400_BAD_REQUEST, "Missing Query String");
         return ESP_FAIL;
     }
 
-    char *uri_dict[] = {"log_download", "log_remove", "log_conv"};
-    http_server_sdlog("/%s?%s", uri_dict[op_0download_1remove_2conv], buf);
-
     char path[128];
     if (httpd_query_key_value(buf, "path", path, sizeof(path)) != ESP_OK) {
-        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing path parameter");
+        _http_send_err(req, HTTPD_400_BAD_REQUEST, "Missing path parameter");
         return ESP_FAIL;
     }
 
     char *log_root = MNT_SDCARD "/log";
     if (strncmp(path, log_root, strlen(log_root))) { // ensure correct path
         ESP_LOGW(TAG, "Access denied: %s", path);
-        httpd_resp_send_err(req, HTTPD_403_FORBIDDEN, "Access Denied");
+        _http_send_err(req, HTTPD_403_FORBIDDEN, "Access Denied");
         return ESP_FAIL;
     }
 
     if (op_0download_1remove_2conv == 0) {
-        char header_val[64]; // the header formating is sent when httpd_resp_send_chunk() is firstly called
+        char header_val[64]; // the header formating is sent when _http_send_chunk() is firstly called
 
         if (strstr(path, ".txt") || strstr(path, ".log")) {
             httpd_resp_set_type(req, "text/plain; charset=utf-8"); // set to pure text to let brower display it directly
@@ -415,7 +629,7 @@ static esp_err_t _log_op(httpd_req_t *req, uint32_t op_0download_1remove_2conv)
         FILE *f = fopen(path, "rb");
         if (!f) {
             ESP_LOGE(TAG, "Failed to open file : %s", path);
-            httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "File not found");
+            _http_send_err(req, HTTPD_404_NOT_FOUND, "File not found");
             return ESP_FAIL;
         }
 
@@ -424,20 +638,23 @@ static esp_err_t _log_op(httpd_req_t *req, uint32_t op_0download_1remove_2conv)
             uint8_t chunk[512]; // stream the file content
             n = fread(chunk, 1, sizeof(chunk), f);
             if (n > 0) {
-                if (httpd_resp_send_chunk(req, (const char *)chunk, n) != ESP_OK) {
+                if (_http_send_chunk(req, (const char *)chunk, n) != ESP_OK) {
                     fclose(f);
-                    httpd_resp_send_chunk(req, NULL, 0); // for terminated if fail
+                    _http_send_chunk(req, NULL, 0); // for terminated if fail
                     return ESP_FAIL;
                 }
             }
         } while (n > 0);
         fclose(f);
 
-        httpd_resp_send_chunk(req, NULL, 0); // end-of-transmission
+        _http_send_chunk(req, NULL, 0); // end-of-transmission
         return ESP_OK;
 
     } else if (op_0download_1remove_2conv == 1) {
+        struct stat st;
+        int64_t size = (stat(path, &st) == 0) ? st.st_size : 0;
         if (remove(path) == 0) {
+            sdlog_retention_account(path, -size);
             ESP_LOGI(TAG, "Deleted: %s", path);
         } else {
             ESP_LOGE(TAG, "Delete failed: %s", path);
@@ -445,8 +662,26 @@ static esp_err_t _log_op(httpd_req_t *req, uint32_t op_0download_1remove_2conv)
         return _http_redirect_to_index(req, "/log_browse?admin=1");
 
     } else if (op_0download_1remove_2conv == 2) {
-        sdlog_conv_trig(path);
-        return _http_redirect_to_index(req, "/log_browse?admin=1");
+        char exporter[16]; // optional, eg. exporter=CANCOL, the default exporter of the log format if absent
+        uint32_t exporter_id = SDLOG_EXPORTER_AUTO;
+        esp_err_t ret = httpd_query_key_value(buf, "exporter", exporter, sizeof(exporter));
+        if (ret != ESP_ERR_NOT_FOUND) {
+            exporter_id = (ret == ESP_OK) ? sdlog_conv_exporter_find(exporter) : SDLOG_EXPORTER_NUM; // truncated: unknown
+            if (exporter_id == SDLOG_EXPORTER_NUM) {
+                _http_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown exporter, valid:"
+#define SDLOG_EXPORTER_REG(_name, _bmp_fmt_supported, _fn_output, _passes, _cb) " " #_name
+#include "sdlog_exporter_reg.h"
+#undef SDLOG_EXPORTER_REG
+                );
+                return ESP_FAIL;
+            }
+        }
+        uint32_t id = sdlog_conv_trig(path, exporter_id, SDLOG_CONV_PRIO_USER);
+        if (id == 0) {
+            _http_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Conversion queue full");
+            return ESP_FAIL;
+        }
+        return _http_redirect_to_index(req, "/conv_jobs");
     } else {
         return _http_redirect_to_index(req, "/log_browse");
     }
@@ -467,6 +702,135 @@ esp_err_t uri_log_conv(httpd_req_t *req)
     return _log_op(req, 2); // conversion
 }
 
+// ----------
+// URI: /signal_stats
+// reset=1 clears the statistics
+// ----------
+// a JSON number, null if NaN/inf (%g prints nan/inf, not JSON)
+static const char *_http_json_num(char *buf, size_t size, float v)
+{
+    if (!isfinite(v)) {
+        return "null";
+    }
+    snprintf(buf, size, "%g", v);
+    return buf;
+}
+
+esp_err_t uri_signal_stats(httpd_req_t *req)
+{
+    char buf[32];
+    if (httpd_req_get_url_query_str(req, buf, sizeof(buf)) == ESP_OK) {
+        char val[4];
+        if (httpd_query_key_value(buf, "reset", val, sizeof(val)) == ESP_OK && strcmp(val, "1") == 0) {
+            can_signal_reset();
+        }
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    _http_send_chunk(req, "{\"signals\":[", HTTPD_RESP_USE_STRLEN);
+
+    for (uint32_t i = 0; i < can_signal_num(); i++) {
+        can_signal_webui_status_t status;
+        can_signal_webui_query(i, &status);
+
+        char num[6][16];
+        http_server_send_resp_chunk_f(req,
+            "%s{\"name\":\"%s\",\"id\":\"%0*" PRIX32 "\",\"count\":%" PRIu32 ","
+            "\"min\":%s,\"max\":%s,\"mean\":%s,\"last\":%s,\"hist_min\":%s,\"hist_max\":%s,\"hist\":[",
+            i ? "," : "", status.name, status.extd ? 8 : 3, status.identifier, status.count,
+            _http_json_num(num[0], sizeof(num[0]), status.min), _http_json_num(num[1], sizeof(num[1]), status.max),
+            _http_json_num(num[2], sizeof(num[2]), status.mean), _http_json_num(num[3], sizeof(num[3]), status.last),
+            _http_json_num(num[4], sizeof(num[4]), status.hist_min), _http_json_num(num[5], sizeof(num[5]), status.hist_max));
+
+        for (uint32_t j = 0; j < CAN_SIGNAL_HIST_BIN; j++) {
+            http_server_send_resp_chunk_f(req, "%s%" PRIu32, j ? "," : "", status.hist[j]);
+        }
+        _http_send_chunk(req, "]}", HTTPD_RESP_USE_STRLEN);
+    }
+
+    _http_send_chunk(req, "]}", HTTPD_RESP_USE_STRLEN);
+    _http_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+// ----------
+// URI: /bus_stats
+// fmt=json returns the per-ID table, otherwise the page polling it every second
+// reset=1 clears the statistics
+// ----------
+static esp_err_t uri_bus_stats_json(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, "application/json");
+    _http_send_chunk(req, "{\"ids\":[", HTTPD_RESP_USE_STRLEN);
+
+    uint32_t first = 1;
+    for (uint32_t i = 0; i < can_stats_num(); i++) {
+        can_stats_webui_status_t status;
+        if (can_stats_webui_query(i, &status)) {
+            continue;
+        }
+
+        char data_hex[17] = {0};
+        for (uint32_t j = 0; j < status.dlc && j < 8; j++) {
+            snprintf(&data_hex[j * 2], 3, "%02X", status.data[j]);
+        }
+
+        http_server_send_resp_chunk_f(req,
+            "%s{\"id\":\"%0*" PRIX32 "\",\"count\":%" PRIu32 ",\"change\":%" PRIu32 ",\"last_us\":%" PRId64 ","
+            "\"period_min\":%" PRIu32 ",\"period_max\":%" PRIu32 ",\"period_mean\":%" PRIu32 ",\"jitter\":%" PRIu32 ","
+            "\"dlc\":%u,\"data\":\"%s\"}",
+            first ? "" : ",", status.extd ? 8 : 3, status.identifier, status.count, status.change_cnt, status.us_last,
+            status.period_min, status.period_max, status.period_mean, status.jitter,
+            status.dlc, data_hex);
+        first = 0;
+    }
+
+    _http_send_chunk(req, "]}", HTTPD_RESP_USE_STRLEN);
+    _http_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+esp_err_t uri_bus_stats(httpd_req_t *req)
+{
+    char buf[32];
+    char val[8];
+    if (httpd_req_get_url_query_str(req, buf, sizeof(buf)) == ESP_OK) {
+        if (httpd_query_key_value(buf, "reset", val, sizeof(val)) == ESP_OK && strcmp(val, "1") == 0) {
+            can_stats_reset();
+        }
+        if (httpd_query_key_value(buf, "fmt", val, sizeof(val)) == ESP_OK && strcmp(val, "json") == 0) {
+            http_resp.no_log = 1; // polled every second, only counted
+            return uri_bus_stats_json(req);
+        }
+    }
+
+    // the table is rendered/sorted by the browser, the device only serves JSON
+    _http_send_chunk(req,
+        "<html><head><title>Bus Statistics</title><style>"
+        "body{font-family:sans-serif; font-size:14px;}"
+        "table{border-collapse:collapse;} th,td{border:1px solid #ddd; padding:3px 10px; text-align:right;}"
+        "th{background-color:#eee; cursor:pointer;} td.d{font-family:monospace; text-align:left;}"
+        "</style></head><body>"
+        "<h2>Bus Statistics (per CAN ID)</h2>"
+        "<a href='/'>Back to Home</a> | <a href='/bus_stats?reset=1'>Reset</a> | <a href='/bus_stats?fmt=json'>JSON</a><br><br>"
+        "<table><thead><tr id='h'></tr></thead><tbody id='b'></tbody></table>"
+        "<script>"
+        "const cols=['id','count','change','period_mean','period_min','period_max','jitter','dlc','data'];"
+        "let key='id', dir=1;"
+        "document.getElementById('h').innerHTML=cols.map(c=>`<th onclick=\"srt('${c}')\">${c}</th>`).join('');"
+        "function srt(c){ dir=(key==c)?-dir:1; key=c; }"
+        "async function poll(){"
+        "  const r=await (await fetch('/bus_stats?fmt=json')).json();"
+        "  r.ids.sort((a,b)=>((a[key]>b[key])-(a[key]<b[key]))*dir);"
+        "  document.getElementById('b').innerHTML=r.ids.map(e=>'<tr>'+cols.map(c=>`<td${c=='data'?\" class=d\":''}>${e[c]}</td>`).join('')+'</tr>').join('');"
+        "}"
+        "poll(); setInterval(poll, 1000);"
+        "</script></body></html>",
+        HTTPD_RESP_USE_STRLEN);
+    _http_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
 // ----------
 // URI: /can_tx
 // id=123&data=AABBCC
@@ -496,14 +860,13 @@ esp_err_t uri_can_tx(httpd_req_t *req)
     char buf[128];
     if (httpd_req_get_url_query_len(req)) {
         if (httpd_req_get_url_query_str(req, buf, sizeof(buf)) == ESP_OK) {
-            http_server_sdlog("/can_tx/?%s", buf);
             char str_id[16]   = {0};
             char str_data[32] = {0};
             httpd_query_key_value(buf, "id", str_id, sizeof(str_id));
             httpd_query_key_value(buf, "data", str_data, sizeof(str_data));
 
             if ((strlen(str_id) == 0) || (strlen(str_data) == 0)) {
-                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing ID or Data (e.g. /can_tx?id=123&data=1122)");
+                _http_send_err(req, HTTPD_400_BAD_REQUEST, "Missing ID or Data (e.g. /can_tx?id=123&data=1122)");
                 return ESP_FAIL;
             }
 
@@ -515,15 +878,179 @@ esp_err_t uri_can_tx(httpd_req_t *req)
             esp_err_t res = twai_webui_transmit(can_id, data_len, data);
 
             if (res != ESP_OK) {
-                httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "TWAI Transmit Failed");
+                _http_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "TWAI Transmit Failed");
             }
         }
     } else {
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "CAN TX without valid parameter");
+        _http_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "CAN TX without valid parameter");
     }
     return _http_redirect_to_index(req, "/");
 }
 
+// ----------
+// URI: /http_stats
+// requests, errors, response bytes and handler time per URI, reset=1 clears them
+// ----------
+esp_err_t uri_http_stats(httpd_req_t *req)
+{
+    static const char *uri_str[HTTP_URI_NUM] = {
+#define HTTP_URI_REG(_name, _uri, _handler) [HTTP_URI_##_name] = _uri,
+#include "http_uri_reg.h"
+#undef HTTP_URI_REG
+    };
+
+    char buf[32];
+    char val[4];
+    if (httpd_req_get_url_query_str(req, buf, sizeof(buf)) == ESP_OK &&
+        httpd_query_key_value(buf, "reset", val, sizeof(val)) == ESP_OK && strcmp(val, "1") == 0) {
+        memset(http_uri_stat, 0, sizeof(http_uri_stat));
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    _http_send_chunk(req, "{\"uris\":[", HTTPD_RESP_USE_STRLEN);
+    for (uint32_t i = 0; i < HTTP_URI_NUM; i++) {
+        http_uri_stat_t *p_stat = &http_uri_stat[i];
+        http_server_send_resp_chunk_f(req,
+            "%s{\"uri\":\"%s\",\"count\":%" PRIu32 ",\"err\":%" PRIu32 ",\"bytes\":%" PRIu64 ","
+            "\"us_mean\":%" PRIu64 ",\"us_max\":%" PRIu32 "}",
+            i ? "," : "", uri_str[i], p_stat->count, p_stat->err_cnt, p_stat->bytes,
+            p_stat->count ? p_stat->us_total / p_stat->count : 0, p_stat->us_max);
+    }
+    _http_send_chunk(req, "]}", HTTPD_RESP_USE_STRLEN);
+    _http_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+// ----------
+// URI: /sd_bench
+// sequential write/read of every bus profile of the board, mb=N MB per profile (default 2, max 16)
+// Every profile remounts the card, refused while a source is logging or a conversion job is queued/running
+// ----------
+esp_err_t uri_sd_bench(httpd_req_t *req)
+{
+    char buf[32];
+    char val[8];
+    uint32_t mb = 2;
+    if (httpd_req_get_url_query_str(req, buf, sizeof(buf)) == ESP_OK && httpd_query_key_value(buf, "mb", val, sizeof(val)) == ESP_OK) {
+        mb = strtoul(val, NULL, 10);
+        mb = (mb < 1) ? 1 : (mb > 16) ? 16 : mb;
+    }
+
+    for (uint32_t i = 0; i < SDLOG_SOURCE_NUM; i++) {
+        sdlog_webui_status_t status;
+        sdlog_webui_query(i, &status);
+        if (status.is_logging || status.sd_fault) {
+            _http_send_err(req, HTTPD_400_BAD_REQUEST, "Stop the logging first");
+            return ESP_FAIL;
+        }
+    }
+    if (sdlog_conv_dir_busy(MNT_SDCARD)) {
+        _http_send_err(req, HTTPD_400_BAD_REQUEST, "Wait for the conversion jobs or cancel them");
+        return ESP_FAIL;
+    }
+
+    uint32_t num           = sd_card_profile_num();
+    uint32_t best          = num;
+    sd_card_bench_t *p_res = calloc(num, sizeof(sd_card_bench_t));
+    if (p_res == NULL || sd_card_bench(mb << 20, p_res, &best) != ESP_OK) {
+        free(p_res);
+        _http_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "SD card busy");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    http_server_send_resp_chunk_f(req, "{\"active\":\"%s\",\"bytes\":%" PRIu32 ",\"profiles\":[", sd_card_profile_active()->name, mb << 20);
+    for (uint32_t i = 0; i < num; i++) {
+        const sd_card_profile_t *p_profile = sd_card_profile(i);
+        const sd_card_bench_t *p_r         = &p_res[i];
+        http_server_send_resp_chunk_f(req,
+            "%s{\"name\":\"%s\",\"width\":%" PRIu32 ",\"freq_khz\":%" PRIu32 ",\"max_transfer_sz\":%" PRIu32 ","
+            "\"mount\":%" PRIu32 ",\"stable\":%" PRIu32 ",\"real_freq_khz\":%" PRIu32 ",\"write_kBps\":%" PRIu32 ","
+            "\"read_kBps\":%" PRIu32 ",\"p99_us\":%" PRIu32 ",\"max_us\":%" PRIu32 "}",
+            i ? "," : "", p_profile->name, p_profile->width, p_profile->freq_khz, p_profile->max_transfer_sz,
+            p_r->mount, p_r->stable, p_r->freq_khz, p_r->kbps_write, p_r->kbps_read, p_r->us_p99, p_r->us_max);
+    }
+    if (best < num) {
+        http_server_send_resp_chunk_f(req, "],\"recommended\":\"%s\",\"syscfg\":\"[sdcard] profile = %s\"}",
+            sd_card_profile(best)->name, sd_card_profile(best)->name);
+    } else {
+        _http_send_chunk(req, "],\"recommended\":null}", HTTPD_RESP_USE_STRLEN);
+    }
+    _http_send_chunk(req, NULL, 0);
+
+    free(p_res);
+    return ESP_OK;
+}
+
+// ----------
+// URI: /mem_stats
+// heap free/low water/largest block, frag_pct = 100 - largest block * 100 / free (8-bit capable heap)
+// and the sdlog buffer pools, a non-zero fallback means the pool is too small for the load
+// ----------
+esp_err_t uri_mem_stats(httpd_req_t *req)
+{
+    uint32_t heap_free    = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    uint32_t heap_largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+
+    httpd_resp_set_type(req, "application/json");
+    http_server_send_resp_chunk_f(req,
+        "{\"heap\":{\"free\":%" PRIu32 ",\"min_free\":%" PRIu32 ",\"largest_block\":%" PRIu32 ",\"frag_pct\":%" PRIu32 "},"
+        "\"pools\":[",
+        heap_free, (uint32_t)esp_get_minimum_free_heap_size(), heap_largest,
+        heap_free ? 100 - (uint32_t)((uint64_t)heap_largest * 100 / heap_free) : 0);
+    for (uint32_t i = 0; i < SDLOG_POOL_NUM; i++) {
+        sdlog_pool_status_t status;
+        sdlog_pool_query(i, &status);
+        http_server_send_resp_chunk_f(req,
+            "%s{\"name\":\"%s\",\"blk_sz\":%" PRIu32 ",\"blk_num\":%" PRIu32 ",\"in_use\":%" PRIu32 ","
+            "\"max_use\":%" PRIu32 ",\"fallback\":%" PRIu32 ",\"fail\":%" PRIu32 "}",
+            i ? "," : "", status.name, status.blk_sz, status.blk_num, status.in_use, status.max_use, status.fallback, status.fail);
+    }
+    _http_send_chunk(req, "]}", HTTPD_RESP_USE_STRLEN);
+    _http_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
+// ----------
+// URI: /conv_jobs
+// the job table of SDLOG_CONV task, cancel=ID cancels a queued or running job
+// ----------
+esp_err_t uri_conv_jobs(httpd_req_t *req)
+{
+    static const char *state_str[] = {"free", "queued", "running", "done", "fail", "canceled"}; // SDLOG_CONV_STATE_xxx
+    static const char *prio_str[]  = {"auto", "user"};                                          // SDLOG_CONV_PRIO_xxx
+
+    char buf[32];
+    char val[12];
+    if (httpd_req_get_url_query_str(req, buf, sizeof(buf)) == ESP_OK && httpd_query_key_value(buf, "cancel", val, sizeof(val)) == ESP_OK) {
+        if (sdlog_conv_cancel(strtoul(val, NULL, 10)) != ESP_OK) {
+            _http_send_err(req, HTTPD_400_BAD_REQUEST, "No such job queued or running");
+            return ESP_FAIL;
+        }
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    _http_send_chunk(req, "{\"jobs\":[", HTTPD_RESP_USE_STRLEN);
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < sdlog_conv_job_num(); i++) {
+        sdlog_conv_webui_status_t status;
+        sdlog_conv_webui_query(i, &status);
+        if (status.id == 0) {
+            continue;
+        }
+        http_server_send_resp_chunk_f(req,
+            "%s{\"id\":%" PRIu32 ",\"state\":\"%s\",\"prio\":\"%s\",\"path\":\"%s\",\"exporter\":\"%s\","
+            "\"pct\":%" PRIu32 ",\"rec\":%" PRIu32 ",\"rec_per_s\":%" PRIu32 ",\"eta_s\":%" PRIu32 ","
+            "\"preempted\":%" PRIu32 ",\"yield_ms\":%" PRIu32 "}",
+            n++ ? "," : "", status.id, (status.state < 6) ? state_str[status.state] : "?", (status.prio < 2) ? prio_str[status.prio] : "?",
+            status.log_path, status.exporter ? status.exporter : "AUTO", status.pct, status.rec, status.rec_per_s, status.eta_s,
+            status.preempted, status.ms_yield);
+    }
+    _http_send_chunk(req, "]}", HTTPD_RESP_USE_STRLEN);
+    _http_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
 // ----------
 // HTTP server start body
 // ----------
@@ -533,16 +1060,17 @@ void http_server_start(void)
     if (init == 0) {
         init = 1;
 
-        httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-        config.stack_size     = 4096; // enlarge the stack size to avoid buffer overflow
+        const task_cfg_t *p_task = task_cfg(TASK_ID_HTTPD);
+        httpd_config_t config    = HTTPD_DEFAULT_CONFIG();
+        config.stack_size        = p_task->stack; // enlarge the stack size to avoid buffer overflow
+        config.task_priority     = p_task->prio;
+        config.core_id           = p_task->core;
+        config.max_uri_handlers  = 16; // default is 8
         if (httpd_start(&http_server_h, &config) == ESP_OK) {
             httpd_uri_t uri_tbl[] = {
-                {.uri = "/", .method = HTTP_GET, .handler = uri_index, .user_ctx = NULL},
-                {.uri = "/log_browse", .method = HTTP_GET, .handler = uri_browse_log, .user_ctx = NULL},
-                {.uri = "/log_download", .method = HTTP_GET, .handler = uri_log_download, .user_ctx = NULL},
-                {.uri = "/log_remove", .method = HTTP_GET, .handler = uri_log_remove, .user_ctx = NULL},
-                {.uri = "/log_conv", .method = HTTP_GET, .handler = uri_log_conv, .user_ctx = NULL},
-                {.uri = "/can_tx", .method = HTTP_GET, .handler = uri_can_tx, .user_ctx = NULL},
+#define HTTP_URI_REG(_name, _uri, _handler) {.uri = _uri, .method = HTTP_GET, .handler = http_server_dispatch, .user_ctx = (void *)HTTP_URI_##_name},
+#include "http_uri_reg.h"
+#undef HTTP_URI_REG
             };
 
             for (uint32_t i = 0; i < sizeof(uri_tbl) / sizeof(httpd_uri_t); i++) {
@@ -0,0 +1,17 @@
+// HTTP_URI_REG(_name, _uri, _handler)
+// name: used to generate enum HTTP_URI_xxx, the uri_id of the HTTP access records (sdlog_http_access_t)
+// uri: the path registered to httpd (GET)
+// handler: esp_err_t handler(httpd_req_t *req) in http_server.c
+// Append only, the logs on the SD card refer to the entries by index
+HTTP_URI_REG(INDEX, "/", uri_index)
+HTTP_URI_REG(LOG_BROWSE, "/log_browse", uri_browse_log)
+HTTP_URI_REG(LOG_DOWNLOAD, "/log_download", uri_log_download)
+HTTP_URI_REG(LOG_REMOVE, "/log_remove", uri_log_remove)
+HTTP_URI_REG(LOG_CONV, "/log_conv", uri_log_conv)
+HTTP_URI_REG(CAN_TX, "/can_tx", uri_can_tx)
+HTTP_URI_REG(SIGNAL_STATS, "/signal_stats", uri_signal_stats)
+HTTP_URI_REG(BUS_STATS, "/bus_stats", uri_bus_stats)
+HTTP_URI_REG(HTTP_STATS, "/http_stats", uri_http_stats)
+HTTP_URI_REG(SD_BENCH, "/sd_bench", uri_sd_bench)
+HTTP_URI_REG(MEM_STATS, "/mem_stats", uri_mem_stats)
+HTTP_URI_REG(CONV_JOBS, "/conv_jobs", uri_conv_jobs)
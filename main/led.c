@@ -1,6 +1,10 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "driver/gpio.h"
 #include "board.h"
 #include "led.h"
+#include "sdlog_service.h"
+#include "task_cfg.h"
 
 #if defined(LED_POLARITY_INV)
 #define LED_ON (0)
@@ -10,6 +14,31 @@
 #define LED_OFF (0)
 #endif
 
+// LED service, led_task drives the pins every LED_TICK_MS from the activity counters and the states
+// LED0: SD error     fast blink (5Hz)
+//       dropped logs double flash every 0.5s, for 2s after the last drop
+//       recording    on, flickers off with CAN RX
+//       idle         off, flickers on with CAN RX
+// LED1: WiFi down    slow blink (1Hz)
+//       WiFi up      on, flickers off with console logs
+// The pins are only touched by led_task (and the manual control), never by the hot paths
+
+#define LED_TICK_MS (50)
+#define LED_TICK_PER_S (1000 / LED_TICK_MS)
+#define LED_DROP_HOLD (2 * LED_TICK_PER_S)
+
+// ----------
+// data structure definition
+// ----------
+typedef struct led_ctrl_s {
+    uint32_t state;      // LED_STATE_xxx
+    uint32_t manual_bmp; // LEDs under manual control
+    uint32_t level_bmp;  // LEDs on, cached so nobody has to read the pins back
+} led_ctrl_t;
+
+static led_ctrl_t led_ctrl;
+uint32_t led_act_cnt[LED_ACT_NUM];
+
 static uint8_t led_pins[LED_PIN_NUM] = {
 #if defined(LED_PIN0)
     LED_PIN0,
@@ -19,45 +48,134 @@ static uint8_t led_pins[LED_PIN_NUM] = {
 #endif
 };
 
+static void _led_set(uint32_t led_idx, uint32_t on)
+{
+    uint32_t bit = 1 << led_idx;
+    if (!!(led_ctrl.level_bmp & bit) != !!on) {
+        gpio_set_level(led_pins[led_idx], on ? LED_ON : LED_OFF);
+        if (on) {
+            __atomic_fetch_or(&led_ctrl.level_bmp, bit, __ATOMIC_RELAXED);
+        } else {
+            __atomic_fetch_and(&led_ctrl.level_bmp, ~bit, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// ----------
+// LED task
+// ----------
+static void led_task(void *arg)
+{
+    uint32_t tick                  = 0;
+    uint32_t act_last[LED_ACT_NUM] = {0};
+    uint32_t drop_last             = 0;
+    uint32_t drop_hold             = 0;
+
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(LED_TICK_MS));
+        tick++;
+
+        uint32_t act[LED_ACT_NUM];
+        for (uint32_t i = 0; i < LED_ACT_NUM; i++) {
+            uint32_t cnt = __atomic_load_n(&led_act_cnt[i], __ATOMIC_RELAXED);
+            act[i]       = (cnt != act_last[i]);
+            act_last[i]  = cnt;
+        }
+
+        uint32_t recording = 0, drop = 0, open_err = 0;
+        for (uint32_t i = 0; i < SDLOG_SOURCE_NUM; i++) {
+            sdlog_webui_status_t status;
+            sdlog_webui_query(i, &status);
+            recording |= status.is_logging;
+            open_err |= status.open_err | status.sd_fault;
+            drop += status.drop_cnt;
+        }
+        if (drop > drop_last) { // the counter restarts with every log file, only a rise is a drop
+            drop_hold = LED_DROP_HOLD;
+        } else if (drop_hold) {
+            drop_hold--;
+        }
+        drop_last = drop;
+
+        uint32_t state = __atomic_load_n(&led_ctrl.state, __ATOMIC_RELAXED);
+        uint32_t level[2];
+        if ((state & LED_STATE_SD_ERROR) || open_err) {
+            level[0] = (tick / 2) & 1;
+        } else if (drop_hold) {
+            level[0] = (tick % 10 == 0) || (tick % 10 == 2);
+        } else if (recording) {
+            level[0] = !(act[LED_ACT_CAN_RX] && (tick & 1));
+        } else {
+            level[0] = act[LED_ACT_CAN_RX] && (tick & 1);
+        }
+
+        if (state & LED_STATE_WIFI_UP) {
+            level[1] = !(act[LED_ACT_LOG] && (tick & 1));
+        } else {
+            level[1] = (tick / (LED_TICK_PER_S / 2)) & 1;
+        }
+
+        uint32_t manual = __atomic_load_n(&led_ctrl.manual_bmp, __ATOMIC_RELAXED);
+        for (uint32_t i = 0; i < LED_PIN_NUM && i < 2; i++) {
+            if (!(manual & (1 << i))) {
+                _led_set(i, level[i]);
+            }
+        }
+    }
+}
+
 esp_err_t led_init(void)
 {
     for (uint32_t i = 0; i < LED_PIN_NUM; i++) {
         gpio_reset_pin(led_pins[i]);
-        gpio_set_direction(led_pins[i], GPIO_MODE_INPUT_OUTPUT); // use INPUT_OUTPUT to allow read back the status
+        gpio_set_direction(led_pins[i], GPIO_MODE_OUTPUT);
         gpio_set_level(led_pins[i], LED_OFF);
     }
 
+    if (LED_PIN_NUM) {
+        task_create(TASK_ID_LED, led_task, NULL, NULL);
+    }
     return ESP_OK;
 }
 
-void led_op_ext(uint32_t led_idx, uint32_t op_0on_1off_2toggle)
+// ----------
+// Runtime API
+// ----------
+void led_state_set(uint32_t state, uint32_t on)
+{
+    if (on) {
+        __atomic_fetch_or(&led_ctrl.state, state, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_and(&led_ctrl.state, ~state, __ATOMIC_RELAXED);
+    }
+}
+
+void led_op_ext(uint32_t led_idx, uint32_t op_0on_1off_2toggle_3auto)
 {
     if (led_idx < LED_PIN_NUM) {
-        uint32_t led_pin = led_pins[led_idx];
-        if (op_0on_1off_2toggle == 0) {
-            gpio_set_level(led_pin, LED_ON);
-        } else if (op_0on_1off_2toggle == 1) {
-            gpio_set_level(led_pin, LED_OFF);
-        } else if (op_0on_1off_2toggle == 2) {
-            uint32_t gpio_read = gpio_get_level(led_pin);
-            gpio_set_level(led_pin, !gpio_read);
+        uint32_t bit = 1 << led_idx;
+        if (op_0on_1off_2toggle_3auto == 3) {
+            __atomic_fetch_and(&led_ctrl.manual_bmp, ~bit, __ATOMIC_RELAXED);
+            return;
+        }
+
+        __atomic_fetch_or(&led_ctrl.manual_bmp, bit, __ATOMIC_RELAXED);
+        if (op_0on_1off_2toggle_3auto == 0) {
+            _led_set(led_idx, 1);
+        } else if (op_0on_1off_2toggle_3auto == 1) {
+            _led_set(led_idx, 0);
+        } else if (op_0on_1off_2toggle_3auto == 2) {
+            _led_set(led_idx, !(led_ctrl.level_bmp & bit));
         }
     }
 }
 
-void led_op(uint32_t op_0on_1off_2toggle) // legacy API, always addressing the LED0
+void led_op(uint32_t op_0on_1off_2toggle_3auto) // legacy API, always addressing the LED0
 {
-    led_op_ext(0, op_0on_1off_2toggle);
+    led_op_ext(0, op_0on_1off_2toggle_3auto);
 }
 
 uint32_t led_is_on_bmp(void)
 {
-    uint32_t ret = 0;
-    for (uint32_t i = 0; i < LED_PIN_NUM; i++) {
-        if (gpio_get_level(led_pins[i]) == LED_ON) {
-            ret |= (1 << i);
-        }
-    }
-
-    return ret; // return bitmap indicating each LED status
+    return __atomic_load_n(&led_ctrl.level_bmp, __ATOMIC_RELAXED); // return bitmap indicating each LED status
 }
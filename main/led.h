@@ -1,6 +1,7 @@
 #ifndef __LED_H__
 #define __LED_H__
 
+#include <stdint.h>
 #include "board.h"
 
 #if !defined(LED_PIN0) && !defined(LED_PIN1)
@@ -13,8 +14,35 @@
 #error "Wrong LED PIN configuration"
 #endif
 
-void led_op_ext(uint32_t led_idx, uint32_t op_0on_1off_2toggle);
-void led_op(uint32_t op_0on_1off_2toggle);
+// ----------
+// Activity counters, the hot paths only bump a counter, led_task turns them into blinks
+// ----------
+enum led_act_e {
+    LED_ACT_CAN_RX = 0, // LED0
+    LED_ACT_LOG,        // LED1, console log lines
+    LED_ACT_NUM,
+};
+
+extern uint32_t led_act_cnt[LED_ACT_NUM];
+
+static inline void led_activity(uint32_t act, uint32_t num)
+{
+    __atomic_fetch_add(&led_act_cnt[act], num, __ATOMIC_RELAXED);
+}
+
+// ----------
+// States, set by the owner of the state, shown as blink patterns
+// ----------
+#define LED_STATE_WIFI_UP (1 << 0)  // station got the IP
+#define LED_STATE_SD_ERROR (1 << 1) // SD card mount failed, a failed log file open is polled from sdlog
+
+void led_state_set(uint32_t state, uint32_t on);
+
+// ----------
+// Manual control (WEB-UI), the LED leaves the patterns until op 3
+// ----------
+void led_op_ext(uint32_t led_idx, uint32_t op_0on_1off_2toggle_3auto);
+void led_op(uint32_t op_0on_1off_2toggle_3auto);
 uint32_t led_is_on_bmp(void);
 
 #endif // __LED_H__
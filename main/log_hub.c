@@ -1,10 +1,17 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <stdarg.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/ringbuf.h"
 #include "esp_err.h"
 #include "esp_log.h"
 
 #include "led.h"
 #include "sdlog_service.h"
+#include "task_cfg.h"
 
 static const char *TAG = "LOG_HUB";
 
@@ -12,38 +19,181 @@ static const char *TAG = "LOG_HUB";
 // 2. esp_log_printf() calls esp_log_vprintf()
 // 3. The default handling function is calling vprintf()
 //    - vprintf_like_t esp_log_vprint_func = &vprintf;
-// 4. Add this log_hub to have the same feature as old way, and we can hook our own implementation later
+// 4. log_hub replaces it, the message is formatted once and fed to two sinks
+//    - SD: the console source, a message longer than LOG_HUB_REC_MAX is split into continuation records
+//      (SDLOG_FMT_TEXT__CONT), the exporters join them back into one line
+//    - UART: a ring buffer drained by log_uart_task, the message is dropped if it's full, the logging task never
+//      waits for the UART
+// The formatting happens in a per-task scratch (thread local storage pointer), allocated on the first log of the task
+// With [sdlog] deferred_fmt = on and the UART sink off, a message is only packed (SDLOG_FMT_TEXT__BIN), not formatted
+//
+// syscfg.ini
+// [log_hub]
+// uart = on          ; on (default), off, or auto: only while the console isn't logged to SD
 
-#define SDLOG_CONSOLE_BUF_SZ (128)
+#define LOG_HUB_TLS_IDX (1) // index 0 is used by pthread, CONFIG_FREERTOS_THREAD_LOCAL_STORAGE_POINTERS=2
+#define LOG_HUB_SCRATCH_SZ (256)
+#define LOG_HUB_LINE_MAX (1024) // the scratch grows up to this for a long message, the rest is cut
+#define LOG_HUB_REC_MAX (128)   // payload of one console record
+#define LOG_HUB_UART_BUF_SZ (4096)
 
+enum {
+    LOG_HUB_UART_OFF  = 0,
+    LOG_HUB_UART_ON   = 1,
+    LOG_HUB_UART_AUTO = 2,
+};
+
+// ----------
+// data structure definition
+// ----------
+typedef struct log_hub_scratch_s {
+    uint32_t size;
+    char buf[];
+} log_hub_scratch_t;
+
+typedef struct log_hub_ctrl_s {
+    uint32_t uart_mode;
+    RingbufHandle_t uart_rb;
+    uint32_t uart_drop; // messages dropped since log_uart_task reported the last time
+} log_hub_ctrl_t;
+
+static log_hub_ctrl_t log_hub_ctrl = {
+    .uart_mode = LOG_HUB_UART_ON,
+};
+
+// ----------
+// SYSCFG
+// ----------
+uint32_t log_hub_syscfg(const char *section, const char *key, const char *value)
+{
+    if (strcmp(key, "uart") == 0) {
+        if (strcmp(value, "off") == 0) {
+            log_hub_ctrl.uart_mode = LOG_HUB_UART_OFF;
+        } else if (strcmp(value, "auto") == 0) {
+            log_hub_ctrl.uart_mode = LOG_HUB_UART_AUTO;
+        } else {
+            log_hub_ctrl.uart_mode = LOG_HUB_UART_ON;
+        }
+    }
+    return 1;
+}
+
+// ----------
+// Per-task scratch
+// ----------
+static void _log_hub_scratch_free(int idx, void *p_scratch)
+{
+    free(p_scratch);
+}
+
+static log_hub_scratch_t *_log_hub_scratch(uint32_t size)
+{
+    log_hub_scratch_t *p_s = pvTaskGetThreadLocalStoragePointer(NULL, LOG_HUB_TLS_IDX);
+    if (p_s && p_s->size >= size) {
+        return p_s;
+    }
+
+    log_hub_scratch_t *p_new = realloc(p_s, sizeof(log_hub_scratch_t) + size);
+    if (p_new == NULL) {
+        return p_s; // keep the old one, the message is cut
+    }
+    p_new->size = size;
+    vTaskSetThreadLocalStoragePointerAndDelCallback(NULL, LOG_HUB_TLS_IDX, p_new, _log_hub_scratch_free);
+    return p_new;
+}
+
+// ----------
+// Sinks
+// ----------
+static void _log_hub_sd(const char *p_msg, uint32_t len)
+{
+    uint32_t type = SDLOG_FMT_TEXT__STRING;
+    do {
+        uint32_t n = (len > LOG_HUB_REC_MAX) ? LOG_HUB_REC_MAX : len;
+        sdlog_write(SDLOG_SOURCE_CONSOLE, type, n, p_msg);
+        p_msg += n;
+        len -= n;
+        type = SDLOG_FMT_TEXT__CONT;
+    } while (len);
+}
+
+static void _log_hub_uart(const char *p_msg, uint32_t len)
+{
+    if (len && xRingbufferSend(log_hub_ctrl.uart_rb, p_msg, len, 0) != pdTRUE) {
+        __atomic_fetch_add(&log_hub_ctrl.uart_drop, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static void log_uart_task(void *arg)
+{
+    while (1) {
+        size_t len;
+        char *p_msg = xRingbufferReceive(log_hub_ctrl.uart_rb, &len, portMAX_DELAY);
+        if (p_msg) {
+            fwrite(p_msg, 1, len, stdout);
+            vRingbufferReturnItem(log_hub_ctrl.uart_rb, p_msg);
+        }
+
+        uint32_t drop = __atomic_exchange_n(&log_hub_ctrl.uart_drop, 0, __ATOMIC_RELAXED);
+        if (drop) {
+            printf("[log_hub] %" PRIu32 " messages dropped, UART too slow\n", drop);
+        }
+        fflush(stdout);
+    }
+}
+
+// ----------
+// vprintf hook
+// ----------
 static int log_hub_vprintf_handler(const char *fmt, va_list args)
 {
+    uint32_t to_sd   = sdlog_source_ready(SDLOG_SOURCE_CONSOLE);
+    uint32_t to_uart = (log_hub_ctrl.uart_mode == LOG_HUB_UART_ON || (log_hub_ctrl.uart_mode == LOG_HUB_UART_AUTO && !to_sd));
+    if (to_sd && !to_uart && sdlog_write_fmt(SDLOG_SOURCE_CONSOLE, fmt, args) != ESP_ERR_NOT_SUPPORTED) {
+        led_activity(LED_ACT_LOG, 1);
+        return 0; // the length is unknown until the exporter formats it, esp_log ignores it
+    }
+
+    log_hub_scratch_t *p_s = _log_hub_scratch(LOG_HUB_SCRATCH_SZ);
+    if (p_s == NULL) {
+        return vprintf(fmt, args); // no memory for the scratch, UART only, the old way
+    }
+
     va_list args_copy;
     va_copy(args_copy, args);
+    int len = vsnprintf(p_s->buf, p_s->size, fmt, args);
+    if (len >= (int)p_s->size) { // longer than the scratch, the only case formatted twice
+        p_s = _log_hub_scratch((len < LOG_HUB_LINE_MAX) ? len + 1 : LOG_HUB_LINE_MAX);
+        vsnprintf(p_s->buf, p_s->size, fmt, args_copy);
+    }
+    va_end(args_copy);
+    if (len <= 0) {
+        return len;
+    }
+    uint32_t n = (len < (int)p_s->size) ? len : p_s->size - 1;
 
-    // Call the original vprintf() which directs to standard UART
-    int len = vprintf(fmt, args);
-
-    // Check whether SDLOG init completed, if so, then direct info to sdlog_service
-    if (sdlog_source_ready(SDLOG_SOURCE_CONSOLE)) {
-        char buf[SDLOG_CONSOLE_BUF_SZ];
-        int32_t ret = vsnprintf(buf, sizeof(buf), fmt, args_copy);
-        if (ret > 0) {
-            uint32_t write_len = (ret < sizeof(buf)) ? ret : sizeof(buf) - 1;
-            sdlog_write(SDLOG_SOURCE_CONSOLE, SDLOG_FMT_TEXT__STRING, write_len, buf);
-        }
+    if (to_sd) {
+        _log_hub_sd(p_s->buf, n);
+    }
+    if (to_uart) {
+        _log_hub_uart(p_s->buf, n);
     }
 
-    led_op_ext(/*led_idx*/ 1, /*led_op=2, toggle*/ 2);
+    led_activity(LED_ACT_LOG, 1); // led_task blinks LED1
 
     return len;
 }
 
 esp_err_t log_hub_init(void)
 {
+    log_hub_ctrl.uart_rb = xRingbufferCreate(LOG_HUB_UART_BUF_SZ, RINGBUF_TYPE_NOSPLIT);
+    if (log_hub_ctrl.uart_rb == NULL || task_create(TASK_ID_LOG_UART, log_uart_task, NULL, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "UART sink init failed, keep the default vprintf");
+        return ESP_OK;
+    }
     esp_log_set_vprintf(log_hub_vprintf_handler);
 
-    ESP_LOGI(TAG, "LOG HUB init done.");
+    ESP_LOGI(TAG, "LOG HUB init done, uart=%" PRIu32, log_hub_ctrl.uart_mode);
 
     return ESP_OK;
 }
@@ -3,31 +3,64 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_system.h"
 #include "nvs_flash.h"
 #include "esp_timer.h"
 
 #include "board.h"
+#include "task_cfg.h"
+
+static const char *TAG = "MAIN";
 
 #define MAIN_INIT_HOOK_FILE "main_hook.h"
 
 #define APP_MAIN_INIT_FUNC(fp) extern esp_err_t(fp)(void);
+#define APP_MAIN_INIT_BG_FUNC(fp) extern esp_err_t(fp)(void);
+#include MAIN_INIT_HOOK_FILE
+#undef APP_MAIN_INIT_BG_FUNC
+#undef APP_MAIN_INIT_FUNC
+
+typedef esp_err_t (*fp_init_t)(void);
+
+static void init_bg_task(void *arg)
+{
+    fp_init_t fp_init[] = {
+#define APP_MAIN_INIT_FUNC(fp)
+#define APP_MAIN_INIT_BG_FUNC(fp) fp,
 #include MAIN_INIT_HOOK_FILE
+#undef APP_MAIN_INIT_BG_FUNC
 #undef APP_MAIN_INIT_FUNC
+    };
+
+    for (uint32_t i = 0; i < sizeof(fp_init) / sizeof(fp_init_t); i++) {
+        ESP_ERROR_CHECK((fp_init[i])());
+    }
+    ESP_LOGI(TAG, "background init done, %" PRId64 " ms after boot", esp_timer_get_time() / 1000);
+    vTaskDelete(NULL);
+}
 
 void app_main(void)
 {
-    // Reserve time for USB to identify the device
-    // If the program crasheds before this delay, the device may not be recognized
-    vTaskDelay(pdMS_TO_TICKS(2000));
+    // Reserve time for USB to identify the device, if the previous run crashed
+    // A program crashing early reboots in a loop, the device may not be recognized and can't be flashed
+    // A normal power-on doesn't wait, the CAN frames right after it are logged
+    esp_reset_reason_t reason = esp_reset_reason();
+    if (reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT || reason == ESP_RST_TASK_WDT || reason == ESP_RST_WDT) {
+        vTaskDelay(pdMS_TO_TICKS(2000));
+    }
 
-    typedef esp_err_t (*fp_init_t)(void);
     fp_init_t fp_init[] = {
 #define APP_MAIN_INIT_FUNC(fp) fp,
+#define APP_MAIN_INIT_BG_FUNC(fp)
 #include MAIN_INIT_HOOK_FILE
+#undef APP_MAIN_INIT_BG_FUNC
 #undef APP_MAIN_INIT_FUNC
     };
 
     for (uint32_t i = 0; i < sizeof(fp_init) / sizeof(fp_init_t); i++) {
         ESP_ERROR_CHECK((fp_init[i])());
     }
+    ESP_LOGI(TAG, "CAN capture armed %" PRId64 " ms after boot", esp_timer_get_time() / 1000);
+
+    task_create(TASK_ID_INIT_BG, init_bg_task, NULL, NULL);
 }
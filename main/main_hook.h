@@ -1,8 +1,18 @@
+// APP_MAIN_INIT_FUNC: run by app_main in this order, CAN capture is armed at the end of them
+// APP_MAIN_INIT_BG_FUNC: slow steps, run in this order by init_bg after the APP_MAIN_INIT_FUNC ones
 APP_MAIN_INIT_FUNC(nvs_init)
+APP_MAIN_INIT_FUNC(sdlog_pool_init) // I/O buffers of sdlog, reserved before the heap is fragmented
 APP_MAIN_INIT_FUNC(led_init)
 APP_MAIN_INIT_FUNC(sd_card_init)
 APP_MAIN_INIT_FUNC(syscfg_init) // this must after sd_card_init
-APP_MAIN_INIT_FUNC(sdlog_service_init)
+APP_MAIN_INIT_FUNC(sd_card_profile_apply) // [sdcard] bus profile of syscfg.ini
+APP_MAIN_INIT_FUNC(can_signal_init) // DBC image on SD card, before twai_service_init
+APP_MAIN_INIT_FUNC(sdlog_service_init) // serial numbers cached in NVS, no folder scan
 APP_MAIN_INIT_FUNC(twai_service_init)
-APP_MAIN_INIT_FUNC(wifi_sta_init)
+APP_MAIN_INIT_FUNC(adc_source_init) // [adc] of syscfg.ini, off without channels
 APP_MAIN_INIT_FUNC(log_hub_init)
+APP_MAIN_INIT_BG_FUNC(wifi_sta_init)
+APP_MAIN_INIT_BG_FUNC(time_sync_init) // SNTP, after esp_netif_init() in wifi_sta_init
+APP_MAIN_INIT_BG_FUNC(group_sync_init) // UDP beacons of the logger group, after wifi_sta_init
+APP_MAIN_INIT_BG_FUNC(sdlog_service_scan) // the log folders of the serial numbers not cached
+APP_MAIN_INIT_BG_FUNC(sdlog_retention_init) // after sdlog_service_scan, the serial numbers are known
@@ -1,12 +1,53 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "esp_vfs_fat.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "sdmmc_cmd.h"
 #include "driver/sdmmc_host.h"
 
 #include "board.h"
+#include "led.h"
+#include "sdcard.h"
 
-static sdmmc_card_t *sdcard = NULL; // keep global reference to the card
-static const char *TAG      = "SDCARD";
+static const char *TAG = "SDCARD";
+
+// syscfg.ini
+// [sdcard]
+// profile = spi26        ; bus profile in sdcard_profile_reg.h, board.h SDCARD_PROFILE by default
+// freq_khz = 26000       ; the fields of the profile, after the profile line
+// width = 4
+// max_transfer_sz = 8192
+// alloc_unit_kb = 32
+//
+// The card is mounted with the board.h profile to read syscfg.ini, sd_card_profile_apply() mounts it again with the
+// [sdcard] one right after. A profile failing to mount falls back to the board.h one
+// /sd_bench (http_server.c) measures the profiles of the board with sd_card_bench() and recommends the fastest
+// stable one
+
+#define SD_CARD_BENCH_FILE (MNT_SDCARD "/sdbench.tmp")
+
+static const sd_card_profile_t sd_card_profile_tbl[] = {
+#define SDCARD_PROFILE_REG(_name, _width, _freq_khz, _max_transfer_sz, _alloc_unit_sz) \
+    {.name = _name, .width = _width, .freq_khz = _freq_khz, .max_transfer_sz = _max_transfer_sz, .alloc_unit_sz = _alloc_unit_sz},
+#include "sdcard_profile_reg.h"
+#undef SDCARD_PROFILE_REG
+};
+
+#define SD_CARD_PROFILE_NUM (sizeof(sd_card_profile_tbl) / sizeof(sd_card_profile_t))
+
+typedef struct sd_card_ctrl_s {
+    sdmmc_card_t *card;        // keep global reference to the card, NULL if not mounted
+    sd_card_profile_t profile; // of the last mount
+    sd_card_profile_t cfg;     // board.h SDCARD_PROFILE, then [sdcard]
+    uint32_t busy;             // a remount or the benchmark is running
+} sd_card_ctrl_t;
+
+static sd_card_ctrl_t sd_card_ctrl;
 
 void sd_card_test(void)
 {
@@ -22,30 +63,105 @@ void sd_card_test(void)
     }
 }
 
-esp_err_t sd_card_init(void)
+// ----------
+// Bus profiles
+// ----------
+static uint32_t _sd_card_profile_find(const char *name)
+{
+    for (uint32_t i = 0; i < SD_CARD_PROFILE_NUM; i++) {
+        if (strcmp(sd_card_profile_tbl[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return SD_CARD_PROFILE_NUM;
+}
+
+static const sd_card_profile_t *_sd_card_profile_board(void)
+{
+    uint32_t idx = _sd_card_profile_find(SDCARD_PROFILE);
+    return &sd_card_profile_tbl[(idx < SD_CARD_PROFILE_NUM) ? idx : 0];
+}
+
+static uint32_t _sd_card_profile_same(const sd_card_profile_t *p_a, const sd_card_profile_t *p_b)
+{
+    return p_a->width == p_b->width && p_a->freq_khz == p_b->freq_khz && p_a->max_transfer_sz == p_b->max_transfer_sz &&
+           p_a->alloc_unit_sz == p_b->alloc_unit_sz;
+}
+
+uint32_t sd_card_profile_num(void)
+{
+    return SD_CARD_PROFILE_NUM;
+}
+
+const sd_card_profile_t *sd_card_profile(uint32_t idx)
+{
+    return (idx < SD_CARD_PROFILE_NUM) ? &sd_card_profile_tbl[idx] : NULL;
+}
+
+const sd_card_profile_t *sd_card_profile_active(void)
+{
+    return &sd_card_ctrl.profile;
+}
+
+uint32_t sd_card_syscfg(const char *section, const char *key, const char *value)
+{
+    sd_card_profile_t *p_cfg = &sd_card_ctrl.cfg;
+    uint32_t num             = strtoul(value, NULL, 10);
+    if (strcmp(key, "profile") == 0) {
+        uint32_t idx = _sd_card_profile_find(value);
+        if (idx < SD_CARD_PROFILE_NUM) {
+            *p_cfg = sd_card_profile_tbl[idx];
+        } else {
+            ESP_LOGE(TAG, "unknown profile %s", value);
+        }
+        return 1;
+    }
+
+    if (strcmp(key, "freq_khz") == 0) {
+        p_cfg->freq_khz = num;
+    } else if (strcmp(key, "width") == 0) {
+        p_cfg->width = (num == 4) ? 4 : 1;
+    } else if (strcmp(key, "max_transfer_sz") == 0) {
+        p_cfg->max_transfer_sz = num;
+    } else if (strcmp(key, "alloc_unit_kb") == 0) {
+        p_cfg->alloc_unit_sz = num * 1024;
+    } else {
+        return 1;
+    }
+    p_cfg->name = "custom";
+    return 1;
+}
+
+// ----------
+// Mount
+// ----------
+static esp_err_t _sd_card_mount(const sd_card_profile_t *p_profile)
 {
     esp_vfs_fat_sdmmc_mount_config_t mount_config = {
         .format_if_mount_failed = false, // no auto format
         .max_files              = 5,
-        .allocation_unit_size   = 16 * 1024};
+        .allocation_unit_size   = p_profile->alloc_unit_sz};
 
+    sd_card_ctrl.card    = NULL;
+    sd_card_ctrl.profile = *p_profile;
 #if defined(SDCARD_IN_SDMMC)
     sdmmc_host_t host               = SDMMC_HOST_DEFAULT();
     sdmmc_slot_config_t slot_config = SDMMC_SLOT_CONFIG_DEFAULT();
-    slot_config.width               = 1; // SDMMC 1-bit mode, because pins were occupied by other functions
+    host.max_freq_khz               = p_profile->freq_khz;
+    slot_config.width               = p_profile->width; // 1-bit leaves DAT1..DAT3 pins to other functions
 
-    esp_err_t ret = esp_vfs_fat_sdmmc_mount(MNT_SDCARD, &host, &slot_config, &mount_config, &sdcard);
+    esp_err_t ret = esp_vfs_fat_sdmmc_mount(MNT_SDCARD, &host, &slot_config, &mount_config, &sd_card_ctrl.card);
 
 #if defined(TARGET_BOARD_ESP32_CAM)
     // In SD card driver init function, it initializes the GPIO4 as SDMMC and pull-up no matter used or not
-    // We add code here to reset it back to normal GPIO output mode (and set low)
-    gpio_reset_pin(GPIO_NUM_4);
-    gpio_set_direction(GPIO_NUM_4, GPIO_MODE_OUTPUT);
-    gpio_set_level(GPIO_NUM_4, 0);
+    // We add code here to reset it back to normal GPIO output mode (and set low), unless it's DAT1 of the 4-bit bus
+    if (p_profile->width == 1) {
+        gpio_reset_pin(GPIO_NUM_4);
+        gpio_set_direction(GPIO_NUM_4, GPIO_MODE_OUTPUT);
+        gpio_set_level(GPIO_NUM_4, 0);
+    }
 #endif
 
-    return ret;
-
 #elif defined(SDCARD_IN_SDSPI)
     sdmmc_host_t host        = SDSPI_HOST_DEFAULT();
     spi_bus_config_t bus_cfg = {
@@ -54,18 +170,206 @@ esp_err_t sd_card_init(void)
         .sclk_io_num     = SDCARD_SPI_CLK_PIN,
         .quadwp_io_num   = -1,
         .quadhd_io_num   = -1,
-        .max_transfer_sz = 4096,
+        .max_transfer_sz = p_profile->max_transfer_sz,
     };
+    host.max_freq_khz = p_profile->freq_khz;
+
+    // the bus lives with the mount, its DMA transfer size is part of the profile
     esp_err_t ret = spi_bus_initialize(host.slot, &bus_cfg, SPI_DMA_CH_AUTO);
-    if (ret != ESP_OK)
-        return ret;
+    if (ret == ESP_OK) {
+        sdspi_device_config_t slot_config = SDSPI_DEVICE_CONFIG_DEFAULT();
+        slot_config.gpio_cs               = SDCARD_SPI_CS_PIN;
+        slot_config.host_id               = host.slot;
+        ret                               = esp_vfs_fat_sdspi_mount(MNT_SDCARD, &host, &slot_config, &mount_config, &sd_card_ctrl.card);
+        if (ret != ESP_OK) {
+            spi_bus_free(host.slot);
+        }
+    }
+#endif
+
+    if (ret != ESP_OK) {
+        sd_card_ctrl.card = NULL;
+    }
+    led_state_set(LED_STATE_SD_ERROR, ret != ESP_OK);
+    return ret;
+}
 
-    sdspi_device_config_t slot_config = SDSPI_DEVICE_CONFIG_DEFAULT();
-    slot_config.gpio_cs               = SDCARD_SPI_CS_PIN;
-    slot_config.host_id               = host.slot;
-    return esp_vfs_fat_sdspi_mount(MNT_SDCARD, &host, &slot_config, &mount_config, &sdcard);
+static void _sd_card_unmount(void)
+{
+    if (sd_card_ctrl.card) {
+        esp_vfs_fat_sdcard_unmount(MNT_SDCARD, sd_card_ctrl.card);
+        sd_card_ctrl.card = NULL;
+#if defined(SDCARD_IN_SDSPI)
+        sdmmc_host_t host = SDSPI_HOST_DEFAULT();
+        spi_bus_free(host.slot);
 #endif
+    }
+}
+
+// A missing card doesn't stop the boot, sdlog keeps the records in RAM and retries sd_card_remount()
+esp_err_t sd_card_init(void)
+{
+    sd_card_ctrl.cfg = *_sd_card_profile_board();
+    if (_sd_card_mount(&sd_card_ctrl.cfg) != ESP_OK) {
+        ESP_LOGE(TAG, "SD card mount failed, running without the card");
+    }
+    return ESP_OK;
+}
+
+esp_err_t sd_card_profile_apply(void)
+{
+    sd_card_profile_t *p_cfg = &sd_card_ctrl.cfg;
+    if (sd_card_ctrl.card == NULL || _sd_card_profile_same(p_cfg, &sd_card_ctrl.profile)) {
+        return ESP_OK;
+    }
+
+    ESP_LOGI(TAG, "profile %s: %" PRIu32 "-bit, %" PRIu32 " kHz, transfer %" PRIu32 ", cluster %" PRIu32, p_cfg->name,
+        p_cfg->width, p_cfg->freq_khz, p_cfg->max_transfer_sz, p_cfg->alloc_unit_sz);
+    _sd_card_unmount();
+    if (_sd_card_mount(p_cfg) != ESP_OK) {
+        ESP_LOGE(TAG, "profile %s failed, back to %s", p_cfg->name, SDCARD_PROFILE);
+        *p_cfg = *_sd_card_profile_board();
+        _sd_card_mount(p_cfg);
+    }
+    return ESP_OK;
+}
+
+// ----------
+// Fault handling, called by sdlog_task
+// ----------
+uint32_t sd_card_ready(void)
+{
+    return sd_card_ctrl.card != NULL;
+}
+
+uint32_t sd_card_busy(void)
+{
+    return __atomic_load_n(&sd_card_ctrl.busy, __ATOMIC_ACQUIRE);
+}
+
+void sd_card_fault(void)
+{
+    led_state_set(LED_STATE_SD_ERROR, 1);
+}
+
+// The card was removed or failed, the files still opened by other tasks (conversion, download) fail with it
+esp_err_t sd_card_remount(void)
+{
+    uint32_t idle = 0;
+    if (!__atomic_compare_exchange_n(&sd_card_ctrl.busy, &idle, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return ESP_ERR_INVALID_STATE; // the benchmark is running, it mounts the card again when done
+    }
+
+    _sd_card_unmount();
+    esp_err_t ret = _sd_card_mount(&sd_card_ctrl.cfg);
+    ESP_LOGI(TAG, "remount: %d", ret);
+
+    __atomic_store_n(&sd_card_ctrl.busy, 0, __ATOMIC_RELEASE);
+    return ret;
+}
+
+// ----------
+// Card benchmark
+// ----------
+static int _sd_card_us_cmp(const void *p_a, const void *p_b)
+{
+    uint32_t a = *(const uint32_t *)p_a, b = *(const uint32_t *)p_b;
+    return (a > b) - (a < b);
+}
+
+static uint32_t _sd_card_kbps(uint32_t blk_num, int64_t us)
+{
+    return (us > 0) ? (uint64_t)blk_num * SD_CARD_BENCH_BLK * 1000000 / 1024 / us : 0;
+}
+
+// sequential writes of the mounted card, then the file is read back and compared
+// The pattern changes with every run, the card can't return the data of the previous profile
+static void _sd_card_bench_one(uint32_t blk_num, uint32_t *p_blk, uint32_t *p_us, sd_card_bench_t *p_res)
+{
+    uint32_t word_num = SD_CARD_BENCH_BLK / sizeof(uint32_t);
+    uint32_t seed     = (uint32_t)esp_timer_get_time();
+    p_res->freq_khz   = sd_card_ctrl.card->real_freq_khz;
+
+    int fd = open(SD_CARD_BENCH_FILE, O_WRONLY | O_CREAT | O_TRUNC);
+    if (fd < 0) {
+        return;
+    }
+    uint32_t ok    = 1;
+    int64_t us_beg = esp_timer_get_time();
+    for (uint32_t i = 0; i < blk_num && ok; i++) {
+        for (uint32_t k = 0; k < word_num; k++) {
+            p_blk[k] = seed ^ (i * word_num + k);
+        }
+        int64_t us = esp_timer_get_time();
+        ok         = (write(fd, p_blk, SD_CARD_BENCH_BLK) == SD_CARD_BENCH_BLK);
+        p_us[i]    = esp_timer_get_time() - us;
+    }
+    ok &= (fsync(fd) == 0);
+    close(fd);
+    int64_t us_write = esp_timer_get_time() - us_beg;
+
+    if (ok && (fd = open(SD_CARD_BENCH_FILE, O_RDONLY)) >= 0) {
+        us_beg = esp_timer_get_time();
+        for (uint32_t i = 0; i < blk_num && ok; i++) {
+            ok = (read(fd, p_blk, SD_CARD_BENCH_BLK) == SD_CARD_BENCH_BLK);
+            for (uint32_t k = 0; k < word_num && ok; k++) {
+                ok = (p_blk[k] == (seed ^ (i * word_num + k)));
+            }
+        }
+        close(fd);
+        if (ok) {
+            qsort(p_us, blk_num, sizeof(uint32_t), _sd_card_us_cmp);
+            p_res->stable     = 1;
+            p_res->kbps_write = _sd_card_kbps(blk_num, us_write);
+            p_res->kbps_read  = _sd_card_kbps(blk_num, esp_timer_get_time() - us_beg);
+            p_res->us_p99     = p_us[blk_num * 99 / 100];
+            p_res->us_max     = p_us[blk_num - 1];
+        }
+    }
+    unlink(SD_CARD_BENCH_FILE);
+}
+
+esp_err_t sd_card_bench(uint32_t bytes, sd_card_bench_t *p_res, uint32_t *p_best)
+{
+    uint32_t blk_num = (bytes < SD_CARD_BENCH_BLK) ? 1 : bytes / SD_CARD_BENCH_BLK;
+    uint32_t idle    = 0;
+    if (!__atomic_compare_exchange_n(&sd_card_ctrl.busy, &idle, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint32_t *p_blk = malloc(SD_CARD_BENCH_BLK);
+    uint32_t *p_us  = malloc(blk_num * sizeof(uint32_t));
+    if (p_blk == NULL || p_us == NULL) {
+        free(p_blk);
+        free(p_us);
+        __atomic_store_n(&sd_card_ctrl.busy, 0, __ATOMIC_RELEASE);
+        return ESP_ERR_NO_MEM;
+    }
+
+    *p_best = SD_CARD_PROFILE_NUM;
+    for (uint32_t i = 0; i < SD_CARD_PROFILE_NUM; i++) {
+        sd_card_bench_t *p_r = &p_res[i];
+        memset(p_r, 0, sizeof(sd_card_bench_t));
+
+        _sd_card_unmount();
+        p_r->mount = (_sd_card_mount(&sd_card_profile_tbl[i]) == ESP_OK);
+        if (p_r->mount) {
+            _sd_card_bench_one(blk_num, p_blk, p_us, p_r);
+        }
+        ESP_LOGI(TAG, "bench %s: mount=%" PRIu32 " stable=%" PRIu32 " %" PRIu32 " kHz, write %" PRIu32 " KB/s, read %" PRIu32 " KB/s, p99 %" PRIu32 " us",
+            sd_card_profile_tbl[i].name, p_r->mount, p_r->stable, p_r->freq_khz, p_r->kbps_write, p_r->kbps_read, p_r->us_p99);
+        if (p_r->stable && (*p_best == SD_CARD_PROFILE_NUM || p_r->kbps_write > p_res[*p_best].kbps_write)) {
+            *p_best = i;
+        }
+    }
+
+    _sd_card_unmount();
+    if (_sd_card_mount(&sd_card_ctrl.cfg) != ESP_OK) {
+        ESP_LOGE(TAG, "profile %s failed after the benchmark", sd_card_ctrl.cfg.name);
+    }
 
-    // once the SD card init, test whether we can write it
-    sd_card_test();
+    free(p_blk);
+    free(p_us);
+    __atomic_store_n(&sd_card_ctrl.busy, 0, __ATOMIC_RELEASE);
+    return ESP_OK;
 }
@@ -0,0 +1,49 @@
+#ifndef __SDCARD_H__
+#define __SDCARD_H__
+
+#include <stdint.h>
+#include "esp_err.h"
+
+esp_err_t sd_card_init(void);   // ESP_OK without a card too, the boot goes on
+uint32_t sd_card_ready(void);    // 1 if the card is mounted
+void sd_card_fault(void);        // a user of the card got an I/O error, the LED shows it until the card is back
+esp_err_t sd_card_remount(void); // unmount and mount again, ESP_OK if the card is back
+uint32_t sd_card_busy(void);     // 1 while a remount or the benchmark runs, the other users keep off the card
+
+// ----------
+// Bus profiles (sdcard_profile_reg.h)
+// ----------
+typedef struct sd_card_profile_s {
+    const char *name;
+    uint32_t width;           // SDMMC data lines, 1 on SDSPI
+    uint32_t freq_khz;        // bus clock
+    uint32_t max_transfer_sz; // SDSPI DMA transfer, ignored by SDMMC
+    uint32_t alloc_unit_sz;   // FATFS cluster size of a format
+} sd_card_profile_t;
+
+uint32_t sd_card_profile_num(void);
+const sd_card_profile_t *sd_card_profile(uint32_t idx); // NULL if out of range
+const sd_card_profile_t *sd_card_profile_active(void);
+esp_err_t sd_card_profile_apply(void); // init hook after syscfg_init(), remounts with the [sdcard] profile
+
+// ----------
+// Card benchmark
+// ----------
+typedef struct sd_card_bench_s {
+    uint32_t mount;      // the card mounted with the profile
+    uint32_t stable;     // no write error, the data read back matches
+    uint32_t freq_khz;   // clock negotiated with the card
+    uint32_t kbps_write; // KB/s, sequential SD_CARD_BENCH_BLK writes + fsync()
+    uint32_t kbps_read;
+    uint32_t us_p99; // latency of one block write
+    uint32_t us_max;
+} sd_card_bench_t;
+
+#define SD_CARD_BENCH_BLK (4096) // the write size of sdlog_task (its FILE buffer)
+
+// every profile is measured with a file of bytes, then the active profile is mounted again
+// p_res has sd_card_profile_num() entries, *p_best is the fastest stable one (sd_card_profile_num() if none)
+// ESP_ERR_INVALID_STATE if a remount is running
+esp_err_t sd_card_bench(uint32_t bytes, sd_card_bench_t *p_res, uint32_t *p_best);
+
+#endif // __SDCARD_H__
@@ -0,0 +1,17 @@
+// SDCARD_PROFILE_REG(_name, _width, _freq_khz, _max_transfer_sz, _alloc_unit_sz)
+// name: [sdcard] profile in syscfg.ini, board.h SDCARD_PROFILE picks the one of the boot
+// width: SDMMC data lines (1 or 4), 1 on SDSPI
+// freq_khz: bus clock, the card may negotiate lower (a card without high speed mode stays at 20MHz on SDMMC)
+// max_transfer_sz: SDSPI DMA transfer of the SPI bus, ignored by SDMMC
+// alloc_unit_sz: FATFS cluster size, only used when the card is formatted by the device
+// Slowest first, /sd_bench measures every profile of the board in this order
+#if defined(SDCARD_IN_SDSPI)
+SDCARD_PROFILE_REG("spi20", 1, 20000, 4096, 16 * 1024)
+SDCARD_PROFILE_REG("spi26", 1, 26000, 8192, 32 * 1024)
+SDCARD_PROFILE_REG("spi40", 1, 40000, 16384, 32 * 1024) // the board must route the bus on the IO MUX pins
+#elif defined(SDCARD_IN_SDMMC)
+SDCARD_PROFILE_REG("sdmmc1_20", 1, 20000, 0, 16 * 1024)
+SDCARD_PROFILE_REG("sdmmc1_40", 1, 40000, 0, 32 * 1024)
+SDCARD_PROFILE_REG("sdmmc4_20", 4, 20000, 0, 32 * 1024)
+SDCARD_PROFILE_REG("sdmmc4_40", 4, 40000, 0, 32 * 1024)
+#endif
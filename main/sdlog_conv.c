@@ -1,4 +1,6 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <inttypes.h>
@@ -17,25 +19,94 @@
 
 #include "board.h"
 #include "sdlog_header.h"
+#include "sdlog_service.h"
 #include "sdlog_conv.h"
+#include "sdlog_fmt.h"
+#include "sdlog_pool.h"
+#include "sdlog_retention.h"
+#include "task_cfg.h"
 
 static const char *TAG = "SDLOG_CONV";
 
 #define SDLOG_CONV_QUEUE_DEPTH (8)
-#define SDLOG_CONV_FILE_BUF_SZ (8192)
+#define SDLOG_CONV_JOB_MAX (8)        // queued, running and finished jobs, the oldest finished one is reused
+#define SDLOG_CONV_POLL_REC (256)     // records between two polls of a job: progress, messages, preemption, backlog
+#define SDLOG_CONV_YIELD_BYTES (8192) // sdlog_backlog() above it, the job sleeps SDLOG_CONV_YIELD_MS at a time
+#define SDLOG_CONV_YIELD_MS (20)
+#define SDLOG_CONV_SYNC_MAX (SDLOG_CONV_SYNC_SZ / sizeof(sdlog_time_sync_t)) // time sync points kept for the interpolation
+#define SDLOG_CONV_TEXT_BUF_SZ (SDLOG_CONV_REC_SZ / 2)                          // the text made by a format callback, second half of the SDLOG_POOL_REC buffer
+#define SDLOG_CONV_PAYLOAD_SZ (SDLOG_CONV_REC_SZ / 2 - sizeof(sdlog_data_t)) // the payload of a record, first half with the header of the next one
 
 QueueHandle_t sdlog_conv_task_msgq;
 
 #define SDLOG_SOURCE(x) (&sdlog_ctrl.source[x])
 
 // ----------
-// Interface between SDLOG_TASK/ SDLOG_CONV_TASK
+// Interface between SDLOG_TASK/ HTTPD/ SDLOG_CONV_TASK
 // ----------
+enum sdlog_conv_op_e {
+    SDLOG_CONV_OP_SUBMIT = 0,
+    SDLOG_CONV_OP_CANCEL,
+};
+
 typedef struct sdlog_conv_msg_s {
+    uint32_t op; // SDLOG_CONV_OP_xxx
+    uint32_t id;
+    uint32_t prio;
+    uint32_t exporter; // SDLOG_EXPORTER_xxx, or SDLOG_EXPORTER_AUTO
     char log_path[64];
-    // in the future, we can extend this interface to allow users specifying the desired converter
 } sdlog_conv_task_msg_t;
 
+// ----------
+// Job table, owned by SDLOG_CONV task, the other tasks only read it
+// ----------
+// A slot is rewritten for a new job (path, exporter, ID...), and its state/prio/abort changed, between
+// _sdlog_conv_job_write_begin()/end(), the readers of the other tasks copy it out and retry while it's odd, same as
+// the per-ID bus statistics. Only rec and exporter_name are written outside, single words for display
+#define SDLOG_CONV_READ_RETRY (8)
+
+enum sdlog_conv_abort_e {
+    SDLOG_CONV_ABORT_NONE = 0,
+    SDLOG_CONV_ABORT_CANCEL,
+    SDLOG_CONV_ABORT_PREEMPT, // queued again
+};
+
+typedef struct sdlog_conv_job_s {
+    uint32_t seq; // odd while SDLOG_CONV task rewrites the slot, the other tasks read a copy, _sdlog_conv_job_read()
+    uint32_t id;
+    uint32_t state; // SDLOG_CONV_STATE_xxx
+    uint32_t prio;
+    uint32_t exporter; // as requested, SDLOG_EXPORTER_AUTO is resolved when the job runs
+    const char *exporter_name;
+    char log_path[64];
+    uint32_t abort; // SDLOG_CONV_ABORT_xxx
+    uint32_t preempted;
+    uint64_t us_begin;
+    uint64_t us_yield;
+    uint32_t pct;
+    uint32_t rec;
+    uint32_t rec_per_s;
+    uint32_t eta_s;
+} sdlog_conv_job_t;
+
+static struct {
+    uint32_t id_last;
+    uint32_t submit_pending; // SUBMIT messages not in the job table yet, sdlog_conv_dir_busy() can't tell their path
+    sdlog_conv_job_t job[SDLOG_CONV_JOB_MAX];
+} sdlog_conv_ctrl;
+
+static void _sdlog_conv_job_write_begin(sdlog_conv_job_t *p_job)
+{
+    __atomic_store_n(&p_job->seq, p_job->seq + 1, __ATOMIC_RELAXED); // odd, the slot is being rewritten
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void _sdlog_conv_job_write_end(sdlog_conv_job_t *p_job)
+{
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&p_job->seq, p_job->seq + 1, __ATOMIC_RELAXED); // even, the slot is consistent
+}
+
 // ----------
 // SDLOG CONV TASK IMPLEMENTATION
 // ----------
@@ -44,259 +115,1187 @@ typedef struct sdlog_exporter_para_s {
     FILE *fp_out;
     uint64_t us_epoch_time;
     uint64_t us_sys_time;
+    const sdlog_time_sync_t *p_sync; // time sync records of the log, the header offset is used if there's none
+    uint32_t sync_num;
+    uint32_t sync_idx;
+    sdlog_conv_job_t *p_job; // NULL for sdlog_conv_file()
+    uint32_t in_size;        // the log when the conversion started, the records written later wait for the next run
+    uint32_t in_begin;       // first record to convert, after the global header or at the checkpoint
+    uint32_t in_pos;         // end of the last record of _sdlog_exporter_rec()
+    uint32_t pass;           // _sdlog_exporter_rewind() of the sync scan and the exporter
+    uint32_t pass_num;
+    sdlog_data_t rec_last;       // the last record of _sdlog_exporter_rec()
+    sdlog_fmt_table_t fmt_table; // TEXT: string table of the deferred records, kept in the checkpoint
+    uint32_t nl_pending;         // TEXT: the line break of the last record is held back, it's the last byte of the output
+    uint32_t fmt;                // SDLOG_FMT_xxx of the log, the record types of _sdlog_exporter_next()
+    uint8_t *p_payload;          // SDLOG_POOL_REC buffer, the payload of the record of _sdlog_exporter_next()
+    char *p_text;                // second half of it, for the format callbacks
+    uint32_t payload_len;        // bytes in p_payload
+    uint32_t payload_off;        // offset of p_payload in the record, a SDLOG_REC_STREAM record comes in pieces
+    uint32_t payload_rest;       // bytes of the record (padded) still in the log, _sdlog_exporter_payload()
+    uint32_t rec_skip;           // records of this pass of an unknown type or size, or rejected by the decoder
+    uint32_t h_next_valid;       // h_next was read with the payload, one fread() per record
+    sdlog_data_t h_next;
 } sdlog_exporter_para_t;
 
+// ----------
+// Record types (sdlog_rec_reg.h)
+// ----------
+#define SDLOG_REC_VAR (0)             // any payload up to SDLOG_CONV_PAYLOAD_SZ
+#define SDLOG_REC_STREAM (UINT32_MAX) // any payload, given to the format callback in pieces of SDLOG_CONV_PAYLOAD_SZ
+
+typedef struct sdlog_rec_s {
+    const char *name;
+    uint32_t size; // SDLOG_REC_VAR, SDLOG_REC_STREAM, or the payload bytes
+    esp_err_t (*decode)(const void *payload, uint32_t len);
+    esp_err_t (*format)(sdlog_exporter_para_t *p_para, const sdlog_data_t *p_h, const void *payload, uint32_t len);
+} sdlog_rec_t;
+
 typedef struct sdlog_exporter_s {
+    const char *name;
     uint32_t bmp_fmt_supported;
+    uint32_t passes; // reads of the log, for the progress of the job. A single pass exporter resumes from its checkpoint
     esp_err_t (*cb)(sdlog_exporter_para_t *p_para);
     char *fn_output;
 } sdlog_exporter_t;
 
-#define SDLOG_EXPORTER_REG(_name, _bmp_fmt_supported, _fn_output, _cb) extern esp_err_t(_cb)(sdlog_exporter_para_t * p_para);
+#define SDLOG_EXPORTER_REG(_name, _bmp_fmt_supported, _fn_output, _passes, _cb) extern esp_err_t(_cb)(sdlog_exporter_para_t * p_para);
 #include "sdlog_exporter_reg.h"
 #undef SDLOG_EXPORTER_REG
 
 sdlog_exporter_t sdlog_exporter[SDLOG_EXPORTER_NUM] = {
-#define SDLOG_EXPORTER_REG(_name, _bmp_fmt_supported, _fn_output, _cb) [SDLOG_EXPORTER_##_name] = (sdlog_exporter_t){ \
-                                                                           .bmp_fmt_supported = (_bmp_fmt_supported), \
-                                                                           .cb                = (_cb),                \
-                                                                           .fn_output         = (_fn_output),         \
-                                                                       },
+#define SDLOG_EXPORTER_REG(_name, _bmp_fmt_supported, _fn_output, _passes, _cb) [SDLOG_EXPORTER_##_name] = (sdlog_exporter_t){ \
+                                                                                    .name              = #_name,               \
+                                                                                    .bmp_fmt_supported = (_bmp_fmt_supported), \
+                                                                                    .passes            = (_passes),            \
+                                                                                    .cb                = (_cb),                \
+                                                                                    .fn_output         = (_fn_output),         \
+                                                                                },
 #include "sdlog_exporter_reg.h"
 #undef SDLOG_EXPORTER_REG
 };
 
-static void _sdlog_exporter_fp_in_padding(FILE *fp_in, uint32_t payload_len)
+static void _sdlog_conv_task_msg(const sdlog_conv_task_msg_t *p_msg);
+static sdlog_conv_job_t *_sdlog_conv_job_next(void);
+
+// the exporters read the log from the first record once per pass
+static esp_err_t _sdlog_exporter_rewind(sdlog_exporter_para_t *p_para)
+{
+    p_para->pass++;
+    p_para->in_pos       = p_para->in_begin;
+    p_para->payload_rest = 0;
+    p_para->rec_skip     = 0;
+    p_para->h_next_valid = 0;
+    return fseek(p_para->fp_in, p_para->in_begin, SEEK_SET) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+// a record read by a single pass exporter, 0 if it ends beyond in_size (still being written), the exporter stops there
+static uint32_t _sdlog_exporter_rec(sdlog_exporter_para_t *p_para, const sdlog_data_t *p_h)
 {
-    uint32_t pad_len = (payload_len + 7) / 8 * 8 - payload_len;
-    if (pad_len) {
-        char buf[8];
-        fread(buf, pad_len, 1, fp_in);
+    uint64_t rec_end = (uint64_t)p_para->in_pos + sizeof(sdlog_data_t) + (p_h->payload_len + 7) / 8 * 8;
+    if (rec_end > p_para->in_size) {
+        return 0;
     }
+    p_para->in_pos   = rec_end;
+    p_para->rec_last = *p_h;
+    return 1;
 }
 
-esp_err_t sdlog_exporter_text(sdlog_exporter_para_t *p_para)
+static void _sdlog_exporter_progress(sdlog_exporter_para_t *p_para)
 {
-    // Move cursor to the begin-of-data
-    if (fseek(p_para->fp_in, sizeof(sdlog_header_t), SEEK_SET) != 0) { // skip gloal header
-        return ESP_FAIL;
+    sdlog_conv_job_t *p_job = p_para->p_job;
+    uint64_t in_len         = p_para->in_size - p_para->in_begin;
+    uint64_t total          = (uint64_t)p_para->pass_num * in_len;
+    uint64_t done           = (uint64_t)(p_para->pass - 1) * in_len + ftell(p_para->fp_in) - p_para->in_begin;
+    uint64_t us_elapsed     = esp_timer_get_time() - p_job->us_begin;
+    if (total == 0 || done == 0 || us_elapsed == 0) {
+        return;
     }
+    done = (done > total) ? total : done;
+    _sdlog_conv_job_write_begin(p_job);
+    p_job->pct       = done * 100 / total;
+    p_job->rec_per_s = (uint64_t)p_job->rec * 1000000 / us_elapsed;
+    p_job->eta_s     = (total - done) * us_elapsed / done / 1000000;
+    _sdlog_conv_job_write_end(p_job);
+}
 
-    sdlog_data_t entry;
-    while (fread(&entry, sizeof(sdlog_data_t), 1, p_para->fp_in) == 1) {
-        if (entry.magic != 0xA5) { // ensure the magic byte sync
-            ESP_LOGI(TAG, "magic_mismatch()");
-            return ESP_FAIL; // we don't expect this happened
+// called once per record by _sdlog_exporter_next(), every SDLOG_CONV_POLL_REC records the job:
+// - updates its progress and handles the messages (new jobs, cancel)
+// - sleeps while the live logging has a backlog, the SD card is theirs
+// - gives way to a queued job of a higher priority
+// ESP_ERR_INVALID_STATE if the job is aborted, the exporter returns at once
+static esp_err_t _sdlog_exporter_poll(sdlog_exporter_para_t *p_para)
+{
+    sdlog_conv_job_t *p_job = p_para->p_job;
+    if (p_job == NULL) {
+        return ESP_OK;
+    }
+    if (++p_job->rec % SDLOG_CONV_POLL_REC) {
+        return (p_job->abort == SDLOG_CONV_ABORT_NONE) ? ESP_OK : ESP_ERR_INVALID_STATE;
+    }
+
+    _sdlog_exporter_progress(p_para);
+
+    sdlog_conv_task_msg_t msg;
+    while (xQueueReceive(sdlog_conv_task_msgq, &msg, 0) == pdPASS) {
+        _sdlog_conv_task_msg(&msg);
+    }
+    while (p_job->abort == SDLOG_CONV_ABORT_NONE && sdlog_backlog() > SDLOG_CONV_YIELD_BYTES) {
+        uint64_t us_sleep = esp_timer_get_time();
+        if (xQueueReceive(sdlog_conv_task_msgq, &msg, pdMS_TO_TICKS(SDLOG_CONV_YIELD_MS)) == pdPASS) {
+            _sdlog_conv_task_msg(&msg);
         }
+        _sdlog_conv_job_write_begin(p_job);
+        p_job->us_yield += esp_timer_get_time() - us_sleep;
+        _sdlog_conv_job_write_end(p_job);
+    }
 
-        // calculate abs time, and write to file
-        fprintf(p_para->fp_out, "[%" PRIu64 "] ", p_para->us_epoch_time + (entry.us_sys_time - p_para->us_sys_time));
+    sdlog_conv_job_t *p_next = _sdlog_conv_job_next();
+    if (p_job->abort == SDLOG_CONV_ABORT_NONE && p_next && p_next->prio > p_job->prio) {
+        _sdlog_conv_job_write_begin(p_job);
+        p_job->abort = SDLOG_CONV_ABORT_PREEMPT;
+        _sdlog_conv_job_write_end(p_job);
+    }
+    return (p_job->abort == SDLOG_CONV_ABORT_NONE) ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
 
-        // write to the file
-        uint32_t remaining_bytes = entry.payload_len;
-        uint32_t last_char       = 0;
-        while (remaining_bytes) {
-            uint8_t payload_buf[256]; // read maximum 256byte one time
+// the absolute time of a record, interpolated between the time sync records
+static uint64_t _sdlog_exporter_abs_us(sdlog_exporter_para_t *p_para, uint64_t us_sys_time)
+{
+    if (p_para->sync_num == 0) {
+        return p_para->us_epoch_time + (us_sys_time - p_para->us_sys_time);
+    }
+    return sdlog_time_sync_abs_us(p_para->p_sync, p_para->sync_num, &p_para->sync_idx, us_sys_time);
+}
 
-            uint32_t read_bytes = (remaining_bytes >= sizeof(payload_buf)) ? sizeof(payload_buf) : remaining_bytes;
-            size_t n            = fread(payload_buf, 1, read_bytes, p_para->fp_in);
+// a line of text, the line break of the last one goes first
+static void _sdlog_rec_text_line(sdlog_exporter_para_t *p_para, const sdlog_data_t *p_h, const char *text, uint32_t len)
+{
+    if (p_para->nl_pending) {
+        fputc('\n', p_para->fp_out);
+    }
+    fprintf(p_para->fp_out, "[%" PRIu64 "] ", _sdlog_exporter_abs_us(p_para, p_h->us_sys_time));
+    fwrite(text, 1, len, p_para->fp_out);
+    p_para->nl_pending = (len == 0 || text[len - 1] != '\n');
+}
 
-            if (n > 0) {
-                fwrite(payload_buf, read_bytes, 1, p_para->fp_out);
-                remaining_bytes -= read_bytes;
-                last_char = payload_buf[read_bytes - 1];
-            } else {
+// a continuation record, or the next piece of a long record, goes on the line of the record before
+static esp_err_t _sdlog_rec_text_string(sdlog_exporter_para_t *p_para, const sdlog_data_t *p_h, const void *payload, uint32_t len)
+{
+    if (p_h->type_data == SDLOG_FMT_TEXT__STRING && p_para->payload_off == 0) {
+        _sdlog_rec_text_line(p_para, p_h, payload, len);
+        return ESP_OK;
+    }
+    fwrite(payload, 1, len, p_para->fp_out);
+    p_para->nl_pending = (len == 0 || ((const char *)payload)[len - 1] != '\n');
+    return ESP_OK;
+}
+
+// the string table entries are collected, the deferred messages are formatted with them
+static esp_err_t _sdlog_rec_text_fmt(sdlog_exporter_para_t *p_para, const sdlog_data_t *p_h, const void *payload, uint32_t len)
+{
+    sdlog_fmt_table_add(&p_para->fmt_table, payload, len);
+    return ESP_OK;
+}
+
+static esp_err_t _sdlog_rec_text_bin(sdlog_exporter_para_t *p_para, const sdlog_data_t *p_h, const void *payload, uint32_t len)
+{
+    uint32_t text_len = sdlog_fmt_render_rec(&p_para->fmt_table, payload, len, p_para->p_text, SDLOG_CONV_TEXT_BUF_SZ);
+    _sdlog_rec_text_line(p_para, p_h, p_para->p_text, text_len);
+    return ESP_OK;
+}
+
+static esp_err_t _sdlog_rec_text_http(sdlog_exporter_para_t *p_para, const sdlog_data_t *p_h, const void *payload, uint32_t len)
+{
+    uint32_t text_len = sdlog_fmt_render_http(payload, len, p_para->p_text, SDLOG_CONV_TEXT_BUF_SZ);
+    _sdlog_rec_text_line(p_para, p_h, p_para->p_text, text_len);
+    return ESP_OK;
+}
+
+// a DLC above 8 is only sent with dlc_non_comp, and still carries 8 bytes
+static esp_err_t _sdlog_rec_can_frame_decode(const void *payload, uint32_t len)
+{
+    const twai_message_t *p_can = payload;
+    if (p_can->data_length_code > 15 || (p_can->data_length_code > TWAI_FRAME_MAX_DLC && !p_can->dlc_non_comp)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
+
+// candump -L style: "(1700000000.002000) can1 123 [3] 01 02 03"
+static esp_err_t _sdlog_rec_can_frame(sdlog_exporter_para_t *p_para, const sdlog_data_t *p_h, const void *payload, uint32_t len)
+{
+    const twai_message_t *p_can = payload;
+    char *line_buf              = p_para->p_text;
+
+    uint64_t abs_us = _sdlog_exporter_abs_us(p_para, p_h->us_sys_time); // calculate absolute micro-second
+    uint32_t n      = snprintf(line_buf, SDLOG_CONV_TEXT_BUF_SZ, "(%" PRIu64 ".%06" PRIu64 ") can1 %03" PRIX32 " [%d] ",
+                               (abs_us / 1000000), (abs_us % 1000000), p_can->identifier, p_can->data_length_code);
+
+    char *p          = line_buf + n;
+    uint32_t dlc_len = (p_can->data_length_code > TWAI_FRAME_MAX_DLC) ? TWAI_FRAME_MAX_DLC : p_can->data_length_code;
+    for (uint32_t i = 0; i < dlc_len; i++) {
+        static const char hex_table[] = "0123456789ABCDEF";
+
+        uint8_t b = p_can->data[i];
+        *p++      = hex_table[(b >> 4) & 0xF];
+        *p++      = hex_table[(b >> 0) & 0xF];
+        *p++      = ' ';
+    }
+
+    if (dlc_len) {
+        p--; // the code above generated one redundant space, if any bytes available, remove it
+    }
+
+    *p++ = '\n';
+    fwrite(line_buf, p - line_buf, 1, p_para->fp_out);
+    return ESP_OK;
+}
+
+static esp_err_t _sdlog_rec_adc_block_decode(const void *payload, uint32_t len)
+{
+    const sdlog_adc_block_t *p_blk = payload;
+    return (p_blk->rate_hz == 0) ? ESP_ERR_INVALID_SIZE : ESP_OK;
+}
+
+// one line per sample: "1700000000.002000,4,2048", the time of a sample from the rate of the block
+static esp_err_t _sdlog_rec_adc_block(sdlog_exporter_para_t *p_para, const sdlog_data_t *p_h, const void *payload, uint32_t len)
+{
+    const sdlog_adc_block_t *p_blk = payload;
+    char *line_buf                 = p_para->p_text;
+    uint32_t n                     = 0;
+
+    uint64_t abs_us = _sdlog_exporter_abs_us(p_para, p_h->us_sys_time);
+    for (uint32_t i = 0; i < SDLOG_ADC_BLOCK_SAMPLES; i++) {
+        uint64_t us = abs_us + (uint64_t)i * 1000000 / p_blk->rate_hz;
+        n += snprintf(line_buf + n, SDLOG_CONV_TEXT_BUF_SZ - n, "%" PRIu64 ".%06" PRIu64 ",%u,%u\n", us / 1000000, us % 1000000,
+                      SDLOG_ADC_SAMPLE_CH(p_blk->sample[i]), SDLOG_ADC_SAMPLE_RAW(p_blk->sample[i]));
+        if (SDLOG_CONV_TEXT_BUF_SZ - n < 48 || i == SDLOG_ADC_BLOCK_SAMPLES - 1) { // a line is 40 bytes at most
+            fwrite(line_buf, n, 1, p_para->fp_out);
+            n = 0;
+        }
+    }
+    return ESP_OK;
+}
+
+#define SDLOG_REC_REG(_name, _fmt, _type, _size, _decode, _format) \
+    static_assert((_size) == SDLOG_REC_STREAM || (_size) <= SDLOG_CONV_PAYLOAD_SZ, #_name " doesn't fit the record buffer");
+#include "sdlog_rec_reg.h"
+#undef SDLOG_REC_REG
+
+enum {
+#define SDLOG_REC_REG(_name, _fmt, _type, _size, _decode, _format) SDLOG_REC_##_name,
+#include "sdlog_rec_reg.h"
+#undef SDLOG_REC_REG
+    SDLOG_REC_NUM,
+};
+
+static_assert(SDLOG_REC_NUM <= 32, "the exporters select the record types with a uint32_t bitmap");
+
+static const sdlog_rec_t sdlog_rec[SDLOG_REC_NUM] = {
+#define SDLOG_REC_REG(_name, _fmt, _type, _size, _decode, _format) [SDLOG_REC_##_name] = (sdlog_rec_t){ \
+                                                                       .name   = #_name,                 \
+                                                                       .size   = (_size),                \
+                                                                       .decode = (_decode),              \
+                                                                       .format = (_format),              \
+                                                                   },
+#include "sdlog_rec_reg.h"
+#undef SDLOG_REC_REG
+};
+
+// jump table of the reader, SDLOG_REC_xxx + 1 of the type_data in the format (row SDLOG_FMT_ANY: the framework records), 0 if unknown
+static const uint8_t sdlog_rec_lut[SDLOG_FMT_NUM + 1][256] = {
+#define SDLOG_REC_REG(_name, _fmt, _type, _size, _decode, _format) [_fmt][_type] = SDLOG_REC_##_name + 1,
+#include "sdlog_rec_reg.h"
+#undef SDLOG_REC_REG
+};
+
+// the next piece of the payload of the record into p_para->p_payload, the padding of the record, and the header of
+// the next one, are read with the last one
+static esp_err_t _sdlog_exporter_payload(sdlog_exporter_para_t *p_para)
+{
+    uint32_t n     = (p_para->payload_rest > SDLOG_CONV_PAYLOAD_SZ) ? SDLOG_CONV_PAYLOAD_SZ : p_para->payload_rest;
+    uint32_t ahead = (n == p_para->payload_rest) ? sizeof(sdlog_data_t) : 0;
+    uint32_t got   = fread(p_para->p_payload, 1, n + ahead, p_para->fp_in);
+    if (got < n) {
+        return ESP_FAIL;
+    }
+    if (ahead && got == n + ahead) {
+        memcpy(&p_para->h_next, p_para->p_payload + n, sizeof(sdlog_data_t));
+        p_para->h_next_valid = 1;
+    }
+    p_para->payload_off += p_para->payload_len;
+    p_para->payload_len = p_para->rec_last.payload_len - p_para->payload_off;
+    p_para->payload_len = (p_para->payload_len > n) ? n : p_para->payload_len;
+    p_para->payload_rest -= n;
+    return ESP_OK;
+}
+
+// the next record of a type of bmp_rec (1 << SDLOG_REC_xxx), the header is p_para->rec_last, the payload p_para->p_payload
+// (the first piece of a SDLOG_REC_STREAM record, _sdlog_exporter_payload() reads the next one)
+// the records of an unknown type or size, or rejected by the decoder, are skipped and counted, the others of the log too
+// ESP_ERR_NOT_FOUND at the end of the log, ESP_ERR_INVALID_STATE if the job is aborted
+static esp_err_t _sdlog_exporter_next(sdlog_exporter_para_t *p_para, uint32_t bmp_rec, const sdlog_rec_t **pp_rec)
+{
+    FILE *fp_in = p_para->fp_in;
+    sdlog_data_t h;
+    esp_err_t ret;
+    while ((ret = _sdlog_exporter_poll(p_para)) == ESP_OK) {
+        if (p_para->payload_rest && fseek(fp_in, p_para->payload_rest, SEEK_CUR) != 0) { // not read by the exporter
+            return ESP_FAIL;
+        }
+        p_para->payload_rest = 0;
+        if (p_para->h_next_valid) {
+            h                    = p_para->h_next;
+            p_para->h_next_valid = 0;
+        } else if (fread(&h, sizeof(h), 1, fp_in) != 1) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        if (h.magic != 0xA5) { // ensure the magic byte sync
+            ESP_LOGE(TAG, "magic mismatch at %" PRIu32, p_para->in_pos);
+            return ESP_FAIL; // we don't expect this happened
+        }
+        if (!_sdlog_exporter_rec(p_para, &h)) {
+            return ESP_ERR_NOT_FOUND; // the rest of the log is converted by the next run
+        }
+
+        uint32_t pad_len = (h.payload_len + 7) / 8 * 8;
+        uint32_t idx     = sdlog_rec_lut[(h.type_data >= SDLOG_TYPE_FRAMEWORK) ? SDLOG_FMT_ANY : p_para->fmt][h.type_data];
+        const sdlog_rec_t *p_rec = idx ? &sdlog_rec[idx - 1] : NULL;
+        uint32_t valid           = p_rec && (p_rec->size == SDLOG_REC_STREAM ||
+                                   ((p_rec->size == SDLOG_REC_VAR || p_rec->size == h.payload_len) && pad_len <= SDLOG_CONV_PAYLOAD_SZ));
+        if (!valid || (bmp_rec & (1 << (idx - 1))) == 0) {
+            p_para->rec_skip += !valid;
+            if (fseek(fp_in, pad_len, SEEK_CUR) != 0) {
                 return ESP_FAIL;
             }
+            continue;
+        }
+
+        p_para->payload_len  = 0;
+        p_para->payload_off  = 0;
+        p_para->payload_rest = pad_len;
+        if (_sdlog_exporter_payload(p_para) != ESP_OK) {
+            return ESP_FAIL;
         }
-        if (last_char != '\n') {
-            fputc(p_para->fp_out, '\n');
+        if (p_rec->decode && p_rec->decode(p_para->p_payload, p_para->payload_len) != ESP_OK) {
+            p_para->rec_skip++;
+            continue;
         }
+        *pp_rec = p_rec;
+        return ESP_OK;
+    }
+    return ret;
+}
 
-        // Handle padding, 8byte align
-        _sdlog_exporter_fp_in_padding(p_para->fp_in, entry.payload_len);
+// ----------
+// EXPORTER: TEXT, CAN, ADCCSV
+// ----------
+// One line per record, made by the format callback of its type, the records without one are skipped
+esp_err_t sdlog_exporter_line(sdlog_exporter_para_t *p_para)
+{
+    uint32_t bmp_rec = 0;
+    for (uint32_t i = 0; i < SDLOG_REC_NUM; i++) {
+        bmp_rec |= (sdlog_rec[i].format != NULL) << i;
     }
 
-    return ESP_OK;
+    // Move cursor to the begin-of-data
+    if (_sdlog_exporter_rewind(p_para) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    // p_para->nl_pending: the line break of the last record, held back for a continuation record
+    const sdlog_rec_t *p_rec;
+    esp_err_t ret;
+    while ((ret = _sdlog_exporter_next(p_para, bmp_rec, &p_rec)) == ESP_OK) {
+        do {
+            ret = p_rec->format(p_para, &p_para->rec_last, p_para->p_payload, p_para->payload_len);
+        } while (ret == ESP_OK && p_para->payload_rest && (ret = _sdlog_exporter_payload(p_para)) == ESP_OK);
+        if (ret != ESP_OK) {
+            break;
+        }
+    }
+    if (p_para->nl_pending) {
+        fputc('\n', p_para->fp_out);
+    }
+
+    return (ret == ESP_ERR_NOT_FOUND) ? ESP_OK : ret;
 }
 
 // ----------
-// EXPORTER: CAN
+// EXPORTER: CAN columnar (per-ID timestamp/payload arrays)
 // ----------
+// Pass#1 counts the frames of every ID and lays out the columns, pass#2 fills them
+// Frames are batched per ID, so the output is written with one seek per column every SDLOG_CANCOL_BATCH frames
 
-// Declare a data structure to merge data/payload read at the same time
-// - sdlog_data_t
-// - twai_message_t
-// - padding
+#define SDLOG_CANCOL_ID_MAX (128)  // distinct IDs in the directory, frames of other IDs are counted as dropped
+#define SDLOG_CANCOL_HASH_SZ (256) // open addressing hash, 2x of SDLOG_CANCOL_ID_MAX
+#define SDLOG_CANCOL_BATCH (8)
 
-struct twai_data_entry_payload_s {
-    sdlog_data_t h;
-    twai_message_t can_msg;
-};
+typedef struct sdlog_cancol_slot_s {
+    uint32_t key; // identifier | (extd << 31), standard and extended IDs are different signals
+    uint32_t written;
+    uint32_t batch_num;
+    sdlog_cancol_dir_t dir;
+    uint64_t ts[SDLOG_CANCOL_BATCH];
+    uint8_t data[SDLOG_CANCOL_BATCH][8];
+    uint8_t dlc[SDLOG_CANCOL_BATCH];
+} sdlog_cancol_slot_t;
 
-struct twai_data_entry_s {
-    struct twai_data_entry_payload_s payload;
-    uint8_t padding[sizeof(struct twai_data_entry_payload_s) % 8];
-};
+typedef struct sdlog_cancol_ctx_s {
+    uint32_t id_num;
+    int16_t hash[SDLOG_CANCOL_HASH_SZ]; // index of slot[], -1 if empty
+    sdlog_cancol_slot_t slot[SDLOG_CANCOL_ID_MAX];
+} sdlog_cancol_ctx_t;
 
-esp_err_t sdlog_exporter_can(sdlog_exporter_para_t *p_para)
+static sdlog_cancol_slot_t *_sdlog_cancol_lookup(sdlog_cancol_ctx_t *p_ctx, uint32_t key, uint32_t create)
 {
-    // Move cursor to the begin-of-data
-    if (fseek(p_para->fp_in, sizeof(sdlog_header_t), SEEK_SET) != 0) { // skip gloal header
+    uint32_t h = (key * 2654435761u) % SDLOG_CANCOL_HASH_SZ;
+    for (uint32_t i = 0; i < SDLOG_CANCOL_HASH_SZ; i++, h = (h + 1) % SDLOG_CANCOL_HASH_SZ) {
+        int16_t idx = p_ctx->hash[h];
+        if (idx >= 0) {
+            if (p_ctx->slot[idx].key == key) {
+                return &p_ctx->slot[idx];
+            }
+        } else if (create && p_ctx->id_num < SDLOG_CANCOL_ID_MAX) {
+            sdlog_cancol_slot_t *p_slot = &p_ctx->slot[p_ctx->id_num];
+            p_slot->key                 = key;
+            p_ctx->hash[h]              = p_ctx->id_num++;
+            return p_slot;
+        } else {
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+static int _sdlog_cancol_cmp(const void *a, const void *b)
+{
+    uint32_t key_a = (*(sdlog_cancol_slot_t *const *)a)->key;
+    uint32_t key_b = (*(sdlog_cancol_slot_t *const *)b)->key;
+    return (key_a > key_b) - (key_a < key_b);
+}
+
+static esp_err_t _sdlog_cancol_flush(sdlog_cancol_slot_t *p_slot, FILE *fp_out)
+{
+    uint32_t n = p_slot->batch_num;
+    if (n == 0) {
+        return ESP_OK;
+    }
+    if (fseek(fp_out, p_slot->dir.offset_ts + p_slot->written * sizeof(uint64_t), SEEK_SET) != 0 ||
+        fwrite(p_slot->ts, sizeof(uint64_t), n, fp_out) != n ||
+        fseek(fp_out, p_slot->dir.offset_data + p_slot->written * 8, SEEK_SET) != 0 ||
+        fwrite(p_slot->data, 8, n, fp_out) != n ||
+        fseek(fp_out, p_slot->dir.offset_dlc + p_slot->written, SEEK_SET) != 0 ||
+        fwrite(p_slot->dlc, 1, n, fp_out) != n) {
         return ESP_FAIL;
     }
+    p_slot->written += n;
+    p_slot->batch_num = 0;
+    return ESP_OK;
+}
+
+esp_err_t sdlog_exporter_can_col(sdlog_exporter_para_t *p_para)
+{
+    sdlog_cancol_ctx_t *p_ctx          = calloc(1, sizeof(sdlog_cancol_ctx_t));
+    sdlog_cancol_slot_t **pp_sorted    = calloc(SDLOG_CANCOL_ID_MAX, sizeof(sdlog_cancol_slot_t *));
+    sdlog_cancol_header_t cancol_header = {
+        .magic      = "QQCANCOL",
+        .version    = 1,
+        .offset_dir = sizeof(sdlog_cancol_header_t),
+    };
+    esp_err_t ret = ESP_FAIL;
 
-    struct twai_data_entry_s buf;
-    sdlog_data_t *p_h     = &buf.payload.h;
-    twai_message_t *p_can = &buf.payload.can_msg;
+    const sdlog_rec_t *p_rec;
+    const sdlog_data_t *p_h     = &p_para->rec_last;
+    const twai_message_t *p_can = (const twai_message_t *)p_para->p_payload;
 
-    while (fread(&buf, sizeof(buf), 1, p_para->fp_in) == 1) {
-        if (p_h->magic != 0xA5) {
-            ESP_LOGE(TAG, "CAN Exporter: Magic mismatch!");
-            return ESP_FAIL;
+    do {
+        if (p_ctx == NULL || pp_sorted == NULL) {
+            break;
         }
+        memset(p_ctx->hash, 0xFF, sizeof(p_ctx->hash));
 
-        char line_buf[128];
+        // Pass#1, count frames per ID
+        if (_sdlog_exporter_rewind(p_para) != ESP_OK) {
+            break;
+        }
+        esp_err_t next;
+        while ((next = _sdlog_exporter_next(p_para, 1 << SDLOG_REC_CAN_FRAME, &p_rec)) == ESP_OK) {
+            sdlog_cancol_slot_t *p_slot = _sdlog_cancol_lookup(p_ctx, p_can->identifier | ((uint32_t)p_can->extd << 31), /*create*/ 1);
+            if (p_slot) {
+                if (p_slot->dir.count++ == 0) {
+                    p_slot->dir.identifier = p_can->identifier;
+                    p_slot->dir.flags      = p_can->flags;
+                }
+                cancol_header.frame_num++;
+            } else {
+                cancol_header.frame_drop++;
+            }
+        }
 
-        uint64_t abs_us = p_para->us_epoch_time + (p_h->us_sys_time - p_para->us_sys_time); // calculate absolute micro-second
-        uint32_t len    = snprintf(line_buf, sizeof(line_buf), "(%llu.%06llu) can1 %03lX [%d] ",
-               (abs_us / 1000000), (abs_us % 1000000), p_can->identifier, p_can->data_length_code);
+        if (next != ESP_ERR_NOT_FOUND) {
+            ret = next;
+            break;
+        }
 
-        char *p = line_buf + len;
-        for (uint32_t i = 0; i < p_can->data_length_code; i++) {
-            static const char hex_table[] = "0123456789ABCDEF";
+        // Lay out the directory (sorted by ID) and the columns
+        cancol_header.id_num = p_ctx->id_num;
+        for (uint32_t i = 0; i < p_ctx->id_num; i++) {
+            pp_sorted[i] = &p_ctx->slot[i];
+        }
+        qsort(pp_sorted, p_ctx->id_num, sizeof(sdlog_cancol_slot_t *), _sdlog_cancol_cmp);
 
-            uint8_t b = p_can->data[i];
-            *p++      = hex_table[(b >> 4) & 0xF];
-            *p++      = hex_table[(b >> 0) & 0xF];
-            *p++      = ' ';
+        uint32_t offset = sizeof(sdlog_cancol_header_t) + p_ctx->id_num * sizeof(sdlog_cancol_dir_t);
+        for (uint32_t i = 0; i < p_ctx->id_num; i++) {
+            sdlog_cancol_dir_t *p_dir = &pp_sorted[i]->dir;
+            p_dir->offset_ts          = offset;
+            offset += p_dir->count * sizeof(uint64_t);
+            p_dir->offset_data = offset;
+            offset += p_dir->count * 8;
+            p_dir->offset_dlc = offset;
+            offset += (p_dir->count + 7) / 8 * 8;
         }
 
-        if (p_can->data_length_code) {
-            p--; // the code above generated one redundant space, if any bytes available, remove it
+        if (fwrite(&cancol_header, sizeof(cancol_header), 1, p_para->fp_out) != 1) {
+            break;
+        }
+        uint32_t i;
+        for (i = 0; i < p_ctx->id_num; i++) {
+            if (fwrite(&pp_sorted[i]->dir, sizeof(sdlog_cancol_dir_t), 1, p_para->fp_out) != 1) {
+                break;
+            }
+        }
+        if (i != p_ctx->id_num) {
+            break;
+        }
+
+        // Pass#2, fill the columns
+        if (_sdlog_exporter_rewind(p_para) != ESP_OK) {
+            break;
+        }
+        ret = ESP_OK;
+        while (ret == ESP_OK && (ret = _sdlog_exporter_next(p_para, 1 << SDLOG_REC_CAN_FRAME, &p_rec)) == ESP_OK) {
+            sdlog_cancol_slot_t *p_slot = _sdlog_cancol_lookup(p_ctx, p_can->identifier | ((uint32_t)p_can->extd << 31), /*create*/ 0);
+            if (p_slot) {
+                uint32_t n       = p_slot->batch_num++;
+                p_slot->ts[n]    = _sdlog_exporter_abs_us(p_para, p_h->us_sys_time);
+                p_slot->dlc[n]   = p_can->data_length_code;
+                memcpy(p_slot->data[n], p_can->data, 8);
+                if (p_slot->batch_num == SDLOG_CANCOL_BATCH) {
+                    ret = _sdlog_cancol_flush(p_slot, p_para->fp_out);
+                }
+            }
         }
+        ret = (ret == ESP_ERR_NOT_FOUND) ? ESP_OK : ret;
+        for (i = 0; ret == ESP_OK && i < p_ctx->id_num; i++) {
+            ret = _sdlog_cancol_flush(&p_ctx->slot[i], p_para->fp_out);
+        }
+    } while (0);
 
-        *p++ = '\n';
-        fwrite(line_buf, p - line_buf, 1, p_para->fp_out);
+    if (cancol_header.frame_drop) {
+        ESP_LOGW(TAG, "CANCOL Exporter: %" PRIu32 " frames dropped, more than %d IDs", cancol_header.frame_drop, SDLOG_CANCOL_ID_MAX);
     }
+    free(pp_sorted);
+    free(p_ctx);
+    return ret;
+}
 
-    return ESP_OK;
+// ----------
+// EXPORTER: ADC
+// ----------
+// CSV: "time,channel,raw" and one line per sample, the lines are made by the format callback of the block
+esp_err_t sdlog_exporter_adc_csv(sdlog_exporter_para_t *p_para)
+{
+    if (ftell(p_para->fp_out) == 0 && fputs("time,channel,raw\n", p_para->fp_out) < 0) { // not when resumed
+        return ESP_FAIL;
+    }
+    return sdlog_exporter_line(p_para);
+}
+
+// Binary: sdlog_adcbin_header_t and the blocks in absolute time, a resumed run appends the blocks
+esp_err_t sdlog_exporter_adc_bin(sdlog_exporter_para_t *p_para)
+{
+    sdlog_adcbin_header_t adcbin_header = {
+        .magic         = "QQADCBIN",
+        .version       = 1,
+        .block_samples = SDLOG_ADC_BLOCK_SAMPLES,
+        .block_size    = sizeof(sdlog_adcbin_block_t),
+    };
+    if (ftell(p_para->fp_out) == 0 && fwrite(&adcbin_header, sizeof(adcbin_header), 1, p_para->fp_out) != 1) {
+        return ESP_FAIL;
+    }
+
+    if (_sdlog_exporter_rewind(p_para) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    const sdlog_rec_t *p_rec;
+    const sdlog_adc_block_t *p_blk = (const sdlog_adc_block_t *)p_para->p_payload;
+    sdlog_adcbin_block_t block;
+    esp_err_t ret;
+    while ((ret = _sdlog_exporter_next(p_para, 1 << SDLOG_REC_ADC_BLOCK, &p_rec)) == ESP_OK) {
+        block.us_epoch_time = _sdlog_exporter_abs_us(p_para, p_para->rec_last.us_sys_time);
+        block.seq           = p_blk->seq;
+        block.rate_hz       = p_blk->rate_hz;
+        memcpy(block.sample, p_blk->sample, sizeof(block.sample));
+        if (fwrite(&block, sizeof(block), 1, p_para->fp_out) != 1) {
+            return ESP_FAIL;
+        }
+    }
+    return (ret == ESP_ERR_NOT_FOUND) ? ESP_OK : ret;
+}
+
+// Collect the time sync records, the other records are skipped with their headers
+// If the log has more than SDLOG_CONV_SYNC_MAX points, every other point is dropped and the stride doubles
+// p_sync[0..num) are the points before in_begin, kept in the checkpoint
+static uint32_t _sdlog_conv_sync_scan(sdlog_exporter_para_t *p_para, sdlog_time_sync_t *p_sync, uint32_t num)
+{
+    uint32_t stride = 1, seen = 0;
+    sdlog_data_t rec_last = p_para->rec_last; // of the checkpoint, until the exporter reads a record
+    const sdlog_rec_t *p_rec;
+
+    if (_sdlog_exporter_rewind(p_para) != ESP_OK) {
+        return num;
+    }
+    while (_sdlog_exporter_next(p_para, 1 << SDLOG_REC_TIME_SYNC, &p_rec) == ESP_OK) {
+        sdlog_time_sync_t sync;
+        memcpy(&sync, p_para->p_payload, sizeof(sync));
+        if (seen++ % stride) {
+            continue;
+        }
+        if (num == SDLOG_CONV_SYNC_MAX) {
+            for (uint32_t i = 0; i < num / 2; i++) {
+                p_sync[i] = p_sync[i * 2];
+            }
+            num /= 2;
+            stride *= 2;
+        }
+        if (num && sync.us_sys_time < p_sync[num - 1].us_sys_time) {
+            continue; // the records are in time order, don't break the table with a corrupted one
+        }
+        p_sync[num++] = sync;
+    }
+    p_para->rec_last = rec_last;
+    return num;
 }
 
 static uint8_t sdlog_conv_def_exporter[] = {
     [SDLOG_FMT_TEXT] = SDLOG_EXPORTER_TEXT,
     [SDLOG_FMT_CAN]  = SDLOG_EXPORTER_CAN,
-    [SDLOG_FMT_ADC]  = SDLOG_EXPORTER_TEXT, // actually not supported yet
+    [SDLOG_FMT_ADC]  = SDLOG_EXPORTER_ADCBIN,
 };
 
-static void sdlog_conv_task(void *param)
+uint32_t sdlog_conv_exporter_find(const char *name)
 {
-    sdlog_conv_task_msg_t msg;
+    for (uint32_t i = 0; i < SDLOG_EXPORTER_NUM; i++) {
+        if (strcmp(sdlog_exporter[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return SDLOG_EXPORTER_NUM;
+}
 
-    while (1) {
-        if (xQueueReceive(sdlog_conv_task_msgq, &msg, portMAX_DELAY) == pdPASS) {
-            uint32_t step      = 1;
-            uint64_t conv_time = 0;
-            FILE *fp_in        = NULL;
-            FILE *fp_out       = NULL;
-            void *iobuf_in     = NULL;
-            void *iobuf_out    = NULL;
-            do {
-                sdlog_header_sys_t sdlog_header;
-
-                // Open the binary file
-                step++;
-                if ((fp_in = fopen(msg.log_path, "rb")) == NULL) {
-                    break;
-                }
-                iobuf_in = malloc(SDLOG_CONV_FILE_BUF_SZ);
-                if (iobuf_in) {
-                    setvbuf(fp_in, iobuf_in, _IOFBF, SDLOG_CONV_FILE_BUF_SZ); // set the wbuf of the FILE*, it writes to the SD card every 4KB
-                }
+// ----------
+// Checkpoint of the single pass exporters, .<output>.ckpt next to the output (hidden from /log_browse)
+// ----------
+// Saved when the exporter reached the end of the log, or was preempted/canceled. The next run of the exporter appends
+// the records after in_offset to the output, if:
+// - the output is out_offset bytes long, plus the held back line break
+// - the epoch of the log header is the same (a provisional epoch wasn't corrected meanwhile)
+// - the record ending at in_offset is still rec_last
+// otherwise the output is rebuilt from the first record
+#define SDLOG_CONV_CKPT_MAGIC "QQCKPT"
+#define SDLOG_CONV_CKPT_EXT ".ckpt"
 
-                // Read whole header image locally,
-                step++;
-                if (fread(&sdlog_header, 1, sizeof(sdlog_header), fp_in) != sizeof(sdlog_header)) {
-                    break;
-                }
+typedef struct sdlog_conv_ckpt_s {
+    char magic[8]; // SDLOG_CONV_CKPT_MAGIC
+    uint32_t version;
+    uint32_t exporter; // SDLOG_EXPORTER_xxx
+    uint64_t us_epoch_time;
+    uint32_t in_offset;  // the first record not converted yet
+    uint32_t out_offset; // the output of the records before in_offset
+    uint32_t nl_pending;
+    uint32_t fmt_num; // TEXT: string table entries after the checkpoint, uint32_t len + SDLOG_FMT_TEXT__FMT payload
+    sdlog_data_t rec_last;
+    sdlog_time_sync_t sync; // the last time sync point before in_offset, us_sys_time 0 if none
+} sdlog_conv_ckpt_t;
 
-                if (strcmp(sdlog_header.magic, "QQMLAB")) {
-                    ESP_LOGW(TAG, "LOG header check fail"); // TODO: strengthen the log binary checker
-                    break;
-                }
+static esp_err_t _sdlog_conv_ckpt_load(const char *ckpt_path, sdlog_conv_ckpt_t *p_ckpt, sdlog_exporter_para_t *p_para, uint32_t exporter, uint32_t out_len)
+{
+    FILE *fp = fopen(ckpt_path, "rb");
+    if (fp == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
 
-                // Read fmt, retrieve the exporter pointer, and check whether the format is supported
-                step++;
-                uint32_t fmt                 = sdlog_header.fmt;
-                sdlog_exporter_t *p_exporter = &sdlog_exporter[sdlog_conv_def_exporter[fmt]];
-                if ((p_exporter->bmp_fmt_supported & (1 << fmt)) == 0) {
-                    break;
-                }
+    esp_err_t ret  = ESP_FAIL;
+    uint8_t *p_buf = NULL;
+    do {
+        if (fread(p_ckpt, sizeof(sdlog_conv_ckpt_t), 1, fp) != 1 || strncmp(p_ckpt->magic, SDLOG_CONV_CKPT_MAGIC, sizeof(p_ckpt->magic)) ||
+            p_ckpt->version != 1 || p_ckpt->exporter != exporter || p_ckpt->us_epoch_time != p_para->us_epoch_time) {
+            break;
+        }
 
-                // Generate the output filename
-                step++;
-                char *last_slash = strrchr(msg.log_path, '/');
-                if (last_slash == NULL) {
-                    break;
-                }
-                char full_path[256];
-                size_t dir_len = last_slash - msg.log_path + 1; // calculate the dir length (including last '/')
-                if (dir_len < sizeof(msg.log_path)) {
-                    memcpy(full_path, msg.log_path, dir_len); // copy the directory path
-                    full_path[dir_len] = '\0';
-                    strcat(full_path, p_exporter->fn_output); // append the filename
-                }
+        sdlog_data_t rec;
+        uint32_t rec_sz = sizeof(sdlog_data_t) + (p_ckpt->rec_last.payload_len + 7) / 8 * 8;
+        if (p_ckpt->in_offset < sizeof(sdlog_header_t) + rec_sz || p_ckpt->in_offset > p_para->in_size ||
+            out_len != p_ckpt->out_offset + p_ckpt->nl_pending ||
+            fseek(p_para->fp_in, p_ckpt->in_offset - rec_sz, SEEK_SET) != 0 || fread(&rec, sizeof(rec), 1, p_para->fp_in) != 1 ||
+            memcmp(&rec, &p_ckpt->rec_last, sizeof(rec))) {
+            break;
+        }
 
-                // Open the output file & allocate file buffer
-                step++;
-                if ((fp_out = fopen(full_path, "wb")) == NULL) {
-                    break;
-                }
+        uint32_t i;
+        for (i = 0; i < p_ckpt->fmt_num; i++) {
+            uint32_t len;
+            if (fread(&len, sizeof(len), 1, fp) != 1 || len > SDLOG_CONV_TEXT_BUF_SZ ||
+                (p_buf == NULL && (p_buf = malloc(SDLOG_CONV_TEXT_BUF_SZ)) == NULL) || fread(p_buf, 1, len, fp) != len) {
+                break;
+            }
+            sdlog_fmt_table_add(&p_para->fmt_table, p_buf, len);
+        }
+        if (i != p_ckpt->fmt_num) {
+            sdlog_fmt_table_free(&p_para->fmt_table);
+            break;
+        }
 
-                // set the output file buffer
-                step++;
-                iobuf_out = malloc(SDLOG_CONV_FILE_BUF_SZ);
-                if (iobuf_out) {
-                    setvbuf(fp_out, iobuf_out, _IOFBF, SDLOG_CONV_FILE_BUF_SZ); // set the wbuf of the FILE*, it writes to the SD card every 4KB
-                }
+        p_para->in_begin   = p_ckpt->in_offset;
+        p_para->nl_pending = p_ckpt->nl_pending;
+        p_para->rec_last   = p_ckpt->rec_last;
+        ret                = ESP_OK;
+    } while (0);
 
-                // Call the converter API
-                step++;
-                uint64_t conv_begin = esp_timer_get_time();
+    free(p_buf);
+    fclose(fp);
+    return ret;
+}
 
-                esp_err_t conv_result = p_exporter->cb(&(sdlog_exporter_para_t){
-                    .fp_in         = fp_in,
-                    .fp_out        = fp_out,
-                    .us_epoch_time = sdlog_header.us_epoch_time,
-                    .us_sys_time   = sdlog_header.us_sys_time,
-                });
+// the length of the checkpoint, 0 if it couldn't be written
+static uint32_t _sdlog_conv_ckpt_save(const char *ckpt_path, const sdlog_exporter_para_t *p_para, uint32_t exporter, uint32_t out_offset)
+{
+    sdlog_conv_ckpt_t ckpt = {
+        .magic         = SDLOG_CONV_CKPT_MAGIC,
+        .version       = 1,
+        .exporter      = exporter,
+        .us_epoch_time = p_para->us_epoch_time,
+        .in_offset     = p_para->in_pos,
+        .out_offset    = out_offset,
+        .nl_pending    = p_para->nl_pending,
+        .fmt_num       = p_para->fmt_table.num,
+        .rec_last      = p_para->rec_last,
+    };
+    for (uint32_t i = p_para->sync_num; i > 0; i--) { // the exporter may have stopped before the end of the sync scan
+        if (p_para->p_sync[i - 1].us_sys_time <= p_para->rec_last.us_sys_time) {
+            ckpt.sync = p_para->p_sync[i - 1];
+            break;
+        }
+    }
 
-                conv_time = esp_timer_get_time() - conv_begin;
-                if (conv_result != ESP_OK) {
-                    break;
-                }
+    FILE *fp = fopen(ckpt_path, "wb");
+    if (fp == NULL) {
+        return 0;
+    }
+    fwrite(&ckpt, sizeof(ckpt), 1, fp);
+    for (uint32_t i = 0; i < p_para->fmt_table.num; i++) {
+        const sdlog_fmt_entry_t *p_entry = &p_para->fmt_table.p_entry[i];
+        uint32_t str_len                 = strlen(p_entry->fmt);
+        uint32_t len                     = sizeof(p_entry->id) + str_len;
+        fwrite(&len, sizeof(len), 1, fp);
+        fwrite(&p_entry->id, sizeof(p_entry->id), 1, fp);
+        fwrite(p_entry->fmt, 1, str_len, fp);
+    }
+    uint32_t ckpt_len = ferror(fp) ? 0 : ftell(fp);
+    fclose(fp);
+    if (ckpt_len == 0) {
+        remove(ckpt_path);
+    }
+    return ckpt_len;
+}
 
-                step = 0; // success, set step to 0
-            } while (0);
+static esp_err_t _sdlog_conv_run(const char *log_path, uint32_t exporter, sdlog_conv_job_t *p_job)
+{
+    uint32_t step      = 1;
+    uint64_t conv_time = 0;
+    FILE *fp_in        = NULL;
+    FILE *fp_out       = NULL;
+    void *iobuf_in     = NULL;
+    void *iobuf_out    = NULL;
+    void *p_sync       = NULL;
+    void *p_rec_buf    = NULL;
+    char full_path[256];
+    char ckpt_path[256];
+    int64_t out_len_old          = 0; // the output is rewritten, the retention is told the difference
+    int64_t ckpt_len_old         = 0;
+    sdlog_exporter_t *p_exporter = NULL;
+    sdlog_exporter_para_t para   = {.p_job = p_job};
+    sdlog_conv_ckpt_t ckpt;
+    uint32_t resume = 0;
+    do {
+        sdlog_header_sys_t sdlog_header;
 
-            // clean up resources
-            if (fp_in) {
-                fclose(fp_in);
-                fp_in = NULL;
-            }
-            if (fp_out) {
-                fclose(fp_out);
-                fp_out = NULL;
-            }
-            if (iobuf_in) {
-                free(iobuf_in);
-                iobuf_in = NULL;
+        // Open the binary file
+        step++;
+        if ((fp_in = fopen(log_path, "rb")) == NULL) {
+            break;
+        }
+        iobuf_in = sdlog_pool_get(SDLOG_POOL_CONV);
+        if (iobuf_in) {
+            setvbuf(fp_in, iobuf_in, _IOFBF, SDLOG_CONV_FILE_BUF_SZ); // set the wbuf of the FILE*, it writes to the SD card every 4KB
+        }
+
+        // Read whole header image locally,
+        step++;
+        if (fread(&sdlog_header, 1, sizeof(sdlog_header), fp_in) != sizeof(sdlog_header)) {
+            break;
+        }
+
+        if (strcmp(sdlog_header.magic, "QQMLAB")) {
+            ESP_LOGW(TAG, "LOG header check fail"); // TODO: strengthen the log binary checker
+            break;
+        }
+
+        // Read fmt, retrieve the exporter pointer, and check whether the format is supported
+        step++;
+        uint32_t fmt = sdlog_header.fmt;
+        if (fmt >= sizeof(sdlog_conv_def_exporter) / sizeof(sdlog_conv_def_exporter[0])) {
+            break;
+        }
+        if (exporter >= SDLOG_EXPORTER_NUM) {
+            exporter = sdlog_conv_def_exporter[fmt];
+        }
+        p_exporter = &sdlog_exporter[exporter];
+        if ((p_exporter->bmp_fmt_supported & (1 << fmt)) == 0) {
+            break;
+        }
+        if (p_job) {
+            p_job->exporter_name = p_exporter->name;
+        }
+
+        // Generate the output filename
+        step++;
+        char *last_slash = strrchr(log_path, '/');
+        if (last_slash == NULL) {
+            break;
+        }
+        size_t dir_len = last_slash - log_path + 1; // calculate the dir length (including last '/')
+        if (dir_len + 1 + strlen(p_exporter->fn_output) + strlen(SDLOG_CONV_CKPT_EXT) >= sizeof(full_path)) {
+            break;
+        }
+        memcpy(full_path, log_path, dir_len); // copy the directory path
+        full_path[dir_len] = '\0';
+        strcat(full_path, p_exporter->fn_output); // append the filename
+        snprintf(ckpt_path, sizeof(ckpt_path), "%.*s.%s" SDLOG_CONV_CKPT_EXT, (int)dir_len, log_path, p_exporter->fn_output);
+
+        // Resume from the checkpoint of a single pass exporter, or rebuild the output
+        struct stat st;
+        para.fp_in         = fp_in;
+        para.us_epoch_time = sdlog_header.us_epoch_time;
+        para.us_sys_time   = sdlog_header.us_sys_time;
+        para.in_size       = (fstat(fileno(fp_in), &st) == 0) ? st.st_size : 0;
+        para.in_begin      = sizeof(sdlog_header_t);
+        out_len_old        = (stat(full_path, &st) == 0) ? st.st_size : 0;
+        ckpt_len_old       = (stat(ckpt_path, &st) == 0) ? st.st_size : 0;
+        if (p_exporter->passes == 1 && ckpt_len_old) {
+            resume = (_sdlog_conv_ckpt_load(ckpt_path, &ckpt, &para, exporter, out_len_old) == ESP_OK);
+        }
+        if (!resume && ckpt_len_old && remove(ckpt_path) == 0) {
+            sdlog_retention_account(ckpt_path, -ckpt_len_old);
+            ckpt_len_old = 0;
+        }
+
+        // Open the output file & allocate file buffer
+        step++;
+        if ((fp_out = fopen(full_path, resume ? "r+b" : "wb")) == NULL) {
+            break;
+        }
+        if (resume && fseek(fp_out, ckpt.out_offset, SEEK_SET) != 0) {
+            break;
+        }
+
+        // set the output file buffer
+        step++;
+        iobuf_out = sdlog_pool_get(SDLOG_POOL_CONV);
+        if (iobuf_out) {
+            setvbuf(fp_out, iobuf_out, _IOFBF, SDLOG_CONV_FILE_BUF_SZ); // set the wbuf of the FILE*, it writes to the SD card every 4KB
+        }
+
+        // Call the converter API
+        step++;
+        uint64_t conv_begin = esp_timer_get_time();
+
+        if ((p_rec_buf = sdlog_pool_get(SDLOG_POOL_REC)) == NULL) {
+            break;
+        }
+        para.fp_out    = fp_out;
+        para.fmt       = fmt;
+        para.p_payload = p_rec_buf;
+        para.p_text    = (char *)p_rec_buf + SDLOG_CONV_REC_SZ - SDLOG_CONV_TEXT_BUF_SZ;
+        para.pass_num  = 1 + p_exporter->passes; // the sync scan reads the log too
+        uint32_t seed = (resume && ckpt.sync.us_sys_time) ? 1 : 0;
+        if ((p_sync = sdlog_pool_get(SDLOG_POOL_SYNC)) != NULL) {
+            memcpy(p_sync, &ckpt.sync, seed * sizeof(sdlog_time_sync_t));
+            para.p_sync   = p_sync;
+            para.sync_num = _sdlog_conv_sync_scan(&para, p_sync, seed);
+        } else {
+            para.p_sync   = &ckpt.sync;
+            para.sync_num = seed;
+            para.pass_num--;
+        }
+
+        esp_err_t conv_result = p_exporter->cb(&para);
+
+        conv_time = esp_timer_get_time() - conv_begin;
+        if (para.rec_skip) {
+            ESP_LOGW(TAG, "%s: %" PRIu32 " records skipped, unknown type or size", p_exporter->name, para.rec_skip);
+        }
+        if (p_exporter->passes == 1 && para.in_pos > sizeof(sdlog_header_t) &&
+            (conv_result == ESP_OK || (p_job && p_job->abort != SDLOG_CONV_ABORT_NONE))) {
+            fflush(fp_out);
+            int64_t ckpt_len = _sdlog_conv_ckpt_save(ckpt_path, &para, exporter, ftell(fp_out) - para.nl_pending);
+            sdlog_retention_account(ckpt_path, ckpt_len - ckpt_len_old);
+        }
+        if (conv_result != ESP_OK) {
+            break;
+        }
+
+        step = 0; // success, set step to 0
+    } while (0);
+
+    // clean up resources
+    if (fp_in) {
+        fclose(fp_in);
+        fp_in = NULL;
+    }
+    if (fp_out) {
+        int64_t out_len = ftell(fp_out);
+        fclose(fp_out);
+        fp_out = NULL;
+        if (p_job && p_job->abort != SDLOG_CONV_ABORT_NONE && p_exporter->passes > 1 && remove(full_path) == 0) {
+            out_len = 0; // the output is rebuilt from the beginning, don't leave a partial one
+        }
+        sdlog_retention_account(full_path, out_len - out_len_old);
+    }
+    sdlog_pool_put(SDLOG_POOL_CONV, iobuf_in);
+    iobuf_in = NULL;
+    sdlog_pool_put(SDLOG_POOL_CONV, iobuf_out);
+    iobuf_out = NULL;
+    sdlog_pool_put(SDLOG_POOL_SYNC, p_sync);
+    sdlog_pool_put(SDLOG_POOL_REC, p_rec_buf);
+    sdlog_fmt_table_free(&para.fmt_table);
+    ESP_LOGI(TAG, "sdlog_conv_file(), fn=%s, status=%s(%" PRIu32 ") conv_time=%" PRIu64 " from=%" PRIu32, log_path, (step == 0) ? "Success" : "Fail", step, conv_time, para.in_begin);
+
+    return (step == 0) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t sdlog_conv_file(const char *log_path, uint32_t exporter)
+{
+    return _sdlog_conv_run(log_path, exporter, NULL);
+}
+
+// ----------
+// Job table
+// ----------
+static uint32_t _sdlog_conv_job_active(const sdlog_conv_job_t *p_job)
+{
+    return p_job->state == SDLOG_CONV_STATE_QUEUED || p_job->state == SDLOG_CONV_STATE_RUNNING;
+}
+
+// a consistent copy of job[idx] without blocking, ESP_ERR_TIMEOUT if SDLOG_CONV task is in the middle of a rewrite
+static esp_err_t _sdlog_conv_job_try_read(uint32_t idx, sdlog_conv_job_t *p_copy)
+{
+    const sdlog_conv_job_t *p_job = &sdlog_conv_ctrl.job[idx];
+    for (uint32_t retry = 0; retry < SDLOG_CONV_READ_RETRY; retry++) {
+        uint32_t seq = __atomic_load_n(&p_job->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            continue;
+        }
+        memcpy(p_copy, p_job, sizeof(*p_copy));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&p_job->seq, __ATOMIC_RELAXED) == seq) {
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_TIMEOUT;
+}
+
+// a consistent copy of job[idx], for the tasks other than SDLOG_CONV, may sleep
+static void _sdlog_conv_job_read(uint32_t idx, sdlog_conv_job_t *p_copy)
+{
+    while (_sdlog_conv_job_try_read(idx, p_copy) != ESP_OK) {
+        vTaskDelay(1); // SDLOG_CONV task was preempted in the middle of the rewrite, let it finish
+    }
+}
+
+// sends a SUBMIT, counted until SDLOG_CONV task has it in the job table
+static BaseType_t _sdlog_conv_submit_send(const sdlog_conv_task_msg_t *p_msg)
+{
+    __atomic_fetch_add(&sdlog_conv_ctrl.submit_pending, 1, __ATOMIC_RELAXED);
+    if (xQueueSend(sdlog_conv_task_msgq, p_msg, 0) != pdPASS) { // block time = 0
+        __atomic_fetch_sub(&sdlog_conv_ctrl.submit_pending, 1, __ATOMIC_RELAXED);
+        return pdFAIL;
+    }
+    return pdPASS;
+}
+
+// the ID of the queued/running job of log_path/exporter, 0 if none, p_prio gets its priority
+// never blocks, sdlog_conv_trig() is called by SDLOG task: a slot being rewritten is skipped, SDLOG_CONV task merges
+static uint32_t _sdlog_conv_job_find_id(const char *log_path, uint32_t exporter, uint32_t *p_prio)
+{
+    sdlog_conv_job_t job;
+    for (uint32_t i = 0; i < SDLOG_CONV_JOB_MAX; i++) {
+        if (_sdlog_conv_job_try_read(i, &job) != ESP_OK) {
+            continue;
+        }
+        if (_sdlog_conv_job_active(&job) && job.exporter == exporter && strncmp(job.log_path, log_path, sizeof(job.log_path)) == 0) {
+            *p_prio = job.prio;
+            return job.id;
+        }
+    }
+    return 0;
+}
+
+// SDLOG_CONV task only
+static sdlog_conv_job_t *_sdlog_conv_job_find(const char *log_path, uint32_t exporter)
+{
+    for (uint32_t i = 0; i < SDLOG_CONV_JOB_MAX; i++) {
+        sdlog_conv_job_t *p_job = &sdlog_conv_ctrl.job[i];
+        if (_sdlog_conv_job_active(p_job) && p_job->exporter == exporter && strncmp(p_job->log_path, log_path, sizeof(p_job->log_path)) == 0) {
+            return p_job;
+        }
+    }
+    return NULL;
+}
+
+// the highest priority queued job, the oldest of them
+static sdlog_conv_job_t *_sdlog_conv_job_next(void)
+{
+    sdlog_conv_job_t *p_next = NULL;
+    for (uint32_t i = 0; i < SDLOG_CONV_JOB_MAX; i++) {
+        sdlog_conv_job_t *p_job = &sdlog_conv_ctrl.job[i];
+        if (p_job->state == SDLOG_CONV_STATE_QUEUED &&
+            (p_next == NULL || p_job->prio > p_next->prio || (p_job->prio == p_next->prio && p_job->id < p_next->id))) {
+            p_next = p_job;
+        }
+    }
+    return p_next;
+}
+
+// a free slot, or the oldest finished job
+static sdlog_conv_job_t *_sdlog_conv_job_alloc(void)
+{
+    sdlog_conv_job_t *p_old = NULL;
+    for (uint32_t i = 0; i < SDLOG_CONV_JOB_MAX; i++) {
+        sdlog_conv_job_t *p_job = &sdlog_conv_ctrl.job[i];
+        if (p_job->state == SDLOG_CONV_STATE_FREE) {
+            return p_job;
+        }
+        if (!_sdlog_conv_job_active(p_job) && (p_old == NULL || p_job->id < p_old->id)) {
+            p_old = p_job;
+        }
+    }
+    return p_old;
+}
+
+static void _sdlog_conv_task_submit(const sdlog_conv_task_msg_t *p_msg)
+{
+    sdlog_conv_job_t *p_job;
+
+    if ((p_job = _sdlog_conv_job_find(p_msg->log_path, p_msg->exporter)) != NULL) {
+        if (p_msg->prio > p_job->prio) {
+            _sdlog_conv_job_write_begin(p_job);
+            p_job->prio = p_msg->prio; // a USER request of a queued AUTO job, it isn't preempted any more
+            _sdlog_conv_job_write_end(p_job);
+        }
+        return;
+    }
+    if ((p_job = _sdlog_conv_job_alloc()) == NULL) {
+        ESP_LOGW(TAG, "job table full, %s dropped", p_msg->log_path);
+        return;
+    }
+    _sdlog_conv_job_write_begin(p_job);
+    uint32_t seq = p_job->seq;
+    memset(p_job, 0, sizeof(sdlog_conv_job_t)); // seq restored below, still odd
+    strlcpy(p_job->log_path, p_msg->log_path, sizeof(p_job->log_path));
+    p_job->seq      = seq;
+    p_job->prio     = p_msg->prio;
+    p_job->exporter = p_msg->exporter;
+    p_job->id       = p_msg->id;
+    p_job->state    = SDLOG_CONV_STATE_QUEUED;
+    _sdlog_conv_job_write_end(p_job);
+}
+
+static void _sdlog_conv_task_msg(const sdlog_conv_task_msg_t *p_msg)
+{
+    sdlog_conv_job_t *p_job;
+
+    if (p_msg->op == SDLOG_CONV_OP_CANCEL) {
+        for (uint32_t i = 0; i < SDLOG_CONV_JOB_MAX; i++) {
+            p_job = &sdlog_conv_ctrl.job[i];
+            if (p_job->id != p_msg->id) {
+                continue;
             }
-            if (iobuf_out) {
-                free(iobuf_out);
-                iobuf_out = NULL;
+            _sdlog_conv_job_write_begin(p_job);
+            if (p_job->state == SDLOG_CONV_STATE_QUEUED) {
+                p_job->state = SDLOG_CONV_STATE_CANCELED;
+            } else if (p_job->state == SDLOG_CONV_STATE_RUNNING) {
+                p_job->abort = SDLOG_CONV_ABORT_CANCEL;
             }
-            ESP_LOGI(TAG, "sdlog_conv_task(), fn=%s, status=%s(%d) conv_time=%lld", msg.log_path, (step == 0) ? "Success" : "Fail", step, conv_time);
+            _sdlog_conv_job_write_end(p_job);
+        }
+        return;
+    }
+
+    _sdlog_conv_task_submit(p_msg);
+    __atomic_fetch_sub(&sdlog_conv_ctrl.submit_pending, 1, __ATOMIC_RELEASE); // after the slot is written
+}
+
+static void _sdlog_conv_job_run(sdlog_conv_job_t *p_job)
+{
+    _sdlog_conv_job_write_begin(p_job);
+    p_job->abort     = SDLOG_CONV_ABORT_NONE;
+    p_job->pct       = 0;
+    p_job->rec       = 0;
+    p_job->rec_per_s = 0;
+    p_job->eta_s     = 0;
+    p_job->us_yield  = 0;
+    p_job->us_begin  = esp_timer_get_time();
+    p_job->state     = SDLOG_CONV_STATE_RUNNING;
+    _sdlog_conv_job_write_end(p_job);
+
+    esp_err_t ret = _sdlog_conv_run(p_job->log_path, p_job->exporter, p_job);
+
+    _sdlog_conv_job_write_begin(p_job);
+    if (p_job->abort == SDLOG_CONV_ABORT_PREEMPT) {
+        ESP_LOGI(TAG, "job %" PRIu32 " preempted at %" PRIu32 "%%", p_job->id, p_job->pct);
+        p_job->preempted++;
+        p_job->state = SDLOG_CONV_STATE_QUEUED;
+    } else if (p_job->abort == SDLOG_CONV_ABORT_CANCEL) {
+        ESP_LOGI(TAG, "job %" PRIu32 " canceled at %" PRIu32 "%%", p_job->id, p_job->pct);
+        p_job->state = SDLOG_CONV_STATE_CANCELED;
+    } else if (ret == ESP_OK) {
+        p_job->pct   = 100;
+        p_job->eta_s = 0;
+        p_job->state = SDLOG_CONV_STATE_DONE;
+    } else {
+        p_job->state = SDLOG_CONV_STATE_FAIL;
+    }
+    _sdlog_conv_job_write_end(p_job);
+}
+
+static void sdlog_conv_task(void *param)
+{
+    sdlog_conv_task_msg_t msg;
+
+    while (1) {
+        while (xQueueReceive(sdlog_conv_task_msgq, &msg, 0) == pdPASS) {
+            _sdlog_conv_task_msg(&msg);
+        }
+
+        sdlog_conv_job_t *p_job = _sdlog_conv_job_next();
+        if (p_job) {
+            _sdlog_conv_job_run(p_job);
+        } else if (xQueueReceive(sdlog_conv_task_msgq, &msg, portMAX_DELAY) == pdPASS) {
+            _sdlog_conv_task_msg(&msg);
         }
     }
 }
@@ -307,22 +1306,108 @@ void sdlog_conv_task_init(void)
     assert(sdlog_conv_task_msgq);
 
     // sdlog_conv_task_msg_t
-    BaseType_t xReturned = xTaskCreate(
-        sdlog_conv_task, // Function pointer
-        "SDLOG_CONV",    // Task name
-        4096,            // 4096 words (16KB), we will have a lot of large data transfer in the task, enlarge it
-        (void *)0,       // Parameter passed into the task
-        2,               // Priority (FIXME: where can I find the priority table)
-        NULL);           // Task Hanlde, if no need, passes NULL
+    task_create(TASK_ID_SDLOG_CONV, sdlog_conv_task, NULL, NULL);
+}
+
+uint32_t sdlog_conv_trig(const char *path, uint32_t exporter, uint32_t prio)
+{
+    // SDLOG_CONV task checks it again, a duplicate still in the queue is merged there and its ID is never listed
+    uint32_t job_prio;
+    uint32_t job_id = _sdlog_conv_job_find_id(path, exporter, &job_prio);
+    if (job_id) {
+        if (prio > job_prio) {
+            sdlog_conv_task_msg_t msg = {.op = SDLOG_CONV_OP_SUBMIT, .id = job_id, .prio = prio, .exporter = exporter};
+            strlcpy(msg.log_path, path, sizeof(msg.log_path));
+            _sdlog_conv_submit_send(&msg);
+        }
+        return job_id;
+    }
+
+    sdlog_conv_job_t job;
+    uint32_t active = uxQueueMessagesWaiting(sdlog_conv_task_msgq);
+    for (uint32_t i = 0; i < SDLOG_CONV_JOB_MAX; i++) {
+        active += (_sdlog_conv_job_try_read(i, &job) != ESP_OK) || _sdlog_conv_job_active(&job); // busy: a new job
+    }
+
+    sdlog_conv_task_msg_t msg = {
+        .op       = SDLOG_CONV_OP_SUBMIT,
+        .id       = __atomic_add_fetch(&sdlog_conv_ctrl.id_last, 1, __ATOMIC_RELAXED),
+        .prio     = prio,
+        .exporter = exporter,
+    };
+    strlcpy(msg.log_path, path, sizeof(msg.log_path));
+    if (active >= SDLOG_CONV_JOB_MAX || _sdlog_conv_submit_send(&msg) != pdPASS) {
+        ESP_LOGW(TAG, "conversion queue full, %s dropped", path);
+        return 0;
+    }
+    return msg.id;
+}
 
-    if (xReturned != pdPASS) {
-        ESP_LOGE("SDLOG CONV TASK", "Failed to create task!");
+esp_err_t sdlog_conv_cancel(uint32_t id)
+{
+    sdlog_conv_job_t job;
+    uint32_t i;
+    for (i = 0; i < SDLOG_CONV_JOB_MAX; i++) {
+        _sdlog_conv_job_read(i, &job);
+        if (job.id == id && _sdlog_conv_job_active(&job)) {
+            break;
+        }
+    }
+    if (id == 0 || i == SDLOG_CONV_JOB_MAX) {
+        return ESP_ERR_NOT_FOUND;
     }
+
+    sdlog_conv_task_msg_t msg = {.op = SDLOG_CONV_OP_CANCEL, .id = id};
+    return (xQueueSend(sdlog_conv_task_msgq, &msg, 0) == pdPASS) ? ESP_OK : ESP_FAIL;
 }
 
-void sdlog_conv_trig(char *path)
+// a job queued or running on a file of dir_path (a session folder), or one not in the job table yet
+uint32_t sdlog_conv_dir_busy(const char *dir_path)
 {
-    sdlog_conv_task_msg_t msg;
-    strlcpy(msg.log_path, path, sizeof(msg.log_path));
-    xQueueSend(sdlog_conv_task_msgq, &msg, 0); // block time = 0
+    if (__atomic_load_n(&sdlog_conv_ctrl.submit_pending, __ATOMIC_ACQUIRE)) {
+        return 1;
+    }
+    sdlog_conv_job_t job;
+    size_t len = strlen(dir_path);
+    for (uint32_t i = 0; i < SDLOG_CONV_JOB_MAX; i++) {
+        _sdlog_conv_job_read(i, &job);
+        if (_sdlog_conv_job_active(&job) && strncmp(job.log_path, dir_path, len) == 0 && job.log_path[len] == '/') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// ----------
+// WEBUI API
+// ----------
+uint32_t sdlog_conv_job_num(void)
+{
+    return SDLOG_CONV_JOB_MAX;
+}
+
+void sdlog_conv_webui_query(uint32_t idx, sdlog_conv_webui_status_t *p_status)
+{
+    memset(p_status, 0, sizeof(sdlog_conv_webui_status_t));
+    if (idx >= SDLOG_CONV_JOB_MAX) {
+        return;
+    }
+
+    sdlog_conv_job_t job;
+    const sdlog_conv_job_t *p_job = &job;
+    _sdlog_conv_job_read(idx, &job);
+    if (job.state == SDLOG_CONV_STATE_FREE) {
+        return;
+    }
+    strlcpy(p_status->log_path, p_job->log_path, sizeof(p_status->log_path));
+    p_status->id        = p_job->id;
+    p_status->state     = p_job->state;
+    p_status->prio      = p_job->prio;
+    p_status->exporter  = (p_job->exporter < SDLOG_EXPORTER_NUM) ? sdlog_exporter[p_job->exporter].name : p_job->exporter_name;
+    p_status->pct       = p_job->pct;
+    p_status->rec       = p_job->rec;
+    p_status->rec_per_s = p_job->rec_per_s;
+    p_status->eta_s     = p_job->eta_s;
+    p_status->preempted = p_job->preempted;
+    p_status->ms_yield  = p_job->us_yield / 1000;
 }
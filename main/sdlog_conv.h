@@ -1,16 +1,61 @@
 #ifndef __SDLOG_CONV_H__
 #define __SDLOG_CONV_H__
 
+#include "esp_err.h"
 #include "sdlog_service_private.h"
 
 enum sdlog_exporter_e {
-#define SDLOG_EXPORTER_REG(_name, _bmp_fmt_supported, _fn_output, _cb) SDLOG_EXPORTER_##_name,
+#define SDLOG_EXPORTER_REG(_name, _bmp_fmt_supported, _fn_output, _passes, _cb) SDLOG_EXPORTER_##_name,
 #include "sdlog_exporter_reg.h"
 #undef SDLOG_EXPORTER_REG
-    SDLOG_EXPORTER_NUM,
+    SDLOG_EXPORTER_NUM,  // not an exporter, sdlog_conv_exporter_find() of an unknown name
+    SDLOG_EXPORTER_AUTO, // pick the default exporter of the log format
+};
+
+// ----------
+// Conversion jobs of SDLOG_CONV task
+// ----------
+// The highest priority queued job runs first, FIFO within a priority. A USER job preempts a running AUTO job, the
+// AUTO job is queued again. A request for a log/exporter already queued or running gets the ID of that job
+enum sdlog_conv_prio_e {
+    SDLOG_CONV_PRIO_AUTO = 0, // the log was closed (SDLOG_CONV_ON_CLOSE)
+    SDLOG_CONV_PRIO_USER = 1, // /log_conv
+};
+
+enum sdlog_conv_state_e {
+    SDLOG_CONV_STATE_FREE = 0,
+    SDLOG_CONV_STATE_QUEUED,
+    SDLOG_CONV_STATE_RUNNING,
+    SDLOG_CONV_STATE_DONE,
+    SDLOG_CONV_STATE_FAIL,
+    SDLOG_CONV_STATE_CANCELED,
 };
 
 void sdlog_conv_task_init(void);
-void sdlog_conv_trig(char *path);
+uint32_t sdlog_conv_trig(const char *path, uint32_t exporter, uint32_t prio); // job ID, 0 if the job table is full
+esp_err_t sdlog_conv_cancel(uint32_t id);                                      // ESP_ERR_NOT_FOUND if not queued/running
+esp_err_t sdlog_conv_file(const char *log_path, uint32_t exporter);            // convert synchronously in the caller's context
+uint32_t sdlog_conv_exporter_find(const char *name);                           // SDLOG_EXPORTER_NUM if not found
+uint32_t sdlog_conv_dir_busy(const char *dir_path);                            // a job queued/running on a file under the folder
+
+// ----------
+// WEBUI API
+// ----------
+typedef struct sdlog_conv_webui_status_s {
+    uint32_t id; // 0: free slot
+    uint32_t state;
+    uint32_t prio;
+    const char *exporter; // NULL until the job runs if SDLOG_EXPORTER_AUTO
+    char log_path[64];
+    uint32_t pct;       // input bytes read, all the passes of the exporter
+    uint32_t rec;       // records read
+    uint32_t rec_per_s;
+    uint32_t eta_s;
+    uint32_t preempted; // times a USER job took over
+    uint32_t ms_yield;  // time left to the live logging (sdlog_backlog())
+} sdlog_conv_webui_status_t;
+
+uint32_t sdlog_conv_job_num(void);
+void sdlog_conv_webui_query(uint32_t idx, sdlog_conv_webui_status_t *p_status);
 
 #endif // __SDLOG_CONV_H__
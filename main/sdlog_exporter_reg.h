@@ -1,2 +1,5 @@
-SDLOG_EXPORTER_REG(TEXT, (1 << SDLOG_FMT_TEXT), "log.txt", sdlog_exporter_text)
-SDLOG_EXPORTER_REG(CAN, (1 << SDLOG_FMT_CAN), "candump.txt", sdlog_exporter_can)
+SDLOG_EXPORTER_REG(TEXT, (1 << SDLOG_FMT_TEXT), "log.txt", 1, sdlog_exporter_line)
+SDLOG_EXPORTER_REG(CAN, (1 << SDLOG_FMT_CAN), "candump.txt", 1, sdlog_exporter_line)
+SDLOG_EXPORTER_REG(CANCOL, (1 << SDLOG_FMT_CAN), "cancol.bin", 2, sdlog_exporter_can_col)
+SDLOG_EXPORTER_REG(ADCBIN, (1 << SDLOG_FMT_ADC), "adc.bin", 1, sdlog_exporter_adc_bin)
+SDLOG_EXPORTER_REG(ADCCSV, (1 << SDLOG_FMT_ADC), "adc.csv", 1, sdlog_exporter_adc_csv)
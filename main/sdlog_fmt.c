@@ -0,0 +1,456 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "sdlog_fmt.h"
+#include "sdlog_header.h"
+
+// Shared by the firmware (writer and exporters) and the host decoders, no ESP-IDF dependency
+
+// ----------
+// Conversion specification parser
+// ----------
+enum {
+    SDLOG_FMT_SPEC_PCT = 0, // "%%"
+    SDLOG_FMT_SPEC_I32,
+    SDLOG_FMT_SPEC_I64,
+    SDLOG_FMT_SPEC_DBL,
+    SDLOG_FMT_SPEC_STR,
+    SDLOG_FMT_SPEC_PTR,
+    SDLOG_FMT_SPEC_BAD,
+};
+
+#define SDLOG_FMT_SPEC_LEN_MAX (24) // a longer conversion spec is not deferred
+
+typedef struct sdlog_fmt_spec_s {
+    uint32_t cls;       // SDLOG_FMT_SPEC_xxx
+    uint32_t is_signed; // d/i
+    uint32_t star_num;  // '*' of the width and the precision, in this order
+    uint32_t star_prec; // the precision is a '*'
+    int32_t prec;       // literal precision, -1 if none
+    char lmod;          // length modifier: 0, 'h' (h/hh), 'l', 'L' (ll), 'j', 'z', 't'
+} sdlog_fmt_spec_t;
+
+// p points to the '%', returns the position after the conversion
+static const char *_sdlog_fmt_spec(const char *p, sdlog_fmt_spec_t *p_spec)
+{
+    const char *p_begin = p++;
+    memset(p_spec, 0, sizeof(*p_spec));
+    p_spec->prec = -1;
+
+    while (*p && strchr("-+ #0", *p)) { // flags
+        p++;
+    }
+    if (*p == '*') { // width
+        p_spec->star_num++;
+        p++;
+    } else {
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+    if (*p == '.') { // precision
+        p++;
+        if (*p == '*') {
+            p_spec->star_num++;
+            p_spec->star_prec = 1;
+            p++;
+        } else {
+            p_spec->prec = 0;
+            while (*p >= '0' && *p <= '9') {
+                p_spec->prec = p_spec->prec * 10 + (*p++ - '0');
+            }
+        }
+    }
+
+    switch (*p) { // length modifier
+    case 'h':
+        p_spec->lmod = 'h';
+        p += (p[1] == 'h') ? 2 : 1;
+        break;
+    case 'l':
+        p_spec->lmod = (p[1] == 'l') ? 'L' : 'l';
+        p += (p[1] == 'l') ? 2 : 1;
+        break;
+    case 'j':
+    case 'z':
+    case 't':
+        p_spec->lmod = *p++;
+        break;
+    case 'L': // long double
+    case 'q':
+        p_spec->cls = SDLOG_FMT_SPEC_BAD;
+        return *p ? p + 1 : p;
+    }
+
+    char conv = *p;
+    if (conv) {
+        p++;
+    }
+    switch (conv) {
+    case 'd':
+    case 'i':
+        p_spec->is_signed = 1;
+        // fall through
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+        p_spec->cls = (p_spec->lmod == 0 || p_spec->lmod == 'h') ? SDLOG_FMT_SPEC_I32 : SDLOG_FMT_SPEC_I64;
+        break;
+    case 'c':
+        p_spec->cls = (p_spec->lmod == 0) ? SDLOG_FMT_SPEC_I32 : SDLOG_FMT_SPEC_BAD; // %lc is a wint_t
+        break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        p_spec->cls = SDLOG_FMT_SPEC_DBL;
+        break;
+    case 's':
+        p_spec->cls = (p_spec->lmod == 0) ? SDLOG_FMT_SPEC_STR : SDLOG_FMT_SPEC_BAD; // %ls is a wchar_t string
+        break;
+    case 'p':
+        p_spec->cls = SDLOG_FMT_SPEC_PTR;
+        break;
+    case '%':
+        p_spec->cls = SDLOG_FMT_SPEC_PCT;
+        break;
+    default: // %n, or the format ends inside the spec
+        p_spec->cls = SDLOG_FMT_SPEC_BAD;
+        break;
+    }
+    if (p - p_begin > SDLOG_FMT_SPEC_LEN_MAX) {
+        p_spec->cls = SDLOG_FMT_SPEC_BAD;
+    }
+    return p;
+}
+
+// ----------
+// Device side, pack the arguments
+// ----------
+static inline int _sdlog_fmt_put(uint8_t *p_out, uint32_t out_sz, uint32_t *p_n, const void *p_data, uint32_t len)
+{
+    if (*p_n + len > out_sz) {
+        return 0;
+    }
+    memcpy(p_out + *p_n, p_data, len);
+    *p_n += len;
+    return 1;
+}
+
+int32_t sdlog_fmt_pack(const char *fmt, va_list args, uint8_t *p_out, uint32_t out_sz)
+{
+    va_list ap;
+    va_copy(ap, args); // the caller still owns args, it falls back to vprintf() with them on failure
+
+    uint32_t n    = 0;
+    int ok        = 1;
+    const char *p = fmt;
+    while (*p && ok) {
+        if (*p != '%') {
+            p++;
+            continue;
+        }
+        sdlog_fmt_spec_t spec;
+        p = _sdlog_fmt_spec(p, &spec);
+
+        int32_t star[2] = {0, 0};
+        for (uint32_t i = 0; i < spec.star_num; i++) {
+            star[i] = va_arg(ap, int);
+            ok      = ok && _sdlog_fmt_put(p_out, out_sz, &n, &star[i], sizeof(int32_t));
+        }
+
+        switch (spec.cls) {
+        case SDLOG_FMT_SPEC_PCT:
+            break;
+        case SDLOG_FMT_SPEC_I32: {
+            int32_t v = va_arg(ap, int);
+            ok        = ok && _sdlog_fmt_put(p_out, out_sz, &n, &v, sizeof(v));
+            break;
+        }
+        case SDLOG_FMT_SPEC_I64: {
+            int64_t v;
+            if (spec.lmod == 'l') {
+                v = spec.is_signed ? (int64_t)va_arg(ap, long) : (int64_t)va_arg(ap, unsigned long);
+            } else if (spec.lmod == 'z') {
+                v = (int64_t)va_arg(ap, size_t);
+            } else if (spec.lmod == 't') {
+                v = (int64_t)va_arg(ap, ptrdiff_t);
+            } else { // ll, j
+                v = (int64_t)va_arg(ap, long long);
+            }
+            ok = ok && _sdlog_fmt_put(p_out, out_sz, &n, &v, sizeof(v));
+            break;
+        }
+        case SDLOG_FMT_SPEC_DBL: {
+            double v = va_arg(ap, double);
+            ok       = ok && _sdlog_fmt_put(p_out, out_sz, &n, &v, sizeof(v));
+            break;
+        }
+        case SDLOG_FMT_SPEC_PTR: {
+            uint64_t v = (uintptr_t)va_arg(ap, void *);
+            ok         = ok && _sdlog_fmt_put(p_out, out_sz, &n, &v, sizeof(v));
+            break;
+        }
+        case SDLOG_FMT_SPEC_STR: {
+            const char *s = va_arg(ap, const char *);
+            if (s == NULL) {
+                s = "(null)";
+            }
+            int32_t prec   = spec.star_prec ? star[spec.star_num - 1] : spec.prec;
+            uint32_t limit = (prec >= 0 && prec < SDLOG_FMT_STR_MAX) ? prec : SDLOG_FMT_STR_MAX; // %.*s may point to a buffer without NUL
+            uint8_t len    = strnlen(s, limit);
+            ok             = ok && _sdlog_fmt_put(p_out, out_sz, &n, &len, 1) && _sdlog_fmt_put(p_out, out_sz, &n, s, len);
+            break;
+        }
+        default:
+            ok = 0;
+            break;
+        }
+    }
+    va_end(ap);
+
+    return ok ? (int32_t)n : -1;
+}
+
+// ----------
+// Decoder side, printf() of the packed arguments
+// ----------
+static inline int _sdlog_fmt_get(const uint8_t *p_arg, uint32_t arg_len, uint32_t *p_pos, void *p_data, uint32_t len)
+{
+    if (*p_pos + len > arg_len) {
+        return 0;
+    }
+    memcpy(p_data, p_arg + *p_pos, len);
+    *p_pos += len;
+    return 1;
+}
+
+uint32_t sdlog_fmt_render(const char *fmt, const uint8_t *p_arg, uint32_t arg_len, char *p_out, uint32_t out_sz)
+{
+    uint32_t n    = 0;
+    uint32_t pos  = 0;
+    const char *p = fmt;
+    while (*p && n + 1 < out_sz) {
+        if (*p != '%') {
+            p_out[n++] = *p++;
+            continue;
+        }
+        const char *p_begin = p;
+        sdlog_fmt_spec_t spec;
+        p = _sdlog_fmt_spec(p, &spec);
+        if (spec.cls == SDLOG_FMT_SPEC_PCT) {
+            p_out[n++] = '%';
+            continue;
+        }
+        if (spec.cls == SDLOG_FMT_SPEC_BAD) { // the writer never packs it, the record is corrupted
+            break;
+        }
+
+        int32_t star[2];
+        int ok = 1;
+        for (uint32_t i = 0; i < spec.star_num; i++) {
+            ok = ok && _sdlog_fmt_get(p_arg, arg_len, &pos, &star[i], sizeof(int32_t));
+        }
+
+        // the same spec with the '*' resolved and the length modifier of the packed width
+        char sp[SDLOG_FMT_SPEC_LEN_MAX + 32];
+        uint32_t k = 0;
+        uint32_t s = 0;
+        for (const char *q = p_begin; q < p - 1; q++) {
+            if (*q == '*') {
+                k += snprintf(sp + k, sizeof(sp) - k, "%" PRId32, (s < spec.star_num) ? star[s] : 0);
+                s++;
+            } else if (!strchr("ljzt", *q)) {
+                sp[k++] = *q;
+            }
+        }
+        if (spec.cls == SDLOG_FMT_SPEC_I64) {
+            sp[k++] = 'l';
+            sp[k++] = 'l';
+        }
+        sp[k++] = p[-1];
+        sp[k]   = '\0';
+
+        uint32_t remaining = out_sz - n;
+        int r              = 0;
+        switch (spec.cls) {
+        case SDLOG_FMT_SPEC_I32: {
+            int32_t v;
+            ok = ok && _sdlog_fmt_get(p_arg, arg_len, &pos, &v, sizeof(v));
+            r  = ok ? snprintf(p_out + n, remaining, sp, (int)v) : 0;
+            break;
+        }
+        case SDLOG_FMT_SPEC_I64: {
+            int64_t v;
+            ok = ok && _sdlog_fmt_get(p_arg, arg_len, &pos, &v, sizeof(v));
+            r  = ok ? snprintf(p_out + n, remaining, sp, (long long)v) : 0;
+            break;
+        }
+        case SDLOG_FMT_SPEC_DBL: {
+            double v;
+            ok = ok && _sdlog_fmt_get(p_arg, arg_len, &pos, &v, sizeof(v));
+            r  = ok ? snprintf(p_out + n, remaining, sp, v) : 0;
+            break;
+        }
+        case SDLOG_FMT_SPEC_PTR: { // newlib prints %p as 0x + hex
+            uint64_t v;
+            ok = ok && _sdlog_fmt_get(p_arg, arg_len, &pos, &v, sizeof(v));
+            r  = ok ? snprintf(p_out + n, remaining, "0x%" PRIx64, v) : 0;
+            break;
+        }
+        case SDLOG_FMT_SPEC_STR: {
+            uint8_t len;
+            char str[256];
+            ok = ok && _sdlog_fmt_get(p_arg, arg_len, &pos, &len, 1) && _sdlog_fmt_get(p_arg, arg_len, &pos, str, len);
+            if (ok) {
+                str[len] = '\0';
+                r        = snprintf(p_out + n, remaining, sp, str);
+            }
+            break;
+        }
+        }
+        if (!ok) { // arguments cut short, the record is corrupted
+            break;
+        }
+        if (r > 0) {
+            n += ((uint32_t)r < remaining) ? (uint32_t)r : remaining - 1;
+        }
+    }
+    p_out[n] = '\0';
+
+    return n;
+}
+
+// ----------
+// String table
+// ----------
+static uint32_t _sdlog_fmt_table_lower(const sdlog_fmt_table_t *p_table, uint32_t id) // first entry with entry.id >= id
+{
+    uint32_t lo = 0;
+    uint32_t hi = p_table->num;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (p_table->p_entry[mid].id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+void sdlog_fmt_table_add(sdlog_fmt_table_t *p_table, const void *payload, uint32_t len)
+{
+    uint32_t id;
+    if (len < sizeof(id)) {
+        return;
+    }
+    memcpy(&id, payload, sizeof(id));
+
+    uint32_t idx = _sdlog_fmt_table_lower(p_table, id);
+    if (idx < p_table->num && p_table->p_entry[idx].id == id) {
+        return; // the writer repeats the entry when its own table is full
+    }
+
+    if (p_table->num == p_table->cap) {
+        uint32_t cap             = p_table->cap ? p_table->cap * 2 : 64;
+        sdlog_fmt_entry_t *p_new = realloc(p_table->p_entry, cap * sizeof(sdlog_fmt_entry_t));
+        if (p_new == NULL) {
+            return;
+        }
+        p_table->p_entry = p_new;
+        p_table->cap     = cap;
+    }
+
+    uint32_t str_len = len - sizeof(id);
+    char *p_fmt      = malloc(str_len + 1);
+    if (p_fmt == NULL) {
+        return;
+    }
+    memcpy(p_fmt, (const uint8_t *)payload + sizeof(id), str_len);
+    p_fmt[str_len] = '\0';
+
+    memmove(&p_table->p_entry[idx + 1], &p_table->p_entry[idx], (p_table->num - idx) * sizeof(sdlog_fmt_entry_t));
+    p_table->p_entry[idx] = (sdlog_fmt_entry_t){
+        .id  = id,
+        .fmt = p_fmt,
+    };
+    p_table->num++;
+}
+
+const char *sdlog_fmt_table_find(const sdlog_fmt_table_t *p_table, uint32_t id)
+{
+    uint32_t idx = _sdlog_fmt_table_lower(p_table, id);
+    return (idx < p_table->num && p_table->p_entry[idx].id == id) ? p_table->p_entry[idx].fmt : NULL;
+}
+
+void sdlog_fmt_table_free(sdlog_fmt_table_t *p_table)
+{
+    for (uint32_t i = 0; i < p_table->num; i++) {
+        free(p_table->p_entry[i].fmt);
+    }
+    free(p_table->p_entry);
+    *p_table = (sdlog_fmt_table_t){0};
+}
+
+uint32_t sdlog_fmt_render_rec(const sdlog_fmt_table_t *p_table, const void *payload, uint32_t len, char *p_out, uint32_t out_sz)
+{
+    uint32_t id = 0;
+    if (len >= sizeof(id)) {
+        memcpy(&id, payload, sizeof(id));
+    }
+    const char *fmt = sdlog_fmt_table_find(p_table, id);
+    if (fmt == NULL || len < sizeof(id)) {
+        int r = snprintf(p_out, out_sz, "<fmt 0x%08" PRIx32 ">", id);
+        return ((uint32_t)r < out_sz) ? (uint32_t)r : out_sz - 1;
+    }
+    return sdlog_fmt_render(fmt, (const uint8_t *)payload + sizeof(id), len - sizeof(id), p_out, out_sz);
+}
+
+// ----------
+// HTTP access record
+// ----------
+static const char *sdlog_fmt_http_uri[] = {
+#define HTTP_URI_REG(_name, _uri, _handler) _uri,
+#include "http_uri_reg.h"
+#undef HTTP_URI_REG
+};
+
+uint32_t sdlog_fmt_render_http(const void *payload, uint32_t len, char *p_out, uint32_t out_sz)
+{
+    static const char *method_str[] = {"DELETE", "GET", "HEAD", "POST", "PUT"};
+    sdlog_http_access_t rec         = {0};
+    memcpy(&rec, payload, (len < sizeof(rec)) ? len : sizeof(rec));
+    rec.query[sizeof(rec.query) - 1] = '\0';
+
+    char method[8];
+    char uri[16];
+    const char *p_method;
+    const char *p_uri;
+    if (rec.method < sizeof(method_str) / sizeof(method_str[0])) {
+        p_method = method_str[rec.method];
+    } else {
+        snprintf(method, sizeof(method), "M%u", rec.method);
+        p_method = method;
+    }
+    if (rec.uri_id < sizeof(sdlog_fmt_http_uri) / sizeof(sdlog_fmt_http_uri[0])) {
+        p_uri = sdlog_fmt_http_uri[rec.uri_id];
+    } else {
+        snprintf(uri, sizeof(uri), "<uri %u>", rec.uri_id);
+        p_uri = uri;
+    }
+
+    const uint8_t *ip = (const uint8_t *)&rec.client_ip; // network order
+    int r = snprintf(p_out, out_sz, "%s %s%s%s %u %" PRIu32 "B %" PRIu32 ".%03" PRIu32 "ms %u.%u.%u.%u", p_method, p_uri,
+        rec.query[0] ? "?" : "", rec.query, rec.status, rec.bytes, rec.us_duration / 1000, rec.us_duration % 1000,
+        ip[0], ip[1], ip[2], ip[3]);
+    return (r < 0) ? 0 : ((uint32_t)r < out_sz) ? (uint32_t)r : out_sz - 1;
+}
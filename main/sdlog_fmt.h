@@ -0,0 +1,52 @@
+#ifndef __SDLOG_FMT_H__
+#define __SDLOG_FMT_H__
+
+#include <stdint.h>
+#include <stdarg.h>
+
+// Deferred text records of FMT_TEXT, the printf() is done by the exporters/decoders instead of the device
+// - SDLOG_FMT_TEXT__FMT: uint32_t fmt_id + the format string (no NUL), written once per log file before the first
+//   SDLOG_FMT_TEXT__BIN record using it, so every log.bin carries its own string table
+// - SDLOG_FMT_TEXT__BIN: uint32_t fmt_id + the packed arguments, in the order of the conversions:
+//   - '*' width/precision, %c and the integers without l/ll/j/z/t: int32_t
+//   - the integers with l/ll/j/z/t, %p: int64_t (long is 32-bit on the device and 64-bit on the host)
+//   - %f/%e/%g/%a: double
+//   - %s: uint8_t len + len bytes, cut at SDLOG_FMT_STR_MAX or the precision
+// All little endian, unaligned. fmt_id is the address of the format string, it must stay valid for the whole run
+// (a string literal), the writer reads the string through it when the table entry is written
+
+#define SDLOG_FMT_ARG_MAX (192) // packed arguments of one message, the message falls back to text if longer
+#define SDLOG_FMT_STR_MAX (128)
+
+// pack the arguments of fmt into p_out, returns the packed length
+// -1 if fmt has a conversion that can't be deferred (%n, %Lf, %ls, ...) or the arguments don't fit
+int32_t sdlog_fmt_pack(const char *fmt, va_list args, uint8_t *p_out, uint32_t out_sz);
+
+// printf() of the packed arguments, returns the length written to p_out (always NUL terminated, cut at out_sz)
+uint32_t sdlog_fmt_render(const char *fmt, const uint8_t *p_arg, uint32_t arg_len, char *p_out, uint32_t out_sz);
+
+// ----------
+// String table of the decoders, built from the SDLOG_FMT_TEXT__FMT records
+// ----------
+typedef struct sdlog_fmt_entry_s {
+    uint32_t id;
+    char *fmt;
+} sdlog_fmt_entry_t;
+
+typedef struct sdlog_fmt_table_s {
+    sdlog_fmt_entry_t *p_entry; // sorted by id
+    uint32_t num;
+    uint32_t cap;
+} sdlog_fmt_table_t;
+
+void sdlog_fmt_table_add(sdlog_fmt_table_t *p_table, const void *payload, uint32_t len); // payload of a FMT record
+const char *sdlog_fmt_table_find(const sdlog_fmt_table_t *p_table, uint32_t id);     // NULL if not found
+void sdlog_fmt_table_free(sdlog_fmt_table_t *p_table);
+
+// render the payload of a BIN record, an unknown fmt_id is rendered as "<fmt 0x...>"
+uint32_t sdlog_fmt_render_rec(const sdlog_fmt_table_t *p_table, const void *payload, uint32_t len, char *p_out, uint32_t out_sz);
+
+// render the payload of a SDLOG_FMT_TEXT__HTTP record (sdlog_http_access_t)
+uint32_t sdlog_fmt_render_http(const void *payload, uint32_t len, char *p_out, uint32_t out_sz);
+
+#endif // __SDLOG_FMT_H__
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <assert.h>
 
 // this ensure the data structure is aligned with 1byte, where compiler doesn't add padding
 // if we write PC tool to examine the data structure, it guaranteed no difference between target/host
@@ -30,12 +31,19 @@ typedef struct sdlog_header_sys_s {
 
             uint32_t offset_meta; // default: 512
             uint32_t offset_data; // 1024
+            uint32_t epoch_src;   // SDLOG_EPOCH_xxx, how us_epoch_time was obtained
         };
     };
     uint32_t crc32;
 } sdlog_header_sys_t;
 
-// header_fmt = "<8sIIQQI32s16sII" # 對應你的 sys.payload 結構
+// header_fmt = "<8sIIQQI32s16sIII" # 對應你的 sys.payload 結構
+
+enum {
+    SDLOG_EPOCH_GIVEN       = 0, // by the START command (browser, group master), the logs before it have 0 here
+    SDLOG_EPOCH_PROVISIONAL = 1, // the device clock at the start (autostart before SNTP), maybe wrong
+    SDLOG_EPOCH_CORRECTED   = 2, // was provisional, rewritten from the first time sync record of the file
+};
 
 static_assert(sizeof(sdlog_header_sys_t) == 512, "System header size mismatch!");
 static_assert(offsetof(sdlog_header_sys_t, us_epoch_time) == 16, "Offset mismatch!");
@@ -49,6 +57,8 @@ typedef struct sdlog_header_s {
     sdlog_header_meta_t meta;
 } sdlog_header_t;
 
+#pragma pack(pop)
+
 // ----------
 // USER DATA header
 // ----------
@@ -65,4 +75,213 @@ typedef struct sdlog_data_s {
 
 #pragma pack(pop)
 
+// ----------
+// Framework records, valid in every format
+// ----------
+// type_data 0xF0~0xFF are reserved by the framework, the types of a format start from 0
+#define SDLOG_TYPE_FRAMEWORK (0xF0)
+#define SDLOG_TYPE_TIME_SYNC (0xF0)    // sdlog_time_sync_t
+#define SDLOG_TYPE_GROUP_BEACON (0xF1) // sdlog_group_beacon_t
+
+enum {
+    SDLOG_TIME_SYNC_SNTP     = 1, // written right after the SNTP client updated the system clock
+    SDLOG_TIME_SYNC_PERIODIC = 2, // the synced system clock sampled periodically, anchors every log file
+};
+
+#define SDLOG_TIME_SYNC_STEP_US (60 * 1000000LL) // a larger correction is a clock reset, not a drift
+
+#pragma pack(push, 1)
+
+typedef struct sdlog_time_sync_s {
+    uint64_t us_sys_time;   // esp_timer_get_time()
+    uint64_t us_epoch_time; // the wall clock at us_sys_time
+    uint32_t source;        // SDLOG_TIME_SYNC_xxx
+    uint32_t reserved;
+} sdlog_time_sync_t;
+
+#pragma pack(pop)
+
+static_assert(sizeof(sdlog_time_sync_t) == 24, "Time sync record size mismatch!");
+
+#pragma pack(push, 1)
+
+// A sync beacon of the logger group (main/group_sync.c), the record time is the reception time of the beacon,
+// or the send time on the master. The host merge tool maps every log onto the master's esp_timer with them
+typedef struct sdlog_group_beacon_s {
+    uint32_t seq;           // beacon sequence of the master
+    uint32_t is_master;     // 1: sent by this logger
+    uint64_t us_sys_time;   // esp_timer of the master when it sent the beacon
+    uint64_t us_epoch_time; // wall clock of the master when it sent the beacon, 0 if the master has no SNTP
+    char master[16];        // hostname of the master, truncated
+} sdlog_group_beacon_t;
+
+#pragma pack(pop)
+
+static_assert(sizeof(sdlog_group_beacon_t) == 40, "Group beacon record size mismatch!");
+
+// Piecewise linear sys_time -> epoch_time over the time sync records of a log, sorted by us_sys_time
+// - between two points the drift is spread linearly, outside of them the offset of the nearest point is used
+// - a segment with a step (> SDLOG_TIME_SYNC_STEP_US) keeps the offset of its left point
+// - *p_idx is the cursor of the caller, the lookup is O(1) when the records come in time order
+// Integer only, the device has no FPU
+static inline uint64_t sdlog_time_sync_abs_us(const sdlog_time_sync_t *p_sync, uint32_t num, uint32_t *p_idx, uint64_t us_sys_time)
+{
+    uint32_t i = (*p_idx < num) ? *p_idx : 0;
+    while (i + 1 < num && us_sys_time >= p_sync[i + 1].us_sys_time) {
+        i++;
+    }
+    while (i > 0 && us_sys_time < p_sync[i].us_sys_time) {
+        i--;
+    }
+    *p_idx = i;
+
+    const sdlog_time_sync_t *p_l = &p_sync[i];
+    int64_t dt                   = (int64_t)(us_sys_time - p_l->us_sys_time);
+    if (dt <= 0 || i + 1 >= num) {
+        return p_l->us_epoch_time + dt; // before the first point, or after the last one
+    }
+
+    const sdlog_time_sync_t *p_r = &p_sync[i + 1];
+    int64_t d_sys                = (int64_t)(p_r->us_sys_time - p_l->us_sys_time);
+    int64_t d_drift              = (int64_t)(p_r->us_epoch_time - p_l->us_epoch_time) - d_sys;
+    if (d_drift > SDLOG_TIME_SYNC_STEP_US || d_drift < -SDLOG_TIME_SYNC_STEP_US) {
+        return p_l->us_epoch_time + dt;
+    }
+    return p_l->us_epoch_time + dt + dt * d_drift / d_sys; // dt < d_sys, |d_drift| <= 60s, no overflow below 40 hours
+}
+
+// ----------
+// CAN log (SDLOG_FMT_CAN) records, selected by sdlog_data_t.type_data
+// ----------
+#define SDLOG_CAN_TYPE_FRAME (0) // twai_message_t, raw copy of the received frame
+#define SDLOG_CAN_TYPE_BUS (1)   // sdlog_can_bus_t, TWAI alerts and controller status
+
+#pragma pack(push, 1)
+
+// Written by twai_monitor_task, immediately when an alert fires (at most once per alert kind per period),
+// and as a periodic snapshot. The counters are cumulative, the loss of the bus and the loss of the logger
+// are counted separately:
+// - rx_missed/rx_overrun, frames lost by the TWAI driver, they never reached twai_rx_task
+// - sdlog_drop, frames received but not logged, the sdlog ring buffer was full
+typedef struct sdlog_can_bus_s {
+    uint32_t alerts; // TWAI_ALERT_xxx raised since the previous record
+    uint32_t state;  // twai_state_t
+    uint32_t tx_error_counter;
+    uint32_t rx_error_counter;
+    uint32_t bus_load;   // permille of the bit rate over the last period, stuff bits not counted
+    uint32_t rx_missed;  // TWAI driver RX queue full (TWAI_RXBUF)
+    uint32_t rx_overrun; // TWAI controller RX FIFO overrun
+    uint32_t sdlog_drop; // sdlog_write() of the CAN source failed, since the log started
+    uint32_t bus_error;
+    uint32_t arb_lost;
+    uint32_t tx_failed;
+    uint32_t reserved;
+} sdlog_can_bus_t;
+
+#pragma pack(pop)
+
+static_assert(sizeof(sdlog_can_bus_t) == 48, "CAN bus record size mismatch!");
+
+// ----------
+// HTTP access log, SDLOG_FMT_TEXT__HTTP records of the HTTP source
+// ----------
+#pragma pack(push, 1)
+
+// Written by http_server.c after the handler of a request returned, the exporters print it as
+// "GET /log_download?path=... 200 1234B 15.201ms 192.168.1.5"
+typedef struct sdlog_http_access_s {
+    uint8_t method;       // http_method of http_parser (0: DELETE, 1: GET, 2: HEAD, 3: POST, 4: PUT)
+    uint8_t uri_id;       // HTTP_URI_xxx, main/http_uri_reg.h
+    uint16_t status;      // HTTP status code of the response
+    uint32_t bytes;       // response body bytes
+    uint32_t us_duration; // the handler time, until the last chunk was sent
+    uint32_t client_ip;   // IPv4 address of the client (network order), 0 if unknown
+    char query[48];       // URL query string, NUL terminated, cut if longer
+} sdlog_http_access_t;
+
+#pragma pack(pop)
+
+static_assert(sizeof(sdlog_http_access_t) == 64, "HTTP access record size mismatch!");
+
+// ----------
+// CAN columnar export (cancol.bin), produced by sdlog_exporter_can_col
+// ----------
+// [header][directory, sorted by (extd, identifier)][columns of ID#0][columns of ID#1]...
+// The columns of one ID: uint64_t ts[count] (absolute epoch us), uint8_t data[count][8], uint8_t dlc[count]
+// Each column starts 8-byte aligned, so loading one signal only reads its own directory entry and columns
+
+typedef struct sdlog_cancol_header_s {
+    char magic[8];       // FIXED TO "QQCANCOL"
+    uint32_t version;    // 1
+    uint32_t id_num;     // directory entries
+    uint32_t frame_num;  // frames exported in total
+    uint32_t frame_drop; // frames whose ID didn't fit in the directory
+    uint32_t offset_dir; // 32
+    uint32_t reserved;
+} sdlog_cancol_header_t;
+
+typedef struct sdlog_cancol_dir_s {
+    uint32_t identifier;
+    uint32_t flags; // twai_message_t.flags of the first frame (bit0: extd)
+    uint32_t count;
+    uint32_t offset_ts;
+    uint32_t offset_data;
+    uint32_t offset_dlc;
+    uint32_t reserved[2];
+} sdlog_cancol_dir_t;
+
+static_assert(sizeof(sdlog_cancol_header_t) == 32, "cancol header size mismatch!");
+static_assert(sizeof(sdlog_cancol_dir_t) == 32, "cancol directory size mismatch!");
+
+// ----------
+// ADC log (SDLOG_FMT_ADC) records, selected by sdlog_data_t.type_data
+// ----------
+#define SDLOG_ADC_TYPE_BLOCK (0)       // sdlog_adc_block_t, one conversion frame of the continuous ADC driver
+#define SDLOG_ADC_BLOCK_SAMPLES (128)  // conversion results per block
+#define SDLOG_ADC_SAMPLE_CH(s) ((s) >> 12)
+#define SDLOG_ADC_SAMPLE_RAW(s) ((s) & 0xFFF)
+
+#pragma pack(push, 1)
+
+// Written by adc_source.c once per DMA frame, one timestamp per block: the record time is the first sample,
+// sample i was converted at us_sys_time + i * 1000000 / rate_hz. The pattern of channels repeats through the
+// block, every sample carries its channel
+typedef struct sdlog_adc_block_s {
+    uint32_t seq;     // DMA frames since the ADC started, a gap is frames lost by the driver (its pool was full)
+    uint32_t rate_hz; // conversions per second, all the channels of the pattern together
+    uint8_t unit;     // adc_unit_t, 0: ADC1
+    uint8_t atten;    // adc_atten_t of the pattern
+    uint8_t ch_num;   // channels in the pattern
+    uint8_t reserved[5];
+    uint16_t sample[SDLOG_ADC_BLOCK_SAMPLES]; // channel << 12 | 12-bit raw result, SDLOG_ADC_SAMPLE_CH/RAW()
+} sdlog_adc_block_t;
+
+#pragma pack(pop)
+
+static_assert(sizeof(sdlog_adc_block_t) == 272, "ADC block record size mismatch!");
+
+// ----------
+// ADC binary export (adc.bin), produced by sdlog_exporter_adc_bin
+// ----------
+// [header][block#0][block#1]... one block per SDLOG_ADC_TYPE_BLOCK record in log order, the first sample of a block
+// in absolute epoch us, the samples as logged. Fixed-size blocks, a loader maps the file as an array
+
+typedef struct sdlog_adcbin_header_s {
+    char magic[8];          // FIXED TO "QQADCBIN"
+    uint32_t version;       // 1
+    uint32_t block_samples; // SDLOG_ADC_BLOCK_SAMPLES
+    uint32_t block_size;    // sizeof(sdlog_adcbin_block_t), the blocks start at sizeof(sdlog_adcbin_header_t)
+    uint32_t reserved[3];
+} sdlog_adcbin_header_t;
+
+typedef struct sdlog_adcbin_block_s {
+    uint64_t us_epoch_time; // first sample, the time sync points applied
+    uint32_t seq;
+    uint32_t rate_hz;
+    uint16_t sample[SDLOG_ADC_BLOCK_SAMPLES];
+} sdlog_adcbin_block_t;
+
+static_assert(sizeof(sdlog_adcbin_header_t) == 32, "adc.bin header size mismatch!");
+static_assert(sizeof(sdlog_adcbin_block_t) == 272, "adc.bin block size mismatch!");
+
 #endif // __SDLOG_HEADER_H__
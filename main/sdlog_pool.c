@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+
+#include "sdlog_pool.h"
+
+static const char *TAG = "SDLOG_POOL";
+
+// The log files of the sources and the conversions used to malloc()/free() their buffers on every open/close/convert
+// After a long uptime the heap of the C3 is fragmented, the allocation failed and stdio went unbuffered (much slower)
+// The buffers are now taken from fixed pools, one allocation at boot (sdlog_pool_reg.h)
+// - a pool is a bitmap of its buffers, get/put are lock free: sdlog_task, the conversion and httpd share them
+// - the pool exhausted (eg. two conversions at once), the buffer comes from malloc() as before and is counted
+// sdlog_pool_query() reports the usage, the heap fragmentation is on /mem_stats (http_server.c)
+
+typedef struct sdlog_pool_s {
+    const char *name;
+    uint32_t blk_sz;
+    uint32_t blk_num;
+    uint8_t *p_mem;    // NULL until sdlog_pool_init()
+    uint32_t bmp_used; // bit i: buffer i is taken
+    uint32_t max_use;
+    uint32_t fallback;
+    uint32_t fail;
+} sdlog_pool_t;
+
+static sdlog_pool_t sdlog_pool[SDLOG_POOL_NUM] = {
+#define SDLOG_POOL_REG(_name, _blk_sz, _blk_num) [SDLOG_POOL_##_name] = {.name = #_name, .blk_sz = (_blk_sz), .blk_num = (_blk_num)},
+#include "sdlog_pool_reg.h"
+#undef SDLOG_POOL_REG
+};
+
+esp_err_t sdlog_pool_init(void)
+{
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < SDLOG_POOL_NUM; i++) {
+        total += sdlog_pool[i].blk_sz * sdlog_pool[i].blk_num;
+    }
+
+    uint8_t *p_mem = malloc(total);
+    if (p_mem == NULL) {
+        ESP_LOGE(TAG, "no memory for the pools (%" PRIu32 " bytes), malloc() on demand", total);
+        return ESP_OK;
+    }
+
+    for (uint32_t i = 0; i < SDLOG_POOL_NUM; i++) {
+        sdlog_pool_t *p_pool = &sdlog_pool[i];
+        p_pool->p_mem        = p_mem;
+        p_mem += p_pool->blk_sz * p_pool->blk_num;
+    }
+    ESP_LOGI(TAG, "%" PRIu32 " bytes reserved", total);
+    return ESP_OK;
+}
+
+void *sdlog_pool_get(uint32_t pool)
+{
+    sdlog_pool_t *p_pool = &sdlog_pool[pool];
+    uint32_t bmp_all     = (p_pool->blk_num >= 32) ? UINT32_MAX : (1u << p_pool->blk_num) - 1;
+    uint32_t bmp         = __atomic_load_n(&p_pool->bmp_used, __ATOMIC_RELAXED);
+
+    while (p_pool->p_mem && (~bmp & bmp_all)) {
+        uint32_t bit = ~bmp & bmp_all & -(~bmp & bmp_all); // the lowest free buffer
+        if (__atomic_compare_exchange_n(&p_pool->bmp_used, &bmp, bmp | bit, 1, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            uint32_t use = __builtin_popcount(bmp | bit);
+            uint32_t max = __atomic_load_n(&p_pool->max_use, __ATOMIC_RELAXED);
+            while (use > max && !__atomic_compare_exchange_n(&p_pool->max_use, &max, use, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            }
+            return p_pool->p_mem + __builtin_ctz(bit) * p_pool->blk_sz;
+        }
+    }
+
+    void *p_buf = malloc(p_pool->blk_sz);
+    __atomic_fetch_add(p_buf ? &p_pool->fallback : &p_pool->fail, 1, __ATOMIC_RELAXED);
+    return p_buf;
+}
+
+void sdlog_pool_put(uint32_t pool, void *p_buf)
+{
+    sdlog_pool_t *p_pool = &sdlog_pool[pool];
+    uint8_t *p_u8        = p_buf;
+    if (p_pool->p_mem && p_u8 >= p_pool->p_mem && p_u8 < p_pool->p_mem + p_pool->blk_sz * p_pool->blk_num) {
+        __atomic_fetch_and(&p_pool->bmp_used, ~(1u << ((p_u8 - p_pool->p_mem) / p_pool->blk_sz)), __ATOMIC_RELEASE);
+    } else {
+        free(p_buf);
+    }
+}
+
+void sdlog_pool_query(uint32_t pool, sdlog_pool_status_t *p_status)
+{
+    sdlog_pool_t *p_pool = &sdlog_pool[pool];
+    p_status->name       = p_pool->name;
+    p_status->blk_sz     = p_pool->blk_sz;
+    p_status->blk_num    = p_pool->p_mem ? p_pool->blk_num : 0;
+    p_status->in_use     = __builtin_popcount(__atomic_load_n(&p_pool->bmp_used, __ATOMIC_RELAXED));
+    p_status->max_use    = __atomic_load_n(&p_pool->max_use, __ATOMIC_RELAXED);
+    p_status->fallback   = __atomic_load_n(&p_pool->fallback, __ATOMIC_RELAXED);
+    p_status->fail       = __atomic_load_n(&p_pool->fail, __ATOMIC_RELAXED);
+}
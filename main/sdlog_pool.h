@@ -0,0 +1,42 @@
+#ifndef __SDLOG_POOL_H__
+#define __SDLOG_POOL_H__
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdlog_service.h"
+
+// I/O buffers of the sdlog paths, reserved at boot in one allocation before the heap gets fragmented
+// A pool with no free buffer falls back to malloc(), counted, the caller still gets NULL only if malloc() fails too
+
+#define SDLOG_FILE_BUF_SZ (4096)      // FILE buffer of a log file, it writes to the SD card every 4KB
+#define SDLOG_CONV_FILE_BUF_SZ (8192) // FILE buffers of a conversion
+#define SDLOG_CONV_SYNC_SZ (4096)     // time sync points of a conversion
+#define SDLOG_CONV_REC_SZ (1024)      // payload of the record being converted, and its text
+
+enum {
+#define SDLOG_POOL_REG(_name, _blk_sz, _blk_num) SDLOG_POOL_##_name,
+#include "sdlog_pool_reg.h"
+#undef SDLOG_POOL_REG
+    SDLOG_POOL_NUM,
+};
+
+esp_err_t sdlog_pool_init(void); // APP_MAIN_INIT_FUNC, early
+void *sdlog_pool_get(uint32_t pool);
+void sdlog_pool_put(uint32_t pool, void *p_buf); // NULL is fine, a fallback buffer is freed
+
+// ----------
+// WEBUI API
+// ----------
+typedef struct sdlog_pool_status_s {
+    const char *name;
+    uint32_t blk_sz;
+    uint32_t blk_num;  // reserved, 0 if the allocation at boot failed
+    uint32_t in_use;
+    uint32_t max_use;  // high water of in_use
+    uint32_t fallback; // served by malloc(), the pool was exhausted
+    uint32_t fail;     // malloc() failed too, the caller went unbuffered
+} sdlog_pool_status_t;
+
+void sdlog_pool_query(uint32_t pool, sdlog_pool_status_t *p_status);
+
+#endif // __SDLOG_POOL_H__
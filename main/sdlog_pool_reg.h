@@ -0,0 +1,8 @@
+// SDLOG_POOL_REG(_name, _blk_sz, _blk_num)
+// name: used to generate enum SDLOG_POOL_xxx
+// blk_sz: bytes of one buffer
+// blk_num: buffers reserved at boot, at most 32
+SDLOG_POOL_REG(WBUF, SDLOG_FILE_BUF_SZ, SDLOG_SOURCE_NUM) // FILE buffer of the log file of every source
+SDLOG_POOL_REG(CONV, SDLOG_CONV_FILE_BUF_SZ, 2)           // input and output FILE buffers of one conversion
+SDLOG_POOL_REG(SYNC, SDLOG_CONV_SYNC_SZ, 1)               // time sync points of one conversion
+SDLOG_POOL_REG(REC, SDLOG_CONV_REC_SZ, 1)                 // record payload and text of one conversion
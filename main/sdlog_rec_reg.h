@@ -0,0 +1,18 @@
+// SDLOG_REC_REG(_name, _fmt, _type, _size, _decode, _format)
+// name: used to generate enum SDLOG_REC_xxx
+// fmt: SDLOG_FMT_xxx of the source, SDLOG_FMT_ANY for the framework records
+// type: type_data of the record in the format
+// size: payload bytes of a fixed-size record, SDLOG_REC_VAR (up to SDLOG_CONV_PAYLOAD_SZ), or SDLOG_REC_STREAM (any
+//       length, read in pieces), a record of another size is skipped
+// decode: checks the payload, NULL if every payload of the size is valid, a rejected record is skipped
+// format: writes the record to the output of the line exporters (TEXT, CAN, ADCCSV), NULL if it has no line
+SDLOG_REC_REG(TEXT_STRING, SDLOG_FMT_TEXT, SDLOG_FMT_TEXT__STRING, SDLOG_REC_STREAM, NULL, _sdlog_rec_text_string)
+SDLOG_REC_REG(TEXT_CONT, SDLOG_FMT_TEXT, SDLOG_FMT_TEXT__CONT, SDLOG_REC_STREAM, NULL, _sdlog_rec_text_string)
+SDLOG_REC_REG(TEXT_FMT, SDLOG_FMT_TEXT, SDLOG_FMT_TEXT__FMT, SDLOG_REC_VAR, NULL, _sdlog_rec_text_fmt)
+SDLOG_REC_REG(TEXT_BIN, SDLOG_FMT_TEXT, SDLOG_FMT_TEXT__BIN, SDLOG_REC_VAR, NULL, _sdlog_rec_text_bin)
+SDLOG_REC_REG(TEXT_HTTP, SDLOG_FMT_TEXT, SDLOG_FMT_TEXT__HTTP, sizeof(sdlog_http_access_t), NULL, _sdlog_rec_text_http)
+SDLOG_REC_REG(CAN_FRAME, SDLOG_FMT_CAN, SDLOG_CAN_TYPE_FRAME, sizeof(twai_message_t), _sdlog_rec_can_frame_decode, _sdlog_rec_can_frame)
+SDLOG_REC_REG(CAN_BUS, SDLOG_FMT_CAN, SDLOG_CAN_TYPE_BUS, sizeof(sdlog_can_bus_t), NULL, NULL)
+SDLOG_REC_REG(ADC_BLOCK, SDLOG_FMT_ADC, SDLOG_ADC_TYPE_BLOCK, sizeof(sdlog_adc_block_t), _sdlog_rec_adc_block_decode, _sdlog_rec_adc_block)
+SDLOG_REC_REG(TIME_SYNC, SDLOG_FMT_ANY, SDLOG_TYPE_TIME_SYNC, sizeof(sdlog_time_sync_t), NULL, NULL)
+SDLOG_REC_REG(GROUP_BEACON, SDLOG_FMT_ANY, SDLOG_TYPE_GROUP_BEACON, sizeof(sdlog_group_beacon_t), NULL, NULL)
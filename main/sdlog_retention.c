@@ -0,0 +1,315 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <dirent.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_vfs_fat.h"
+
+#include "board.h"
+
+#include "sdlog_service.h"
+#include "sdlog_service_private.h"
+#include "sdlog_retention.h"
+#include "sdlog_conv.h"
+#include "sdcard.h"
+#include "task_cfg.h"
+
+static const char *TAG = "RETENTION";
+
+// Retention of the sessions on the SD card, a low priority task, per source ([sdlog] of syscfg.ini):
+// - quota_mb: the sessions of the source take more than it
+// - free_low_mb: the card has less free space than it, the sessions are evicted until free_high_mb
+// Eviction goes oldest first, in two passes: the exporter outputs (log.txt, candump.txt, ...) of the sessions first,
+// then the raw log.bin with its folder. The session being recorded and the last closed one (sdlog_source_sn_closed(),
+// not sn - 1, the serial numbers of a boot start at a new NVS block) are never evicted, and both
+// passes stop at a session with a conversion job queued or running (sdlog_conv_dir_busy()), removing the files under
+// an open FIL cross-links the FAT (FF_FS_LOCK = 0)
+// Nothing is evicted while sd_card_busy(), the card is unmounted by the /sd_bench profiles or a remount
+// The free space is not read per check, esp_vfs_fat_info() (f_getfree) is called at start, every RETENTION_RESYNC_S,
+// and before evicting on a stale estimate. In between it's estimated from the bytes written by sdlog_task and the
+// ones reported by sdlog_retention_account(). The usage of a source comes from one scan of its folder at start,
+// then from the same counters
+
+#define RETENTION_PERIOD_MS (5000)
+#define RETENTION_RESYNC_S (600)
+#define RETENTION_VERIFY_S (30) // the estimate is re-read before evicting if older than this
+#define RETENTION_PATH_SZ (80 + 16 + 256) // session folder + d_name
+
+// ----------
+// data structure definition
+// ----------
+typedef struct retention_source_s {
+    uint64_t used;       // bytes of the sessions of the source
+    uint32_t oldest_sn;  // cursor of the raw pass
+    uint32_t derived_sn; // cursor of the derived pass
+    uint32_t bytes_seen; // sdlog_source_bytes() at the last update
+    uint32_t evicted;
+    uint32_t scanned;
+} retention_source_t;
+
+typedef struct retention_ctrl_s {
+    uint64_t total;
+    int64_t free; // estimated
+    int64_t us_sync;
+    int64_t pending[SDLOG_SOURCE_NUM + 1]; // sdlog_retention_account() not applied yet, [SDLOG_SOURCE_NUM]: other files
+    retention_source_t source[SDLOG_SOURCE_NUM];
+} retention_ctrl_t;
+
+static retention_ctrl_t retention_ctrl;
+
+// ----------
+// Accounting
+// ----------
+void sdlog_retention_account(const char *path, int64_t bytes)
+{
+    uint32_t source = sdlog_source_from_path(path);
+    __atomic_fetch_add(&retention_ctrl.pending[source], bytes, __ATOMIC_RELAXED);
+}
+
+static void _retention_sync(void)
+{
+    uint64_t total, free;
+    if (sd_card_busy()) {
+        return; // retried at the next check
+    }
+    if (esp_vfs_fat_info(MNT_SDCARD, &total, &free) == ESP_OK) {
+        retention_ctrl.total = total;
+        retention_ctrl.free  = free;
+    }
+    retention_ctrl.us_sync = esp_timer_get_time();
+}
+
+// the bytes written/removed since the last update, on the usage of every source and the free space
+static void _retention_update(void)
+{
+    int64_t delta = __atomic_exchange_n(&retention_ctrl.pending[SDLOG_SOURCE_NUM], 0, __ATOMIC_RELAXED);
+    for (uint32_t i = 0; i < SDLOG_SOURCE_NUM; i++) {
+        retention_source_t *p_rs = &retention_ctrl.source[i];
+        uint32_t bytes           = sdlog_source_bytes(i);
+        int64_t d                = (uint32_t)(bytes - p_rs->bytes_seen);
+        p_rs->bytes_seen         = bytes;
+        d += __atomic_exchange_n(&retention_ctrl.pending[i], 0, __ATOMIC_RELAXED);
+
+        p_rs->used = ((int64_t)p_rs->used + d > 0) ? p_rs->used + d : 0;
+        delta += d;
+    }
+    retention_ctrl.free -= delta;
+
+    if (esp_timer_get_time() - retention_ctrl.us_sync >= RETENTION_RESYNC_S * 1000000LL) {
+        _retention_sync();
+    }
+}
+
+// ----------
+// Scan and eviction
+// ----------
+// the usage and the oldest session of the source, once at start
+static void _retention_scan(uint32_t source)
+{
+    retention_source_t *p_rs = &retention_ctrl.source[source];
+    char dir_path[64];
+    char path[RETENTION_PATH_SZ];
+    struct stat st;
+    sdlog_source_path(source, dir_path, sizeof(dir_path));
+
+    uint32_t oldest_sn = UINT32_MAX;
+    uint64_t used      = 0;
+    DIR *dir           = opendir(dir_path);
+    struct dirent *entry;
+    while (dir && (entry = readdir(dir)) != NULL) {
+        uint32_t sn = strtoul(entry->d_name, NULL, 10);
+        if (entry->d_type != DT_DIR || sn == 0) {
+            continue;
+        }
+        oldest_sn = (sn < oldest_sn) ? sn : oldest_sn;
+
+        snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name);
+        DIR *dir_sn = opendir(path);
+        struct dirent *entry_sn;
+        while (dir_sn && (entry_sn = readdir(dir_sn)) != NULL) {
+            snprintf(path, sizeof(path), "%s/%06" PRIu32 "/%s", dir_path, sn, entry_sn->d_name);
+            if (entry_sn->d_type != DT_DIR && stat(path, &st) == 0) {
+                used += st.st_size;
+            }
+        }
+        if (dir_sn) {
+            closedir(dir_sn);
+        }
+    }
+    if (dir) {
+        closedir(dir);
+    }
+
+    // the bytes written during the scan may be counted twice, the next scan is at the next boot
+    p_rs->bytes_seen = sdlog_source_bytes(source);
+    p_rs->used       = used;
+    p_rs->oldest_sn  = (oldest_sn == UINT32_MAX) ? 1 : oldest_sn;
+    p_rs->derived_sn = p_rs->oldest_sn;
+    p_rs->scanned    = 1;
+    ESP_LOGI(TAG, "%s: %" PRIu64 " KB, oldest sn=%" PRIu32, dir_path, used >> 10, p_rs->oldest_sn);
+}
+
+// removes the files of a session folder, only the exporter outputs if derived_only, returns the bytes freed
+static uint64_t _retention_remove(const char *dir_path, uint32_t derived_only)
+{
+    char path[RETENTION_PATH_SZ];
+    struct stat st;
+    uint64_t freed = 0;
+
+    // one file per opendir(), the folder isn't modified while it's read
+    while (1) {
+        if (sdlog_conv_dir_busy(dir_path) || sd_card_busy()) {
+            break; // a job was submitted meanwhile, or /sd_bench remounts the card
+        }
+        DIR *dir = opendir(dir_path);
+        if (dir == NULL) {
+            return freed;
+        }
+        struct dirent *entry;
+        path[0] = '\0';
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_type != DT_DIR && (!derived_only || strcmp(entry->d_name, "log.bin"))) {
+                snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name);
+                break;
+            }
+        }
+        closedir(dir);
+
+        if (path[0] == '\0') {
+            break;
+        }
+        uint64_t size = (stat(path, &st) == 0) ? st.st_size : 0;
+        if (remove(path) != 0) {
+            ESP_LOGE(TAG, "remove %s failed", path);
+            break;
+        }
+        freed += size;
+    }
+
+    if (!derived_only && path[0] == '\0') {
+        rmdir(dir_path);
+    }
+    return freed;
+}
+
+// evicts the next step of the source, returns the bytes freed, 0 if nothing can be evicted
+static uint64_t _retention_evict(uint32_t source)
+{
+    retention_source_t *p_rs = &retention_ctrl.source[source];
+    uint32_t sn              = sdlog_source_sn(source);
+    uint32_t sn_keep         = sdlog_source_sn_closed(source); // the last closed session, and the one being recorded
+    if (sn_keep == 0 || sn_keep >= sn) {
+        return 0; // not known yet (the background scan), the serial numbers jump by NVS blocks at boot
+    }
+    char dir_path[64];
+    char path[80];
+    struct stat st;
+    sdlog_source_path(source, dir_path, sizeof(dir_path));
+
+    for (; p_rs->derived_sn < sn_keep; p_rs->derived_sn++) {
+        snprintf(path, sizeof(path), "%s/%06" PRIu32, dir_path, p_rs->derived_sn);
+        if (sdlog_conv_dir_busy(path)) {
+            break; // the cursor waits there, its outputs are being written
+        }
+        uint64_t freed = _retention_remove(path, 1);
+        if (freed) {
+            ESP_LOGI(TAG, "%s: exporter outputs removed, %" PRIu64 " KB", path, freed >> 10);
+            p_rs->derived_sn += !sdlog_conv_dir_busy(path); // not if stopped by a job, the rest are removed after it
+            return freed;
+        }
+    }
+
+    for (; p_rs->oldest_sn < sn_keep; p_rs->oldest_sn++) {
+        snprintf(path, sizeof(path), "%s/%06" PRIu32, dir_path, p_rs->oldest_sn);
+        if (sdlog_conv_dir_busy(path)) {
+            break;
+        }
+        if (stat(path, &st) == 0) {
+            uint64_t freed = _retention_remove(path, 0);
+            if (stat(path, &st) == 0) {
+                return freed; // stopped by a job, the folder is left
+            }
+            ESP_LOGI(TAG, "%s: session removed, %" PRIu64 " KB", path, freed >> 10);
+            p_rs->oldest_sn++;
+            p_rs->evicted++;
+            return freed ? freed : 1;
+        }
+    }
+    return 0;
+}
+
+static void _retention_enforce(uint32_t source)
+{
+    const sdlog_policy_t *p_policy = sdlog_policy(source);
+    retention_source_t *p_rs       = &retention_ctrl.source[source];
+    int64_t quota                  = (int64_t)p_policy->quota_mb << 20;
+    int64_t free_low               = (int64_t)p_policy->free_low_mb << 20;
+    int64_t free_high              = p_policy->free_high_mb ? (int64_t)p_policy->free_high_mb << 20 : free_low * 5 / 4;
+
+    if (free_low && retention_ctrl.free < free_low && esp_timer_get_time() - retention_ctrl.us_sync >= RETENTION_VERIFY_S * 1000000LL) {
+        _retention_sync(); // don't evict on a stale estimate
+    }
+
+    uint32_t by_free = (free_low && retention_ctrl.free < free_low);
+    while ((quota && p_rs->scanned && (int64_t)p_rs->used > quota) || (by_free && retention_ctrl.free < free_high)) {
+        uint64_t freed = _retention_evict(source);
+        if (freed == 0) {
+            break;
+        }
+        __atomic_fetch_sub(&retention_ctrl.pending[source], (int64_t)freed, __ATOMIC_RELAXED);
+        _retention_update();
+    }
+}
+
+static void sdlog_retention_task(void *arg)
+{
+    _retention_sync();
+    for (uint32_t i = 0; i < SDLOG_SOURCE_NUM; i++) {
+        retention_ctrl.source[i].bytes_seen = sdlog_source_bytes(i);
+        const sdlog_policy_t *p_policy      = sdlog_policy(i);
+        if (p_policy->quota_mb || p_policy->free_low_mb) {
+            _retention_scan(i);
+        }
+    }
+    ESP_LOGI(TAG, "card %" PRIu64 " MB, free %" PRId64 " MB", retention_ctrl.total >> 20, retention_ctrl.free >> 20);
+
+    while (1) {
+        _retention_update();
+        for (uint32_t i = 0; i < SDLOG_SOURCE_NUM && !sd_card_busy(); i++) {
+            _retention_enforce(i);
+        }
+        vTaskDelay(pdMS_TO_TICKS(RETENTION_PERIOD_MS));
+    }
+}
+
+esp_err_t sdlog_retention_init(void)
+{
+    task_create(TASK_ID_RETENTION, sdlog_retention_task, NULL, NULL);
+    return ESP_OK;
+}
+
+// ----------
+// Status query API, for WEB-UI
+// ----------
+uint32_t sdlog_retention_query(uint32_t source, sdlog_retention_status_t *p_status)
+{
+    p_status->total   = retention_ctrl.total;
+    p_status->free    = (retention_ctrl.free > 0) ? retention_ctrl.free : 0;
+    p_status->used    = 0;
+    p_status->evicted = 0;
+    p_status->scanned = 0;
+    if (source < SDLOG_SOURCE_NUM) {
+        p_status->used    = retention_ctrl.source[source].used;
+        p_status->evicted = retention_ctrl.source[source].evicted;
+        p_status->scanned = retention_ctrl.source[source].scanned;
+    }
+    return 0;
+}
@@ -0,0 +1,25 @@
+#ifndef __SDLOG_RETENTION_H__
+#define __SDLOG_RETENTION_H__
+
+#include <stdint.h>
+#include "esp_err.h"
+
+esp_err_t sdlog_retention_init(void); // APP_MAIN_INIT_BG_FUNC, after sdlog_service_scan
+
+// a file of the card grew (> 0) or was removed (< 0) outside of sdlog_task: exporter outputs, removal from the web
+void sdlog_retention_account(const char *path, int64_t bytes);
+
+// ----------
+// WEBUI API
+// ----------
+typedef struct sdlog_retention_status_s {
+    uint64_t total;   // bytes of the card, 0 if not known yet
+    uint64_t free;    // estimated
+    uint64_t used;    // the sessions of the source
+    uint32_t evicted; // sessions removed since boot
+    uint32_t scanned; // used is known
+} sdlog_retention_status_t;
+
+uint32_t sdlog_retention_query(uint32_t source, sdlog_retention_status_t *p_status);
+
+#endif // __SDLOG_RETENTION_H__
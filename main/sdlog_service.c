@@ -1,9 +1,12 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <inttypes.h>
 #include <assert.h>
 #include <dirent.h>
+#include <sys/time.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -12,24 +15,59 @@
 #include "esp_timer.h"
 #include "esp_log.h"
 #include "esp_check.h"
+#include "esp_memory_utils.h"
+#include "nvs.h"
 
 #include "board.h"
+#include "sdcard.h"
 
 #include "sdlog_service.h"
 #include "sdlog_service_private.h"
 #include "sdlog_header.h"
 #include "sdlog_conv.h"
+#include "sdlog_fmt.h"
+#include "sdlog_pool.h"
+#include "task_cfg.h"
 
 static const char *TAG = "SDLOG";
 
 #define SDLOG_ROOT (MNT_SDCARD "/log")
 #define SDLOG_TASK_INBUF_SZ (32768)
-#define SDLOG_FILE_BUF_SZ (4096)
-
-// FIXME: in the sdlog service, we may encounter that sdcard service is not ready
-// Or we may encounter the SD card inserted (currently, it will reboot forever)
-// Handle them in the future. For example, if the SD card not inserted, I expect not hang
-// and the service can handle it gracefully
+#define SDLOG_FMT_SEEN_NUM (256) // format strings tracked per opened file, the table entry is repeated beyond 3/4 of it
+#define SDLOG_NVS_NS "sdlog"     // next serial number of every source, the key is the folder name
+#define SDLOG_SN_BLOCK (16)      // serial numbers reserved per NVS write
+#define SDLOG_SPILL_SZ (32768)   // default of [sdlog] spill_kb
+#define SDLOG_REMOUNT_MS (5000)
+
+#ifndef SDLOG_CONV_ON_CLOSE
+#define SDLOG_CONV_ON_CLOSE (1) // trigger the exporter once the log is closed, host bench turns it off to time conversion alone
+#endif
+
+// syscfg.ini
+// [sdlog]
+// deferred_fmt = on   ; HTTP/console messages are kept as format ID + arguments (SDLOG_FMT_TEXT__BIN), the
+//                     ; exporters and host decoders do the printf(). Default off
+// can.autostart = on        ; <source>.<policy>, the source is the folder name (sdlog_source_reg.h)
+// can.max_size_mb = 256     ; the session is rolled over to a new serial number beyond it, 0: no limit
+// can.max_duration_min = 60 ; same, by the recording time
+// can.quota_mb = 4096       ; space of all the sessions of the source, enforced by the retention, 0: no limit
+// can.free_low_mb = 1024    ; the retention evicts sessions of the source when the card has less free space,
+// can.free_high_mb = 2048   ; until it has free_high_mb (default free_low_mb * 5 / 4), main/sdlog_retention.c
+// spill_kb = 32             ; RAM kept for the records while the SD card is gone, 0: drop them
+//
+// An autostarted session starts when sdlog_service_init() is done, with the device clock as a provisional epoch
+// (SDLOG_EPOCH_PROVISIONAL). The first time sync record reaching the file corrects the header, the exporters also
+// align the records with the time sync records themselves
+//
+// SD card fault: no card at START, the card removed, or a write error (ferror() of the log file)
+// - the log file is closed (its unflushed tail is lost), the sessions go on in the spill buffer, a bounded RAM buffer
+//   of [sdlog] spill_kb (default 32) allocated on the first fault. The records beyond it are counted in drop_cnt
+// - sdlog_task retries sd_card_remount() every SDLOG_REMOUNT_MS, once the card is back every session continues in a
+//   new file (next serial number, same time base) starting with its spilled records. A session stopped meanwhile is
+//   closed after its records are flushed
+// - the FILE buffer of the broken file is lost, stdio writes it out every SDLOG_FILE_BUF_SZ so the records after the
+//   last write-out that succeeded are known (_sdlog_task_wrote()), they're counted in drop_cnt and fault_lost
+// - the LED blinks the SD error and sdlog_webui_query() reports sd_fault/spill_bytes until then
 
 // ----------
 // data structure definition
@@ -37,30 +75,71 @@ static const char *TAG = "SDLOG";
 typedef struct sdlog_ctrl_source_s {
     char *name;
     uint8_t fmt;
-    uint8_t reserved[3];
+    uint8_t fault; // SDLOG_FAULT_*, the session goes on in the spill buffer
+    uint8_t reserved[2];
     uint32_t sn;
+    uint32_t sn_reserved; // the serial numbers below it are taken in NVS
+    uint32_t sn_closed;   // the last file closed, from the folders at boot (sdlog_service_scan()), 0 if none yet
     FILE *fp;
-    void *wbuf; // for setvbuf() to hold wbuf to avoid frequently writing to SD card
+    void *wbuf; // for setvbuf() to hold wbuf to avoid frequently writing to SD card, from SDLOG_POOL_WBUF
     uint32_t bytes_written;
+    uint32_t bytes_total; // written since boot, all the files, wraps (sdlog_source_bytes())
+    uint32_t drop_cnt; // records dropped (ring buffer or spill buffer full) since sdlog_start(), several producers: atomic
+    uint32_t fault_lost;  // records of the FILE buffer lost at the faults since sdlog_start(), in drop_cnt too
+    uint32_t rec_written; // records of the opened file, the FILE buffer included
+    uint32_t rec_flushed; // the ones before the last write-out of the FILE buffer
+    uint32_t rec_safe;    // rec_flushed after the last write checked by ferror(), a fault loses the ones after it
+    uint32_t buf_base;    // file offset where the FILE buffer starts, written out every SDLOG_FILE_BUF_SZ from there
+    uint32_t open_err; // the last START failed to open the log file
+    uint32_t *fmt_seen; // IDs of the format strings whose table entry is in the opened file, open addressing
+    uint32_t fmt_seen_num;
+    uint64_t us_first_rec; // esp_timer when the first record of the boot reached the file, 0 if none yet
+    sdlog_policy_t policy;
+    uint64_t us_open;       // header of the opened file: us_sys_time, us_epoch_time and epoch_src
+    uint64_t us_epoch_open;
+    uint32_t epoch_src;
 } sdlog_ctrl_source_t;
 
 typedef struct sdlog_ctrl_s {
     char *root;
     uint8_t num_ch;
     uint8_t init;
-    uint8_t reserved[2];
+    uint8_t deferred_fmt; // sdlog_write_fmt() is enabled
+    uint8_t nvs_ok;       // nvs is opened, the serial numbers are cached
     sdlog_ctrl_source_t source[SDLOG_SOURCE_NUM];
+    nvs_handle_t nvs;
 
     // sdlog_task
     RingbufHandle_t sdlog_task_inbuf;
+
+    // SD card fault, only touched by sdlog_task except spill_len
+    uint8_t sd_fault;    // a source is in fault, sd_card_remount() is retried
+    uint8_t *spill;      // entries of sdlog_spill_hdr_t + log.bin records
+    uint32_t spill_sz;   // [sdlog] spill_kb
+    uint32_t spill_len;
+    uint32_t spill_last; // offset of the last entry, the next record of the same source is appended to it
+    int64_t us_remount;  // next sd_card_remount()
 } sdlog_ctrl_t;
 
+enum {
+    SDLOG_FAULT_NONE = 0,
+    SDLOG_FAULT_SPILL,   // the session is recorded in the spill buffer
+    SDLOG_FAULT_STOPPED, // stopped while in the spill buffer, closed once flushed
+};
+
+typedef struct sdlog_spill_hdr_s {
+    uint8_t source;
+    uint8_t reserved[3];
+    uint32_t len; // records following the header
+} sdlog_spill_hdr_t;
+
 // ----------
 // SDLOG ctrl data structure instance
 // ----------
 sdlog_ctrl_t sdlog_ctrl = {
-    .root   = SDLOG_ROOT,
-    .source = {
+    .root     = SDLOG_ROOT,
+    .spill_sz = SDLOG_SPILL_SZ,
+    .source   = {
 #define SDLOG_SOURCE_REG(_name, _fd_name, _fmt) [SDLOG_SOURCE_##_name] = (sdlog_ctrl_source_t){ \
                                                     .name = (_fd_name),                         \
                                                     .fmt  = (_fmt),                             \
@@ -72,6 +151,45 @@ sdlog_ctrl_t sdlog_ctrl = {
 
 #define SDLOG_SOURCE(x) (&sdlog_ctrl.source[x])
 
+// ----------
+// SYSCFG
+// ----------
+static void _sdlog_policy_set(sdlog_policy_t *p_policy, const char *key, const char *value)
+{
+    uint32_t num = strtoul(value, NULL, 10);
+    if (strcmp(key, "autostart") == 0) {
+        p_policy->autostart = (strcmp(value, "on") == 0);
+    } else if (strcmp(key, "max_size_mb") == 0) {
+        p_policy->max_size_mb = (num < 4095) ? num : 4095; // FAT32 file size limit
+    } else if (strcmp(key, "max_duration_min") == 0) {
+        p_policy->max_duration_s = num * 60;
+    } else if (strcmp(key, "quota_mb") == 0) {
+        p_policy->quota_mb = num;
+    } else if (strcmp(key, "free_low_mb") == 0) {
+        p_policy->free_low_mb = num;
+    } else if (strcmp(key, "free_high_mb") == 0) {
+        p_policy->free_high_mb = num;
+    }
+}
+
+uint32_t sdlog_syscfg(const char *section, const char *key, const char *value)
+{
+    const char *p_dot = strchr(key, '.');
+    if (p_dot) { // <source>.<policy>
+        for (uint32_t i = 0; i < SDLOG_SOURCE_NUM; i++) {
+            sdlog_ctrl_source_t *p_src = SDLOG_SOURCE(i);
+            if (strlen(p_src->name) == (size_t)(p_dot - key) && strncmp(key, p_src->name, p_dot - key) == 0) {
+                _sdlog_policy_set(&p_src->policy, p_dot + 1, value);
+            }
+        }
+    } else if (strcmp(key, "deferred_fmt") == 0) {
+        sdlog_ctrl.deferred_fmt = (strcmp(value, "on") == 0);
+    } else if (strcmp(key, "spill_kb") == 0) {
+        sdlog_ctrl.spill_sz = strtoul(value, NULL, 10) * 1024;
+    }
+    return 1;
+}
+
 // ----------
 // Operate API
 // ----------
@@ -79,6 +197,8 @@ enum {
     SDLOG_CMD_START = 0,
     SDLOG_CMD_STOP,
     SDLOG_CMD_WRITE,
+    SDLOG_CMD_WRITE_RAW, // a batch of records, already in the log.bin layout
+    SDLOG_CMD_WRITE_FMT, // a SDLOG_FMT_TEXT__BIN record, preceded by the address of its format string
 };
 
 typedef struct sdlog_cmd_s {
@@ -132,7 +252,12 @@ void sdlog_stop(uint32_t source)
     }
 }
 
-void sdlog_write(uint32_t source, uint32_t type_data, uint32_t len, const void *payload)
+esp_err_t sdlog_write(uint32_t source, uint32_t type_data, uint32_t len, const void *payload)
+{
+    return sdlog_write_ts(source, type_data, esp_timer_get_time(), len, payload);
+}
+
+esp_err_t sdlog_write_ts(uint32_t source, uint32_t type_data, int64_t us_sys_time, uint32_t len, const void *payload)
 {
     void *p_buf;
     BaseType_t res = xRingbufferSendAcquire(sdlog_ctrl.sdlog_task_inbuf, &p_buf, sizeof(sdlog_cmd_t) + len, 0);
@@ -143,30 +268,273 @@ void sdlog_write(uint32_t source, uint32_t type_data, uint32_t len, const void *
         p_cmd->cmd         = SDLOG_CMD_WRITE;
         p_cmd->type_data   = type_data;
         p_cmd->length      = len;
-        p_cmd->us_sys_time = esp_timer_get_time();
+        p_cmd->us_sys_time = us_sys_time;
 
         memcpy(p_buf + sizeof(sdlog_cmd_t), payload, len);
 
         xRingbufferSendComplete(sdlog_ctrl.sdlog_task_inbuf, p_buf); // notify rbuf to read
+        return ESP_OK;
+    }
+
+    // Don't print here, the console source writes through this API and would recurse
+    if (source < SDLOG_SOURCE_NUM) {
+        __atomic_fetch_add(&SDLOG_SOURCE(source)->drop_cnt, 1, __ATOMIC_RELAXED);
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+// num records of the same type and length in one ring buffer item
+// The records are laid out as in log.bin (sdlog_data_t + padded payload), sdlog_task writes them with one fwrite()
+// The batch is dropped as a whole if the ring buffer is full
+esp_err_t sdlog_write_batch(uint32_t source, uint32_t type_data, uint32_t num, uint32_t len, const int64_t *p_us_sys_time, const void *payload)
+{
+    uint32_t pad_sz = (len + 7) / 8 * 8;
+    uint32_t rec_sz = sizeof(sdlog_data_t) + pad_sz;
+
+    void *p_buf;
+    BaseType_t res = xRingbufferSendAcquire(sdlog_ctrl.sdlog_task_inbuf, &p_buf, sizeof(sdlog_cmd_t) + num * rec_sz, 0);
+
+    if (res == pdTRUE && p_buf) {
+        sdlog_cmd_t *p_cmd = (sdlog_cmd_t *)p_buf;
+        p_cmd->source      = source;
+        p_cmd->cmd         = SDLOG_CMD_WRITE_RAW;
+        p_cmd->type_data   = type_data;
+        p_cmd->length      = num * rec_sz;
+        p_cmd->us_sys_time = p_us_sys_time[0];
+
+        uint8_t *p_rec = p_buf + sizeof(sdlog_cmd_t);
+        for (uint32_t i = 0; i < num; i++, p_rec += rec_sz) {
+            sdlog_data_t *p_data = (sdlog_data_t *)p_rec;
+            p_data->magic        = 0xA5;
+            p_data->type_data    = type_data;
+            p_data->reserved[0]  = 0;
+            p_data->reserved[1]  = 0;
+            p_data->payload_len  = len;
+            p_data->us_sys_time  = p_us_sys_time[i];
+            memcpy(p_data + 1, (const uint8_t *)payload + i * len, len);
+            memset((uint8_t *)(p_data + 1) + len, 0, pad_sz - len);
+        }
+
+        xRingbufferSendComplete(sdlog_ctrl.sdlog_task_inbuf, p_buf); // notify rbuf to read
+        return ESP_OK;
+    }
+
+    if (source < SDLOG_SOURCE_NUM) {
+        __atomic_fetch_add(&SDLOG_SOURCE(source)->drop_cnt, num, __ATOMIC_RELAXED);
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+// Only the arguments are copied, the format string is referenced by its address, so it must be a literal (in flash)
+// sdlog_task writes the string table entry (SDLOG_FMT_TEXT__FMT) the first time the opened file meets the ID
+esp_err_t sdlog_write_fmt(uint32_t source, const char *fmt, va_list args)
+{
+    if (!sdlog_ctrl.deferred_fmt || !esp_ptr_in_drom(fmt)) {
+        return ESP_ERR_NOT_SUPPORTED; // a format in RAM may be gone by the time sdlog_task reads it
+    }
+
+    uint8_t arg[SDLOG_FMT_ARG_MAX];
+    int32_t arg_len = sdlog_fmt_pack(fmt, args, arg, sizeof(arg));
+    if (arg_len < 0) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    uint64_t fmt_addr = (uintptr_t)fmt;
+    uint32_t fmt_id   = (uint32_t)(uintptr_t)fmt;
+    uint32_t len      = sizeof(fmt_addr) + sizeof(fmt_id) + arg_len;
+
+    void *p_buf;
+    BaseType_t res = xRingbufferSendAcquire(sdlog_ctrl.sdlog_task_inbuf, &p_buf, sizeof(sdlog_cmd_t) + len, 0);
+
+    if (res == pdTRUE && p_buf) {
+        sdlog_cmd_t *p_cmd = (sdlog_cmd_t *)p_buf;
+        p_cmd->source      = source;
+        p_cmd->cmd         = SDLOG_CMD_WRITE_FMT;
+        p_cmd->type_data   = SDLOG_FMT_TEXT__BIN;
+        p_cmd->length      = len;
+        p_cmd->us_sys_time = esp_timer_get_time();
+
+        uint8_t *p_payload = p_buf + sizeof(sdlog_cmd_t);
+        memcpy(p_payload, &fmt_addr, sizeof(fmt_addr));
+        memcpy(p_payload + sizeof(fmt_addr), &fmt_id, sizeof(fmt_id));
+        memcpy(p_payload + sizeof(fmt_addr) + sizeof(fmt_id), arg, arg_len);
+
+        xRingbufferSendComplete(sdlog_ctrl.sdlog_task_inbuf, p_buf); // notify rbuf to read
+        return ESP_OK;
+    }
+
+    if (source < SDLOG_SOURCE_NUM) {
+        __atomic_fetch_add(&SDLOG_SOURCE(source)->drop_cnt, 1, __ATOMIC_RELAXED);
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+uint32_t sdlog_backlog(void)
+{
+    if (sdlog_ctrl.sdlog_task_inbuf == NULL) {
+        return 0;
+    }
+    return SDLOG_TASK_INBUF_SZ - xRingbufferGetCurFreeSize(sdlog_ctrl.sdlog_task_inbuf);
+}
+
+// ----------
+// Serial number of the sessions
+// ----------
+// The next serial number of every source is cached in NVS, the boot doesn't read the log folders
+// - sn = 0 is unknown (no cache, first boot), sdlog_service_scan() scans the folder in the background, or the first
+//   START does it if it comes earlier
+// - START checks the cache with one stat(): if the folder already exists (the SD card was swapped), it scans
+// - they are reserved by blocks of SDLOG_SN_BLOCK, the NVS write (flash cache off) is once per block and not per file
+//   of the rollovers or remounts, TWAI_RX would miss its FIFO meanwhile. A reboot skips the rest of the block
+// - so sn - 1 may never have been used, the last closed one is tracked apart (sn_closed) for the retention, the
+//   background scan rebuilds it from the folders, then every close updates it
+// the highest serial number of the folders below sn_below
+static uint32_t sdlog_find_max_sn(const char *dir_path, uint32_t sn_below)
+{
+    DIR *dir = opendir(dir_path);
+    if (dir == NULL) {
+        return 0;
+    }
+
+    struct dirent *entry;
+    uint32_t max_sn = 0;
+
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_type == DT_DIR) {
+            uint32_t current_sn = (uint32_t)strtoul(entry->d_name, NULL, 10);
+            if (current_sn > max_sn && current_sn < sn_below) {
+                max_sn = current_sn;
+            }
+        }
+    }
+    closedir(dir);
+    return max_sn;
+}
+
+// returns the next serial number of the source, from the folders on the SD card
+static uint32_t _sdlog_sn_scan(sdlog_ctrl_source_t *p_src)
+{
+    char full_path[256];
+    snprintf(full_path, sizeof(full_path), "%s/%s", sdlog_ctrl.root, p_src->name);
+
+    int64_t us_beg  = esp_timer_get_time();
+    uint32_t max_sn = sdlog_find_max_sn(full_path, UINT32_MAX);
+    ESP_LOGI(TAG, "%s max_sn=%" PRIu32 ", scan %" PRId64 " ms", full_path, max_sn, (esp_timer_get_time() - us_beg) / 1000);
+    return max_sn + 1;
+}
+
+static void _sdlog_sn_save(sdlog_ctrl_source_t *p_src, uint32_t sn_next)
+{
+    p_src->sn_reserved = sn_next;
+    if (sdlog_ctrl.nvs_ok && nvs_set_u32(sdlog_ctrl.nvs, p_src->name, sn_next) == ESP_OK) {
+        nvs_commit(sdlog_ctrl.nvs);
+    }
+}
+
+// takes sn, a new block is reserved if it's beyond the one in NVS
+static void _sdlog_sn_take(sdlog_ctrl_source_t *p_src, uint32_t sn)
+{
+    if (sn >= p_src->sn_reserved) {
+        _sdlog_sn_save(p_src, sn + SDLOG_SN_BLOCK);
+    }
+}
+
+// ----------
+// SD card fault: spill buffer
+// ----------
+// rec_num records of rec_sz bytes went into the FILE at bytes_written. stdio (newlib, glibc alike) writes its buffer out
+// when it's full, at buf_base + n * SDLOG_FILE_BUF_SZ, the records before the last such offset are on the card
+static void _sdlog_task_wrote(sdlog_ctrl_source_t *p_src, uint32_t rec_num, uint32_t rec_sz)
+{
+    uint32_t beg = p_src->bytes_written;
+    uint32_t len = rec_num * rec_sz;
+    uint32_t out = p_src->buf_base + (beg + len - p_src->buf_base) / SDLOG_FILE_BUF_SZ * SDLOG_FILE_BUF_SZ;
+    if (out > beg) {
+        p_src->rec_flushed = p_src->rec_written + (out - beg) / rec_sz;
+    }
+    p_src->rec_written += rec_num;
+    p_src->bytes_written += len;
+    p_src->bytes_total += len;
+}
+
+// room for len bytes of rec_num records of the source, NULL if the spill buffer is full (the records are dropped)
+static uint8_t *_sdlog_spill_reserve(uint32_t source, uint32_t len, uint32_t rec_num)
+{
+    if (sdlog_ctrl.spill == NULL || sdlog_ctrl.spill_len + sizeof(sdlog_spill_hdr_t) + len > sdlog_ctrl.spill_sz) {
+        __atomic_fetch_add(&SDLOG_SOURCE(source)->drop_cnt, rec_num, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    sdlog_spill_hdr_t *p_hdr = (sdlog_spill_hdr_t *)(sdlog_ctrl.spill + sdlog_ctrl.spill_last);
+    if (sdlog_ctrl.spill_last < sdlog_ctrl.spill_len && p_hdr->source == source) {
+        p_hdr->len += len; // the same source as the last entry, no new header
     } else {
-        ESP_LOGE(TAG, "RB Acquire failed, buffer full?");
+        sdlog_ctrl.spill_last = sdlog_ctrl.spill_len;
+        p_hdr                 = (sdlog_spill_hdr_t *)(sdlog_ctrl.spill + sdlog_ctrl.spill_last);
+        p_hdr->source         = source;
+        p_hdr->len            = len;
+        sdlog_ctrl.spill_len += sizeof(sdlog_spill_hdr_t);
+    }
+
+    uint8_t *p_rec = sdlog_ctrl.spill + sdlog_ctrl.spill_len;
+    __atomic_store_n(&sdlog_ctrl.spill_len, sdlog_ctrl.spill_len + len, __ATOMIC_RELAXED);
+    return p_rec;
+}
+
+// the records of the sources with an opened file are written, the others stay in the spill buffer
+static void _sdlog_spill_flush(void)
+{
+    uint32_t rd = 0, wr = 0;
+    while (rd < sdlog_ctrl.spill_len) {
+        sdlog_spill_hdr_t *p_hdr   = (sdlog_spill_hdr_t *)(sdlog_ctrl.spill + rd);
+        sdlog_ctrl_source_t *p_src = SDLOG_SOURCE(p_hdr->source);
+        uint32_t entry_sz          = sizeof(sdlog_spill_hdr_t) + p_hdr->len;
+
+        if (p_src->fp) {
+            fwrite(p_hdr + 1, 1, p_hdr->len, p_src->fp);
+            for (uint32_t pos = 0; pos < p_hdr->len;) {
+                const sdlog_data_t *p_data = (const sdlog_data_t *)((uint8_t *)(p_hdr + 1) + pos);
+                uint32_t rec_sz            = sizeof(sdlog_data_t) + (p_data->payload_len + 7) / 8 * 8;
+                _sdlog_task_wrote(p_src, 1, rec_sz);
+                pos += rec_sz;
+            }
+        } else {
+            memmove(sdlog_ctrl.spill + wr, p_hdr, entry_sz);
+            wr += entry_sz;
+        }
+        rd += entry_sz;
     }
+    sdlog_ctrl.spill_last = wr; // none, a new entry for the next record
+    __atomic_store_n(&sdlog_ctrl.spill_len, wr, __ATOMIC_RELAXED);
 }
 
 // ----------
 // SDLOG TASK IMPLEMENTATION
 // ----------
-static void _sdlog_task_openfile(sdlog_cmd_t *p_cmd, void *p_payload)
+static void _sdlog_task_first_rec(sdlog_ctrl_source_t *p_src)
 {
-    sdlog_ctrl_source_t *p_src = SDLOG_SOURCE(p_cmd->source);
-    if (p_src->fp) {
-        ESP_LOGI(TAG, "ch %s already opened", p_src->name);
-        return;
+    if (p_src->us_first_rec == 0) {
+        p_src->us_first_rec = esp_timer_get_time();
+        ESP_LOGI(TAG, "%s first record logged %" PRIu64 " ms after boot", p_src->name, p_src->us_first_rec / 1000);
     }
+}
+
+// the log file of the session: folder, file and header with the time base in p_src, 0 if it failed
+static uint32_t _sdlog_task_create(uint32_t source)
+{
+    sdlog_ctrl_source_t *p_src = SDLOG_SOURCE(source);
 
-    // create the output folder
+    // create the output folder, the cached serial number is trusted unless its folder already exists
     char full_path[256];
-    snprintf(full_path, sizeof(full_path), "%s/%s/%06" PRIu32, sdlog_ctrl.root, p_src->name, p_src->sn);
+    struct stat st;
+    uint32_t sn = __atomic_load_n(&p_src->sn, __ATOMIC_RELAXED);
+    snprintf(full_path, sizeof(full_path), "%s/%s/%06" PRIu32, sdlog_ctrl.root, p_src->name, sn);
+    if (sn == 0 || stat(full_path, &st) == 0) {
+        sn = _sdlog_sn_scan(p_src);
+        snprintf(full_path, sizeof(full_path), "%s/%s/%06" PRIu32, sdlog_ctrl.root, p_src->name, sn);
+    }
+    __atomic_store_n(&p_src->sn, sn, __ATOMIC_RELAXED);
+    _sdlog_sn_take(p_src, sn); // taken even if the session is cut by a power loss
     mkdir(full_path, 0700);
 
     // open log file
@@ -176,15 +544,18 @@ static void _sdlog_task_openfile(sdlog_cmd_t *p_cmd, void *p_payload)
 
     if (p_src->fp == NULL) { // check whether file open success
         ESP_LOGE(TAG, "ch %s file open error", p_src->name);
-        return;
+        return 0;
     }
 
-    p_src->wbuf = malloc(SDLOG_FILE_BUF_SZ);
+    p_src->wbuf = sdlog_pool_get(SDLOG_POOL_WBUF);
     if (p_src->wbuf) {
         setvbuf(p_src->fp, p_src->wbuf, _IOFBF, SDLOG_FILE_BUF_SZ); // set the wbuf of the FILE*, it writes to the SD card every 4KB
     }
-
-    p_src->bytes_written = 0; // reset the statistics
+    p_src->bytes_written = 0;
+    p_src->rec_written   = 0;
+    p_src->rec_flushed   = 0;
+    p_src->rec_safe      = 0;
+    p_src->buf_base      = 0;
 
     sdlog_header_t sdlog_header = {0};
 
@@ -192,8 +563,9 @@ static void _sdlog_task_openfile(sdlog_cmd_t *p_cmd, void *p_payload)
     strlcpy(sdlog_header.sys.magic, "QQMLAB", sizeof(sdlog_header.sys.magic));
     sdlog_header.sys.version       = 1;
     sdlog_header.sys.header_sz     = 512;
-    sdlog_header.sys.us_epoch_time = *(uint64_t *)(p_payload);
-    sdlog_header.sys.us_sys_time   = p_cmd->us_sys_time;
+    sdlog_header.sys.us_epoch_time = p_src->us_epoch_open;
+    sdlog_header.sys.us_sys_time   = p_src->us_open;
+    sdlog_header.sys.epoch_src     = p_src->epoch_src;
     sdlog_header.sys.fmt           = p_src->fmt;
     strlcpy(sdlog_header.sys.board_name, BOARD_NAME, sizeof(sdlog_header.sys.board_name));
     strlcpy(sdlog_header.sys.firmware_ver, "20260107", sizeof(sdlog_header.sys.firmware_ver));
@@ -201,64 +573,383 @@ static void _sdlog_task_openfile(sdlog_cmd_t *p_cmd, void *p_payload)
     sdlog_header.sys.offset_data = 1024;
 
     // sdlog_header.meta
-    snprintf(sdlog_header.meta.description, sizeof(sdlog_header.meta.description), "Source: %d, Name: %s", p_cmd->source, p_src->name);
+    snprintf(sdlog_header.meta.description, sizeof(sdlog_header.meta.description), "Source: %" PRIu32 ", Name: %s", source, p_src->name);
 
     // write to the file
-    if (fwrite(&sdlog_header, sizeof(sdlog_header), 1, p_src->fp) != 1) {
-        assert(0); // TODO: we should handle this error, such as mark the channel ERROR
-        return;
+    if (fwrite(&sdlog_header, sizeof(sdlog_header), 1, p_src->fp) != 1) { // the card is full, or gone
+        ESP_LOGE(TAG, "ch %s header write error", p_src->name);
+        fclose(p_src->fp);
+        p_src->fp = NULL;
+        sdlog_pool_put(SDLOG_POOL_WBUF, p_src->wbuf);
+        p_src->wbuf = NULL;
+        return 0;
     }
     p_src->bytes_written += sizeof(sdlog_header);
+    p_src->bytes_total += sizeof(sdlog_header);
+    return 1;
+}
+
+// the log file of the source is lost, the session goes on in the spill buffer until the card is remounted
+static void _sdlog_task_fault(uint32_t source)
+{
+    sdlog_ctrl_source_t *p_src = SDLOG_SOURCE(source);
+    if (p_src->fp) {
+        uint32_t lost = p_src->rec_written - p_src->rec_safe;
+        __atomic_fetch_add(&p_src->drop_cnt, lost, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&p_src->fault_lost, lost, __ATOMIC_RELAXED);
+        fclose(p_src->fp); // fails too, the buffered tail is lost
+        p_src->fp = NULL;
+        __atomic_store_n(&p_src->sn_closed, p_src->sn, __ATOMIC_RELAXED);
+        __atomic_store_n(&p_src->sn, p_src->sn + 1, __ATOMIC_RELAXED); // the broken file keeps its serial number
+    }
+    sdlog_pool_put(SDLOG_POOL_WBUF, p_src->wbuf);
+    p_src->wbuf         = NULL;
+    p_src->fmt_seen_num = 0; // the spilled records carry the string table again, the next file starts with them
+    if (p_src->fmt_seen) {
+        memset(p_src->fmt_seen, 0, SDLOG_FMT_SEEN_NUM * sizeof(uint32_t));
+    }
+    p_src->fault = SDLOG_FAULT_SPILL;
+
+    if (!sdlog_ctrl.sd_fault) {
+        if (sdlog_ctrl.spill == NULL && sdlog_ctrl.spill_sz) {
+            sdlog_ctrl.spill = malloc(sdlog_ctrl.spill_sz);
+        }
+        sdlog_ctrl.spill_len  = 0;
+        sdlog_ctrl.spill_last = 0;
+        sdlog_ctrl.us_remount = esp_timer_get_time() + SDLOG_REMOUNT_MS * 1000;
+        sdlog_ctrl.sd_fault   = 1;
+    }
+    sd_card_fault();
+    ESP_LOGE(TAG, "%s SD card fault, spill buffer %" PRIu32 " bytes", p_src->name, sdlog_ctrl.spill ? sdlog_ctrl.spill_sz : 0);
+}
+
+static void _sdlog_task_openfile(sdlog_cmd_t *p_cmd, void *p_payload)
+{
+    sdlog_ctrl_source_t *p_src = SDLOG_SOURCE(p_cmd->source);
+    if (p_src->fp || p_src->fault == SDLOG_FAULT_SPILL) {
+        ESP_LOGI(TAG, "ch %s already opened", p_src->name);
+        return;
+    }
+    if (p_src->fault == SDLOG_FAULT_STOPPED) { // its records are still in the spill buffer, they share the file
+        ESP_LOGW(TAG, "ch %s restarted before the SD card is back, the stopped session goes on", p_src->name);
+        p_src->fault = SDLOG_FAULT_SPILL;
+        return;
+    }
+
+    // time base of the session, kept by the files after a rollover or a remount
+    p_src->us_open       = p_cmd->us_sys_time;
+    p_src->us_epoch_open = *(uint64_t *)(p_payload);
+    p_src->epoch_src     = SDLOG_EPOCH_GIVEN;
+    if (p_src->us_epoch_open == 0) { // provisional, the device clock at the START
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        p_src->us_epoch_open = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec - (esp_timer_get_time() - p_cmd->us_sys_time);
+        p_src->epoch_src     = SDLOG_EPOCH_PROVISIONAL;
+    }
+
+    p_src->open_err     = 0;
+    p_src->fmt_seen_num = 0; // every file carries its own string table
+    if (p_src->fmt_seen) {
+        memset(p_src->fmt_seen, 0, SDLOG_FMT_SEEN_NUM * sizeof(uint32_t));
+    }
+
+    if (!_sdlog_task_create(p_cmd->source)) { // no card, or it's full: recorded in RAM until the remount
+        p_src->open_err = 1;
+        _sdlog_task_fault(p_cmd->source);
+    }
+}
+
+// START of sdlog_start(), the statistics of the session are reset here and not per file, a rollover keeps them
+static void _sdlog_task_start(sdlog_cmd_t *p_cmd, void *p_payload)
+{
+    sdlog_ctrl_source_t *p_src = SDLOG_SOURCE(p_cmd->source);
+    if (p_src->fp == NULL && p_src->fault == SDLOG_FAULT_NONE) {
+        __atomic_store_n(&p_src->drop_cnt, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&p_src->fault_lost, 0, __ATOMIC_RELAXED);
+    }
+    _sdlog_task_openfile(p_cmd, p_payload);
 }
 
 static void _sdlog_task_closefile(sdlog_cmd_t *p_cmd, void *p_payload)
 {
     sdlog_ctrl_source_t *p_src = SDLOG_SOURCE(p_cmd->source);
 
+    if (p_src->fault == SDLOG_FAULT_SPILL) {
+        ESP_LOGW(TAG, "CH %s stopped, closed once the SD card is back", p_src->name);
+        p_src->fault = SDLOG_FAULT_STOPPED;
+        return;
+    }
+
     if (p_src->fp) {
         fclose(p_src->fp);
         p_src->fp = NULL;
-        if (p_src->wbuf) {
-            free(p_src->wbuf);
-            p_src->wbuf = NULL;
-        }
+        sdlog_pool_put(SDLOG_POOL_WBUF, p_src->wbuf);
+        p_src->wbuf = NULL;
+        free(p_src->fmt_seen);
+        p_src->fmt_seen = NULL;
         ESP_LOGI(TAG, "CH %s logging stopped", p_src->name);
 
         char log_path[256];
         snprintf(log_path, sizeof(log_path), "%s/%s/%06" PRIu32 "/log.bin", sdlog_ctrl.root, p_src->name, p_src->sn);
 
-        sdlog_conv_trig(log_path);
+        if (SDLOG_CONV_ON_CLOSE) {
+            sdlog_conv_trig(log_path, SDLOG_EXPORTER_AUTO, SDLOG_CONV_PRIO_AUTO);
+        }
+
+        __atomic_store_n(&p_src->sn_closed, p_src->sn, __ATOMIC_RELAXED);
+        __atomic_store_n(&p_src->sn, p_src->sn + 1, __ATOMIC_RELAXED);
+    }
+}
+
+// every session in fault gets a new file and its spilled records, then the stopped ones are closed
+static void _sdlog_task_remount(void)
+{
+    sdlog_ctrl.us_remount = esp_timer_get_time() + SDLOG_REMOUNT_MS * 1000;
+    if (sd_card_remount() != ESP_OK) {
+        sd_card_fault();
+        return;
+    }
+
+    char full_path[128];
+    mkdir(sdlog_ctrl.root, 0700); // may be another card
+    for (uint32_t i = 0; i < SDLOG_SOURCE_NUM; i++) {
+        sdlog_ctrl_source_t *p_src = SDLOG_SOURCE(i);
+        if (p_src->fault != SDLOG_FAULT_NONE) {
+            mkdir(sdlog_source_path(i, full_path, sizeof(full_path)), 0700);
+            _sdlog_task_create(i);
+        }
+    }
+    _sdlog_spill_flush();
+
+    uint32_t fault = 0;
+    for (uint32_t i = 0; i < SDLOG_SOURCE_NUM; i++) {
+        sdlog_ctrl_source_t *p_src = SDLOG_SOURCE(i);
+        if (p_src->fault == SDLOG_FAULT_NONE) {
+            continue;
+        }
+        if (p_src->fp == NULL || ferror(p_src->fp)) { // the spilled records of a write error are lost
+            _sdlog_task_fault(i);
+            fault = 1;
+            continue;
+        }
+
+        p_src->rec_safe = p_src->rec_flushed;
+        ESP_LOGI(TAG, "%s SD card back, session %" PRIu32 " goes on", p_src->name, p_src->sn);
+        uint32_t stopped = (p_src->fault == SDLOG_FAULT_STOPPED);
+        p_src->fault     = SDLOG_FAULT_NONE;
+        p_src->open_err  = 0;
+        if (stopped) {
+            sdlog_cmd_t cmd = {.source = i, .cmd = SDLOG_CMD_STOP};
+            _sdlog_task_closefile(&cmd, NULL);
+        }
+    }
+
+    if (!fault) {
+        free(sdlog_ctrl.spill);
+        sdlog_ctrl.spill = NULL;
+        __atomic_store_n(&sdlog_ctrl.spill_len, 0, __ATOMIC_RELAXED);
+        sdlog_ctrl.sd_fault = 0;
+    }
+}
+
+// the session takes records: a file is opened, or it's in the spill buffer
+static inline uint32_t _sdlog_task_active(sdlog_ctrl_source_t *p_src)
+{
+    return p_src->fp || p_src->fault == SDLOG_FAULT_SPILL;
+}
+
+// one record, the payload is the concatenation of head and body
+static uint32_t _sdlog_task_write_rec(sdlog_ctrl_source_t *p_src, uint32_t type_data, uint64_t us_sys_time, const void *p_head, uint32_t head_len, const void *p_body, uint32_t body_len)
+{
+    uint32_t length  = head_len + body_len;
+    uint32_t pad_len = (length + 7) / 8 * 8 - length;
+    _sdlog_task_first_rec(p_src);
+
+    // header
+    sdlog_data_t sdlog_data = {
+        .magic       = 0xA5, // magic word
+        .type_data   = type_data,
+        .reserved    = {0, 0},
+        .payload_len = length,
+        .us_sys_time = us_sys_time,
+    };
+
+    if (p_src->fp == NULL) { // SD card fault, the whole record or nothing
+        uint8_t *p_rec = _sdlog_spill_reserve(p_src - sdlog_ctrl.source, sizeof(sdlog_data) + length + pad_len, 1);
+        if (p_rec) {
+            memcpy(p_rec, &sdlog_data, sizeof(sdlog_data));
+            p_rec += sizeof(sdlog_data);
+            if (head_len) {
+                memcpy(p_rec, p_head, head_len);
+            }
+            if (body_len) {
+                memcpy(p_rec + head_len, p_body, body_len);
+            }
+            memset(p_rec + length, 0, pad_len);
+        }
+        return p_rec != NULL;
+    }
+
+    uint32_t ok = (fwrite(&sdlog_data, sizeof(sdlog_data), 1, p_src->fp) == 1);
 
-        p_src->sn++;
+    // Body
+    if (head_len) {
+        ok &= (fwrite(p_head, 1, head_len, p_src->fp) == head_len);
     }
+    if (body_len) {
+        ok &= (fwrite(p_body, 1, body_len, p_src->fp) == body_len);
+    }
+
+    // padding
+    if (pad_len) {
+        static const uint8_t padding_zeros[8] = {0};
+        ok &= (fwrite(padding_zeros, 1, pad_len, p_src->fp) == pad_len);
+    }
+    _sdlog_task_wrote(p_src, 1, sizeof(sdlog_data) + length + pad_len); // a short write is lost with the file at the fault
+    return ok;
+}
+
+// the first time sync record of a file with a provisional epoch, the header is rewritten with the synced clock
+// In the spill buffer, the file created at the remount gets it
+static void _sdlog_task_fix_epoch(sdlog_ctrl_source_t *p_src, const sdlog_time_sync_t *p_sync)
+{
+    uint64_t us_epoch = p_sync->us_epoch_time - (p_sync->us_sys_time - p_src->us_open);
+    uint32_t src      = SDLOG_EPOCH_CORRECTED;
+
+    if (p_src->fp) {
+        long pos = ftell(p_src->fp);
+        fseek(p_src->fp, offsetof(sdlog_header_t, sys.us_epoch_time), SEEK_SET);
+        fwrite(&us_epoch, sizeof(us_epoch), 1, p_src->fp);
+        fseek(p_src->fp, offsetof(sdlog_header_t, sys.epoch_src), SEEK_SET);
+        fwrite(&src, sizeof(src), 1, p_src->fp);
+        fseek(p_src->fp, pos, SEEK_SET); // the FILE buffer was written out by the fseek()
+        p_src->buf_base    = pos;
+        p_src->rec_flushed = p_src->rec_written;
+    }
+
+    ESP_LOGI(TAG, "%s provisional epoch corrected by %" PRId64 " ms", p_src->name, (int64_t)(us_epoch - p_src->us_epoch_open) / 1000);
+    p_src->us_epoch_open = us_epoch;
+    p_src->epoch_src     = SDLOG_EPOCH_CORRECTED;
 }
 
 static void _sdlog_task_write(sdlog_cmd_t *p_cmd, void *p_payload)
 {
     sdlog_ctrl_source_t *p_src = SDLOG_SOURCE(p_cmd->source);
-    if (p_src->fp) {
-        // header
-        sdlog_data_t sdlog_data = {
-            .magic       = 0xA5, // magic word
-            .type_data   = p_cmd->type_data,
-            .reserved    = {0, 0},
-            .payload_len = p_cmd->length,
-            .us_sys_time = p_cmd->us_sys_time,
-        };
-        fwrite(&sdlog_data, sizeof(sdlog_data), 1, p_src->fp);
+    if (_sdlog_task_active(p_src)) {
+        _sdlog_task_write_rec(p_src, p_cmd->type_data, p_cmd->us_sys_time, p_payload, p_cmd->length, NULL, 0);
+        if (p_cmd->type_data == SDLOG_TYPE_TIME_SYNC && p_src->epoch_src == SDLOG_EPOCH_PROVISIONAL && p_cmd->length == sizeof(sdlog_time_sync_t)) {
+            _sdlog_task_fix_epoch(p_src, p_payload);
+        }
+    }
+}
+
+// 1 if the string table entry of the ID is already in the opened file, it is marked by _sdlog_fmt_mark() once stored
+static uint32_t _sdlog_fmt_seen(sdlog_ctrl_source_t *p_src, uint32_t fmt_id)
+{
+    if (p_src->fmt_seen == NULL) {
+        p_src->fmt_seen = calloc(SDLOG_FMT_SEEN_NUM, sizeof(uint32_t));
+        if (p_src->fmt_seen == NULL) {
+            return 0;
+        }
+    }
 
-        // Body
-        if (p_cmd->length) {
-            fwrite(p_payload, 1, p_cmd->length, p_src->fp);
+    uint32_t i = ((fmt_id * 2654435761u) >> 16) % SDLOG_FMT_SEEN_NUM;
+    for (uint32_t k = 0; k < SDLOG_FMT_SEEN_NUM; k++, i = (i + 1) % SDLOG_FMT_SEEN_NUM) {
+        if (p_src->fmt_seen[i] == fmt_id) {
+            return 1;
         }
+        if (p_src->fmt_seen[i] == 0) {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+// the table entry of fmt_id is stored in the file (or the spill buffer), the next records only reference it
+static void _sdlog_fmt_mark(sdlog_ctrl_source_t *p_src, uint32_t fmt_id)
+{
+    if (p_src->fmt_seen == NULL || p_src->fmt_seen_num >= SDLOG_FMT_SEEN_NUM * 3 / 4) {
+        return;
+    }
+    uint32_t i = ((fmt_id * 2654435761u) >> 16) % SDLOG_FMT_SEEN_NUM;
+    while (p_src->fmt_seen[i] != 0 && p_src->fmt_seen[i] != fmt_id) {
+        i = (i + 1) % SDLOG_FMT_SEEN_NUM;
+    }
+    if (p_src->fmt_seen[i] == 0) {
+        p_src->fmt_seen[i] = fmt_id;
+        p_src->fmt_seen_num++;
+    }
+}
 
-        // padding
-        uint32_t pad_len = (p_cmd->length + 7) / 8 * 8 - p_cmd->length;
-        if (pad_len) {
-            static const uint8_t padding_zeros[8] = {0};
-            fwrite(padding_zeros, 1, pad_len, p_src->fp);
+static void _sdlog_task_write_fmt(sdlog_cmd_t *p_cmd, void *p_payload)
+{
+    sdlog_ctrl_source_t *p_src = SDLOG_SOURCE(p_cmd->source);
+    if (_sdlog_task_active(p_src)) {
+        uint64_t fmt_addr;
+        uint32_t fmt_id;
+        memcpy(&fmt_addr, p_payload, sizeof(fmt_addr));
+        memcpy(&fmt_id, p_payload + sizeof(fmt_addr), sizeof(fmt_id));
+
+        if (!_sdlog_fmt_seen(p_src, fmt_id)) {
+            const char *fmt = (const char *)(uintptr_t)fmt_addr;
+            if (!_sdlog_task_write_rec(p_src, SDLOG_FMT_TEXT__FMT, p_cmd->us_sys_time, &fmt_id, sizeof(fmt_id), fmt, strlen(fmt))) {
+                // not stored, a BIN record would reference a string the file doesn't have
+                __atomic_fetch_add(&p_src->drop_cnt, 1, __ATOMIC_RELAXED);
+                return;
+            }
+            _sdlog_fmt_mark(p_src, fmt_id);
         }
-        p_src->bytes_written += sizeof(sdlog_data) + p_cmd->length + pad_len;
+        _sdlog_task_write_rec(p_src, SDLOG_FMT_TEXT__BIN, p_cmd->us_sys_time, p_payload + sizeof(fmt_addr), p_cmd->length - sizeof(fmt_addr), NULL, 0);
+    }
+}
+
+static void _sdlog_task_write_raw(sdlog_cmd_t *p_cmd, void *p_payload)
+{
+    sdlog_ctrl_source_t *p_src = SDLOG_SOURCE(p_cmd->source);
+    const sdlog_data_t *p_data = p_payload; // the records of a batch have the same length
+    uint32_t rec_sz            = sizeof(sdlog_data_t) + (p_data->payload_len + 7) / 8 * 8;
+    if (p_src->fp) {
+        _sdlog_task_first_rec(p_src);
+        fwrite(p_payload, 1, p_cmd->length, p_src->fp);
+        _sdlog_task_wrote(p_src, p_cmd->length / rec_sz, rec_sz);
+    } else if (p_src->fault == SDLOG_FAULT_SPILL) {
+        _sdlog_task_first_rec(p_src);
+        uint8_t *p_rec = _sdlog_spill_reserve(p_cmd->source, p_cmd->length, p_cmd->length / rec_sz);
+        if (p_rec) {
+            memcpy(p_rec, p_payload, p_cmd->length);
+        }
+    }
+}
+
+// after every write: a write error of the file (SD card fault), then max_size_mb/max_duration_min of the source,
+// the session continues in a new file with the next serial number
+static void _sdlog_task_policy(sdlog_cmd_t *p_cmd)
+{
+    sdlog_ctrl_source_t *p_src = SDLOG_SOURCE(p_cmd->source);
+    sdlog_policy_t *p_policy   = &p_src->policy;
+    if (p_src->fp && ferror(p_src->fp)) {
+        _sdlog_task_fault(p_cmd->source);
+        return;
+    }
+    p_src->rec_safe = p_src->rec_flushed;
+    if (p_src->fp == NULL || (p_policy->max_size_mb == 0 && p_policy->max_duration_s == 0)) {
+        return;
+    }
+
+    uint64_t us_elapsed = p_cmd->us_sys_time - p_src->us_open;
+    if ((p_policy->max_size_mb && p_src->bytes_written >= ((uint64_t)p_policy->max_size_mb << 20)) ||
+        (p_policy->max_duration_s && us_elapsed >= (uint64_t)p_policy->max_duration_s * 1000000)) {
+        // the new file keeps the time base, a provisional epoch stays provisional
+        uint64_t us_epoch = (p_src->epoch_src == SDLOG_EPOCH_PROVISIONAL) ? 0 : p_src->us_epoch_open + us_elapsed;
+        sdlog_cmd_t cmd   = {
+            .source      = p_cmd->source,
+            .cmd         = SDLOG_CMD_START,
+            .length      = sizeof(us_epoch),
+            .us_sys_time = p_cmd->us_sys_time,
+        };
+        ESP_LOGI(TAG, "%s session %" PRIu32 " rolled over, %" PRIu32 " bytes, %" PRIu64 " s", p_src->name, p_src->sn, p_src->bytes_written, us_elapsed / 1000000);
+        _sdlog_task_closefile(&cmd, NULL);
+        _sdlog_task_openfile(&cmd, &us_epoch);
     }
 }
 
@@ -266,21 +957,33 @@ void sdlog_task(void *param)
 {
     while (1) {
         size_t buf_size;
-        void *p_buf = xRingbufferReceive(sdlog_ctrl.sdlog_task_inbuf, &buf_size, portMAX_DELAY);
+        TickType_t wait = sdlog_ctrl.sd_fault ? pdMS_TO_TICKS(SDLOG_REMOUNT_MS) : portMAX_DELAY;
+        void *p_buf     = xRingbufferReceive(sdlog_ctrl.sdlog_task_inbuf, &buf_size, wait);
         if (p_buf) {
             sdlog_cmd_t *p_cmd = (sdlog_cmd_t *)p_buf;
             void *p_payload    = p_buf + sizeof(sdlog_cmd_t);
 
             if (p_cmd->cmd == SDLOG_CMD_WRITE) { // put the common case in the beginning
                 _sdlog_task_write(p_cmd, p_payload);
+                _sdlog_task_policy(p_cmd);
+            } else if (p_cmd->cmd == SDLOG_CMD_WRITE_RAW) {
+                _sdlog_task_write_raw(p_cmd, p_payload);
+                _sdlog_task_policy(p_cmd);
+            } else if (p_cmd->cmd == SDLOG_CMD_WRITE_FMT) {
+                _sdlog_task_write_fmt(p_cmd, p_payload);
+                _sdlog_task_policy(p_cmd);
             } else if (p_cmd->cmd == SDLOG_CMD_START) {
-                _sdlog_task_openfile(p_cmd, p_payload);
+                _sdlog_task_start(p_cmd, p_payload);
             } else if (p_cmd->cmd == SDLOG_CMD_STOP) {
                 _sdlog_task_closefile(p_cmd, p_payload);
             }
 
             vRingbufferReturnItem(sdlog_ctrl.sdlog_task_inbuf, p_buf);
         }
+
+        if (sdlog_ctrl.sd_fault && esp_timer_get_time() >= sdlog_ctrl.us_remount) {
+            _sdlog_task_remount();
+        }
     }
 }
 
@@ -289,63 +992,39 @@ void sdlog_task_init(void)
     sdlog_ctrl.sdlog_task_inbuf = xRingbufferCreate(SDLOG_TASK_INBUF_SZ, RINGBUF_TYPE_NOSPLIT);
     assert(sdlog_ctrl.sdlog_task_inbuf);
 
-    BaseType_t xReturned = xTaskCreate(
-        sdlog_task, // Function pointer
-        "SDLOG",    // Task name
-        4096,       // 4096 words (16KB), we will have a lot of large data transfer in the task, enlarge it
-        (void *)0,  // Parameter passed into the task
-        6,          // Priority (FIXME: where can I find the priority table)
-        NULL);      // Task Hanlde, if no need, passes NULL
-
-    if (xReturned != pdPASS) {
-        ESP_LOGE("SDLOG TASK", "Failed to create task!");
-    }
+    task_create(TASK_ID_SDLOG, sdlog_task, NULL, NULL);
     sdlog_ctrl.init = 1; // mark the service init completed
 }
 
 // ----------
 // INIT API
 // ----------
-static uint32_t sdlog_find_max_sn(const char *dir_path)
-{
-    DIR *dir = opendir(dir_path);
-    assert(dir); // ensure this is not NULL
-
-    struct dirent *entry;
-    uint32_t max_sn = 0;
-
-    while ((entry = readdir(dir)) != NULL) {
-        if (entry->d_type == DT_DIR) {
-            uint32_t current_sn = (uint32_t)strtoul(entry->d_name, NULL, 10);
-            if (current_sn > max_sn) {
-                max_sn = current_sn;
-            }
-        }
-    }
-    closedir(dir);
-    return max_sn;
-}
-
 static void sdlog_service_create_fd(uint32_t source)
 {
+    sdlog_ctrl_source_t *p_src = SDLOG_SOURCE(source);
     struct stat st;
     char full_path[256];
 
     // Create log folder if it doesn't exist
-    snprintf(full_path, sizeof(full_path), "%s/%s", sdlog_ctrl.root, SDLOG_SOURCE(source)->name);
+    snprintf(full_path, sizeof(full_path), "%s/%s", sdlog_ctrl.root, p_src->name);
     if (stat(full_path, &st) == -1) {
         mkdir(full_path, 0700); // In FatFS, mode parameter (0700) is actually ignored, but it's a good habit to keep it
         ESP_LOGI(TAG, "Create folder %s", full_path);
     }
 
-    uint32_t max_sn = sdlog_find_max_sn(full_path);
-    ESP_LOGI(TAG, "%s max_sn=%" PRIu32, full_path, max_sn);
-
-    SDLOG_SOURCE(source)->sn = max_sn + 1;
+    uint32_t sn = 0;
+    if (sdlog_ctrl.nvs_ok) {
+        nvs_get_u32(sdlog_ctrl.nvs, p_src->name, &sn);
+    }
+    ESP_LOGI(TAG, "%s next sn=%" PRIu32 "%s", full_path, sn, sn ? " (cached)" : ", scan in the background");
+    p_src->sn          = sn;
+    p_src->sn_reserved = sn;
 }
 
 esp_err_t sdlog_service_init(void)
 {
+    sdlog_ctrl.nvs_ok = (nvs_open(SDLOG_NVS_NS, NVS_READWRITE, &sdlog_ctrl.nvs) == ESP_OK);
+
     // Create root folder, and each module's folder
     mkdir(sdlog_ctrl.root, 0700);
     for (uint32_t i = 0; i < SDLOG_SOURCE_NUM; i++) {
@@ -355,6 +1034,38 @@ esp_err_t sdlog_service_init(void)
     sdlog_task_init();
     sdlog_conv_task_init();
 
+    // the first commands of sdlog_task, before any record of the sources
+    for (uint32_t i = 0; i < SDLOG_SOURCE_NUM; i++) {
+        if (SDLOG_SOURCE(i)->policy.autostart) {
+            ESP_LOGI(TAG, "%s autostart", SDLOG_SOURCE(i)->name);
+            sdlog_start(i, 0);
+        }
+    }
+
+    return ESP_OK;
+}
+
+// background init, the serial numbers not in the cache, a START coming earlier scans by itself
+// The last closed file of the previous boot is the highest folder below the current serial number, unless a file
+// was closed meanwhile
+esp_err_t sdlog_service_scan(void)
+{
+    char full_path[256];
+    for (uint32_t i = 0; i < SDLOG_SOURCE_NUM; i++) {
+        sdlog_ctrl_source_t *p_src = SDLOG_SOURCE(i);
+        if (__atomic_load_n(&p_src->sn, __ATOMIC_RELAXED) == 0) {
+            uint32_t sn      = _sdlog_sn_scan(p_src);
+            uint32_t unknown = 0;
+            if (__atomic_compare_exchange_n(&p_src->sn, &unknown, sn, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                _sdlog_sn_save(p_src, sn);
+            }
+        }
+
+        snprintf(full_path, sizeof(full_path), "%s/%s", sdlog_ctrl.root, p_src->name);
+        uint32_t sn_closed = sdlog_find_max_sn(full_path, __atomic_load_n(&p_src->sn, __ATOMIC_RELAXED));
+        uint32_t none      = 0;
+        __atomic_compare_exchange_n(&p_src->sn_closed, &none, sn_closed, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    }
     return ESP_OK;
 }
 
@@ -366,13 +1077,26 @@ uint32_t sdlog_webui_query(uint32_t source, sdlog_webui_status_t *p_status)
     // by default, write the null report
     p_status->is_logging    = 0;
     p_status->bytes_written = 0;
+    p_status->drop_cnt      = 0;
+    p_status->fault_lost    = 0;
+    p_status->sn            = 0;
+    p_status->open_err      = 0;
+    p_status->us_first_rec  = 0;
+    p_status->sd_fault      = 0;
+    p_status->spill_bytes   = __atomic_load_n(&sdlog_ctrl.spill_len, __ATOMIC_RELAXED);
 
     if (source < SDLOG_SOURCE_NUM) {
         sdlog_ctrl_source_t *p_src = SDLOG_SOURCE(source);
         p_status->name             = p_src->name;
-        if (p_src->fp) {
-            p_status->is_logging    = 1;
+        p_status->open_err         = p_src->open_err;
+        p_status->us_first_rec     = p_src->us_first_rec;
+        p_status->sd_fault         = (p_src->fault != SDLOG_FAULT_NONE);
+        if (_sdlog_task_active(p_src) || p_status->sd_fault) { // a stopped session is reported until it's flushed
+            p_status->is_logging    = _sdlog_task_active(p_src);
             p_status->bytes_written = p_src->bytes_written;
+            p_status->drop_cnt      = __atomic_load_n(&p_src->drop_cnt, __ATOMIC_RELAXED);
+            p_status->fault_lost    = __atomic_load_n(&p_src->fault_lost, __ATOMIC_RELAXED);
+            p_status->sn            = p_src->sn;
         }
     }
 
@@ -384,5 +1108,48 @@ uint32_t sdlog_webui_query(uint32_t source, sdlog_webui_status_t *p_status)
 // ----------
 uint32_t sdlog_source_ready(uint32_t source)
 {
-    return sdlog_ctrl.init && (SDLOG_SOURCE(source)->fp);
-}
\ No newline at end of file
+    return sdlog_ctrl.init && _sdlog_task_active(SDLOG_SOURCE(source));
+}
+
+// ----------
+// Retention API (main/sdlog_retention.c)
+// ----------
+const sdlog_policy_t *sdlog_policy(uint32_t source)
+{
+    return &SDLOG_SOURCE(source)->policy;
+}
+
+uint32_t sdlog_source_bytes(uint32_t source)
+{
+    return __atomic_load_n(&SDLOG_SOURCE(source)->bytes_total, __ATOMIC_RELAXED);
+}
+
+uint32_t sdlog_source_sn(uint32_t source)
+{
+    return __atomic_load_n(&SDLOG_SOURCE(source)->sn, __ATOMIC_RELAXED);
+}
+
+uint32_t sdlog_source_sn_closed(uint32_t source)
+{
+    return __atomic_load_n(&SDLOG_SOURCE(source)->sn_closed, __ATOMIC_RELAXED);
+}
+
+const char *sdlog_source_path(uint32_t source, char *p_path, uint32_t sz)
+{
+    snprintf(p_path, sz, "%s/%s", sdlog_ctrl.root, SDLOG_SOURCE(source)->name);
+    return p_path;
+}
+
+uint32_t sdlog_source_from_path(const char *path)
+{
+    size_t root_len = strlen(sdlog_ctrl.root);
+    if (strncmp(path, sdlog_ctrl.root, root_len) == 0 && path[root_len] == '/') {
+        for (uint32_t i = 0; i < SDLOG_SOURCE_NUM; i++) {
+            size_t len = strlen(SDLOG_SOURCE(i)->name);
+            if (strncmp(path + root_len + 1, SDLOG_SOURCE(i)->name, len) == 0 && path[root_len + 1 + len] == '/') {
+                return i;
+            }
+        }
+    }
+    return SDLOG_SOURCE_NUM;
+}
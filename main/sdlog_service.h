@@ -1,12 +1,20 @@
 #ifndef __SDLOG_SERVICE_H__
 #define __SDLOG_SERVICE_H__
 
+#include <stdint.h>
+#include <stdarg.h>
+#include "esp_err.h"
+
 // ----------
 // SDLOG_FMT_TEST__DATA_TYPE
 // ----------
 // FMT_TEXT is officially supported by the framework, so we defined its enum here
 enum sdlog_fmt_text__data_type {
     SDLOG_FMT_TEXT__STRING = 0,
+    SDLOG_FMT_TEXT__CONT   = 1, // continues the previous record, a long message is split into several records
+    SDLOG_FMT_TEXT__FMT    = 2, // string table entry of the deferred records (main/sdlog_fmt.h)
+    SDLOG_FMT_TEXT__BIN    = 3, // deferred message: format string ID + raw arguments, printf() is done by the exporters
+    SDLOG_FMT_TEXT__HTTP   = 4, // sdlog_http_access_t (main/sdlog_header.h), one per HTTP request
 };
 
 // ----------
@@ -22,10 +30,18 @@ enum sdlog_source_e {
 // ----------
 // Common API
 // ----------
-void sdlog_start(uint32_t source, uint64_t epoch_time);
+void sdlog_start(uint32_t source, uint64_t epoch_time); // epoch_time 0: provisional, the device clock is used
+
 void sdlog_stop(uint32_t source);
-void sdlog_write(uint32_t source, uint32_t type_data, uint32_t len, const void *payload);
+esp_err_t sdlog_write(uint32_t source, uint32_t type_data, uint32_t len, const void *payload); // ESP_ERR_NO_MEM if dropped
+esp_err_t sdlog_write_ts(uint32_t source, uint32_t type_data, int64_t us_sys_time, uint32_t len, const void *payload); // the caller captured the time
+esp_err_t sdlog_write_batch(uint32_t source, uint32_t type_data, uint32_t num, uint32_t len, const int64_t *p_us_sys_time, const void *payload); // payload[num] of len bytes each
 uint32_t sdlog_source_ready(uint32_t source);
+uint32_t sdlog_backlog(void); // bytes waiting for the SDLOG task, the background users of the SD card back off while it grows
+
+// A TEXT source message kept as SDLOG_FMT_TEXT__BIN, fmt must be a string literal
+// ESP_ERR_NOT_SUPPORTED if the deferred format is turned off or fmt can't be deferred, the caller writes the text itself
+esp_err_t sdlog_write_fmt(uint32_t source, const char *fmt, va_list args);
 
 // ----------
 // WEBUI API
@@ -34,6 +50,13 @@ typedef struct sdlog_webui_status_s {
     const char *name;
     uint32_t is_logging;
     uint32_t bytes_written;
+    uint32_t drop_cnt;     // records lost since the START, the rollovers and remounts keep counting
+    uint32_t fault_lost;   // the ones of drop_cnt lost in the FILE buffer of a file broken by an SD card fault
+    uint32_t sn;           // serial number of the session being recorded
+    uint32_t open_err;     // the last START failed to open the log file
+    uint64_t us_first_rec; // esp_timer when the first record of the boot was logged, 0 if none yet
+    uint32_t sd_fault;     // the session waits for the SD card in the spill buffer, or the card is missing
+    uint32_t spill_bytes;  // records in the spill buffer, all the sources
 } sdlog_webui_status_t;
 
 uint32_t sdlog_webui_query(uint32_t source, sdlog_webui_status_t *p_status);
@@ -1,6 +1,8 @@
 #ifndef __SDLOG_SERVICE_PRIVATE_H__
 #define __SDLOG_SERVICE_PRIVATE_H__
 
+#include <stdint.h>
+
 // ----------
 // SDLOG_FMT
 // ----------
@@ -8,6 +10,30 @@ enum { // declare what the FMT that the producer is using
     SDLOG_FMT_TEXT = 0,
     SDLOG_FMT_CAN  = 1,
     SDLOG_FMT_ADC  = 2,
+    SDLOG_FMT_NUM,
+    SDLOG_FMT_ANY = SDLOG_FMT_NUM, // framework records (SDLOG_TYPE_FRAMEWORK), main/sdlog_rec_reg.h
 };
 
+// ----------
+// Session policies, [sdlog] <source>.<policy> of syscfg.ini
+// ----------
+typedef struct sdlog_policy_s {
+    uint32_t autostart;
+    uint32_t max_size_mb;    // 0: no limit
+    uint32_t max_duration_s; // 0: no limit
+    uint32_t quota_mb;       // 0: no limit
+    uint32_t free_low_mb;    // 0: the free space of the card doesn't evict the sessions of the source
+    uint32_t free_high_mb;
+} sdlog_policy_t;
+
+// ----------
+// For the retention (main/sdlog_retention.c)
+// ----------
+const sdlog_policy_t *sdlog_policy(uint32_t source);
+uint32_t sdlog_source_bytes(uint32_t source); // bytes written by sdlog_task since boot, wraps
+uint32_t sdlog_source_sn(uint32_t source);    // the session being recorded or the next one, 0 if not known yet
+uint32_t sdlog_source_sn_closed(uint32_t source); // the last file closed, kept by the retention, 0 if none yet
+const char *sdlog_source_path(uint32_t source, char *p_path, uint32_t sz); // the folder of the source
+uint32_t sdlog_source_from_path(const char *path); // SDLOG_SOURCE_NUM if the path is not in a source folder
+
 #endif // __SDLOG_SERVICE_PRIVATE_H__
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include "esp_err.h"
 #include "esp_log.h"
 #include "ini.h"
 
@@ -64,7 +65,7 @@ static int syscfg_handler(void *user, const char *section, const char *name, con
     return 1;
 }
 
-void syscfg_init(void)
+esp_err_t syscfg_init(void)
 {
     // init known fields in syscfg_system, if the parameter is not available
     strlcpy(syscfg_system.hostname, DEF_HOSTNAME, sizeof(syscfg_system.hostname));
@@ -73,4 +74,5 @@ void syscfg_init(void)
     if (ini_parse(SYSCFG_INI, syscfg_handler, NULL) < 0) {
         ESP_LOGE(TAG, "Can't load " SYSCFG_INI);
     }
+    return ESP_OK; // no card or no syscfg.ini, the defaults are used
 }
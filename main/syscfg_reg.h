@@ -1,2 +1,8 @@
 SYSCFG_REG("http_server_can_tx", http_syscfg)
 SYSCFG_REG("wifi_known_network", wifi_manager_syscfg)
+SYSCFG_REG("time_sync", time_sync_syscfg)
+SYSCFG_REG("group_sync", group_sync_syscfg)
+SYSCFG_REG("log_hub", log_hub_syscfg)
+SYSCFG_REG("sdlog", sdlog_syscfg)
+SYSCFG_REG("sdcard", sd_card_syscfg)
+SYSCFG_REG("adc", adc_source_syscfg)
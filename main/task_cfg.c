@@ -0,0 +1,40 @@
+#include <stdio.h>
+#include <inttypes.h>
+
+#include "esp_log.h"
+
+#include "task_cfg.h"
+
+static const char *TAG = "TASK_CFG";
+
+// One table for the priority, stack and core of every task of the application (task_reg.h)
+
+#if (configNUMBER_OF_CORES > 1) && TASK_PIN_CORES
+#define TASK_CORE(_core) (_core)
+#else
+#define TASK_CORE(_core) (tskNO_AFFINITY)
+#endif
+
+static const task_cfg_t task_cfg_tbl[TASK_ID_NUM] = {
+#define TASK_REG(_name, _task_name, _stack, _prio, _core) \
+    [TASK_ID_##_name] = {.name = _task_name, .stack = _stack, .prio = _prio, .core = TASK_CORE(_core)},
+#include "task_reg.h"
+#undef TASK_REG
+};
+
+const task_cfg_t *task_cfg(uint32_t id)
+{
+    return &task_cfg_tbl[id];
+}
+
+BaseType_t task_create(uint32_t id, TaskFunction_t fn, void *param, TaskHandle_t *p_handle)
+{
+    const task_cfg_t *p_cfg = &task_cfg_tbl[id];
+    BaseType_t ret          = xTaskCreatePinnedToCore(fn, p_cfg->name, p_cfg->stack, param, p_cfg->prio, p_handle, p_cfg->core);
+    if (ret != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create task %s!", p_cfg->name);
+    } else {
+        ESP_LOGI(TAG, "%s, prio=%" PRIu32 ", stack=%" PRIu32 ", core=%d", p_cfg->name, (uint32_t)p_cfg->prio, p_cfg->stack, (int)p_cfg->core);
+    }
+    return ret;
+}
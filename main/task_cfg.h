@@ -0,0 +1,49 @@
+#ifndef __TASK_CFG_H__
+#define __TASK_CFG_H__
+
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "board.h"
+
+// ----------
+// Core affinity
+// ----------
+// On a dual-core target (ESP32-CAM) the CAN RX path and the SD writer own the APP CPU, WiFi/lwIP/HTTP and the
+// conversion stay on the PRO CPU where the WiFi driver runs (CONFIG_ESP_WIFI_TASK_CORE_ID=0)
+// On a single-core target (ESP32-C3) both are the same core, the affinity is ignored
+#define TASK_CORE_NET (0)
+#define TASK_CORE_RT (1)
+
+// The legacy TWAI driver has no RX callback, the closest point to the ISR is the return of twai_receive()
+// TWAI_RX_TS_CAPTURE=1 runs twai_rx above lwIP(18) and below esp_timer(22)/WiFi(23), so HTTP/SDLOG/TCP can't
+// delay the wake-up, TWAI_RX_TS_CAPTURE=0 keeps the legacy priority 6 for the comparison. It only receives, takes the
+// time, writes the log and hands the batch to twai_stat (can_stats/can_signal), nothing of O(signals) runs above lwIP
+#if TWAI_RX_TS_CAPTURE
+#define TWAI_RX_TASK_PRIO (19)
+#else
+#define TWAI_RX_TASK_PRIO (6)
+#endif
+
+// ----------
+// Task table
+// ----------
+enum task_id_e {
+#define TASK_REG(_name, _task_name, _stack, _prio, _core) TASK_ID_##_name,
+#include "task_reg.h"
+#undef TASK_REG
+    TASK_ID_NUM,
+};
+
+typedef struct task_cfg_s {
+    const char *name;
+    uint32_t stack; // bytes
+    UBaseType_t prio;
+    BaseType_t core; // tskNO_AFFINITY on a single-core target
+} task_cfg_t;
+
+const task_cfg_t *task_cfg(uint32_t id);
+BaseType_t task_create(uint32_t id, TaskFunction_t fn, void *param, TaskHandle_t *p_handle);
+
+#endif // __TASK_CFG_H__
@@ -0,0 +1,20 @@
+// TASK_REG(_name, _task_name, _stack, _prio, _core)
+// name: used to generate enum TASK_ID_xxx
+// task_name: FreeRTOS task name
+// stack: bytes (ESP-IDF counts the stack in bytes, not words)
+// prio: FreeRTOS priority, for reference: idle(0), httpd(5 by default), lwIP tcpip(18), esp_timer(22), WiFi(23)
+// core: TASK_CORE_RT (CAN RX, ADC, SD writer) or TASK_CORE_NET (WiFi, HTTP, conversion), see task_cfg.h
+TASK_REG(TWAI_RX, "twai_rx", 4096, TWAI_RX_TASK_PRIO, TASK_CORE_RT)
+TASK_REG(TWAI_MON, "twai_mon", 4096, 6, TASK_CORE_RT)
+TASK_REG(TWAI_STAT, "twai_stat", 4096, 6, TASK_CORE_RT) // per-ID statistics and signals of the frames of twai_rx
+TASK_REG(ADC_RD, "adc_rd", 3072, 7, TASK_CORE_RT) // DMA frames of the ADC source, above SDLOG so the driver pool drains
+TASK_REG(SDLOG, "SDLOG", 4096, 6, TASK_CORE_RT)
+TASK_REG(SDLOG_CONV, "SDLOG_CONV", 4096, 2, TASK_CORE_NET)
+TASK_REG(WIFI_MGR, "wifi_mgr_task", 4096, 5, TASK_CORE_NET)
+TASK_REG(HTTPD, "httpd", 4096, 5, TASK_CORE_NET) // created by httpd_start(), http_server_start() copies the config
+TASK_REG(TIME_SYNC, "time_sync", 3072, 4, TASK_CORE_NET)
+TASK_REG(GROUP_SYNC, "group_sync", 3072, 5, TASK_CORE_NET)
+TASK_REG(LED, "led", 2048, 1, TASK_CORE_NET)
+TASK_REG(LOG_UART, "log_uart", 2048, 1, TASK_CORE_NET) // UART sink of log_hub, the loggers never wait for it
+TASK_REG(INIT_BG, "init_bg", 4096, 3, TASK_CORE_NET)    // APP_MAIN_INIT_BG_FUNC() of main_hook.h, deleted when done
+TASK_REG(RETENTION, "retention", 3072, 1, TASK_CORE_NET) // session eviction, main/sdlog_retention.c
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/time.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_netif_sntp.h"
+#include "esp_sntp.h"
+
+#include "sdlog_service.h"
+#include "sdlog_header.h"
+#include "time_sync.h"
+#include "task_cfg.h"
+
+static const char *TAG = "TIME_SYNC";
+
+// Wall clock from SNTP, and time sync records in the logs
+// - the SNTP client updates the system clock every sync_interval seconds, each update is written to every
+//   opened log as a SDLOG_TYPE_TIME_SYNC record, (esp_timer, wall clock) sampled at the same moment
+// - the synced clock is also sampled every TIME_SYNC_REC_PERIOD_S, so every log file carries its own points
+// - the exporters interpolate the record time piecewise between the points, the crystal drift of esp_timer
+//   between two updates is spread linearly instead of showing up as a step
+//
+// syscfg.ini
+// [time_sync]
+// ntp_server = pool.ntp.org
+// sync_interval = 600
+
+#define TIME_SYNC_SERVER_DEF "pool.ntp.org"
+#define TIME_SYNC_INTERVAL_DEF (600) // seconds
+#define TIME_SYNC_INTERVAL_MIN (15)  // the minimum of lwIP SNTP
+#define TIME_SYNC_REC_PERIOD_S (60)
+
+// ----------
+// data structure definition
+// ----------
+typedef struct time_sync_ctrl_s {
+    char server[64];
+    uint32_t interval; // seconds
+    uint32_t valid;
+    uint32_t sync_cnt;
+    sdlog_time_sync_t last; // the last SNTP update
+    int64_t us_correction;
+    int32_t drift_ppb;
+} time_sync_ctrl_t;
+
+static time_sync_ctrl_t time_sync_ctrl = {
+    .server   = TIME_SYNC_SERVER_DEF,
+    .interval = TIME_SYNC_INTERVAL_DEF,
+};
+
+// ----------
+// SYSCFG
+// ----------
+uint32_t time_sync_syscfg(const char *section, const char *key, const char *value)
+{
+    if (strcmp(key, "ntp_server") == 0) {
+        strlcpy(time_sync_ctrl.server, value, sizeof(time_sync_ctrl.server));
+    } else if (strcmp(key, "sync_interval") == 0) {
+        uint32_t interval       = strtoul(value, NULL, 10);
+        time_sync_ctrl.interval = (interval < TIME_SYNC_INTERVAL_MIN) ? TIME_SYNC_INTERVAL_MIN : interval;
+    }
+    return 1;
+}
+
+// ----------
+// Time sync records
+// ----------
+static void _time_sync_sample(sdlog_time_sync_t *p_sync, uint32_t source)
+{
+    struct timeval tv;
+    p_sync->us_sys_time = esp_timer_get_time();
+    gettimeofday(&tv, NULL);
+    p_sync->us_epoch_time = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+    p_sync->source        = source;
+    p_sync->reserved      = 0;
+}
+
+static void _time_sync_log(const sdlog_time_sync_t *p_sync)
+{
+    for (uint32_t i = 0; i < SDLOG_SOURCE_NUM; i++) {
+        if (sdlog_source_ready(i)) {
+            sdlog_write_ts(i, SDLOG_TYPE_TIME_SYNC, p_sync->us_sys_time, sizeof(*p_sync), p_sync);
+        }
+    }
+}
+
+// called by the SNTP client (lwIP context) once the system clock is updated
+static void _time_sync_cb(struct timeval *tv)
+{
+    sdlog_time_sync_t sync;
+    _time_sync_sample(&sync, SDLOG_TIME_SYNC_SNTP);
+
+    if (time_sync_ctrl.valid) {
+        // how far the clock ran away since the last update
+        int64_t d_sys                = (int64_t)(sync.us_sys_time - time_sync_ctrl.last.us_sys_time);
+        int64_t predicted            = time_sync_ctrl.last.us_epoch_time + d_sys;
+        time_sync_ctrl.us_correction = (int64_t)sync.us_epoch_time - predicted;
+        time_sync_ctrl.drift_ppb     = (d_sys >= 1000) ? (int32_t)(time_sync_ctrl.us_correction * 1000000 / (d_sys / 1000)) : 0;
+    }
+    time_sync_ctrl.last  = sync;
+    time_sync_ctrl.valid = 1;
+    time_sync_ctrl.sync_cnt++;
+
+    _time_sync_log(&sync);
+    ESP_LOGI(TAG, "SNTP update #%" PRIu32 ", correction=%" PRId64 "us, drift=%" PRId32 "ppb",
+        time_sync_ctrl.sync_cnt, time_sync_ctrl.us_correction, time_sync_ctrl.drift_ppb);
+}
+
+static void time_sync_task(void *arg)
+{
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(TIME_SYNC_REC_PERIOD_S * 1000));
+        if (time_sync_ctrl.valid) {
+            sdlog_time_sync_t sync;
+            _time_sync_sample(&sync, SDLOG_TIME_SYNC_PERIODIC);
+            _time_sync_log(&sync);
+        }
+    }
+}
+
+// ----------
+// Runtime API
+// ----------
+uint32_t time_sync_valid(void)
+{
+    return time_sync_ctrl.valid;
+}
+
+uint64_t time_sync_epoch_now(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+// after wifi_sta_init(), the SNTP client starts once the station gets the IP
+esp_err_t time_sync_init(void)
+{
+    esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG(time_sync_ctrl.server);
+    config.sync_cb           = _time_sync_cb;
+
+    sntp_set_sync_interval(time_sync_ctrl.interval * 1000);
+    esp_err_t ret = esp_netif_sntp_init(&config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "SNTP init failed: %d", ret);
+        return ESP_OK; // the logs fall back to the browser time, don't stop the boot
+    }
+    task_create(TASK_ID_TIME_SYNC, time_sync_task, NULL, NULL);
+
+    ESP_LOGI(TAG, "SNTP server=%s, interval=%" PRIu32 "s", time_sync_ctrl.server, time_sync_ctrl.interval);
+    return ESP_OK;
+}
+
+// ----------
+// Status query API, for WEB-UI
+// ----------
+uint32_t time_sync_webui_query(time_sync_webui_status_t *p_status)
+{
+    p_status->server        = time_sync_ctrl.server;
+    p_status->valid         = time_sync_ctrl.valid;
+    p_status->sync_cnt      = time_sync_ctrl.sync_cnt;
+    p_status->us_epoch_last = time_sync_ctrl.last.us_epoch_time;
+    p_status->us_correction = time_sync_ctrl.us_correction;
+    p_status->drift_ppb     = time_sync_ctrl.drift_ppb;
+    return 0;
+}
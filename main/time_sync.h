@@ -0,0 +1,27 @@
+#ifndef __TIME_SYNC_H__
+#define __TIME_SYNC_H__
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// ----------
+// Runtime API
+// ----------
+uint32_t time_sync_valid(void);     // 1 if the system clock was set by SNTP
+uint64_t time_sync_epoch_now(void); // wall clock in us, only meaningful if time_sync_valid()
+
+// ----------
+// WEBUI API
+// ----------
+typedef struct time_sync_webui_status_s {
+    const char *server;
+    uint32_t valid;
+    uint32_t sync_cnt;
+    uint64_t us_epoch_last; // epoch time of the last SNTP update
+    int64_t us_correction;  // the last SNTP update minus the time predicted from the update before it
+    int32_t drift_ppb;      // us_correction over the interval between the two updates
+} time_sync_webui_status_t;
+
+uint32_t time_sync_webui_query(time_sync_webui_status_t *p_status);
+
+#endif // __TIME_SYNC_H__
@@ -1,29 +1,202 @@
 #include "driver/twai.h"
+#include "freertos/ringbuf.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "sdlog_service.h"
+#include "sdlog_header.h"
 #include "board.h"
 #include "led.h"
 #include "twai.h"
+#include "can_signal.h"
+#include "can_stats.h"
+#include "task_cfg.h"
 
 static const char *TAG = "TWAI";
 static twai_webui_status_t twai_webui_stat;
 
+// ----------
+// Bus monitor
+// ----------
+// The alerts wake twai_monitor_task immediately, the status/bus load is sampled every TWAI_MON_PERIOD_MS
+#define TWAI_MON_PERIOD_MS (1000)
+#define TWAI_MON_ALERTS (TWAI_ALERT_ERR_ACTIVE | TWAI_ALERT_BUS_RECOVERED | TWAI_ALERT_ARB_LOST | TWAI_ALERT_ABOVE_ERR_WARN | \
+                         TWAI_ALERT_BUS_ERROR | TWAI_ALERT_TX_FAILED | TWAI_ALERT_RX_QUEUE_FULL | TWAI_ALERT_ERR_PASS |      \
+                         TWAI_ALERT_BUS_OFF | TWAI_ALERT_RX_FIFO_OVERRUN)
+
+static uint32_t twai_bus_bits; // bits of the frames received/transmitted, consumed by twai_monitor_task
+
+// Nominal frame length on the wire, SOF to the end of the interframe space, stuff bits not counted
+// - standard: 1+11+1+1+1+4+8n+15+1+1+1+7+3 = 47 + 8n
+// - extended: 1+11+1+1+18+1+1+1+4+8n+15+1+1+1+7+3 = 67 + 8n
+static uint32_t _twai_frame_bits(const twai_message_t *p_msg)
+{
+    uint32_t dlc = (p_msg->data_length_code > 8) ? 8 : p_msg->data_length_code;
+    return (p_msg->extd ? 67 : 47) + (p_msg->rtr ? 0 : dlc * 8);
+}
+
+static void _twai_monitor_log(uint32_t alerts, const twai_status_info_t *p_info)
+{
+    sdlog_webui_status_t sdlog_status;
+    sdlog_webui_query(SDLOG_SOURCE_CAN, &sdlog_status);
+
+    sdlog_can_bus_t rec = {
+        .alerts           = alerts,
+        .state            = p_info->state,
+        .tx_error_counter = p_info->tx_error_counter,
+        .rx_error_counter = p_info->rx_error_counter,
+        .bus_load         = twai_webui_stat.bus_load,
+        .rx_missed        = p_info->rx_missed_count,
+        .rx_overrun       = p_info->rx_overrun_count,
+        .sdlog_drop       = sdlog_status.drop_cnt,
+        .bus_error        = p_info->bus_error_count,
+        .arb_lost         = p_info->arb_lost_count,
+        .tx_failed        = p_info->tx_failed_count,
+    };
+    sdlog_write(SDLOG_SOURCE_CAN, SDLOG_CAN_TYPE_BUS, sizeof(rec), &rec);
+}
+
+static void twai_monitor_task(void *arg)
+{
+    uint32_t bitrate       = (TWAI_SPEED == 0) ? 125000 : 500000;
+    uint32_t alerts_period = 0; // alerts raised in this period, each kind is logged once per period
+    int64_t us_period      = esp_timer_get_time();
+    ESP_LOGI(TAG, "TWAI monitor Task started");
+
+    while (1) {
+        uint32_t alerts = 0;
+        twai_read_alerts(&alerts, pdMS_TO_TICKS(TWAI_MON_PERIOD_MS)); // ESP_ERR_TIMEOUT if no alert, alerts is 0
+
+        if (alerts & TWAI_ALERT_BUS_OFF) {
+            ESP_LOGW(TAG, "bus-off, initiate recovery");
+            twai_initiate_recovery();
+        }
+        if (alerts & TWAI_ALERT_BUS_RECOVERED) {
+            ESP_LOGW(TAG, "bus recovered, restart");
+            twai_start();
+        }
+
+        twai_status_info_t info;
+        if (twai_get_status_info(&info) != ESP_OK) {
+            continue;
+        }
+
+        // update the status of WEB-UI
+        twai_webui_stat.alerts |= alerts;
+        twai_webui_stat.state            = info.state;
+        twai_webui_stat.tx_error_counter = info.tx_error_counter;
+        twai_webui_stat.rx_error_counter = info.rx_error_counter;
+        twai_webui_stat.rx_missed        = info.rx_missed_count;
+        twai_webui_stat.rx_overrun       = info.rx_overrun_count;
+        twai_webui_stat.bus_error        = info.bus_error_count;
+        twai_webui_stat.arb_lost         = info.arb_lost_count;
+
+        // new kind of alert, log it right away
+        if (alerts & ~alerts_period) {
+            _twai_monitor_log(alerts & ~alerts_period, &info);
+            alerts_period |= alerts;
+        }
+
+        // periodic snapshot, with the bus load over the period
+        int64_t us_now = esp_timer_get_time();
+        if (us_now - us_period >= TWAI_MON_PERIOD_MS * 1000) {
+            uint64_t bits            = __atomic_exchange_n(&twai_bus_bits, 0, __ATOMIC_RELAXED);
+            twai_webui_stat.bus_load = (uint32_t)(bits * 1000 * 1000000 / ((uint64_t)bitrate * (us_now - us_period)));
+            us_period                = us_now;
+
+            _twai_monitor_log(alerts_period, &info);
+            alerts_period = 0;
+        }
+    }
+}
+
+// ----------
+// RX
+// ----------
+// The legacy TWAI driver has no RX callback, the closest point to the ISR is the return of twai_receive()
+// - the time is captured before anything else and carried to the record by sdlog_write_ts()
+// - the priority is TWAI_RX_TASK_PRIO in task_cfg.h, TWAI_RX_TS_CAPTURE=0 keeps the legacy behavior
+//   (priority 6, time taken by sdlog_write()) for the comparison
+// The task blocks for the first frame only, then drains the frames already queued without blocking (up to
+// TWAI_RX_BATCH) and hands them to sdlog/statistics as one batch: one ring buffer item and one sdlog_task wake-up
+// per burst instead of per frame. A drained frame gets the time it was pulled, it arrived a bit earlier
+// The per-ID statistics and the signal decode (64-bit math, soft float) don't run at TWAI_RX_TASK_PRIO, the batch is
+// copied with its times to twai_stat_task below lwIP. A batch not fitting in TWAI_STAT_BUF_SZ is only missing from
+// the statistics (stat_drop), its frames are in the log
+#define TWAI_RX_BATCH (32)
+#define TWAI_STAT_BUF_SZ (8192)
+
+static RingbufHandle_t twai_stat_rb; // items: num, us_rx[num], msg[num]
+
+static void _twai_stat_send(const twai_message_t *p_msg, const int64_t *p_us_rx, uint32_t num)
+{
+    uint8_t *p_item;
+    size_t sz = sizeof(uint32_t) + num * (sizeof(int64_t) + sizeof(twai_message_t));
+    if (xRingbufferSendAcquire(twai_stat_rb, (void **)&p_item, sz, 0) != pdTRUE) {
+        twai_webui_stat.stat_drop++;
+        return;
+    }
+    memcpy(p_item, &num, sizeof(uint32_t));
+    memcpy(p_item + sizeof(uint32_t), p_us_rx, num * sizeof(int64_t));
+    memcpy(p_item + sizeof(uint32_t) + num * sizeof(int64_t), p_msg, num * sizeof(twai_message_t));
+    xRingbufferSendComplete(twai_stat_rb, p_item);
+}
+
+static void twai_stat_task(void *arg)
+{
+    twai_message_t msg[TWAI_RX_BATCH];
+    int64_t us_rx[TWAI_RX_BATCH];
+
+    while (1) {
+        size_t sz;
+        uint8_t *p_item = xRingbufferReceive(twai_stat_rb, &sz, portMAX_DELAY);
+        if (p_item == NULL) {
+            continue;
+        }
+        uint32_t num;
+        memcpy(&num, p_item, sizeof(uint32_t)); // copied out, the item is 4-byte aligned only
+        memcpy(us_rx, p_item + sizeof(uint32_t), num * sizeof(int64_t));
+        memcpy(msg, p_item + sizeof(uint32_t) + num * sizeof(int64_t), num * sizeof(twai_message_t));
+        vRingbufferReturnItem(twai_stat_rb, p_item);
+
+        can_stats_update(msg, us_rx, num);
+        can_signal_feed(msg, num);
+    }
+}
+
 static void twai_rx_task(void *arg)
 {
-    twai_message_t msg;
-    ESP_LOGI(TAG, "TWAI RX Task started");
+    twai_message_t msg[TWAI_RX_BATCH];
+    int64_t us_rx[TWAI_RX_BATCH];
+    ESP_LOGI(TAG, "TWAI RX Task started, ts_capture=%d, batch=%d", TWAI_RX_TS_CAPTURE, TWAI_RX_BATCH);
 
     while (1) {
-        if (twai_receive(&msg, portMAX_DELAY) == ESP_OK) { // Wait for CAN packet arriving
-            twai_webui_stat.rx_pkt++;
-            sdlog_write(SDLOG_SOURCE_CAN, /*data_type*/ 0, sizeof(msg), &msg);
+        uint32_t num    = 0;
+        TickType_t wait = portMAX_DELAY; // Wait for CAN packet arriving
+        while (num < TWAI_RX_BATCH && twai_receive(&msg[num], wait) == ESP_OK) {
+            us_rx[num++] = esp_timer_get_time();
+            wait         = 0;
+        }
+        if (num == 0) {
+            continue;
+        }
 
-            // Make LED toggle to show the packet arriving
-            led_op(/*op_0on_1off_2toggle*/ 2);
+        uint32_t bits = 0;
+        for (uint32_t i = 0; i < num; i++) {
+            bits += _twai_frame_bits(&msg[i]);
+        }
+        twai_webui_stat.rx_pkt += num;
+        __atomic_fetch_add(&twai_bus_bits, bits, __ATOMIC_RELAXED);
 
-            // Observe CAN packet in Console
-            // ESP_LOGI(TAG, "ID: 0x%03lX DLC:%d Data: %02x %02x...", msg.identifier, msg.data_length_code, msg.data[0], msg.data[1]);
+        if (TWAI_RX_TS_CAPTURE) {
+            sdlog_write_batch(SDLOG_SOURCE_CAN, SDLOG_CAN_TYPE_FRAME, num, sizeof(msg[0]), us_rx, msg);
+        } else {
+            for (uint32_t i = 0; i < num; i++) {
+                sdlog_write(SDLOG_SOURCE_CAN, SDLOG_CAN_TYPE_FRAME, sizeof(msg[0]), &msg[i]);
+            }
         }
+        _twai_stat_send(msg, us_rx, num);
+
+        led_activity(LED_ACT_CAN_RX, num); // led_task blinks LED0
     }
 }
 
@@ -38,6 +211,7 @@ esp_err_t twai_service_init(void)
         // 2. Init TWAI driver
         twai_general_config_t g_config = TWAI_GENERAL_CONFIG_DEFAULT(TWAI_PIN_TX, TWAI_PIN_RX, TWAI_MODE_NORMAL);
         g_config.rx_queue_len          = TWAI_RXBUF;
+        g_config.alerts_enabled        = TWAI_MON_ALERTS;
         twai_timing_config_t t_config;
         if (TWAI_SPEED == 0) {
             t_config = (twai_timing_config_t)TWAI_TIMING_CONFIG_125KBITS();
@@ -51,8 +225,11 @@ esp_err_t twai_service_init(void)
         ESP_ERROR_CHECK(twai_start());
         ESP_LOGI(TAG, "TWAI bus init, tx_pin=%d, rx_pin=%d, standby=%d, speed=%s", TWAI_PIN_TX, TWAI_PIN_RX, TWAI_PIN_STANDBY, (TWAI_SPEED == 0) ? "125K" : "500K");
 
-        // 4. Start the TWAI task, whose priority is #6, which is higher than HTTP (5)
-        xTaskCreate(twai_rx_task, "twai_rx", 4096, NULL, 6, NULL);
+        // 4. Start the TWAI task, whose priority is higher than HTTP (5), see task_reg.h
+        twai_stat_rb = xRingbufferCreate(TWAI_STAT_BUF_SZ, RINGBUF_TYPE_NOSPLIT);
+        task_create(TASK_ID_TWAI_STAT, twai_stat_task, NULL, NULL);
+        task_create(TASK_ID_TWAI_RX, twai_rx_task, NULL, NULL);
+        task_create(TASK_ID_TWAI_MON, twai_monitor_task, NULL, NULL);
 
         // 5. Set the CAN transceiver to normal mode (low)
         gpio_set_level(TWAI_PIN_STANDBY, 0);
@@ -78,5 +255,10 @@ esp_err_t twai_webui_transmit(uint32_t can_id, uint32_t data_len, uint8_t *p_dat
     };
     memcpy(tx_msg.data, p_data, data_len);
 
-    return twai_transmit(&tx_msg, pdMS_TO_TICKS(100));
+    esp_err_t ret = twai_transmit(&tx_msg, pdMS_TO_TICKS(100));
+    if (ret == ESP_OK) {
+        twai_webui_stat.tx_pkt++;
+        __atomic_fetch_add(&twai_bus_bits, _twai_frame_bits(&tx_msg), __ATOMIC_RELAXED);
+    }
+    return ret;
 }
\ No newline at end of file
@@ -7,6 +7,16 @@
 typedef struct twai_webui_status_s {
     uint32_t rx_pkt;
     uint32_t tx_pkt;
+    uint32_t alerts;   // TWAI_ALERT_xxx raised since boot
+    uint32_t state;    // twai_state_t
+    uint32_t bus_load; // permille
+    uint32_t tx_error_counter;
+    uint32_t rx_error_counter;
+    uint32_t rx_missed;  // frames lost by the driver, RX queue full
+    uint32_t rx_overrun; // frames lost by the controller, RX FIFO overrun
+    uint32_t bus_error;
+    uint32_t arb_lost;
+    uint32_t stat_drop; // batches of frames missing from the statistics, twai_stat_task was behind
 } twai_webui_status_t;
 
 uint32_t twai_webui_query(twai_webui_status_t *p_stat);
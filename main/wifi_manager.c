@@ -7,6 +7,8 @@
 #include "http_server.h"
 #include "mdns_service.h"
 #include "syscfg.h"
+#include "task_cfg.h"
+#include "led.h"
 
 static const char *TAG = "WIFI_MANAGER";
 
@@ -134,6 +136,7 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t e
         } else if (event_id == WIFI_EVENT_STA_DISCONNECTED) {
             ESP_LOGI(TAG, "Disconnected. Scanning for other known networks...");
             xEventGroupClearBits(wifi_ctrl.evt_grp, WIFI_EVT_BIT_CONNECTED | WIFI_EVT_BIT_GOT_IP);
+            led_state_set(LED_STATE_WIFI_UP, 0);
             if (wifi_ctrl.task_handle) {
                 xTaskNotifyGive(wifi_ctrl.task_handle);
             }
@@ -145,6 +148,7 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t e
             ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
             server_up_when_ip_obtained();
             xEventGroupSetBits(wifi_ctrl.evt_grp, WIFI_EVT_BIT_GOT_IP);
+            led_state_set(LED_STATE_WIFI_UP, 1);
         }
     }
 }
@@ -191,7 +195,7 @@ esp_err_t wifi_sta_init(void)
 
     // Start the WIFI manager background task
     wifi_ctrl.evt_grp = xEventGroupCreate();
-    xTaskCreate(wifi_manager_background_task, "wifi_mgr_task", 4096, NULL, 5, &wifi_ctrl.task_handle);
+    task_create(TASK_ID_WIFI_MGR, wifi_manager_background_task, NULL, &wifi_ctrl.task_handle);
 
     // Init TCP/IP & WIFI (only once)
     ESP_ERROR_CHECK(esp_netif_init());
@@ -0,0 +1,125 @@
+import math
+import re
+import struct
+import sys
+
+# Compile a DBC file into the compact image loaded by main/can_signal.c (see can_dbc_header_t in can_signal.h)
+# Copy the output to the SD card root as dbc.bin
+# Multiplexed signals are skipped, the device decodes every signal of a message on every frame
+
+RE_BO = re.compile(r"^BO_\s+(\d+)\s+(\w+)\s*:\s*(\d+)")
+RE_SG = re.compile(r"^\s+SG_\s+(\w+)\s*(M|m\d+)?\s*:\s*(\d+)\|(\d+)@([01])([+-])\s*"
+                   r"\(([^,]+),([^)]+)\)\s*\[([^|]+)\|([^\]]+)\]")
+
+SIG_BIG_ENDIAN = 1 << 0
+SIG_SIGNED = 1 << 1
+FLT_MAX = 3.4028234663852886e38
+
+
+def parse_dbc(path):
+    msgs = {}
+    cur = None
+    skipped = 0
+    with open(path, encoding="latin-1") as f:
+        for line in f:
+            m = RE_BO.match(line)
+            if m:
+                raw_id = int(m.group(1))
+                extd = 1 if raw_id & 0x80000000 else 0
+                cur = (extd, raw_id & 0x1FFFFFFF)
+                msgs[cur] = []
+                continue
+
+            m = RE_SG.match(line)
+            if m and cur is not None:
+                name, mux, start, length, order, sign, scale, offset, vmin, vmax = m.groups()
+                if mux and mux.startswith("m"):
+                    skipped += 1
+                    continue
+                msgs[cur].append({
+                    "name": name,
+                    "start": int(start),
+                    "length": int(length),
+                    "big_endian": order == "0",
+                    "signed": sign == "-",
+                    "scale": float(scale),
+                    "offset": float(offset),
+                    "min": float(vmin),
+                    "max": float(vmax),
+                })
+    return msgs, skipped
+
+
+def sig_shift(sig):
+    if not sig["big_endian"]:
+        return sig["start"]  # Intel: bit index of the LSB in the little-endian word
+
+    # Motorola: start is the MSB in DBC sawtooth numbering, byte0 is the most significant byte of the big-endian word
+    byte, bit = divmod(sig["start"], 8)
+    msb = (7 - byte) * 8 + bit
+    return msb - (sig["length"] - 1)
+
+
+def hist_range(sig):
+    if sig["min"] != sig["max"]:
+        return sig["min"], sig["max"]
+
+    # no [min|max] in the DBC, use the full raw range
+    if sig["signed"]:
+        lo, hi = -(1 << (sig["length"] - 1)), (1 << (sig["length"] - 1)) - 1
+    else:
+        lo, hi = 0, (1 << sig["length"]) - 1
+    a, b = lo * sig["scale"] + sig["offset"], hi * sig["scale"] + sig["offset"]
+    return min(a, b), max(a, b)
+
+
+def f32(x):
+    # the value as stored in the image, None if a float can't hold it
+    if not math.isfinite(x) or abs(x) > FLT_MAX:
+        return None
+    return struct.unpack("<f", struct.pack("<f", x))[0]
+
+
+def compile_dbc(msgs):
+    msg_bin = b""
+    sig_bin = b""
+    sig_num = 0
+    for (extd, identifier) in sorted(msgs):
+        sigs = []
+        for sig in msgs[(extd, identifier)]:
+            shift = sig_shift(sig)
+            if shift < 0 or shift + sig["length"] > 64 or sig["scale"] == 0:
+                print(f"skip {sig['name']}: unsupported layout")
+                continue
+            if f32(sig["scale"]) in (None, 0.0) or f32(sig["offset"]) is None:
+                print(f"skip {sig['name']}: scale/offset not a finite float")
+                continue
+            hist_min, hist_max = (f32(x) for x in hist_range(sig))
+            if hist_min is None or hist_max is None or hist_max <= hist_min:
+                print(f"skip {sig['name']}: histogram range [{sig['min']}|{sig['max']}] empty or not finite")
+                continue
+            sig["hist"] = hist_min, hist_max
+            sigs.append(sig)
+
+        msg_bin += struct.pack("<IIHHI", identifier, extd, sig_num, len(sigs), 0)
+        for sig in sigs:
+            flags = (SIG_BIG_ENDIAN if sig["big_endian"] else 0) | (SIG_SIGNED if sig["signed"] else 0)
+            hist_min, hist_max = sig["hist"]
+            sig_bin += struct.pack("<24sBBBBffff", sig["name"].encode()[:23], sig_shift(sig), sig["length"], flags, 0,
+                                   sig["scale"], sig["offset"], hist_min, hist_max)
+        sig_num += len(sigs)
+
+    header = struct.pack("<8sIIII", b"QQDBC", 1, len(msgs), sig_num, 0)
+    return header + msg_bin + sig_bin, sig_num
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 3:
+        print("Usage: python dbc_compile.py <input.dbc> <dbc.bin>")
+        sys.exit(1)
+
+    msgs, skipped = parse_dbc(sys.argv[1])
+    image, sig_num = compile_dbc(msgs)
+    with open(sys.argv[2], "wb") as f:
+        f.write(image)
+    print(f"{len(msgs)} messages, {sig_num} signals, {skipped} multiplexed signals skipped, {len(image)} bytes")
@@ -0,0 +1,53 @@
+import socket
+import struct
+import sys
+import time
+
+# Local NTP stand-in to test the time sync of the logger (main/time_sync.c)
+# Answers SNTP requests with the host clock plus a fixed offset and a drift, so the correction shows up
+# in the time sync records and on the home page without waiting hours for a real crystal drift
+#
+# python tool/ntp_standin.py [offset_ms] [drift_ppm]
+# then set ntp_server to the IP of this host in the [time_sync] section of syscfg.ini
+# UDP port 123 needs root (or CAP_NET_BIND_SERVICE)
+
+NTP_PORT = 123
+NTP_EPOCH_DELTA = 2208988800  # 1900-01-01 to 1970-01-01
+
+
+def to_ntp(t):
+    sec = int(t) + NTP_EPOCH_DELTA
+    frac = int((t - int(t)) * (1 << 32)) & 0xFFFFFFFF
+    return sec, frac
+
+
+def main():
+    offset = float(sys.argv[1]) / 1000 if len(sys.argv) > 1 else 0.0
+    drift = float(sys.argv[2]) * 1e-6 if len(sys.argv) > 2 else 0.0
+    t_begin = time.time()
+
+    def now():
+        t = time.time()
+        return t + offset + (t - t_begin) * drift
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("0.0.0.0", NTP_PORT))
+    print(f"NTP stand-in on UDP {NTP_PORT}, offset={offset * 1000:.3f}ms drift={drift * 1e6:.1f}ppm")
+
+    while True:
+        req, addr = sock.recvfrom(512)
+        t_rx = now()
+        if len(req) < 48:
+            continue
+        # answer: LI=0, VN=4, mode=4 (server), stratum 1, the client's transmit time as the originate time
+        orig = req[40:48]
+        rx_sec, rx_frac = to_ntp(t_rx)
+        tx_sec, tx_frac = to_ntp(now())
+        resp = struct.pack("!BBbb II 4s II", (0 << 6) | (4 << 3) | 4, 1, 4, -20, 0, 0, b"LOCL", rx_sec, rx_frac)
+        resp += orig + struct.pack("!II II", rx_sec, rx_frac, tx_sec, tx_frac)
+        sock.sendto(resp, addr)
+        print(f"{addr[0]}: {time.strftime('%H:%M:%S', time.localtime(t_rx))} sent")
+
+
+if __name__ == "__main__":
+    main()
@@ -2,12 +2,55 @@ import struct
 import sys
 import os
 import csv
+import re
 
 # 定義結構大小
 SYS_HEADER_SIZE = 512
 META_HEADER_SIZE = 512
 ENTRY_HEADER_SIZE = 16  # sdlog_data_t
 
+# 延遲格式化的文字紀錄 (SDLOG_FMT_TEXT__BIN), 參數的打包方式見 main/sdlog_fmt.h
+FMT_SPEC = re.compile(rb"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|j|z|t)?([diuoxXcfFeEgGaAsp%])")
+
+def render_fmt(fmt, args):
+    out = []
+    pos = 0  # args 的讀取位置
+    last = 0
+    for m in FMT_SPEC.finditer(fmt):
+        out.append(fmt[last:m.start()].decode('utf-8', errors='ignore'))
+        last = m.end()
+        flags, width, prec, lmod, conv = [g.decode() if g is not None else None for g in m.groups()]
+        if conv == '%':
+            out.append('%')
+            continue
+        if width == '*':
+            width = str(struct.unpack_from("<i", args, pos)[0])
+            pos += 4
+        if prec == '*':
+            prec = str(struct.unpack_from("<i", args, pos)[0])
+            pos += 4
+        spec = '%' + flags + (width or '') + ('.' + prec if prec is not None else '')
+
+        if conv in 'diuoxXc':
+            wide = lmod in ('l', 'll', 'j', 'z', 't')
+            code = ('<q' if wide else '<i') if conv in 'di' else ('<Q' if wide else '<I')
+            value = struct.unpack_from(code, args, pos)[0]
+            pos += 8 if wide else 4
+            out.append((spec + ('d' if conv == 'u' else conv)) % value)
+        elif conv in 'fFeEgGaA':
+            value = struct.unpack_from("<d", args, pos)[0]
+            pos += 8
+            out.append(value.hex() if conv in 'aA' else (spec + conv) % value)
+        elif conv == 'p':
+            out.append(f"0x{struct.unpack_from('<Q', args, pos)[0]:x}")
+            pos += 8
+        else:  # s
+            n = args[pos]
+            out.append((spec + 's') % args[pos + 1:pos + 1 + n].decode('utf-8', errors='ignore'))
+            pos += 1 + n
+    out.append(fmt[last:].decode('utf-8', errors='ignore'))
+    return ''.join(out)
+
 def parse_log(file_path):
     if not os.path.exists(file_path):
         print(f"找不到檔案: {file_path}")
@@ -30,6 +73,9 @@ def parse_log(file_path):
         # 解析關鍵時間欄位
         magic, version, _ = struct.unpack_from("<8sII", sys_header_raw, 0)
         us_epoch_time, us_sys_time, fmt = struct.unpack_from("<QQI", sys_header_raw, 16)
+        epoch_src, = struct.unpack_from("<I", sys_header_raw, 92) # 0: START 給的, 1: 暫定 (開機自動開始, 裝置時鐘), 2: 已由 time sync 校正
+        if epoch_src == 1:
+            print("注意: epoch 為暫定值 (開機自動開始時的裝置時鐘), 沒有 time sync 紀錄時絕對時間可能不準")
         
         if b"QQMLAB" not in magic:
             print("無效的 QQMLAB Log 檔案")
@@ -38,6 +84,29 @@ def parse_log(file_path):
         # 跳過 Meta Header
         f.seek(SYS_HEADER_SIZE + META_HEADER_SIZE)
 
+        # 同時印到螢幕並寫入 CSV
+        def emit(serial, ts, rel, log_content):
+            # 1. Stdout
+            print(log_content)
+
+            # 2. CSV
+            writer.writerow({
+                'serial num': serial,
+                'epoch time': f"{ts:.6f}",
+                'relative time': f"{rel:.6f}",
+                'stdout': log_content
+            })
+
+        # TEXT 模式的一行要等後續片段都讀完才輸出
+        text_pending = None
+        fmt_table = {}  # 延遲格式化的字串表, fmt_id -> format string
+        def emit_text():
+            nonlocal text_pending
+            if text_pending:
+                text_data = text_pending['text'].decode('utf-8', errors='ignore').strip()
+                emit(text_pending['count'], text_pending['ts'], text_pending['rel'], f"({text_pending['ts']:.6f}) http_log: {text_data}")
+                text_pending = None
+
         # 2. 循環讀取資料
         count = 0
         start_timestamp = None
@@ -74,29 +143,74 @@ def parse_log(file_path):
 
             # 根據格式產生輸出字串 (stdout 內容)
             log_content = ""
-            if fmt == 1: # CAN 模式
+            if type_data == 0xF0: # time sync (sdlog_time_sync_t), 所有格式共用
+                sync_sys, sync_epoch, sync_src, _ = struct.unpack_from("<QQII", payload, 0)
+                log_content = f"({timestamp_sec:.6f}) time_sync src={sync_src} sys={sync_sys} epoch={sync_epoch / 1000000.0:.6f}"
+
+            elif type_data == 0xF1: # group sync beacon (sdlog_group_beacon_t), 所有格式共用
+                seq, is_master, m_sys, m_epoch, master = struct.unpack_from("<IIQQ16s", payload, 0)
+                master = master.split(b"\0")[0].decode(errors="ignore")
+                log_content = f"({timestamp_sec:.6f}) beacon seq={seq} master={master}{' (self)' if is_master else ''} sys={m_sys} epoch={m_epoch / 1000000.0:.6f}"
+
+            elif fmt == 1 and type_data == 1: # CAN 模式, bus 狀態 (sdlog_can_bus_t)
+                alerts, state, tec, rec, bus_load, rx_missed, rx_overrun, sdlog_drop, bus_error, arb_lost, tx_failed, _ = struct.unpack_from("<12I", payload, 0)
+                log_content = (f"({timestamp_sec:.6f}) bus alerts=0x{alerts:05X} state={state} tec={tec} rec={rec} load={bus_load / 10:.1f}% "
+                               f"rx_missed={rx_missed} rx_overrun={rx_overrun} sdlog_drop={sdlog_drop} bus_error={bus_error} arb_lost={arb_lost}")
+
+            elif fmt == 1: # CAN 模式
                 flags, identifier, dlc = struct.unpack_from("<IIB", payload, 0)
                 can_data = payload[9:9+dlc]
                 data_hex = " ".join([f"{b:02X}" for b in can_data])
                 id_fmt = f"{identifier:08X}" if (flags & 0x01) else f"{identifier:03X}"
                 log_content = f"({timestamp_sec:.6f}) can1 {id_fmt} [{dlc}] {data_hex}"
 
+            elif fmt == 2 and type_data == 0: # ADC 模式, 一個 block 一個時間戳 (sdlog_adc_block_t), 每個 channel 印平均值
+                seq, rate_hz, unit, atten, ch_num = struct.unpack_from("<IIBBB", payload, 0)
+                samples = struct.unpack_from("<128H", payload, 16)
+                per_ch = {}
+                for smp in samples:
+                    per_ch.setdefault(smp >> 12, []).append(smp & 0xFFF)
+                avg = " ".join(f"ch{ch}={sum(v) / len(v):.1f}" for ch, v in sorted(per_ch.items()))
+                log_content = f"({timestamp_sec:.6f}) adc seq={seq} rate={rate_hz}Hz {avg}"
+
+            elif fmt == 0 and type_data == 2: # TEXT 模式, 字串表 (SDLOG_FMT_TEXT__FMT)
+                fmt_table[struct.unpack_from("<I", payload, 0)[0]] = payload[4:]
+                continue
+
+            elif fmt == 0 and type_data == 3: # TEXT 模式, 延遲格式化的訊息 (SDLOG_FMT_TEXT__BIN)
+                emit_text()
+                fmt_id = struct.unpack_from("<I", payload, 0)[0]
+                text_data = render_fmt(fmt_table[fmt_id], payload[4:]) if fmt_id in fmt_table else f"<fmt 0x{fmt_id:08x}>"
+                text_pending = {'ts': timestamp_sec, 'rel': relative_time, 'count': count, 'text': text_data.encode()}
+                continue
+
+            elif fmt == 0 and type_data == 4: # TEXT 模式, HTTP 存取紀錄 (sdlog_http_access_t)
+                emit_text()
+                method, uri_id, status, nbytes, us_duration, ip, query = struct.unpack_from("<BBHII4s48s", payload, 0)
+                methods = ["DELETE", "GET", "HEAD", "POST", "PUT"]
+                uris = ["/", "/log_browse", "/log_download", "/log_remove", "/log_conv", "/can_tx", "/signal_stats", "/bus_stats", "/http_stats", "/sd_bench", "/mem_stats", "/conv_jobs"] # main/http_uri_reg.h
+                query = query[:47].split(b"\0")[0].decode(errors="ignore") # NUL terminated by the device
+                text_data = (f"{methods[method] if method < len(methods) else f'M{method}'} "
+                             f"{uris[uri_id] if uri_id < len(uris) else f'<uri {uri_id}>'}{'?' + query if query else ''} "
+                             f"{status} {nbytes}B {us_duration // 1000}.{us_duration % 1000:03d}ms {'.'.join(str(b) for b in ip)}")
+                text_pending = {'ts': timestamp_sec, 'rel': relative_time, 'count': count, 'text': text_data.encode()}
+                continue
+
+            elif fmt == 0 and type_data == 1: # TEXT 模式, 長訊息的後續片段 (SDLOG_FMT_TEXT__CONT), 接回上一行
+                if text_pending:
+                    text_pending['text'] += payload
+                continue
+
             elif fmt == 0: # TEXT 模式
-                text_data = payload.decode('utf-8', errors='ignore').strip()
-                log_content = f"({timestamp_sec:.6f}) http_log: {text_data}"
+                emit_text()
+                text_pending = {'ts': timestamp_sec, 'rel': relative_time, 'count': count, 'text': payload}
+                continue
 
-            # 同時印到螢幕並寫入 CSV
             if log_content:
-                # 1. Stdout
-                print(log_content)
-                
-                # 2. CSV
-                writer.writerow({
-                    'serial num': count,
-                    'epoch time': f"{timestamp_sec:.6f}",
-                    'relative time': f"{relative_time:.6f}",
-                    'stdout': log_content
-                })
+                emit_text()
+                emit(count, timestamp_sec, relative_time, log_content)
+
+        emit_text()
 
     print(f"\n解析完成！共處理 {count} 筆資料。")
 
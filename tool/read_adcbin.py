@@ -0,0 +1,50 @@
+import struct
+import sys
+
+# Loader of adc.bin (see sdlog_adcbin_header_t in main/sdlog_header.h)
+# Fixed-size blocks, one timestamp per block, the time of sample i is us_epoch_time + i * 1000000 / rate_hz
+
+HEADER_FMT = "<8sIII12x"  # magic, version, block_samples, block_size, reserved
+BLOCK_FMT = "<QII"        # us_epoch_time, seq, rate_hz, then block_samples x uint16 (channel << 12 | raw)
+
+
+def read_blocks(f):
+    f.seek(0)
+    magic, version, block_samples, block_size = struct.unpack(HEADER_FMT, f.read(32))
+    if magic != b"QQADCBIN":
+        raise ValueError("not an adc.bin file")
+
+    while True:
+        raw = f.read(block_size)
+        if len(raw) < block_size:
+            break
+        us_epoch_time, seq, rate_hz = struct.unpack_from(BLOCK_FMT, raw, 0)
+        sample = struct.unpack_from(f"<{block_samples}H", raw, 16)
+        yield us_epoch_time, seq, rate_hz, sample
+
+
+def read_channel(f, channel):
+    # (us, raw) of one channel, the frames lost by the driver show as gaps of seq
+    out = []
+    for us_epoch_time, seq, rate_hz, sample in read_blocks(f):
+        for i, s in enumerate(sample):
+            if s >> 12 == channel:
+                out.append((us_epoch_time + i * 1000000 // rate_hz, s & 0xFFF))
+    return out
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print("Usage: python read_adcbin.py <adc.bin> [channel]")
+        sys.exit(1)
+
+    with open(sys.argv[1], "rb") as f:
+        if len(sys.argv) < 3:
+            seq_next = None
+            for us_epoch_time, seq, rate_hz, sample in read_blocks(f):
+                lost = f" lost={seq - seq_next}" if seq_next is not None and seq != seq_next else ""
+                print(f"({us_epoch_time // 1000000}.{us_epoch_time % 1000000:06d}) seq={seq} rate={rate_hz}Hz{lost}")
+                seq_next = seq + 1
+        else:
+            for us, raw in read_channel(f, int(sys.argv[2])):
+                print(f"{us // 1000000}.{us % 1000000:06d},{raw}")
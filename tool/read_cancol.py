@@ -0,0 +1,54 @@
+import struct
+import sys
+
+# Loader of cancol.bin (see sdlog_cancol_header_t in main/sdlog_header.h)
+# Only the directory and the columns of the requested ID are read from the file
+
+HEADER_FMT = "<8sIIIIII"  # magic, version, id_num, frame_num, frame_drop, offset_dir, reserved
+DIR_FMT = "<IIIIII8x"     # identifier, flags, count, offset_ts, offset_data, offset_dlc
+
+
+def read_directory(f):
+    f.seek(0)
+    magic, version, id_num, frame_num, frame_drop, offset_dir, _ = struct.unpack(HEADER_FMT, f.read(32))
+    if magic != b"QQCANCOL":
+        raise ValueError("not a cancol.bin file")
+
+    f.seek(offset_dir)
+    raw = f.read(32 * id_num)
+    directory = {}
+    for i in range(id_num):
+        identifier, flags, count, off_ts, off_data, off_dlc = struct.unpack_from(DIR_FMT, raw, 32 * i)
+        directory[(identifier, flags & 1)] = (count, off_ts, off_data, off_dlc)
+    return directory
+
+
+def read_signal(f, entry):
+    count, off_ts, off_data, off_dlc = entry
+    f.seek(off_ts)
+    ts = struct.unpack(f"<{count}Q", f.read(8 * count))
+    f.seek(off_data)
+    data = f.read(8 * count)
+    f.seek(off_dlc)
+    dlc = f.read(count)
+    return [(ts[i], data[8 * i:8 * i + dlc[i]]) for i in range(count)]
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print("Usage: python read_cancol.py <cancol.bin> [id_hex]")
+        sys.exit(1)
+
+    with open(sys.argv[1], "rb") as f:
+        directory = read_directory(f)
+        if len(sys.argv) < 3:
+            for (identifier, extd), (count, *_) in sorted(directory.items()):
+                print(f"{identifier:08X}" if extd else f"{identifier:03X}", count)
+        else:
+            identifier = int(sys.argv[2], 16)
+            entry = directory.get((identifier, 0)) or directory.get((identifier, 1))
+            if entry is None:
+                print("ID not found")
+                sys.exit(1)
+            for ts, data in read_signal(f, entry):
+                print(f"({ts // 1000000}.{ts % 1000000:06d}) {data.hex(' ').upper()}")